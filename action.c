@@ -1726,6 +1726,9 @@ static rsRetVal setActionQueType(void __attribute__((unused)) * pVal, uchar *psz
     } else if (!strcasecmp((char *)pszType, "linkedlist")) {
         cs.ActionQueType = QUEUETYPE_LINKEDLIST;
         DBGPRINTF("action queue type set to LINKEDLIST\n");
+    } else if (!strcasecmp((char *)pszType, "ringbuffer")) {
+        cs.ActionQueType = QUEUETYPE_RINGBUFFER;
+        DBGPRINTF("action queue type set to RINGBUFFER\n");
     } else if (!strcasecmp((char *)pszType, "disk")) {
         cs.ActionQueType = QUEUETYPE_DISK;
         DBGPRINTF("action queue type set to DISK\n");
@@ -1771,6 +1774,7 @@ static rsRetVal ATTR_NONNULL() doSubmitToActionQ(action_t *const pAction, wti_t
     } else { /* in this case, we do single submits to the queue.
               * TODO: optimize this, we may do at least a multi-submit!
               */
+        if (runConf->globals.bFinalizeMsgBeforeFanOut && !pAction->bCopyMsg) MsgFinalize(pMsg);
         iRet = qqueueEnqMsg(pAction->pQueue, eFLOWCTL_NO_DELAY, pAction->bCopyMsg ? MsgDup(pMsg) : MsgAddRef(pMsg));
     }
     pWti->execState.bPrevWasSuspended = (iRet == RS_RET_SUSPENDED || iRet == RS_RET_ACTION_FAILED);
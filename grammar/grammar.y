@@ -170,11 +170,13 @@ stmt:	  actlst			{ $$ = $1; }
 	| IF expr THEN block 		{ $$ = cnfstmtNew(S_IF);
 					  $$->d.s_if.expr = $2;
 					  $$->d.s_if.t_then = $4;
-					  $$->d.s_if.t_else = NULL; }
+					  $$->d.s_if.t_else = NULL;
+					  $$->d.s_if.prog = NULL; }
 	| IF expr THEN block ELSE block	{ $$ = cnfstmtNew(S_IF);
 					  $$->d.s_if.expr = $2;
 					  $$->d.s_if.t_then = $4;
-					  $$->d.s_if.t_else = $6; }
+					  $$->d.s_if.t_else = $6;
+					  $$->d.s_if.prog = NULL; }
 	| FOREACH iterator_decl DO block { $$ = cnfstmtNew(S_FOREACH);
 					  $$->d.s_foreach.iter = $2;
 					  $$->d.s_foreach.body = $4;}
@@ -39,6 +39,9 @@
 
 #include "rsyslog.h"
 #include "rainerscript.h"
+#include "rscriptvm.h"
+#include "acmatch.h"
+#include "mregex.h"
 #include "conf.h"
 #include "parserif.h"
 #include "parse.h"
@@ -901,6 +904,8 @@ static int doGetQueueType(struct nvlst *valnode, struct cnfparamdescr *param, st
         val->val.d.n = QUEUETYPE_FIXED_ARRAY;
     } else if (!es_strcasebufcmp(valnode->val.d.estr, (uchar *)"linkedlist", 10)) {
         val->val.d.n = QUEUETYPE_LINKEDLIST;
+    } else if (!es_strcasebufcmp(valnode->val.d.estr, (uchar *)"ringbuffer", 10)) {
+        val->val.d.n = QUEUETYPE_RINGBUFFER;
     } else if (!es_strcasebufcmp(valnode->val.d.estr, (uchar *)"disk", 4)) {
         val->val.d.n = QUEUETYPE_DISK;
     } else if (!es_strcasebufcmp(valnode->val.d.estr, (uchar *)"direct", 6)) {
@@ -2175,6 +2180,28 @@ static void ATTR_NONNULL() doFunct_ReMatch(struct cnffunc *__restrict__ const fu
     varFreeMembers(&srcVal);
 }
 
+/* A chain of re_match()/re_match_i() calls on the same value, combined by
+ * "or". The optimizer has merged their regexes into a single automaton
+ * (funcdata), the only parameter is the value to check.
+ */
+static void ATTR_NONNULL() doFunct_ReMatchSet(struct cnffunc *__restrict__ const func,
+                                              struct svar *__restrict__ const ret,
+                                              void *__restrict__ const usrptr,
+                                              wti_t *__restrict__ const pWti) {
+    struct svar srcVal;
+    int bMustFree;
+    char *str;
+
+    cnfexprEval(func->expr[0], &srcVal, usrptr, pWti);
+    str = (char *)var2CString(&srcVal, &bMustFree);
+    ret->d.n = mregexFirst(func->funcdata, (uchar *)str, strlen(str)) >= 0;
+    ret->datatype = 'N';
+    if (bMustFree) {
+        free(str);
+    }
+    varFreeMembers(&srcVal);
+}
+
 static void ATTR_NONNULL() doFunct_Ipv42num(struct cnffunc *__restrict__ const func,
                                             struct svar *__restrict__ const ret,
                                             void *__restrict__ const usrptr,
@@ -2896,8 +2923,10 @@ static void evalVar(struct cnfvar *__restrict__ const var,
 
 /* perform a string comparision operation against a while array. Semantic is
  * that one one comparison is true, the whole construct is true.
- * TODO: we can obviously optimize this process. One idea is to
- * compile a regex, which should work faster than serial comparison.
+ * For EQ/NE, the optimizer has sorted the array, so we can use binary
+ * search. For the other operations, the optimizer usually has built a
+ * matcher that checks all array elements in a single pass. The serial
+ * comparison is only used if that could not be done.
  * Note: compiling a regex does NOT work at all. I experimented with that
  * and it was generally 5 to 10 times SLOWER than what we do here...
  */
@@ -2911,6 +2940,8 @@ static int evalStrArrayCmp(es_str_t *const estr_l, const struct cnfarray *__rest
     } else if (cmpop == CMP_NE) {
         res = bsearch(&estr_l, ar->arr, ar->nmemb, sizeof(es_str_t *), qs_arrcmp);
         r = res == NULL;
+    } else if (ar->pMatcher != NULL) {
+        r = acmatchMatch(ar->pMatcher, es_getBufAddr(estr_l), es_strlen(estr_l));
     } else {
         for (i = 0; (r == 0) && (i < ar->nmemb); ++i) {
             switch (cmpop) {
@@ -3350,6 +3381,7 @@ void cnfarrayContentDestruct(struct cnfarray *ar) {
         es_deleteStr(ar->arr[i]);
     }
     free(ar->arr);
+    acmatchDestruct(&ar->pMatcher);
 }
 
 static void regex_destruct(struct cnffunc *func) {
@@ -3705,6 +3737,9 @@ static void cnffuncDestruct(struct cnffunc *func) {
     if (foundFunc && foundFunc->destruct != NULL) {
         foundFunc->destruct(func);
     }
+    if (func->fPtr == doFunct_ReMatchSet) {
+        mregexDestruct((mregex_t **)&func->funcdata);
+    }
 
     if (func->destructable_funcdata) {
         free(func->funcdata);
@@ -3773,6 +3808,83 @@ void cnfexprDestruct(struct cnfexpr *__restrict__ const expr) {
 //---- END
 
 
+/* check if an expression calls a function that reports the outcome of
+ * the previous statement for the current message.
+ */
+static int cnfexprUsesExecState(const struct cnfexpr *const expr) {
+    const struct cnffunc *func;
+    unsigned short i;
+
+    if (expr == NULL) return 0;
+    switch (expr->nodetype) {
+        case 'N':
+        case 'S':
+        case 'A':
+        case 'V':
+        case S_FUNC_EXISTS:
+            return 0;
+        case 'F':
+            func = (const struct cnffunc *)expr;
+            if (func->fPtr == doFunct_ScriptError || func->fPtr == doFunct_PreviousActionSuspended) return 1;
+            for (i = 0; i < func->nParams; ++i) {
+                if (cnfexprUsesExecState(func->expr[i])) return 1;
+            }
+            return 0;
+        default: /* operators */
+            return cnfexprUsesExecState(expr->l) || cnfexprUsesExecState(expr->r);
+    }
+}
+
+/* check if a script depends on the per-message execution state of the
+ * worker thread (script_error(), previous_action_suspended(), actions
+ * that run only if the previous one is suspended). Such scripts must
+ * be executed message by message. Called rulesets are not checked, as
+ * calls are always executed per message.
+ */
+int cnfstmtUsesExecState(struct cnfstmt *const root) {
+    struct cnfstmt *stmt;
+
+    for (stmt = root; stmt != NULL; stmt = stmt->next) {
+        switch (stmt->nodetype) {
+            case S_ACT:
+                if (stmt->d.act->bExecWhenPrevSusp) return 1;
+                break;
+            case S_SET:
+                if (cnfexprUsesExecState(stmt->d.s_set.expr)) return 1;
+                break;
+            case S_CALL_INDIRECT:
+                if (cnfexprUsesExecState(stmt->d.s_call_ind.expr)) return 1;
+                break;
+            case S_IF:
+                if (cnfexprUsesExecState(stmt->d.s_if.expr) || cnfstmtUsesExecState(stmt->d.s_if.t_then) ||
+                    cnfstmtUsesExecState(stmt->d.s_if.t_else))
+                    return 1;
+                break;
+            case S_FOREACH:
+                if (cnfexprUsesExecState(stmt->d.s_foreach.iter->collection) ||
+                    cnfstmtUsesExecState(stmt->d.s_foreach.body))
+                    return 1;
+                break;
+            case S_PRIFILT:
+                if (cnfstmtUsesExecState(stmt->d.s_prifilt.t_then) || cnfstmtUsesExecState(stmt->d.s_prifilt.t_else))
+                    return 1;
+                break;
+            case S_PROPFILT:
+                if (cnfstmtUsesExecState(stmt->d.s_propfilt.t_then)) return 1;
+                break;
+            default:
+                break;
+        }
+    }
+    return 0;
+}
+
+/* check if a function node is a prifilt() call; used by the bytecode compiler */
+int cnffuncIsPrifilt(const struct cnffunc *const func) {
+    return func->fPtr == doFunct_Prifilt;
+}
+
+
 /* Evaluate an expression as a bool. This is added because expressions are
  * mostly used inside filters, and so this function is quite common and
  * important.
@@ -4007,6 +4119,11 @@ void cnfstmtPrintOnly(struct cnfstmt *stmt, int indent, sbool subtree) {
             doIndent(indent);
             dbgprintf("IF\n");
             cnfexprPrint(stmt->d.s_if.expr, indent + 1);
+            if (stmt->d.s_if.prog != NULL) {
+                doIndent(indent);
+                dbgprintf("COMPILED TO\n");
+                rsvmPrint(stmt->d.s_if.prog, indent + 1);
+            }
             if (subtree) {
                 doIndent(indent);
                 dbgprintf("THEN\n");
@@ -4125,6 +4242,7 @@ struct cnfarray *cnfarrayNew(es_str_t *val) {
     if ((ar = malloc(sizeof(struct cnfarray))) != NULL) {
         ar->nodetype = 'A';
         ar->nmemb = 1;
+        ar->pMatcher = NULL;
         if ((ar->arr = malloc(sizeof(es_str_t *))) == NULL) {
             free(ar);
             ar = NULL;
@@ -4212,6 +4330,7 @@ static void cnfstmtDestruct(struct cnfstmt *stmt) {
             actionDestruct(stmt->d.act);
             break;
         case S_IF:
+            rsvmDestruct(stmt->d.s_if.prog);
             cnfexprDestruct(stmt->d.s_if.expr);
             if (stmt->d.s_if.t_then != NULL) {
                 cnfstmtDestructLst(stmt->d.s_if.t_then);
@@ -4678,6 +4797,98 @@ static struct cnfexpr *cnfexprOptimize_NOT(struct cnfexpr *expr) {
     return expr;
 }
 
+/* check if func is a (successfully compiled) re_match()/re_match_i() or
+ * an already combined set of them
+ */
+static int isReMatch(const struct cnffunc *const func) {
+    return (func->fPtr == doFunct_ReMatch && func->funcdata != NULL) || func->fPtr == doFunct_ReMatchSet;
+}
+
+static int reMatchSameValue(const struct cnffunc *const a, const struct cnffunc *const b) {
+    return a->expr[0]->nodetype == 'V' && b->expr[0]->nodetype == 'V' &&
+           !strcmp(((struct cnfvar *)a->expr[0])->name, ((struct cnfvar *)b->expr[0])->name);
+}
+
+static rsRetVal reMatchAddToSet(mregex_t *const pMre, const struct cnffunc *const func) {
+    char *regex = NULL;
+    DEFiRet;
+
+    if (func->fPtr == doFunct_ReMatchSet) {
+        CHKiRet(mregexAddSet(pMre, func->funcdata));
+    } else {
+        CHKmalloc(regex = es_str2cstr(((struct cnfstringval *)func->expr[1])->estr, NULL));
+        CHKiRet(mregexAdd(pMre, regex, !es_strbufcmp(func->fname, (uchar *)"re_match_i", sizeof("re_match_i") - 1)));
+    }
+
+finalize_it:
+    free(regex);
+    RETiRet;
+}
+
+/* combine two re_match() calls (or sets) on the same value into a set.
+ * On success, l and r are destructed. Returns NULL if the regexes cannot
+ * be combined, l and r are then left untouched.
+ */
+static struct cnffunc *reMatchCombine(struct cnffunc *const l, struct cnffunc *const r) {
+    struct cnffunc *func = NULL;
+    mregex_t *pMre = NULL;
+
+    if (mregexConstruct(&pMre) != RS_RET_OK) goto done;
+    if (reMatchAddToSet(pMre, l) != RS_RET_OK || reMatchAddToSet(pMre, r) != RS_RET_OK ||
+        mregexCompile(pMre) != RS_RET_OK) {
+        DBGPRINTF("optimizer: re_match() regexes cannot be combined\n");
+        goto done;
+    }
+    if ((func = malloc(sizeof(struct cnffunc) + sizeof(struct cnfexpr *))) == NULL) goto done;
+    if ((func->fname = es_newStrFromCStr("re_match_set", sizeof("re_match_set") - 1)) == NULL) {
+        free(func);
+        func = NULL;
+        goto done;
+    }
+    func->nodetype = 'F';
+    func->nParams = 1;
+    func->fPtr = doFunct_ReMatchSet;
+    func->funcdata = pMre;
+    func->destructable_funcdata = 0;
+    pMre = NULL;
+    func->expr[0] = l->expr[0];
+    l->expr[0] = NULL;
+    DBGPRINTF("optimizer: combined re_match() calls into a set of %d regexes\n", mregexNumPatterns(func->funcdata));
+    cnfexprDestruct((struct cnfexpr *)l);
+    cnfexprDestruct((struct cnfexpr *)r);
+
+done:
+    mregexDestruct(&pMre);
+    return func;
+}
+
+/* "re_match(x, a) or re_match(x, b)" and "(y or re_match(x, a)) or re_match(x, b)"
+ * are combined, so that long chains of or-ed re_match() calls on the same
+ * value are checked in a single pass. Only directly adjacent calls are
+ * combined, so what is evaluated before and after the chain does not change.
+ */
+static struct cnfexpr *cnfexprOptimize_OR_re_match(struct cnfexpr *expr) {
+    struct cnfexpr *const left = (expr->l->nodetype == OR) ? expr->l->r : expr->l;
+    struct cnffunc *combined;
+    struct cnfexpr *ret;
+
+    if (left->nodetype != 'F' || expr->r->nodetype != 'F') return expr;
+    if (!isReMatch((struct cnffunc *)left) || !isReMatch((struct cnffunc *)expr->r) ||
+        !reMatchSameValue((struct cnffunc *)left, (struct cnffunc *)expr->r))
+        return expr;
+    if ((combined = reMatchCombine((struct cnffunc *)left, (struct cnffunc *)expr->r)) == NULL) return expr;
+
+    if (left == expr->l) {
+        ret = (struct cnfexpr *)combined;
+    } else {
+        expr->l->r = (struct cnfexpr *)combined;
+        ret = expr->l;
+    }
+    expr->l = expr->r = NULL;
+    cnfexprDestruct(expr);
+    return ret;
+}
+
 static struct cnfexpr *cnfexprOptimize_AND_OR(struct cnfexpr *expr) {
     struct cnffunc *funcl, *funcr;
 
@@ -4694,6 +4905,9 @@ static struct cnfexpr *cnfexprOptimize_AND_OR(struct cnfexpr *expr) {
             }
         }
     }
+    if (expr->nodetype == OR) {
+        expr = cnfexprOptimize_OR_re_match(expr);
+    }
     return expr;
 }
 
@@ -4707,6 +4921,53 @@ static inline void cnfexprOptimize_CMPEQ_arr(struct cnfarray *arr) {
 }
 
 
+/* build a matcher for contains/startswith/endswith comparisons against an
+ * array, so that evaluation needs only a single pass over the string,
+ * regardless of the number of array elements. If that fails, we simply
+ * keep the serial comparison.
+ */
+static void cnfexprOptimize_CMPSTR_arr(struct cnfarray *arr, const unsigned cmpop) {
+    acmatchMode_t mode;
+    int bIgnoreCase = 0;
+    int i;
+
+    if (arr->nmemb < 2 || arr->pMatcher != NULL) return;
+    switch (cmpop) {
+        case CMP_CONTAINSI:
+            bIgnoreCase = 1;
+            /* fallthrough */
+        case CMP_CONTAINS:
+            mode = ACMATCH_CONTAINS;
+            break;
+        case CMP_STARTSWITHI:
+            bIgnoreCase = 1;
+            /* fallthrough */
+        case CMP_STARTSWITH:
+            mode = ACMATCH_PREFIX;
+            break;
+        case CMP_ENDSWITH:
+            mode = ACMATCH_SUFFIX;
+            break;
+        default:
+            return;
+    }
+
+    DBGPRINTF("optimizer: building matcher for array of %d members, comparison %s\n", arr->nmemb,
+              tokenToString(cmpop));
+    if (acmatchConstruct(&arr->pMatcher, mode, bIgnoreCase) != RS_RET_OK) return;
+    for (i = 0; i < arr->nmemb; ++i) {
+        if (acmatchAddPattern(arr->pMatcher, es_getBufAddr(arr->arr[i]), es_strlen(arr->arr[i])) != RS_RET_OK)
+            goto fail;
+    }
+    if (acmatchCompile(arr->pMatcher) != RS_RET_OK) goto fail;
+    return;
+
+fail:
+    DBGPRINTF("optimizer: could not build array matcher, using serial comparison\n");
+    acmatchDestruct(&arr->pMatcher);
+}
+
+
 /* (recursively) optimize an expression */
 struct cnfexpr *cnfexprOptimize(struct cnfexpr *expr) {
     long long ln, rn;
@@ -4798,6 +5059,9 @@ struct cnfexpr *cnfexprOptimize(struct cnfexpr *expr) {
         case CMP_STARTSWITHI:
             expr->l = cnfexprOptimize(expr->l);
             expr->r = cnfexprOptimize(expr->r);
+            if (expr->r->nodetype == 'A') {
+                cnfexprOptimize_CMPSTR_arr((struct cnfarray *)expr->r, expr->nodetype);
+            }
             break;
         case AND:
         case OR:
@@ -4886,8 +5150,11 @@ static void cnfstmtOptimizeIf(struct cnfstmt *stmt) {
                 stmt->printable = (uchar *)es_str2cstr(((struct cnfstringval *)func->expr[0])->estr, NULL);
             cnfexprDestruct(expr);
             cnfstmtOptimizePRIFilt(stmt);
+            goto done;
         }
     }
+
+    if (loadConf->globals.bScriptBytecode && stmt->d.s_if.prog == NULL) stmt->d.s_if.prog = rsvmCompile(stmt->d.s_if.expr);
 done:
     return;
 }
@@ -135,6 +135,7 @@ struct cnfstmt {
             struct cnfexpr *expr;
             struct cnfstmt *t_then;
             struct cnfstmt *t_else;
+            struct rsvmProg_s *prog; /* compiled expr, NULL if tree interpreter is used */
         } s_if;
         struct {
             uchar *varname;
@@ -210,6 +211,7 @@ struct cnfarray {
     unsigned nodetype;
     int nmemb;
     es_str_t **arr;
+    struct acmatch_s *pMatcher; /* set by optimizer for contains/startswith/endswith comparisons */
 } __attribute__((aligned(8)));
 
 struct cnffparamlst {
@@ -392,6 +394,8 @@ struct cnfexpr *cnfexprNew(unsigned nodetype, struct cnfexpr *l, struct cnfexpr
 void cnfexprPrint(struct cnfexpr *expr, int indent);
 void cnfexprEval(const struct cnfexpr *const expr, struct svar *ret, void *pusr, wti_t *pWti);
 int cnfexprEvalBool(struct cnfexpr *expr, void *usrptr, wti_t *pWti);
+int cnffuncIsPrifilt(const struct cnffunc *func);
+int cnfstmtUsesExecState(struct cnfstmt *root);
 struct json_object *cnfexprEvalCollection(struct cnfexpr *const expr, void *const usrptr, wti_t *pWti);
 void cnfexprDestruct(struct cnfexpr *expr);
 struct cnfnumval *cnfnumvalNew(long long val);
@@ -0,0 +1,387 @@
+/* rscriptvm.c - bytecode compiler and interpreter for RainerScript filters
+ *
+ * Copyright 2025 Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file rscriptvm.c
+ * @brief Accumulator machine with property registers.
+ *
+ * The machine has a single accumulator holding the truth value of the
+ * last (sub)expression and up to RSVM_MAXREGS property registers. A
+ * register holds a pointer to a message property as returned by
+ * MsgGetProp() and is loaded on first use; as there are no backward
+ * jumps, each instruction executes at most once per evaluation.
+ *
+ * Boolean operators are compiled to
+ *   AND: <l> JMPF end <r> BOOL end:
+ *   OR:  <l> JMPT end <r> BOOL end:
+ *   NOT: <r> NOT
+ * which gives the same short-circuit behaviour as cnfexprEval().
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <ctype.h>
+#include <libestr.h>
+
+#include "rsyslog.h"
+#include "rainerscript.h"
+#include "rscriptvm.h"
+#include "grammar.h"
+#include "msg.h"
+#include "srUtils.h"
+#include "debug.h"
+
+#define RSVM_MAXREGS 32
+#define RSVM_NOJMP 0xffffffff
+
+enum rsvmOp {
+    RSVM_OP_END, /* stop, result is acc */
+    RSVM_OP_EVAL, /* acc = value of subtree via tree interpreter */
+    RSVM_OP_PRIFILT, /* acc = prifilt() mask matches */
+    RSVM_OP_PROPCMP, /* acc = compare property register with string constant */
+    RSVM_OP_JMPF, /* if acc is false, jump */
+    RSVM_OP_JMPT, /* if acc is true, set it to 1 and jump */
+    RSVM_OP_BOOL, /* acc = acc != 0 */
+    RSVM_OP_NOT /* acc = !acc */
+};
+
+typedef struct rsvmInstr_s {
+    uint8_t op;
+    uint8_t reg; /* property register (PROPCMP) */
+    uint16_t cmpop; /* CMP_* token (PROPCMP) */
+    uint32_t jmp; /* jump target (JMPF, JMPT) */
+    union {
+        const struct cnfexpr *expr;
+        const struct funcData_prifilt *prifilt;
+        const es_str_t *estr;
+    } d;
+} rsvmInstr_t;
+
+struct rsvmProg_s {
+    unsigned nInstr;
+    unsigned maxInstr;
+    unsigned nRegs;
+    unsigned nFused; /* instructions not handled by the tree interpreter */
+    rsvmInstr_t *instr;
+    msgPropDescr_t *regProp[RSVM_MAXREGS];
+};
+
+typedef struct rsvmReg_s {
+    uchar *pBuf; /* NULL: not yet loaded */
+    rs_size_t len;
+    unsigned short bMustBeFreed;
+} rsvmReg_t;
+
+
+/* ------------------------------ compiler ------------------------------ */
+
+/* returns the index of the new instruction or -1 if out of memory */
+static int emit(rsvmProg_t *const prog, const enum rsvmOp op) {
+    rsvmInstr_t *newInstr;
+    rsvmInstr_t *pInstr;
+
+    if (prog->nInstr == prog->maxInstr) {
+        const unsigned newMax = (prog->maxInstr == 0) ? 16 : 2 * prog->maxInstr;
+        if ((newInstr = realloc(prog->instr, newMax * sizeof(rsvmInstr_t))) == NULL) return -1;
+        prog->instr = newInstr;
+        prog->maxInstr = newMax;
+    }
+    pInstr = prog->instr + prog->nInstr;
+    memset(pInstr, 0, sizeof(rsvmInstr_t));
+    pInstr->op = op;
+    pInstr->jmp = RSVM_NOJMP;
+    return (int)prog->nInstr++;
+}
+
+/* Plain message properties do not change while a filter is evaluated,
+ * so all comparisons with them can share one register. Other properties
+ * (time-based, UUID, ...) get a private register, so they are fetched
+ * exactly as often as by the tree interpreter.
+ * Returns the register or -1 if we are out of registers.
+ */
+static int getPropReg(rsvmProg_t *const prog, msgPropDescr_t *const pProp) {
+    unsigned i;
+
+    if (pProp->id < PROP_SYS_NOW) {
+        for (i = 0; i < prog->nRegs; ++i) {
+            if (prog->regProp[i]->id == pProp->id) return (int)i;
+        }
+    }
+    if (prog->nRegs == RSVM_MAXREGS) return -1;
+    prog->regProp[prog->nRegs] = pProp;
+    return (int)prog->nRegs++;
+}
+
+/* can a comparison be done directly on the property buffer? */
+static int isFusableCmp(const struct cnfexpr *const expr) {
+    const struct cnfvar *var;
+
+    if (expr->l->nodetype != 'V' || expr->r->nodetype != 'S') return 0;
+    var = (const struct cnfvar *)expr->l;
+    /* JSON-based variables may evaluate to non-strings */
+    if (var->prop.id == PROP_CEE || var->prop.id == PROP_LOCAL_VAR || var->prop.id == PROP_GLOBAL_VAR) return 0;
+    return 1;
+}
+
+static int compileExpr(rsvmProg_t *const prog, struct cnfexpr *const expr) {
+    int i, reg;
+
+    switch (expr->nodetype) {
+        case AND:
+        case OR:
+            if (!compileExpr(prog, expr->l)) return 0;
+            if ((i = emit(prog, (expr->nodetype == AND) ? RSVM_OP_JMPF : RSVM_OP_JMPT)) < 0) return 0;
+            if (!compileExpr(prog, expr->r)) return 0;
+            if (emit(prog, RSVM_OP_BOOL) < 0) return 0;
+            prog->instr[i].jmp = prog->nInstr;
+            ++prog->nFused;
+            return 1;
+        case NOT:
+            if (!compileExpr(prog, expr->r)) return 0;
+            if (emit(prog, RSVM_OP_NOT) < 0) return 0;
+            ++prog->nFused;
+            return 1;
+        case CMP_EQ:
+        case CMP_NE:
+        case CMP_STARTSWITH:
+        case CMP_STARTSWITHI:
+        case CMP_ENDSWITH:
+        case CMP_CONTAINS:
+        case CMP_CONTAINSI:
+            if (!isFusableCmp(expr)) break;
+            if ((reg = getPropReg(prog, &((struct cnfvar *)expr->l)->prop)) < 0) break;
+            if ((i = emit(prog, RSVM_OP_PROPCMP)) < 0) return 0;
+            prog->instr[i].reg = (uint8_t)reg;
+            prog->instr[i].cmpop = (uint16_t)expr->nodetype;
+            prog->instr[i].d.estr = ((struct cnfstringval *)expr->r)->estr;
+            ++prog->nFused;
+            return 1;
+        case 'F':
+            if (!cnffuncIsPrifilt((struct cnffunc *)expr)) break;
+            if ((i = emit(prog, RSVM_OP_PRIFILT)) < 0) return 0;
+            prog->instr[i].d.prifilt = ((struct cnffunc *)expr)->funcdata;
+            ++prog->nFused;
+            return 1;
+        default:
+            break;
+    }
+
+    if ((i = emit(prog, RSVM_OP_EVAL)) < 0) return 0;
+    prog->instr[i].d.expr = expr;
+    return 1;
+}
+
+rsvmProg_t *rsvmCompile(struct cnfexpr *const expr) {
+    rsvmProg_t *prog;
+
+    if ((prog = calloc(1, sizeof(rsvmProg_t))) == NULL) return NULL;
+    if (!compileExpr(prog, expr) || emit(prog, RSVM_OP_END) < 0) {
+        rsvmDestruct(prog);
+        return NULL;
+    }
+    if (prog->nFused == 0) {
+        /* a single EVAL; the tree interpreter does the same with less overhead */
+        rsvmDestruct(prog);
+        return NULL;
+    }
+    DBGPRINTF("rscriptvm: compiled expression %p into %u instructions, %u registers\n", expr, prog->nInstr,
+              prog->nRegs);
+    return prog;
+}
+
+void rsvmDestruct(rsvmProg_t *const prog) {
+    if (prog == NULL) return;
+    free(prog->instr);
+    free(prog);
+}
+
+
+/* ---------------------------- interpreter ----------------------------- */
+
+/* The comparisons below must yield the same truth value as the es_str*()
+ * based ones in cnfexprEval().
+ */
+static int ATTR_NONNULL() bufStartsWithI(const uchar *const buf, const uchar *const pat, const size_t len) {
+    size_t i;
+    for (i = 0; i < len; ++i) {
+        if (tolower(buf[i]) != tolower(pat[i])) return 0;
+    }
+    return 1;
+}
+
+static int ATTR_NONNULL()
+    bufContains(const uchar *const buf, const size_t len, const uchar *const pat, const size_t lenPat, const int bCase) {
+    size_t i;
+
+    if (lenPat == 0) return 1;
+    if (lenPat > len) return 0;
+    for (i = 0; i <= len - lenPat; ++i) {
+        if (bCase) {
+            if (buf[i] == pat[0] && !memcmp(buf + i, pat, lenPat)) return 1;
+        } else {
+            if (bufStartsWithI(buf + i, pat, lenPat)) return 1;
+        }
+    }
+    return 0;
+}
+
+static int ATTR_NONNULL() propCmp(const rsvmInstr_t *const ip, const rsvmReg_t *const reg) {
+    const size_t len = (size_t)reg->len;
+    const size_t lenPat = es_strlen(ip->d.estr);
+    const uchar *const pat = es_getBufAddr((es_str_t *)ip->d.estr);
+
+    switch (ip->cmpop) {
+        case CMP_EQ:
+            return len == lenPat && !memcmp(reg->pBuf, pat, len);
+        case CMP_NE:
+            return !(len == lenPat && !memcmp(reg->pBuf, pat, len));
+        case CMP_STARTSWITH:
+            return len >= lenPat && !memcmp(reg->pBuf, pat, lenPat);
+        case CMP_STARTSWITHI:
+            return len >= lenPat && bufStartsWithI(reg->pBuf, pat, lenPat);
+        case CMP_ENDSWITH:
+            return len >= lenPat && !memcmp(reg->pBuf + len - lenPat, pat, lenPat);
+        case CMP_CONTAINS:
+            return bufContains(reg->pBuf, len, pat, lenPat, 1);
+        case CMP_CONTAINSI:
+            return bufContains(reg->pBuf, len, pat, lenPat, 0);
+        default:
+            assert(0); /* cannot happen, compiler only emits the above */
+            return 0;
+    }
+}
+
+static void ATTR_NONNULL() loadReg(const rsvmProg_t *const prog, rsvmReg_t *const reg, const unsigned iReg,
+                                   smsg_t *const pMsg) {
+    reg->pBuf = MsgGetProp(pMsg, NULL, prog->regProp[iReg], &reg->len, &reg->bMustBeFreed, NULL);
+    if (reg->pBuf == NULL) {
+        reg->pBuf = (uchar *)"";
+        reg->len = 0;
+        reg->bMustBeFreed = 0;
+    }
+}
+
+int rsvmExecBool(const rsvmProg_t *const prog, void *const usrptr, wti_t *const pWti) {
+    rsvmReg_t regs[RSVM_MAXREGS];
+    const rsvmInstr_t *ip = prog->instr;
+    struct svar v;
+    long long acc = 0;
+    int convok;
+    unsigned i;
+
+    for (i = 0; i < prog->nRegs; ++i) regs[i].pBuf = NULL;
+
+    for (;;) {
+        switch (ip->op) {
+            case RSVM_OP_EVAL:
+                cnfexprEval(ip->d.expr, &v, usrptr, pWti);
+                acc = var2Number(&v, &convok);
+                varFreeMembers(&v);
+                break;
+            case RSVM_OP_PRIFILT: {
+                const smsg_t *const pMsg = (smsg_t *)usrptr;
+                const uchar mask = ip->d.prifilt->pmask[pMsg->iFacility];
+                acc = (mask != TABLE_NOPRI) && (mask & (1 << pMsg->iSeverity));
+            } break;
+            case RSVM_OP_PROPCMP:
+                if (regs[ip->reg].pBuf == NULL) loadReg(prog, &regs[ip->reg], ip->reg, (smsg_t *)usrptr);
+                acc = propCmp(ip, &regs[ip->reg]);
+                break;
+            case RSVM_OP_JMPF:
+                if (!acc) {
+                    ip = prog->instr + ip->jmp;
+                    continue;
+                }
+                break;
+            case RSVM_OP_JMPT:
+                if (acc) {
+                    acc = 1;
+                    ip = prog->instr + ip->jmp;
+                    continue;
+                }
+                break;
+            case RSVM_OP_BOOL:
+                acc = (acc != 0);
+                break;
+            case RSVM_OP_NOT:
+                acc = !acc;
+                break;
+            case RSVM_OP_END:
+            default:
+                goto done;
+        }
+        ++ip;
+    }
+
+done:
+    for (i = 0; i < prog->nRegs; ++i) {
+        if (regs[i].pBuf != NULL && regs[i].bMustBeFreed) free(regs[i].pBuf);
+    }
+    return (int)acc;
+}
+
+
+static const char *opName(const uint8_t op) {
+    switch (op) {
+        case RSVM_OP_END:
+            return "END";
+        case RSVM_OP_EVAL:
+            return "EVAL";
+        case RSVM_OP_PRIFILT:
+            return "PRIFILT";
+        case RSVM_OP_PROPCMP:
+            return "PROPCMP";
+        case RSVM_OP_JMPF:
+            return "JMPF";
+        case RSVM_OP_JMPT:
+            return "JMPT";
+        case RSVM_OP_BOOL:
+            return "BOOL";
+        case RSVM_OP_NOT:
+            return "NOT";
+        default:
+            return "INVALID";
+    }
+}
+
+void rsvmPrint(const rsvmProg_t *const prog, const int indent) {
+    const rsvmInstr_t *ip;
+    char *cstr;
+    unsigned i;
+
+    for (i = 0; i < prog->nInstr; ++i) {
+        ip = prog->instr + i;
+        dbgprintf("%*s%3u: %s", indent * 2, "", i, opName(ip->op));
+        if (ip->op == RSVM_OP_JMPF || ip->op == RSVM_OP_JMPT) {
+            dbgprintf(" %u\n", ip->jmp);
+        } else if (ip->op == RSVM_OP_PROPCMP) {
+            cstr = es_str2cstr((es_str_t *)ip->d.estr, NULL);
+            dbgprintf(" r%u(prop %d) op %u '%s'\n", ip->reg, prog->regProp[ip->reg]->id, ip->cmpop,
+                      (cstr == NULL) ? "" : cstr);
+            free(cstr);
+        } else if (ip->op == RSVM_OP_EVAL) {
+            dbgprintf(" %p\n", ip->d.expr);
+        } else {
+            dbgprintf("\n");
+        }
+    }
+}
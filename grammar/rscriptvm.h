@@ -0,0 +1,61 @@
+/* Definitions for the RainerScript filter bytecode.
+ *
+ * Copyright 2025 Rainer Gerhards and Adiscon GmbH.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file rscriptvm.h
+ * @brief Flat bytecode for the expressions of script filters ("if ... then").
+ *
+ * After the optimizer has run, the expression of an if statement can be
+ * compiled into a linear instruction array. The program is executed by a
+ * simple dispatch loop instead of the recursive cnfexprEval(). Boolean
+ * operators become conditional jumps, comparisons of a message property
+ * with a string constant are fused into a single instruction that works
+ * on the property buffer directly (no es_str_t copy), and every plain
+ * message property is fetched at most once per evaluation via a property
+ * register. Anything the bytecode does not know is evaluated by calling
+ * into the tree interpreter for that subtree, so the result is always
+ * the same as the one of cnfexprEvalBool().
+ */
+#ifndef INCLUDED_RSCRIPTVM_H
+#define INCLUDED_RSCRIPTVM_H
+
+#include "rainerscript.h"
+
+typedef struct rsvmProg_s rsvmProg_t;
+
+/**
+ * @brief Compile a (optimized) filter expression.
+ *
+ * The expression tree must stay alive as long as the program, as the
+ * program references constants and subtrees of it.
+ * @return the program or NULL if the expression cannot be compiled
+ *         (then the tree interpreter is to be used)
+ */
+rsvmProg_t *rsvmCompile(struct cnfexpr *expr);
+
+/** @brief Destruct a program. NULL is permitted. */
+void rsvmDestruct(rsvmProg_t *prog);
+
+/** @brief Evaluate the program for a message; same result as cnfexprEvalBool(). */
+int rsvmExecBool(const rsvmProg_t *prog, void *usrptr, wti_t *pWti);
+
+/** @brief Debug-print the program. */
+void rsvmPrint(const rsvmProg_t *prog, int indent);
+
+#endif /* #ifndef INCLUDED_RSCRIPTVM_H */
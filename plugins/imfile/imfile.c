@@ -38,6 +38,9 @@
 #include <poll.h>
 #include <json.h>
 #include <fnmatch.h>
+#ifdef HAVE_SYS_PRCTL_H
+    #include <sys/prctl.h>
+#endif
 #ifdef HAVE_SYS_INOTIFY_H
     #include <sys/inotify.h>
     #include <linux/types.h>
@@ -149,6 +152,7 @@ struct instanceConf_s {
     uchar *pszBindRuleset;
     int nMultiSub;
     per_minute_rate_limit_t perMinuteRateLimits;
+    pthread_mutex_t mutRateLimits; /* files of this instance may be read by different reader threads */
     int iPersistStateInterval;
     int bPersistStateAfterSubmission;
     int iFacility;
@@ -210,6 +214,10 @@ struct act_obj_s {
     multi_submit_t multiSub;
     int is_symlink;
     time_t time_to_delete; /* Helper variable to DELAY the actual file delete in act_obj_unlink */
+    /* reader pool state, protected by rdrPool.mut */
+    int rdrState; /* RDR_IDLE, RDR_QUEUED or RDR_BUSY */
+    sbool rdrRepoll; /* new data was signaled while a reader was busy with the file */
+    act_obj_t *rdrNext; /* next object in reader queue */
 };
 struct fs_edge_s {
     fs_node_t *parent; /* node pointing to this edge */
@@ -231,12 +239,15 @@ struct fs_node_s {
 /* forward definitions */
 static rsRetVal persistStrmState(act_obj_t *);
 static rsRetVal resetConfigVariables(uchar __attribute__((unused)) * pp, void __attribute__((unused)) * pVal);
-static rsRetVal ATTR_NONNULL(1) pollFile(act_obj_t *act);
+static rsRetVal ATTR_NONNULL(1, 2) pollFile(act_obj_t *act, sbool *pbHadData);
 static int ATTR_NONNULL() getBasename(uchar *const __restrict__ basen, uchar *const __restrict__ path);
 static void ATTR_NONNULL() act_obj_unlink(act_obj_t *act);
 static uchar *ATTR_NONNULL(1, 2) getStateFileName(const act_obj_t *, uchar *, const size_t);
 static int ATTR_NONNULL()
     getFullStateFileName(const uchar *const, const char *const, uchar *const pszout, const size_t ilenout);
+static void ATTR_NONNULL() rdrSubmit(act_obj_t *const act);
+static void ATTR_NONNULL() rdrQuiesce(act_obj_t *const act);
+static int ATTR_NONNULL() rdrIsIdle(act_obj_t *const act);
 
 
 #define OPMODE_POLLING 0
@@ -258,11 +269,13 @@ struct modConfData_s {
     sbool sortFiles;
     sbool normalizePath; /* normalize file system pathes (all start with root dir) */
     sbool haveReadTimeouts; /* use special processing if read timeouts exist */
+    int nReaders; /* number of reader threads, 0: files are read by the input thread */
     sbool bHadFileData; /* actually a global variable:
                    1 - last call to pollFile() had data
                    0 - last call to pollFile() had NO data
                    Must be manually reset to 0 if desired. Helper for
-                   polling mode.
+                   polling mode. Only written by the input thread, the
+                   reader pool reports via rdrPool.bHadData.
                  */
 };
 static modConfData_t *loadModConf = NULL; /* modConf ptr to use for the current load process */
@@ -302,6 +315,29 @@ static int glport; /* Static port handle for FEN api*/
 static prop_t *pInputName = NULL;
 /* there is only one global inputName for all messages generated by this input */
 
+/* reader pool. If configured, files are read by these threads while the
+ * input thread keeps handling notifications and the file tree. The input
+ * thread only hands files with new data to the pool. A file is read by at
+ * most one reader at a time, so the order of its lines and its state file
+ * stay consistent. Before the input thread accesses a file's stream itself
+ * (e.g. to close it), it takes the file back via rdrQuiesce().
+ */
+#define RDR_IDLE 0
+#define RDR_QUEUED 1
+#define RDR_BUSY 2
+static struct {
+    pthread_mutex_t mut;
+    pthread_cond_t wakeup; /* work available or pool shutdown */
+    pthread_cond_t done; /* a reader finished reading a file */
+    act_obj_t *head; /* queue of files with new data */
+    act_obj_t *tail;
+    int nBusy; /* number of files currently being read */
+    sbool bHadData; /* a reader read data since the last rdrWaitIdle() */
+    sbool bStop;
+    int nThreads; /* 0 if there is no pool */
+    pthread_t *tids;
+} rdrPool;
+
 /* module-global parameters */
 static struct cnfparamdescr modpdescr[] = {
     {"pollinginterval", eCmdHdlrPositiveInt, 0},
@@ -312,6 +348,7 @@ static struct cnfparamdescr modpdescr[] = {
     {"normalizepath", eCmdHdlrBinary, 0},
     {"mode", eCmdHdlrGetWord, 0},
     {"deletestateonfilemove", eCmdHdlrBinary, 0},
+    {"readerthreads", eCmdHdlrNonNegInt, 0},
 };
 static struct cnfparamblk modpblk = {CNFPARAMBLK_VERSION, sizeof(modpdescr) / sizeof(struct cnfparamdescr), modpdescr};
 
@@ -738,7 +775,6 @@ static rsRetVal ATTR_NONNULL(1, 2) act_obj_add(fs_edge_t *const edge,
         CHKmalloc(act->multiSub.ppMsgs = malloc(inst->nMultiSub * sizeof(smsg_t *)));
         act->multiSub.maxElem = inst->nMultiSub;
         act->multiSub.nElem = 0;
-        pollFile(act);
     }
 
     /* all well, add to active list */
@@ -747,6 +783,9 @@ static rsRetVal ATTR_NONNULL(1, 2) act_obj_add(fs_edge_t *const edge,
     }
     act->next = edge->active;
     edge->active = act;
+    if (is_file && !is_symlink) {
+        rdrSubmit(act);
+    }
 finalize_it:
     if (iRet != RS_RET_OK) {
         if (act != NULL) {
@@ -810,7 +849,7 @@ static void detect_updates(fs_edge_t *const edge) {
                         "detect_updates obj gone away, keep '%s' "
                         "open: %" PRId64 "/%" PRId64 "/%" PRId64 "s!\n",
                         act->name, (int64_t)act->time_to_delete, (int64_t)ttNow, (int64_t)ttNow - act->time_to_delete);
-                    pollFile(act);
+                    rdrSubmit(act);
                 }
             }
             break;
@@ -843,7 +882,7 @@ static void ATTR_NONNULL() poll_active_files(fs_edge_t *const edge) {
     for (act = edge->active; act != NULL; act = act->next) {
         fen_setupWatch(act);
         DBGPRINTF("poll_active_files: polling '%s'\n", act->name);
-        pollFile(act);
+        rdrSubmit(act);
     }
 }
 
@@ -947,9 +986,10 @@ static void ATTR_NONNULL() poll_timeouts(fs_edge_t *const edge) {
     if (edge->is_file) {
         act_obj_t *act;
         for (act = edge->active; act != NULL; act = act->next) {
-            if (act->pStrm && strmReadMultiLine_isTimedOut(act->pStrm)) {
+            /* a file being read has no timeout, and we must not access its stream */
+            if (rdrIsIdle(act) && act->pStrm && strmReadMultiLine_isTimedOut(act->pStrm)) {
                 DBGPRINTF("timeout occurred on %s\n", act->name);
-                pollFile(act);
+                rdrSubmit(act);
             }
         }
     }
@@ -965,6 +1005,7 @@ static void act_obj_destroy(act_obj_t *const act, const int is_deleted) {
 
     if (act == NULL) return;
 
+    rdrQuiesce(act);
     DBGPRINTF("act_obj_destroy: act %p '%s' (source '%s'), wd %d, pStrm %p, is_deleted %d, in_move %d\n", act,
               act->name, act->source_name ? act->source_name : "---", act->wd, act->pStrm, is_deleted, act->in_move);
     if (act->is_symlink && is_deleted) {
@@ -980,7 +1021,7 @@ static void act_obj_destroy(act_obj_t *const act, const int is_deleted) {
     }
     if (act->pStrm != NULL) {
         const instanceConf_t *const inst = act->edge->instarr[0];  // TODO: same file, multiple instances?
-        pollFile(act); /* get any left-over data */
+        pollFile(act, &runModConf->bHadFileData); /* get any left-over data */
         if (inst->bRMStateOnDel) {
             statefn = getStateFileName(act, statefile, sizeof(statefile));
             getFullStateFileName(statefn, act->file_id, toDel, sizeof(toDel));  // TODO: check!
@@ -1327,6 +1368,7 @@ static rsRetVal ATTR_NONNULL(1, 2)
     const uchar *metadata_names[2] = {(uchar *)"filename", (uchar *)"fileoffset"};
     const uchar *metadata_values[2];
     const size_t msgLen = cstrLen(cstrLine);
+    rsRetVal localRet;
 
     if (msgLen == 0) {
         /* we do not process empty lines */
@@ -1365,7 +1407,10 @@ static rsRetVal ATTR_NONNULL(1, 2)
     }
 
     if (inst->perMinuteRateLimits.maxBytesPerMinute || inst->perMinuteRateLimits.maxLinesPerMinute) {
-        CHKiRet(checkPerMinuteRateLimits((per_minute_rate_limit_t *)&inst->perMinuteRateLimits, msgLen));
+        pthread_mutex_lock((pthread_mutex_t *)&inst->mutRateLimits);
+        localRet = checkPerMinuteRateLimits((per_minute_rate_limit_t *)&inst->perMinuteRateLimits, msgLen);
+        pthread_mutex_unlock((pthread_mutex_t *)&inst->mutRateLimits);
+        CHKiRet(localRet);
     }
 
     if (inst->delay_perMsg) {
@@ -1552,7 +1597,7 @@ static void pollFileCancelCleanup(void *pArg) {
 
 
 /* pollFile needs to be split due to the unfortunate pthread_cancel_push() macros. */
-static rsRetVal ATTR_NONNULL() pollFileReal(act_obj_t *act, cstr_t **pCStr) {
+static rsRetVal ATTR_NONNULL() pollFileReal(act_obj_t *act, cstr_t **pCStr, sbool *const pbHadData) {
     int64 strtOffs;
     DEFiRet;
     int64_t startOffs = 0;
@@ -1589,7 +1634,7 @@ static rsRetVal ATTR_NONNULL() pollFileReal(act_obj_t *act, cstr_t **pCStr) {
             persistStrmState(act);
             startOffs = act->pStrm->iCurrOffs; /* disable check */
         }
-        runModConf->bHadFileData = 1; /* this is just a flag, so set it and forget it */
+        *pbHadData = 1; /* this is just a flag, so set it and forget it */
         CHKiRet(enqLine(act, *pCStr, strtOffs)); /* process line */
         rsCStrDestruct(pCStr); /* discard string (must be done by us!) */
         if (inst->iPersistStateInterval > 0 && ++act->nRecords >= inst->iPersistStateInterval) {
@@ -1611,8 +1656,10 @@ finalize_it:
     RETiRet;
 }
 
-/* poll a file, need to check file rollover etc. open file if not open */
-static rsRetVal ATTR_NONNULL(1) pollFile(act_obj_t *const act) {
+/* poll a file, need to check file rollover etc. open file if not open.
+ * *pbHadData is set to 1 if data was read and left unchanged otherwise.
+ */
+static rsRetVal ATTR_NONNULL(1, 2) pollFile(act_obj_t *const act, sbool *const pbHadData) {
     cstr_t *pCStr = NULL;
     DEFiRet;
     if (act->is_symlink) {
@@ -1622,13 +1669,203 @@ static rsRetVal ATTR_NONNULL(1) pollFile(act_obj_t *const act) {
      * otherwise do not work if I include the _cleanup_pop() inside an if... -- rgerhards, 2008-08-14
      */
     pthread_cleanup_push(pollFileCancelCleanup, &pCStr);
-    iRet = pollFileReal(act, &pCStr);
+    iRet = pollFileReal(act, &pCStr, pbHadData);
     pthread_cleanup_pop(0);
 finalize_it:
     RETiRet;
 }
 
 
+/* append a file to the reader queue, rdrPool.mut must be locked */
+static void ATTR_NONNULL() rdrEnqueue(act_obj_t *const act) {
+    act->rdrNext = NULL;
+    if (rdrPool.tail == NULL) {
+        rdrPool.head = act;
+    } else {
+        rdrPool.tail->rdrNext = act;
+    }
+    rdrPool.tail = act;
+    act->rdrState = RDR_QUEUED;
+}
+
+static void *rdrWorker(void *arg) {
+    act_obj_t *act;
+    sbool bHadData;
+    uchar thrdName[32];
+
+    snprintf((char *)thrdName, sizeof(thrdName), "imfile/r%d", (int)(intptr_t)arg);
+#if defined(HAVE_PRCTL) && defined(PR_SET_NAME)
+    /* set thread name - we ignore if the call fails, has no harsh consequences... */
+    if (prctl(PR_SET_NAME, thrdName, 0, 0, 0) != 0) {
+        DBGPRINTF("prctl failed, not setting thread name for '%s'\n", thrdName);
+    }
+#endif
+
+    pthread_mutex_lock(&rdrPool.mut);
+    while (1) {
+        while (rdrPool.head == NULL && !rdrPool.bStop) {
+            pthread_cond_wait(&rdrPool.wakeup, &rdrPool.mut);
+        }
+        if (rdrPool.bStop) break;
+        act = rdrPool.head;
+        rdrPool.head = act->rdrNext;
+        if (rdrPool.head == NULL) rdrPool.tail = NULL;
+        act->rdrNext = NULL;
+        act->rdrState = RDR_BUSY;
+        ++rdrPool.nBusy;
+        pthread_mutex_unlock(&rdrPool.mut);
+
+        bHadData = 0;
+        pollFile(act, &bHadData);
+
+        pthread_mutex_lock(&rdrPool.mut);
+        --rdrPool.nBusy;
+        if (bHadData) rdrPool.bHadData = 1;
+        if (act->rdrRepoll) {
+            /* more data arrived while we were reading, other files go first */
+            act->rdrRepoll = 0;
+            rdrEnqueue(act);
+        } else {
+            act->rdrState = RDR_IDLE;
+        }
+        pthread_cond_broadcast(&rdrPool.done);
+    }
+    pthread_mutex_unlock(&rdrPool.mut);
+    return NULL;
+}
+
+static void rdrPoolStart(void) {
+    int i;
+
+    if (runModConf->nReaders == 0) return;
+    pthread_mutex_init(&rdrPool.mut, NULL);
+    pthread_cond_init(&rdrPool.wakeup, NULL);
+    pthread_cond_init(&rdrPool.done, NULL);
+    rdrPool.head = rdrPool.tail = NULL;
+    rdrPool.nBusy = 0;
+    rdrPool.bHadData = 0;
+    rdrPool.bStop = 0;
+    rdrPool.nThreads = 0;
+    if ((rdrPool.tids = calloc(runModConf->nReaders, sizeof(pthread_t))) == NULL) {
+        LogError(errno, RS_RET_OUT_OF_MEMORY, "imfile: cannot create reader pool, files are read by input thread");
+        return;
+    }
+    for (i = 0; i < runModConf->nReaders; ++i) {
+        if (pthread_create(&rdrPool.tids[i], NULL, rdrWorker, (void *)(intptr_t)i) != 0) {
+            LogError(errno, RS_RET_ERR, "imfile: could only create %d of %d reader threads", i,
+                     runModConf->nReaders);
+            break;
+        }
+    }
+    rdrPool.nThreads = i;
+    DBGPRINTF("imfile: reader pool started with %d threads\n", rdrPool.nThreads);
+}
+
+/* stop the reader pool and wait for readers to finish the files they are
+ * currently reading. Queued files are not read anymore; their data is read
+ * when they are destroyed.
+ */
+static void rdrPoolStop(void) {
+    act_obj_t *act;
+    int i;
+
+    if (rdrPool.tids == NULL) return;
+    pthread_mutex_lock(&rdrPool.mut);
+    rdrPool.bStop = 1;
+    pthread_cond_broadcast(&rdrPool.wakeup);
+    pthread_mutex_unlock(&rdrPool.mut);
+    for (i = 0; i < rdrPool.nThreads; ++i) {
+        pthread_join(rdrPool.tids[i], NULL);
+    }
+    for (act = rdrPool.head; act != NULL; act = act->rdrNext) {
+        act->rdrState = RDR_IDLE;
+        act->rdrRepoll = 0;
+    }
+    rdrPool.head = rdrPool.tail = NULL;
+    rdrPool.nThreads = 0;
+    free(rdrPool.tids);
+    rdrPool.tids = NULL;
+    pthread_cond_destroy(&rdrPool.done);
+    pthread_cond_destroy(&rdrPool.wakeup);
+    pthread_mutex_destroy(&rdrPool.mut);
+}
+
+/* read a file with new data: hand it to the reader pool or, without pool,
+ * read it right away. Called by the input thread only.
+ */
+static void ATTR_NONNULL() rdrSubmit(act_obj_t *const act) {
+    if (rdrPool.nThreads == 0) {
+        pollFile(act, &runModConf->bHadFileData);
+        return;
+    }
+    pthread_mutex_lock(&rdrPool.mut);
+    if (act->rdrState == RDR_IDLE) {
+        rdrEnqueue(act);
+        pthread_cond_signal(&rdrPool.wakeup);
+    } else if (act->rdrState == RDR_BUSY) {
+        act->rdrRepoll = 1;
+    } /* else already queued, nothing to do */
+    pthread_mutex_unlock(&rdrPool.mut);
+}
+
+/* take a file back from the reader pool: remove it from the queue and wait
+ * until no reader works on it. Afterwards, the input thread may access the
+ * file's stream until it hands the file to the pool again.
+ */
+static void ATTR_NONNULL() rdrQuiesce(act_obj_t *const act) {
+    act_obj_t *prev;
+
+    if (rdrPool.nThreads == 0) return;
+    pthread_mutex_lock(&rdrPool.mut);
+    act->rdrRepoll = 0;
+    while (act->rdrState != RDR_IDLE) {
+        if (act->rdrState == RDR_QUEUED) {
+            if (rdrPool.head == act) {
+                rdrPool.head = act->rdrNext;
+                prev = NULL;
+            } else {
+                for (prev = rdrPool.head; prev->rdrNext != act; prev = prev->rdrNext)
+                    ;
+                prev->rdrNext = act->rdrNext;
+            }
+            if (rdrPool.tail == act) rdrPool.tail = prev;
+            act->rdrNext = NULL;
+            act->rdrState = RDR_IDLE;
+        } else {
+            pthread_cond_wait(&rdrPool.done, &rdrPool.mut);
+        }
+    }
+    pthread_mutex_unlock(&rdrPool.mut);
+}
+
+/* check if the input thread may access a file's stream right now */
+static int ATTR_NONNULL() rdrIsIdle(act_obj_t *const act) {
+    int r;
+
+    if (rdrPool.nThreads == 0) return 1;
+    pthread_mutex_lock(&rdrPool.mut);
+    r = (act->rdrState == RDR_IDLE);
+    pthread_mutex_unlock(&rdrPool.mut);
+    return r;
+}
+
+/* wait until the reader pool has read all files handed to it. If the
+ * readers read any data meanwhile, bHadFileData is set.
+ */
+static void rdrWaitIdle(void) {
+    if (rdrPool.nThreads == 0) return;
+    pthread_mutex_lock(&rdrPool.mut);
+    while (rdrPool.head != NULL || rdrPool.nBusy > 0) {
+        pthread_cond_wait(&rdrPool.done, &rdrPool.mut);
+    }
+    if (rdrPool.bHadData) {
+        runModConf->bHadFileData = 1;
+        rdrPool.bHadData = 0;
+    }
+    pthread_mutex_unlock(&rdrPool.mut);
+}
+
+
 /* create input instance, set default parameters, and
  * add it to the list of instances.
  */
@@ -1654,6 +1891,7 @@ static rsRetVal ATTR_NONNULL(1) createInstance(instanceConf_t **const pinst) {
     inst->perMinuteRateLimits.rateLimitingMinute = 0;
     inst->perMinuteRateLimits.linesThisMinute = 0;
     inst->perMinuteRateLimits.bytesThisMinute = 0;
+    pthread_mutex_init(&inst->mutRateLimits, NULL);
     inst->bPersistStateAfterSubmission = 0;
     inst->readMode = 0;
     inst->startRegex = NULL;
@@ -1981,6 +2219,7 @@ BEGINbeginCnfLoad
     loadModConf->readTimeout = 0; /* default: no timeout */
     loadModConf->timeoutGranularity = 1000; /* default: 1 second */
     loadModConf->haveReadTimeouts = 0; /* default: no timeout */
+    loadModConf->nReaders = 0;
     loadModConf->normalizePath = 1;
     loadModConf->sortFiles = GLOB_NOSORT;
     loadModConf->stateFileDirectory = NULL;
@@ -2043,6 +2282,8 @@ BEGINsetModCnf
             loadModConf->stateFileDirectory = (uchar *)es_str2cstr(pvals[i].val.d.estr, NULL);
         } else if (!strcmp(modpblk.descr[i].name, "normalizepath")) {
             loadModConf->normalizePath = (sbool)pvals[i].val.d.n;
+        } else if (!strcmp(modpblk.descr[i].name, "readerthreads")) {
+            loadModConf->nReaders = (int)pvals[i].val.d.n;
         } else if (!strcmp(modpblk.descr[i].name, "mode")) {
             if (!es_strconstcmp(pvals[i].val.d.estr, "polling"))
                 loadModConf->opMode = OPMODE_POLLING;
@@ -2185,6 +2426,7 @@ BEGINfreeCnf
             regfree(&inst->end_preg);
             free(inst->endRegex);
         }
+        pthread_mutex_destroy(&inst->mutRateLimits);
         del = inst;
         inst = inst->next;
         free(del);
@@ -2222,6 +2464,7 @@ static rsRetVal doPolling(void) {
         do {
             runModConf->bHadFileData = 0;
             fs_node_walk(runModConf->conf_tree, poll_tree);
+            rdrWaitIdle();
             DBGPRINTF("doPolling: end poll walk, hadData %d\n", runModConf->bHadFileData);
         } while (runModConf->bHadFileData); /* warning: do...while()! */
 
@@ -2289,7 +2532,7 @@ static void ATTR_NONNULL(1) in_dbg_showEv(const struct inotify_event *ev) {
 static void ATTR_NONNULL(1, 2) in_handleFileEvent(struct inotify_event *ev, const wd_map_t *const etry) {
     if (ev->mask & IN_MODIFY) {
         DBGPRINTF("fs_node_notify_file_update: act->name '%s'\n", etry->act->name);
-        pollFile(etry->act);
+        rdrSubmit(etry->act);
     } else {
         DBGPRINTF("got non-expected inotify event:\n");
         in_dbg_showEv(ev);
@@ -2536,7 +2779,7 @@ static rsRetVal do_fen(void) {
             fen_setupWatch(act);
 
             if (act->edge->is_file) {
-                pollFile(act);
+                pollFile(act, &runModConf->bHadFileData);
             } else {
                 fs_node_walk(act->edge->node, poll_tree);
             }
@@ -2575,6 +2818,11 @@ BEGINrunInput
     DBGPRINTF("working in %s mode\n", (runModConf->opMode == OPMODE_POLLING)
                                           ? "polling"
                                           : ((runModConf->opMode == OPMODE_INOTIFY) ? "inotify" : "fen"));
+    if (runModConf->opMode == OPMODE_FEN && runModConf->nReaders > 0) {
+        LogMsg(0, RS_RET_OK_WARN, LOG_WARNING, "imfile: readerThreads is not supported in fen mode - ignored");
+    } else {
+        rdrPoolStart();
+    }
     if (runModConf->opMode == OPMODE_POLLING)
         iRet = doPolling();
     else if (runModConf->opMode == OPMODE_INOTIFY)
@@ -2583,8 +2831,10 @@ BEGINrunInput
         iRet = do_fen();
     else {
         LogError(0, RS_RET_NOT_IMPLEMENTED, "imfile: unknown mode %d set", runModConf->opMode);
+        rdrPoolStop();
         return RS_RET_NOT_IMPLEMENTED;
     }
+    rdrPoolStop();
     DBGPRINTF("terminating upon request of rsyslog core\n");
 ENDrunInput
 
@@ -0,0 +1,266 @@
+/* Multi-pattern string matcher (Aho-Corasick and tries).
+ *
+ * Copyright 2025 Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file acmatch.c
+ * @brief Dense automaton over byte classes.
+ *
+ * Only the bytes that occur in patterns get an own class, all others
+ * share class 0. The transition table is states x classes, so its size
+ * depends on the pattern alphabet, not on 256. For case-insensitive
+ * matchers, the class map already folds case, so the scan loop does not
+ * need to call tolower().
+ *
+ * State 0 is the dead state, state 1 the root. In prefix and suffix mode
+ * the table is the plain trie and a transition into state 0 ends the walk.
+ * In contains mode, missing transitions are filled in from the failure
+ * links, which gives a DFA that never enters state 0.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+
+#include "rsyslog.h"
+#include "acmatch.h"
+
+#define ACM_DEAD 0
+#define ACM_ROOT 1
+
+typedef struct acmatchPat_s {
+    uchar *pat;
+    size_t len;
+} acmatchPat_t;
+
+struct acmatch_s {
+    acmatchMode_t mode;
+    int bIgnoreCase;
+    int bAlways; /* an empty pattern matches everything */
+    /* patterns, only needed until compiled */
+    acmatchPat_t *pats;
+    int nPats;
+    int maxPats;
+    /* the automaton */
+    uint16_t cls[256]; /* byte -> class */
+    unsigned nClasses;
+    unsigned nStates;
+    uint32_t *delta; /* nStates x nClasses transitions */
+    uint8_t *final; /* a pattern ends in (or, for contains, before) this state */
+};
+
+
+rsRetVal acmatchConstruct(acmatch_t **const ppThis, const acmatchMode_t mode, const int bIgnoreCase) {
+    acmatch_t *pThis;
+    DEFiRet;
+
+    CHKmalloc(pThis = calloc(1, sizeof(acmatch_t)));
+    pThis->mode = mode;
+    pThis->bIgnoreCase = bIgnoreCase;
+    *ppThis = pThis;
+
+finalize_it:
+    RETiRet;
+}
+
+
+rsRetVal acmatchAddPattern(acmatch_t *const pThis, const uchar *const pat, const size_t lenPat) {
+    acmatchPat_t *newPats;
+    uchar *copy;
+    size_t i;
+    DEFiRet;
+
+    if (lenPat == 0) {
+        pThis->bAlways = 1;
+        FINALIZE;
+    }
+    if (pThis->nPats == pThis->maxPats) {
+        const int newMax = (pThis->maxPats == 0) ? 16 : 2 * pThis->maxPats;
+        CHKmalloc(newPats = realloc(pThis->pats, newMax * sizeof(acmatchPat_t)));
+        pThis->pats = newPats;
+        pThis->maxPats = newMax;
+    }
+    CHKmalloc(copy = malloc(lenPat));
+    for (i = 0; i < lenPat; ++i) {
+        /* suffix patterns are stored reversed, the subject is walked from the end */
+        const uchar c = (pThis->mode == ACMATCH_SUFFIX) ? pat[lenPat - 1 - i] : pat[i];
+        copy[i] = pThis->bIgnoreCase ? (uchar)tolower(c) : c;
+    }
+    pThis->pats[pThis->nPats].pat = copy;
+    pThis->pats[pThis->nPats].len = lenPat;
+    ++pThis->nPats;
+
+finalize_it:
+    RETiRet;
+}
+
+
+/* assign classes to all bytes that occur in patterns */
+static void buildClasses(acmatch_t *const pThis) {
+    int i, c;
+    size_t j;
+
+    memset(pThis->cls, 0, sizeof(pThis->cls));
+    pThis->nClasses = 1;
+    for (i = 0; i < pThis->nPats; ++i) {
+        for (j = 0; j < pThis->pats[i].len; ++j) {
+            if (pThis->cls[pThis->pats[i].pat[j]] == 0) pThis->cls[pThis->pats[i].pat[j]] = (uint16_t)pThis->nClasses++;
+        }
+    }
+    if (pThis->bIgnoreCase) {
+        for (c = 0; c < 256; ++c) pThis->cls[c] = pThis->cls[tolower(c)];
+    }
+}
+
+
+/* fill in missing transitions from the failure links (contains mode) */
+static rsRetVal buildFailureLinks(acmatch_t *const pThis) {
+    const unsigned nCls = pThis->nClasses;
+    uint32_t *fail = NULL;
+    uint32_t *queue = NULL;
+    unsigned head = 0, tail = 0;
+    unsigned c;
+    uint32_t s, t;
+    DEFiRet;
+
+    CHKmalloc(fail = calloc(pThis->nStates, sizeof(uint32_t)));
+    CHKmalloc(queue = malloc(pThis->nStates * sizeof(uint32_t)));
+
+    for (c = 0; c < nCls; ++c) {
+        t = pThis->delta[ACM_ROOT * nCls + c];
+        if (t == ACM_DEAD) {
+            pThis->delta[ACM_ROOT * nCls + c] = ACM_ROOT;
+        } else {
+            fail[t] = ACM_ROOT;
+            queue[tail++] = t;
+        }
+    }
+    while (head < tail) {
+        s = queue[head++];
+        for (c = 0; c < nCls; ++c) {
+            t = pThis->delta[s * nCls + c];
+            if (t == ACM_DEAD) {
+                pThis->delta[s * nCls + c] = pThis->delta[fail[s] * nCls + c];
+            } else {
+                fail[t] = pThis->delta[fail[s] * nCls + c];
+                pThis->final[t] |= pThis->final[fail[t]];
+                queue[tail++] = t;
+            }
+        }
+    }
+
+finalize_it:
+    free(queue);
+    free(fail);
+    RETiRet;
+}
+
+
+rsRetVal acmatchCompile(acmatch_t *const pThis) {
+    size_t maxStates;
+    uint32_t s;
+    unsigned nCls;
+    int i;
+    size_t j;
+    DEFiRet;
+
+    buildClasses(pThis);
+    nCls = pThis->nClasses;
+    for (maxStates = 2, i = 0; i < pThis->nPats; ++i) maxStates += pThis->pats[i].len;
+
+    CHKmalloc(pThis->delta = calloc(maxStates * nCls, sizeof(uint32_t)));
+    CHKmalloc(pThis->final = calloc(maxStates, sizeof(uint8_t)));
+    pThis->nStates = 2;
+
+    for (i = 0; i < pThis->nPats; ++i) {
+        s = ACM_ROOT;
+        for (j = 0; j < pThis->pats[i].len; ++j) {
+            uint32_t *const pNext = &pThis->delta[s * nCls + pThis->cls[pThis->pats[i].pat[j]]];
+            if (*pNext == ACM_DEAD) *pNext = pThis->nStates++;
+            s = *pNext;
+        }
+        pThis->final[s] = 1;
+    }
+
+    if (pThis->mode == ACMATCH_CONTAINS) CHKiRet(buildFailureLinks(pThis));
+
+    /* the patterns are no longer needed */
+    for (i = 0; i < pThis->nPats; ++i) free(pThis->pats[i].pat);
+    free(pThis->pats);
+    pThis->pats = NULL;
+    pThis->nPats = pThis->maxPats = 0;
+
+    DBGPRINTF("acmatch: compiled automaton with %u states, %u byte classes\n", pThis->nStates, nCls);
+
+finalize_it:
+    RETiRet;
+}
+
+
+int acmatchMatch(const acmatch_t *const pThis, const uchar *const buf, const size_t len) {
+    const uint32_t *const delta = pThis->delta;
+    const uint8_t *const final = pThis->final;
+    const unsigned nCls = pThis->nClasses;
+    uint32_t s = ACM_ROOT;
+    size_t i;
+
+    if (pThis->bAlways) return 1;
+
+    switch (pThis->mode) {
+        case ACMATCH_CONTAINS:
+            for (i = 0; i < len; ++i) {
+                s = delta[s * nCls + pThis->cls[buf[i]]];
+                if (final[s]) return 1;
+            }
+            break;
+        case ACMATCH_PREFIX:
+            for (i = 0; i < len; ++i) {
+                s = delta[s * nCls + pThis->cls[buf[i]]];
+                if (s == ACM_DEAD) return 0;
+                if (final[s]) return 1;
+            }
+            break;
+        case ACMATCH_SUFFIX:
+            for (i = len; i > 0; --i) {
+                s = delta[s * nCls + pThis->cls[buf[i - 1]]];
+                if (s == ACM_DEAD) return 0;
+                if (final[s]) return 1;
+            }
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+
+
+void acmatchDestruct(acmatch_t **const ppThis) {
+    acmatch_t *const pThis = *ppThis;
+    int i;
+
+    if (pThis == NULL) return;
+    for (i = 0; i < pThis->nPats; ++i) free(pThis->pats[i].pat);
+    free(pThis->pats);
+    free(pThis->delta);
+    free(pThis->final);
+    free(pThis);
+    *ppThis = NULL;
+}
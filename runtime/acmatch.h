@@ -0,0 +1,64 @@
+/* Definitions for the multi-pattern string matcher.
+ *
+ * Copyright 2025 Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file acmatch.h
+ * @brief Check a string against a set of constant patterns in one pass.
+ *
+ * The matcher is built once (usually at config load) from a set of
+ * patterns and then answers "does any pattern match" for a subject
+ * string in time linear to the subject, independent of the number of
+ * patterns. Depending on the mode, a pattern matches if the subject
+ * contains it (Aho-Corasick automaton), starts with it or ends with it
+ * (trie walk from the front or back). Case-insensitive matchers fold
+ * with tolower(), just like the es_str*case*() functions.
+ *
+ * A compiled matcher is read-only and may be used by many threads
+ * concurrently.
+ */
+#ifndef INCLUDED_ACMATCH_H
+#define INCLUDED_ACMATCH_H
+
+#include <stddef.h>
+
+typedef enum acmatchMode { ACMATCH_CONTAINS, ACMATCH_PREFIX, ACMATCH_SUFFIX } acmatchMode_t;
+
+typedef struct acmatch_s acmatch_t;
+
+/** @brief Create an empty matcher. */
+rsRetVal acmatchConstruct(acmatch_t **ppThis, acmatchMode_t mode, int bIgnoreCase);
+
+/** @brief Add a pattern; only permitted before acmatchCompile(). The pattern is copied. */
+rsRetVal acmatchAddPattern(acmatch_t *pThis, const uchar *pat, size_t lenPat);
+
+/**
+ * @brief Build the automaton.
+ * @return RS_RET_OK or RS_RET_OUT_OF_MEMORY; in the latter case the matcher
+ *         must be destructed, it cannot be used.
+ */
+rsRetVal acmatchCompile(acmatch_t *pThis);
+
+/** @brief Returns 1 if any pattern matches the subject, 0 otherwise. */
+int acmatchMatch(const acmatch_t *pThis, const uchar *buf, size_t len);
+
+void acmatchDestruct(acmatch_t **ppThis);
+
+#endif /* #ifndef INCLUDED_ACMATCH_H */
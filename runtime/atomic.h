@@ -42,6 +42,7 @@
     #define ATOMIC_SUB(data, val, phlpmut) __sync_fetch_and_sub(data, val)
     #define ATOMIC_SUB_unsigned(data, val, phlpmut) __sync_fetch_and_sub(data, val)
     #define ATOMIC_ADD(data, val) __sync_fetch_and_add(&(data), val)
+    #define ATOMIC_ADD_int(data, val, phlpmut) ((void)__sync_fetch_and_add(data, val))
     #define ATOMIC_INC(data, phlpmut) ((void)__sync_fetch_and_add(data, 1))
     #define ATOMIC_INC_AND_FETCH_int(data, phlpmut) __sync_fetch_and_add(data, 1)
     #define ATOMIC_INC_AND_FETCH_unsigned(data, phlpmut) __sync_fetch_and_add(data, 1)
@@ -203,6 +204,12 @@ static inline void ATOMIC_SUB_unsigned(unsigned *data, int val, pthread_mutex_t
     (*data) -= val;
     pthread_mutex_unlock(phlpmut);
 }
+
+static inline void ATOMIC_ADD_int(int *data, int val, pthread_mutex_t *phlpmut) {
+    pthread_mutex_lock(phlpmut);
+    (*data) += val;
+    pthread_mutex_unlock(phlpmut);
+}
     #define DEF_ATOMIC_HELPER_MUT(x) pthread_mutex_t x;
     #define INIT_ATOMIC_HELPER_MUT(x) pthread_mutex_init(&(x), NULL);
     #define DESTROY_ATOMIC_HELPER_MUT(x) pthread_mutex_destroy(&(x));
@@ -68,6 +68,7 @@ struct batch_s {
     int nElem; /* actual number of element in this entry */
     int nElemDeq; /* actual number of elements dequeued (and thus to be deleted) - see comment above! */
     qDeqID deqID; /* ID of dequeue operation that generated this batch */
+    void *pDrainPiece; /* disk queue drain ledger entry this batch was read from (queue.parallelDrain only) */
     batch_obj_t *pElem; /* batch elements */
     batch_state_t *eltState; /* state (array!) for individual objects.
                     NOTE: we have moved this out of batch_obj_t because we
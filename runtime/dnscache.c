@@ -34,6 +34,8 @@
 #include <netdb.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <errno.h>
+#include <time.h>
 
 #include "syslogd-types.h"
 #include "glbl.h"
@@ -45,6 +47,9 @@
 #include "prop.h"
 #include "dnscache.h"
 #include "rsconf.h"
+#include "srUtils.h"
+#include "statsobj.h"
+#include "atomic.h"
 
 /* module data structures */
 struct dnscache_entry_s {
@@ -53,23 +58,76 @@ struct dnscache_entry_s {
     prop_t *fqdnLowerCase;
     prop_t *localName; /* only local name, without domain part (if configured so) */
     prop_t *ip;
-    time_t validUntil;
-    struct dnscache_entry_s *next;
+    time_t validUntil; /* 0: entry never expires */
+    unsigned clockSlot; /* index into the shard's clock array */
+    int bReferenced; /* CLOCK reference bit, set on cache hits */
     unsigned nUsed;
+    uint8_t bPending; /* placeholder (IP only) until the resolver pool has resolved the address */
 };
 typedef struct dnscache_entry_s dnscache_entry_t;
-struct dnscache_s {
+
+/* The cache is split into shards, selected by the address hash, each with
+ * its own lock, so that lookups for different addresses do not contend for
+ * a single lock. If the cache size is limited, each shard evicts entries
+ * via the CLOCK algorithm: entries are kept in an array that a "hand" walks
+ * over; an entry that was hit since the hand passed it last gets a second
+ * chance, otherwise it is evicted.
+ */
+#define DNSCACHE_SHARD_BITS 4
+#define DNSCACHE_NSHARDS (1 << DNSCACHE_SHARD_BITS)
+struct dnscache_shard_s {
     pthread_rwlock_t rwlock;
     struct hashtable *ht;
+    dnscache_entry_t **clock; /* all entries of the shard, without holes */
     unsigned nEntries;
+    unsigned clockSize; /* allocated size of clock */
+    unsigned hand;
+};
+typedef struct dnscache_shard_s dnscache_shard_t;
+struct dnscache_s {
+    dnscache_shard_t shards[DNSCACHE_NSHARDS];
 };
 typedef struct dnscache_s dnscache_t;
 
+/* In async mode (reverselookup.async.resolvers > 0), a cache miss inserts a
+ * placeholder entry that carries only the IP address and queues the address
+ * for the resolver pool. The message proceeds with the IP (optionally after
+ * waiting a bounded time), and the resolver replaces the placeholder once the
+ * name is known. So a slow PTR lookup never blocks the cache lock.
+ */
+#define DNSCACHE_ASYNC_QUEUE_SIZE 1024
+#define DNSCACHE_PENDING_TTL 10 /* seconds until a placeholder is queued again */
+typedef struct dnscache_async_s {
+    pthread_mutex_t mut; /* protects all members; may be acquired while holding a shard rwlock, not vice versa */
+    pthread_cond_t condWork; /* request queued or shutdown */
+    pthread_cond_t condDone; /* a request was completed */
+    struct sockaddr_storage queue[DNSCACHE_ASYNC_QUEUE_SIZE]; /* ring buffer */
+    unsigned head;
+    unsigned nQueued;
+    uint64_t nDone; /* completed requests, lets waiters detect progress */
+    pthread_t *thrds;
+    int nThrds;
+    int bShutdown;
+} dnscache_async_t;
+
 
 /* static data */
 DEFobjStaticHelpers;
-DEFobjCurrIf(glbl) DEFobjCurrIf(prop) static dnscache_t dnsCache;
+DEFobjCurrIf(glbl) DEFobjCurrIf(prop) DEFobjCurrIf(statsobj) static dnscache_t dnsCache;
+static dnscache_async_t dnsAsync;
 static prop_t *staticErrValue;
+DEF_ATOMIC_HELPER_MUT(mutReferenced)
+static statsobj_t *stats;
+STATSCOUNTER_DEF(ctrHits, mutCtrHits)
+STATSCOUNTER_DEF(ctrMisses, mutCtrMisses)
+STATSCOUNTER_DEF(ctrExpired, mutCtrExpired)
+STATSCOUNTER_DEF(ctrEvicted, mutCtrEvicted)
+STATSCOUNTER_DEF(ctrResolved, mutCtrResolved)
+STATSCOUNTER_DEF(ctrFailed, mutCtrFailed)
+STATSCOUNTER_DEF(ctrResolveTime, mutCtrResolveTime)
+STATSCOUNTER_DEF(ctrQueued, mutCtrQueued)
+STATSCOUNTER_DEF(ctrQueueFull, mutCtrQueueFull)
+STATSCOUNTER_DEF(ctrWaitTimeout, mutCtrWaitTimeout)
 
 
 /* Our hash function.
@@ -141,33 +199,109 @@ static void ATTR_NONNULL() entryDestruct(dnscache_entry_t *const etry) {
 
 /* init function (must be called once) */
 rsRetVal dnscacheInit(void) {
+    int i;
     DEFiRet;
-    if ((dnsCache.ht = create_hashtable(100, hash_from_key_fn, key_equals_fn, (void (*)(void *))entryDestruct)) ==
-        NULL) {
-        DBGPRINTF("dnscache: error creating hash table!\n");
-        ABORT_FINALIZE(RS_RET_ERR);  // TODO: make this degrade, but run!
+    for (i = 0; i < DNSCACHE_NSHARDS; ++i) {
+        dnscache_shard_t *const shard = &dnsCache.shards[i];
+        if ((shard->ht = create_hashtable(16, hash_from_key_fn, key_equals_fn, (void (*)(void *))entryDestruct)) ==
+            NULL) {
+            DBGPRINTF("dnscache: error creating hash table!\n");
+            ABORT_FINALIZE(RS_RET_ERR);  // TODO: make this degrade, but run!
+        }
+        shard->clock = NULL;
+        shard->nEntries = 0;
+        shard->clockSize = 0;
+        shard->hand = 0;
+        pthread_rwlock_init(&shard->rwlock, NULL);
     }
-    dnsCache.nEntries = 0;
-    pthread_rwlock_init(&dnsCache.rwlock, NULL);
+    INIT_ATOMIC_HELPER_MUT(mutReferenced);
     CHKiRet(objGetObjInterface(&obj)); /* this provides the root pointer for all other queries */
     CHKiRet(objUse(glbl, CORE_COMPONENT));
     CHKiRet(objUse(prop, CORE_COMPONENT));
+    CHKiRet(objUse(statsobj, CORE_COMPONENT));
 
     prop.Construct(&staticErrValue);
     prop.SetString(staticErrValue, (uchar *)"???", 3);
     prop.ConstructFinalize(staticErrValue);
+
+    pthread_mutex_init(&dnsAsync.mut, NULL);
+    pthread_cond_init(&dnsAsync.condWork, NULL);
+    pthread_cond_init(&dnsAsync.condDone, NULL);
+
+    CHKiRet(statsobj.Construct(&stats));
+    CHKiRet(statsobj.SetName(stats, (uchar *)"dnscache"));
+    CHKiRet(statsobj.SetOrigin(stats, (uchar *)"core.dnscache"));
+    STATSCOUNTER_INIT(ctrHits, mutCtrHits);
+    CHKiRet(statsobj.AddCounter(stats, UCHAR_CONSTANT("hits"), ctrType_IntCtr, CTR_FLAG_RESETTABLE, &ctrHits));
+    STATSCOUNTER_INIT(ctrMisses, mutCtrMisses);
+    CHKiRet(statsobj.AddCounter(stats, UCHAR_CONSTANT("misses"), ctrType_IntCtr, CTR_FLAG_RESETTABLE, &ctrMisses));
+    STATSCOUNTER_INIT(ctrExpired, mutCtrExpired);
+    CHKiRet(statsobj.AddCounter(stats, UCHAR_CONSTANT("expired"), ctrType_IntCtr, CTR_FLAG_RESETTABLE, &ctrExpired));
+    STATSCOUNTER_INIT(ctrEvicted, mutCtrEvicted);
+    CHKiRet(statsobj.AddCounter(stats, UCHAR_CONSTANT("evicted"), ctrType_IntCtr, CTR_FLAG_RESETTABLE, &ctrEvicted));
+    STATSCOUNTER_INIT(ctrResolved, mutCtrResolved);
+    CHKiRet(
+        statsobj.AddCounter(stats, UCHAR_CONSTANT("resolved"), ctrType_IntCtr, CTR_FLAG_RESETTABLE, &ctrResolved));
+    STATSCOUNTER_INIT(ctrFailed, mutCtrFailed);
+    CHKiRet(statsobj.AddCounter(stats, UCHAR_CONSTANT("failed"), ctrType_IntCtr, CTR_FLAG_RESETTABLE, &ctrFailed));
+    STATSCOUNTER_INIT(ctrResolveTime, mutCtrResolveTime);
+    CHKiRet(statsobj.AddCounter(stats, UCHAR_CONSTANT("resolve.time.us"), ctrType_IntCtr, CTR_FLAG_RESETTABLE,
+                                &ctrResolveTime));
+    STATSCOUNTER_INIT(ctrQueued, mutCtrQueued);
+    CHKiRet(
+        statsobj.AddCounter(stats, UCHAR_CONSTANT("async.queued"), ctrType_IntCtr, CTR_FLAG_RESETTABLE, &ctrQueued));
+    STATSCOUNTER_INIT(ctrQueueFull, mutCtrQueueFull);
+    CHKiRet(statsobj.AddCounter(stats, UCHAR_CONSTANT("async.queuefull"), ctrType_IntCtr, CTR_FLAG_RESETTABLE,
+                                &ctrQueueFull));
+    STATSCOUNTER_INIT(ctrWaitTimeout, mutCtrWaitTimeout);
+    CHKiRet(statsobj.AddCounter(stats, UCHAR_CONSTANT("async.waittimeout"), ctrType_IntCtr, CTR_FLAG_RESETTABLE,
+                                &ctrWaitTimeout));
+    CHKiRet(statsobj.ConstructFinalize(stats));
 finalize_it:
     RETiRet;
 }
 
+
+/* stop the resolver pool. Must be called while the config is still valid,
+ * because the resolvers use it. Afterwards, lookups are done synchronously.
+ * Shutdown may need to wait for lookups that are currently in progress.
+ */
+void dnscacheStopResolvers(void) {
+    int i;
+
+    pthread_mutex_lock(&dnsAsync.mut);
+    dnsAsync.bShutdown = 1;
+    pthread_cond_broadcast(&dnsAsync.condWork);
+    pthread_mutex_unlock(&dnsAsync.mut);
+    for (i = 0; i < dnsAsync.nThrds; ++i) {
+        pthread_join(dnsAsync.thrds[i], NULL);
+    }
+    free(dnsAsync.thrds);
+    dnsAsync.thrds = NULL;
+    dnsAsync.nThrds = 0;
+    dnsAsync.nQueued = 0;
+}
+
 /* deinit function (must be called once) */
 rsRetVal dnscacheDeinit(void) {
+    int i;
     DEFiRet;
+    dnscacheStopResolvers();
+    pthread_cond_destroy(&dnsAsync.condDone);
+    pthread_cond_destroy(&dnsAsync.condWork);
+    pthread_mutex_destroy(&dnsAsync.mut);
+    if (stats != NULL) statsobj.Destruct(&stats);
     prop.Destruct(&staticErrValue);
-    hashtable_destroy(dnsCache.ht, 1); /* 1 => free all values automatically */
-    pthread_rwlock_destroy(&dnsCache.rwlock);
+    for (i = 0; i < DNSCACHE_NSHARDS; ++i) {
+        dnscache_shard_t *const shard = &dnsCache.shards[i];
+        hashtable_destroy(shard->ht, 1); /* 1 => free all values automatically */
+        free(shard->clock);
+        pthread_rwlock_destroy(&shard->rwlock);
+    }
+    DESTROY_ATOMIC_HELPER_MUT(mutReferenced);
     objRelease(glbl, CORE_COMPONENT);
     objRelease(prop, CORE_COMPONENT);
+    objRelease(statsobj, CORE_COMPONENT);
     RETiRet;
 }
 
@@ -332,73 +466,396 @@ finalize_it:
 }
 
 
-static rsRetVal ATTR_NONNULL() addEntry(struct sockaddr_storage *const addr, dnscache_entry_t **const pEtry) {
-    int r;
-    dnscache_entry_t *etry = NULL;
-    DEFiRet;
+/* compute when a freshly resolved entry expires, 0 means never. Failed
+ * lookups may use a shorter (negative) TTL. The optional jitter spreads the
+ * expiry of entries that were created at the same time, e.g. after startup,
+ * so that they are not all re-queried at once.
+ */
+static time_t entryExpiry(const int bNegative) {
+    long ttl;
+    const int jitter = runConf->globals.dnscacheTTLJitter;
+
+    if (bNegative && runConf->globals.dnscacheNegativeTTL >= 0) {
+        ttl = runConf->globals.dnscacheNegativeTTL;
+    } else if (runConf->globals.dnscacheEnableTTL) {
+        ttl = runConf->globals.dnscacheDefaultTTL;
+    } else {
+        return 0;
+    }
+    if (jitter > 0 && ttl > 0) {
+        ttl -= randomNumber() % (ttl * jitter / 100 + 1);
+    }
+    return time(NULL) + ttl;
+}
 
-    /* entry still does not exist, so add it */
-    struct sockaddr_storage *const keybuf = malloc(sizeof(struct sockaddr_storage));
-    CHKmalloc(keybuf);
-    CHKmalloc(etry = malloc(sizeof(dnscache_entry_t)));
+
+static int ATTR_NONNULL() entryExpired(const dnscache_entry_t *const etry) {
+    return etry->validUntil != 0 && etry->validUntil <= time(NULL);
+}
+
+
+/* resolve an address into a new cache entry and set its expiry. This is
+ * where the time goes, so in async mode it is called without any lock.
+ */
+static void ATTR_NONNULL() resolveEntry(struct sockaddr_storage *const addr, dnscache_entry_t *const etry) {
+    struct timespec tStart, tEnd;
+    const int bDisableDNS = glbl.GetDisableDNS(runConf);
+    int bNegative;
+
+    clock_gettime(CLOCK_MONOTONIC, &tStart);
     resolveAddr(addr, etry);
-    assert(etry != NULL);
+    clock_gettime(CLOCK_MONOTONIC, &tEnd);
     memcpy(&etry->addr, addr, SALEN((struct sockaddr *)addr));
     etry->nUsed = 0;
-    if (runConf->globals.dnscacheEnableTTL) {
-        etry->validUntil = time(NULL) + runConf->globals.dnscacheDefaultTTL;
+    etry->bPending = 0;
+    bNegative = !bDisableDNS && etry->fqdn == etry->ip;
+    if (!bDisableDNS) {
+        STATSCOUNTER_ADD(ctrResolveTime, mutCtrResolveTime,
+                         (tEnd.tv_sec - tStart.tv_sec) * 1000000 + (tEnd.tv_nsec - tStart.tv_nsec) / 1000);
+        if (bNegative) {
+            STATSCOUNTER_INC(ctrFailed, mutCtrFailed);
+        } else {
+            STATSCOUNTER_INC(ctrResolved, mutCtrResolved);
+        }
     }
+    etry->validUntil = entryExpiry(bNegative);
+}
 
-    memcpy(keybuf, addr, sizeof(struct sockaddr_storage));
 
-    r = hashtable_insert(dnsCache.ht, keybuf, etry);
-    if (r == 0) {
+static dnscache_shard_t *ATTR_NONNULL() getShard(struct sockaddr_storage *const addr) {
+    /* the hashtable uses the low bits of the hash, so use the high ones after mixing */
+    const unsigned h = hash_from_key_fn(addr) * 2654435761u;
+    return &dnsCache.shards[h >> (32 - DNSCACHE_SHARD_BITS)];
+}
+
+
+/* unlink an entry from its shard and destruct it; must be called with the
+ * write lock held. The last entry of the clock array takes its place.
+ */
+static void ATTR_NONNULL() removeEntry(dnscache_shard_t *const shard, dnscache_entry_t *const etry) {
+    const unsigned slot = etry->clockSlot;
+    dnscache_entry_t *const deleted = hashtable_remove(shard->ht, &etry->addr);
+
+    if (deleted != etry) {
+        LogError(0, RS_RET_INTERNAL_ERROR,
+                 "dnscache %d: removed different "
+                 "hashtable entry than expected - please report issue; "
+                 "rsyslog version is %s",
+                 __LINE__, VERSION);
+    }
+    --shard->nEntries;
+    shard->clock[slot] = shard->clock[shard->nEntries];
+    shard->clock[slot]->clockSlot = slot;
+    if (shard->hand >= shard->nEntries) shard->hand = 0;
+    entryDestruct(etry);
+}
+
+
+/* evict the least recently used entry (as far as CLOCK can tell) */
+static void ATTR_NONNULL() clockEvict(dnscache_shard_t *const shard) {
+    dnscache_entry_t *etry;
+
+    while (1) {
+        etry = shard->clock[shard->hand];
+        if (!etry->bReferenced) break;
+        etry->bReferenced = 0;
+        shard->hand = (shard->hand + 1) % shard->nEntries;
+    }
+    DBGPRINTF("dnscache: cache full, evicting entry %p\n", etry);
+    removeEntry(shard, etry);
+    STATSCOUNTER_INC(ctrEvicted, mutCtrEvicted);
+}
+
+
+/* insert an entry into the cache, evicting another one if the shard is
+ * full; must be called with the write lock held.
+ */
+static rsRetVal ATTR_NONNULL() insertEntry(dnscache_shard_t *const shard,
+                                           struct sockaddr_storage *const addr,
+                                           dnscache_entry_t *const etry) {
+    const int maxSize = runConf->globals.dnscacheMaxSize;
+    const unsigned maxEntries = (maxSize + DNSCACHE_NSHARDS - 1) / DNSCACHE_NSHARDS;
+    struct sockaddr_storage *keybuf = NULL;
+    dnscache_entry_t **newClock;
+    unsigned newSize;
+    DEFiRet;
+
+    if (maxSize > 0 && shard->nEntries >= maxEntries) {
+        clockEvict(shard);
+    } else if (shard->nEntries == shard->clockSize) {
+        newSize = (shard->clockSize == 0) ? 16 : 2 * shard->clockSize;
+        if (maxSize > 0 && newSize > maxEntries) newSize = maxEntries;
+        CHKmalloc(newClock = realloc(shard->clock, newSize * sizeof(dnscache_entry_t *)));
+        shard->clock = newClock;
+        shard->clockSize = newSize;
+    }
+
+    CHKmalloc(keybuf = malloc(sizeof(struct sockaddr_storage)));
+    memcpy(keybuf, addr, sizeof(struct sockaddr_storage));
+    if (hashtable_insert(shard->ht, keybuf, etry) == 0) {
         DBGPRINTF("dnscache: inserting element failed\n");
+        ABORT_FINALIZE(RS_RET_OUT_OF_MEMORY);
     }
+    keybuf = NULL; /* now owned by the hashtable */
+    etry->clockSlot = shard->nEntries;
+    shard->clock[shard->nEntries++] = etry;
+
+finalize_it:
+    free(keybuf);
+    RETiRet;
+}
+
+
+static rsRetVal ATTR_NONNULL() addEntry(dnscache_shard_t *const shard,
+                                        struct sockaddr_storage *const addr,
+                                        dnscache_entry_t **const pEtry) {
+    dnscache_entry_t *etry = NULL;
+    DEFiRet;
+
+    /* entry still does not exist, so add it */
+    CHKmalloc(etry = calloc(1, sizeof(dnscache_entry_t)));
+    resolveEntry(addr, etry);
+    CHKiRet(insertEntry(shard, addr, etry));
     *pEtry = etry;
 
 finalize_it:
-    if (iRet != RS_RET_OK) {
-        free(keybuf);
+    if (iRet != RS_RET_OK && etry != NULL) {
+        entryDestruct(etry);
     }
     RETiRet;
 }
 
 
+/* resolver pool thread: resolve queued addresses and replace the
+ * placeholder entries with the result.
+ */
+static void *asyncResolver(void __attribute__((unused)) * arg) {
+    struct sockaddr_storage addr;
+    dnscache_shard_t *shard;
+    dnscache_entry_t *etry, *old;
+    sigset_t sigSet;
+
+    sigfillset(&sigSet);
+    pthread_sigmask(SIG_BLOCK, &sigSet, NULL);
+
+    pthread_mutex_lock(&dnsAsync.mut);
+    while (1) {
+        while (dnsAsync.nQueued == 0 && !dnsAsync.bShutdown) {
+            pthread_cond_wait(&dnsAsync.condWork, &dnsAsync.mut);
+        }
+        if (dnsAsync.bShutdown) break;
+        memcpy(&addr, &dnsAsync.queue[dnsAsync.head], sizeof(addr));
+        dnsAsync.head = (dnsAsync.head + 1) % DNSCACHE_ASYNC_QUEUE_SIZE;
+        --dnsAsync.nQueued;
+        pthread_mutex_unlock(&dnsAsync.mut);
+
+        if ((etry = calloc(1, sizeof(dnscache_entry_t))) != NULL) {
+            resolveEntry(&addr, etry);
+            shard = getShard(&addr);
+            pthread_rwlock_wrlock(&shard->rwlock);
+            if ((old = hashtable_search(shard->ht, &addr)) != NULL) {
+                removeEntry(shard, old);
+            }
+            if (insertEntry(shard, &addr, etry) != RS_RET_OK) {
+                entryDestruct(etry);
+            }
+            pthread_rwlock_unlock(&shard->rwlock);
+        }
+
+        pthread_mutex_lock(&dnsAsync.mut);
+        ++dnsAsync.nDone;
+        pthread_cond_broadcast(&dnsAsync.condDone);
+    }
+    pthread_mutex_unlock(&dnsAsync.mut);
+    return NULL;
+}
+
+
+/* queue an address for the resolver pool, which is started on first use.
+ * Returns 1 if the address was queued, 0 if the queue is full and -1 if the
+ * pool is not available (shut down or could not be started).
+ */
+static int ATTR_NONNULL() asyncEnqueue(struct sockaddr_storage *const addr) {
+    const int nResolvers = runConf->globals.dnscacheAsyncResolvers;
+    int bQueued = -1;
+    int i;
+
+    pthread_mutex_lock(&dnsAsync.mut);
+    if (dnsAsync.bShutdown) goto done;
+    if (dnsAsync.thrds == NULL) {
+        if ((dnsAsync.thrds = calloc(nResolvers, sizeof(pthread_t))) == NULL) goto done;
+        for (i = 0; i < nResolvers; ++i) {
+            if (pthread_create(&dnsAsync.thrds[dnsAsync.nThrds], NULL, asyncResolver, NULL) == 0) {
+                ++dnsAsync.nThrds;
+            }
+        }
+        DBGPRINTF("dnscache: started %d resolver threads\n", dnsAsync.nThrds);
+    }
+    if (dnsAsync.nThrds == 0) goto done;
+    if (dnsAsync.nQueued == DNSCACHE_ASYNC_QUEUE_SIZE) {
+        STATSCOUNTER_INC(ctrQueueFull, mutCtrQueueFull);
+        bQueued = 0;
+        goto done;
+    }
+    memcpy(&dnsAsync.queue[(dnsAsync.head + dnsAsync.nQueued) % DNSCACHE_ASYNC_QUEUE_SIZE], addr,
+           sizeof(struct sockaddr_storage));
+    ++dnsAsync.nQueued;
+    pthread_cond_signal(&dnsAsync.condWork);
+    STATSCOUNTER_INC(ctrQueued, mutCtrQueued);
+    bQueued = 1;
+
+done:
+    pthread_mutex_unlock(&dnsAsync.mut);
+    return bQueued;
+}
+
+
+/* add a placeholder entry that carries only the IP address and queue the
+ * address for the resolver pool. If the pool is not available (e.g. during
+ * shutdown) or its queue is full, the address is resolved right away, as
+ * nobody would replace the placeholder before it expires. Must be called
+ * with the write lock held.
+ */
+static rsRetVal ATTR_NONNULL() addPendingEntry(dnscache_shard_t *const shard,
+                                               struct sockaddr_storage *const addr,
+                                               dnscache_entry_t **const pEtry) {
+    dnscache_entry_t *etry = NULL;
+    char szIP[80]; /* large enough for IPv6 */
+    DEFiRet;
+
+    if (asyncEnqueue(addr) <= 0) {
+        CHKiRet(addEntry(shard, addr, pEtry));
+        FINALIZE;
+    }
+
+    CHKmalloc(etry = calloc(1, sizeof(dnscache_entry_t)));
+    if (mygetnameinfo((struct sockaddr *)addr, SALEN((struct sockaddr *)addr), szIP, sizeof(szIP), NULL, 0,
+                      NI_NUMERICHOST) != 0) {
+        strcpy(szIP, "?error.obtaining.ip?");
+    }
+    CHKiRet(prop.CreateStringProp(&etry->ip, (uchar *)szIP, strlen(szIP)));
+    prop.AddRef(etry->ip);
+    etry->fqdn = etry->ip;
+    prop.AddRef(etry->ip);
+    etry->fqdnLowerCase = etry->ip;
+    prop.AddRef(etry->ip);
+    etry->localName = etry->ip;
+    memcpy(&etry->addr, addr, SALEN((struct sockaddr *)addr));
+    etry->bPending = 1;
+    etry->validUntil = time(NULL) + DNSCACHE_PENDING_TTL;
+    CHKiRet(insertEntry(shard, addr, etry));
+    *pEtry = etry;
+
+finalize_it:
+    if (iRet != RS_RET_OK && etry != NULL) {
+        entryDestruct(etry);
+    }
+    RETiRet;
+}
+
+
+/* wait until the resolver pool has replaced the placeholder for addr, but
+ * at most reverselookup.async.maxwait milliseconds. Must be called without
+ * any lock held.
+ */
+static void ATTR_NONNULL() asyncWaitResolved(dnscache_shard_t *const shard, struct sockaddr_storage *const addr) {
+    struct timespec deadline;
+    dnscache_entry_t *etry;
+    uint64_t nDone;
+    int bPending;
+
+    timeoutComp(&deadline, runConf->globals.dnscacheAsyncMaxWait);
+    pthread_mutex_lock(&dnsAsync.mut);
+    nDone = dnsAsync.nDone;
+    pthread_mutex_unlock(&dnsAsync.mut);
+    while (1) {
+        pthread_rwlock_rdlock(&shard->rwlock);
+        etry = hashtable_search(shard->ht, addr);
+        bPending = (etry != NULL && etry->bPending);
+        pthread_rwlock_unlock(&shard->rwlock);
+        if (!bPending) return;
+
+        pthread_mutex_lock(&dnsAsync.mut);
+        while (dnsAsync.nDone == nDone) {
+            if (pthread_cond_timedwait(&dnsAsync.condDone, &dnsAsync.mut, &deadline) == ETIMEDOUT) {
+                pthread_mutex_unlock(&dnsAsync.mut);
+                STATSCOUNTER_INC(ctrWaitTimeout, mutCtrWaitTimeout);
+                return;
+            }
+        }
+        nDone = dnsAsync.nDone;
+        pthread_mutex_unlock(&dnsAsync.mut);
+    }
+}
+
+
+/* mark an entry as recently used for CLOCK. Called under the read lock, so
+ * the bit is only written if not yet set, which keeps hot entries' cache
+ * lines shared between cores.
+ */
+static void ATTR_NONNULL() entryReferenced(dnscache_entry_t *const etry) {
+    if (!etry->bReferenced) {
+        ATOMIC_STORE_1_TO_INT(&etry->bReferenced, &mutReferenced);
+    }
+    STATSCOUNTER_INC(ctrHits, mutCtrHits);
+}
+
+
 static rsRetVal ATTR_NONNULL(1, 5) findEntry(struct sockaddr_storage *const addr,
                                              prop_t **const fqdn,
                                              prop_t **const fqdnLowerCase,
                                              prop_t **const localName,
                                              prop_t **const ip) {
+    dnscache_shard_t *const shard = getShard(addr);
+    const int bAsync = runConf->globals.dnscacheAsyncResolvers > 0 && !glbl.GetDisableDNS(runConf);
+    const int bMayWait = bAsync && runConf->globals.dnscacheAsyncMaxWait > 0;
     DEFiRet;
 
-    pthread_rwlock_rdlock(&dnsCache.rwlock);
-    dnscache_entry_t *etry = hashtable_search(dnsCache.ht, addr);
+    pthread_rwlock_rdlock(&shard->rwlock);
+    dnscache_entry_t *etry = hashtable_search(shard->ht, addr);
     DBGPRINTF("findEntry: 1st lookup found %p\n", etry);
 
-    if (etry == NULL || (runConf->globals.dnscacheEnableTTL && (etry->validUntil <= time(NULL)))) {
-        pthread_rwlock_unlock(&dnsCache.rwlock);
-        pthread_rwlock_wrlock(&dnsCache.rwlock);
-        etry = hashtable_search(dnsCache.ht, addr); /* re-query, might have changed */
+    if (etry == NULL || entryExpired(etry)) {
+        pthread_rwlock_unlock(&shard->rwlock);
+        pthread_rwlock_wrlock(&shard->rwlock);
+        etry = hashtable_search(shard->ht, addr); /* re-query, might have changed */
         DBGPRINTF("findEntry: 2nd lookup found %p\n", etry);
-        if (etry == NULL || (runConf->globals.dnscacheEnableTTL && (etry->validUntil <= time(NULL)))) {
+        if (etry == NULL || entryExpired(etry)) {
             if (etry != NULL) {
                 DBGPRINTF(
                     "hashtable: entry timed out, discarding it; "
                     "valid until %lld, now %lld\n",
                     (long long)etry->validUntil, (long long)time(NULL));
-                dnscache_entry_t *const deleted = hashtable_remove(dnsCache.ht, addr);
-                if (deleted != etry) {
-                    LogError(0, RS_RET_INTERNAL_ERROR,
-                             "dnscache %d: removed different "
-                             "hashtable entry than expected - please report issue; "
-                             "rsyslog version is %s",
-                             __LINE__, VERSION);
-                }
-                entryDestruct(etry);
+                removeEntry(shard, etry);
+                STATSCOUNTER_INC(ctrExpired, mutCtrExpired);
             }
+            STATSCOUNTER_INC(ctrMisses, mutCtrMisses);
             /* now entry doesn't exist in any case, so let's (re)create it */
-            CHKiRet(addEntry(addr, &etry));
+            if (bAsync) {
+                CHKiRet(addPendingEntry(shard, addr, &etry));
+            } else {
+                CHKiRet(addEntry(shard, addr, &etry));
+            }
+        } else {
+            entryReferenced(etry);
+        }
+    } else {
+        entryReferenced(etry);
+    }
+
+    if (etry->bPending && bMayWait) {
+        /* wait (bounded) for the resolver, then use whatever the cache has */
+        pthread_rwlock_unlock(&shard->rwlock);
+        asyncWaitResolved(shard, addr);
+        pthread_rwlock_rdlock(&shard->rwlock);
+        etry = hashtable_search(shard->ht, addr);
+        if (etry == NULL) {
+            /* entry vanished meanwhile (expired or evicted); resolve it now */
+            pthread_rwlock_unlock(&shard->rwlock);
+            pthread_rwlock_wrlock(&shard->rwlock);
+            if ((etry = hashtable_search(shard->ht, addr)) == NULL) {
+                CHKiRet(addEntry(shard, addr, &etry));
+            }
         }
     }
 
@@ -418,7 +875,7 @@ static rsRetVal ATTR_NONNULL(1, 5) findEntry(struct sockaddr_storage *const addr
     }
 
 finalize_it:
-    pthread_rwlock_unlock(&dnsCache.rwlock);
+    pthread_rwlock_unlock(&shard->rwlock);
     RETiRet;
 }
 
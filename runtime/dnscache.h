@@ -22,8 +22,11 @@
 #ifndef INCLUDED_DNSCACHE_H
 #define INCLUDED_DNSCACHE_H
 
+#define DNSCACHE_MAX_ASYNC_RESOLVERS 64 /* upper bound for reverselookup.async.resolvers */
+
 rsRetVal dnscacheInit(void);
 rsRetVal dnscacheDeinit(void);
+void dnscacheStopResolvers(void);
 rsRetVal ATTR_NONNULL(1, 5) dnscacheLookup(struct sockaddr_storage *const addr,
                                            prop_t **const fqdn,
                                            prop_t **const fqdnLowerCase,
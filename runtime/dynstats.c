@@ -54,10 +54,206 @@ DEFobjCurrIf(statsobj)
 
 static struct cnfparamblk modpblk = {CNFPARAMBLK_VERSION, sizeof(modpdescr) / sizeof(struct cnfparamdescr), modpdescr};
 
+/* Per-thread caches. Each thread that increments bucket counters owns a
+ * root (the value of a single, process-wide TLS key) with one cache per
+ * bucket it used. The root is only ever freed by the exit callback of its
+ * thread; caches are freed either by that callback or, when their bucket is
+ * destroyed first, by the bucket. Buckets thus neither need a TLS key of
+ * their own nor can the exit callback be handed memory a bucket has freed.
+ */
+static pthread_key_t keyTlsRoot;
+static int bTlsRoot = 0; /* keyTlsRoot was created; if not, all threads use the shared path */
+
+/* Serializes thread exit callbacks with bucket destruction, so that neither
+ * frees a cache the other is working on.
+ * Lock order: this mutex, a bucket's lock, its mutTls, a root's mut.
+ */
+static pthread_mutex_t mutTlsDetach = PTHREAD_MUTEX_INITIALIZER;
+
+/* add the counts of all per-thread caches to the bucket's counters and, if
+ * bClear is set, empty the caches. Must be called with the bucket lock held,
+ * exclusively if bClear is set, so that the cached counters stay valid.
+ */
+static void dynstats_mergeTls(dynstats_bucket_t *b, const int bClear) {
+    dynstats_tls_t *tls;
+    dynstats_tlsctr_t *lc;
+
+    pthread_mutex_lock(&b->mutTls);
+    for (tls = b->tls; tls != NULL; tls = tls->next) {
+        pthread_mutex_lock(&tls->root->mut);
+        for (lc = tls->ctrs; lc != NULL; lc = lc->next) {
+            if (lc->pending != 0) {
+                STATSCOUNTER_ADD(lc->ctr->ctr, lc->ctr->mutCtr, lc->pending);
+                lc->pending = 0;
+            }
+        }
+        if (bClear && tls->table != NULL) {
+            hashtable_destroy(tls->table, 1); /* also frees the tlsctrs */
+            tls->table = NULL;
+            tls->ctrs = NULL;
+        }
+        pthread_mutex_unlock(&tls->root->mut);
+    }
+    pthread_mutex_unlock(&b->mutTls);
+}
+
+/* unlink a cache from its thread's root; the root's mutex must be locked */
+static void dynstats_unlinkTlsFromRoot(dynstats_tls_t *tls) {
+    if (tls->thrPrev != NULL) {
+        tls->thrPrev->thrNext = tls->thrNext;
+    } else {
+        tls->root->caches = tls->thrNext;
+    }
+    if (tls->thrNext != NULL) {
+        tls->thrNext->thrPrev = tls->thrPrev;
+    }
+}
+
+/* free a per-thread cache; it must already be unlinked from bucket and root */
+static void dynstats_destroyTls(dynstats_tls_t *tls) {
+    if (tls->table != NULL) {
+        hashtable_destroy(tls->table, 1);
+    }
+    free(tls);
+}
+
+/* called by pthreads when a thread that used dynstats terminates: merge the
+ * thread's caches into their buckets and free them.
+ */
+static void dynstats_tlsThreadExit(void *arg) {
+    dynstats_tlsroot_t *const root = (dynstats_tlsroot_t *)arg;
+    dynstats_tls_t *tls;
+    dynstats_bucket_t *b;
+    dynstats_tlsctr_t *lc;
+
+    pthread_mutex_lock(&mutTlsDetach);
+    while ((tls = root->caches) != NULL) {
+        b = tls->bucket;
+        pthread_rwlock_rdlock(&b->lock);
+        pthread_mutex_lock(&b->mutTls);
+        pthread_mutex_lock(&root->mut);
+        for (lc = tls->ctrs; lc != NULL; lc = lc->next) {
+            STATSCOUNTER_ADD(lc->ctr->ctr, lc->ctr->mutCtr, lc->pending);
+        }
+        dynstats_unlinkTlsFromRoot(tls);
+        pthread_mutex_unlock(&root->mut);
+        if (tls->prev != NULL) {
+            tls->prev->next = tls->next;
+        } else {
+            b->tls = tls->next;
+        }
+        if (tls->next != NULL) {
+            tls->next->prev = tls->prev;
+        }
+        pthread_mutex_unlock(&b->mutTls);
+        pthread_rwlock_unlock(&b->lock);
+        dynstats_destroyTls(tls);
+    }
+    pthread_mutex_unlock(&mutTlsDetach);
+    pthread_mutex_destroy(&root->mut);
+    free(root);
+}
+
+/* get the calling thread's root, creating it if needed. Returns NULL if
+ * there is none, in which case the shared path is used.
+ */
+static dynstats_tlsroot_t *dynstats_getTlsRoot(void) {
+    dynstats_tlsroot_t *root;
+
+    if (!bTlsRoot) {
+        return NULL;
+    }
+    root = (dynstats_tlsroot_t *)pthread_getspecific(keyTlsRoot);
+    if (root == NULL) {
+        if ((root = calloc(1, sizeof(dynstats_tlsroot_t))) == NULL) {
+            return NULL;
+        }
+        pthread_mutex_init(&root->mut, NULL);
+        if (pthread_setspecific(keyTlsRoot, root) != 0) {
+            pthread_mutex_destroy(&root->mut);
+            free(root);
+            return NULL;
+        }
+    }
+    return root;
+}
+
+/* find the thread's cache for the bucket; the root's mutex must be locked */
+static dynstats_tls_t *dynstats_findTls(dynstats_tlsroot_t *root, dynstats_bucket_t *b) {
+    dynstats_tls_t *tls;
+
+    for (tls = root->caches; tls != NULL && tls->bucket != b; tls = tls->thrNext) {
+        /* just search */
+    }
+    return tls;
+}
+
+/* create the thread's cache for the bucket. Must be called without the
+ * root's mutex held. Returns NULL if out of memory.
+ */
+static dynstats_tls_t *dynstats_newTls(dynstats_tlsroot_t *root, dynstats_bucket_t *b) {
+    dynstats_tls_t *tls;
+
+    if ((tls = calloc(1, sizeof(dynstats_tls_t))) == NULL) {
+        return NULL;
+    }
+    tls->root = root;
+    tls->bucket = b;
+    pthread_mutex_lock(&b->mutTls);
+    tls->next = b->tls;
+    if (b->tls != NULL) {
+        b->tls->prev = tls;
+    }
+    b->tls = tls;
+    pthread_mutex_lock(&root->mut);
+    tls->thrNext = root->caches;
+    if (root->caches != NULL) {
+        root->caches->thrPrev = tls;
+    }
+    root->caches = tls;
+    pthread_mutex_unlock(&root->mut);
+    pthread_mutex_unlock(&b->mutTls);
+    return tls;
+}
+
+/* add a bucket counter to the thread's cache. Must be called with the
+ * bucket lock held (shared), so that the counter cannot go away meanwhile.
+ * Failures are ignored, the counter is then just not cached.
+ */
+static void dynstats_cacheCtr(dynstats_tls_t *tls, dynstats_ctr_t *ctr) {
+    dynstats_tlsctr_t *lc = NULL;
+    uchar *key = NULL;
+
+    pthread_mutex_lock(&tls->root->mut);
+    if (tls->table == NULL) {
+        tls->table = create_hashtable(16, hash_from_string, key_equals_string, NULL);
+        if (tls->table == NULL) goto done;
+    }
+    if ((lc = calloc(1, sizeof(dynstats_tlsctr_t))) == NULL || (key = ustrdup(ctr->metric)) == NULL) {
+        goto done;
+    }
+    lc->ctr = ctr;
+    if (hashtable_insert(tls->table, key, lc)) {
+        lc->next = tls->ctrs;
+        tls->ctrs = lc;
+        lc = NULL;
+        key = NULL;
+    }
+done:
+    pthread_mutex_unlock(&tls->root->mut);
+    free(lc);
+    free(key);
+}
+
 rsRetVal dynstatsClassInit(void) {
     DEFiRet;
     CHKiRet(objGetObjInterface(&obj));
     CHKiRet(objUse(statsobj, CORE_COMPONENT));
+    if (pthread_key_create(&keyTlsRoot, dynstats_tlsThreadExit) == 0) {
+        bTlsRoot = 1;
+    } else {
+        LogMsg(0, RS_RET_OK, LOG_INFO, "dynstats: cannot use per-thread counters, falling back to shared counters");
+    }
 finalize_it:
     RETiRet;
 }
@@ -90,7 +286,19 @@ dynstats_destroyCounters(dynstats_bucket_t *b) {
 }
 
 static void dynstats_destroyBucket(dynstats_buckets_t *bkts, dynstats_bucket_t *b) {
+    dynstats_tls_t *tls;
+    pthread_mutex_lock(&mutTlsDetach);
     pthread_rwlock_wrlock(&b->lock);
+    /* free the caches; their threads are still running, but no longer use the bucket */
+    while ((tls = b->tls) != NULL) {
+        b->tls = tls->next;
+        pthread_mutex_lock(&tls->root->mut);
+        dynstats_unlinkTlsFromRoot(tls);
+        pthread_mutex_unlock(&tls->root->mut);
+        dynstats_destroyTls(tls);
+    }
+    pthread_mutex_destroy(&b->mutTls);
+    pthread_mutex_unlock(&mutTlsDetach);
     dynstats_destroyCounters(b);
     dynstats_destroyCountersIn(b, b->survivor_table, b->survivor_ctrs);
     statsobj.Destruct(&b->stats);
@@ -237,6 +445,7 @@ finalize_it:
 static rsRetVal dynstats_resetBucket(dynstats_bucket_t *b) {
     DEFiRet;
     pthread_rwlock_wrlock(&b->lock);
+    dynstats_mergeTls(b, 1);
     CHKiRet(dynstats_rebuildSurvivorTable(b));
     STATSCOUNTER_INC(b->ctrPurgeTriggered, b->mutCtrPurgeTriggered);
     timeoutComp(&b->metricCleanupTimeout, b->unusedMetricLife);
@@ -265,6 +474,14 @@ static void dynstats_readCallback(statsobj_t __attribute__((unused)) * ignore, v
     pthread_rwlock_unlock(&bkts->lock);
 }
 
+static void dynstats_preReadCallback(statsobj_t __attribute__((unused)) * ignore, void *ctx) {
+    dynstats_bucket_t *const b = (dynstats_bucket_t *)ctx;
+
+    pthread_rwlock_rdlock(&b->lock);
+    dynstats_mergeTls(b, 0);
+    pthread_rwlock_unlock(&b->lock);
+}
+
 static rsRetVal dynstats_initNewBucketStats(dynstats_bucket_t *b) {
     DEFiRet;
 
@@ -273,6 +490,7 @@ static rsRetVal dynstats_initNewBucketStats(dynstats_bucket_t *b) {
     CHKiRet(statsobj.SetName(b->stats, b->name));
     CHKiRet(statsobj.SetReportingNamespace(b->stats, UCHAR_CONSTANT("values")));
     statsobj.SetReadNotifier(b->stats, dynstats_readCallback, b);
+    statsobj.SetPreReadNotifier(b->stats, dynstats_preReadCallback, b);
     CHKiRet(statsobj.ConstructFinalize(b->stats));
 
 finalize_it:
@@ -310,6 +528,7 @@ static rsRetVal dynstats_newBucket(const uchar *name,
         lock_initialized = 1;
         pthread_mutex_init(&b->mutMetricCount, NULL);
         metric_count_mutex_initialized = 1;
+        pthread_mutex_init(&b->mutTls, NULL);
 
         CHKiRet(dynstats_initNewBucketStats(b));
 
@@ -560,6 +779,9 @@ finalize_it:
 
 rsRetVal dynstats_inc(dynstats_bucket_t *b, uchar *metric) {
     dynstats_ctr_t *ctr;
+    dynstats_tlsroot_t *root;
+    dynstats_tls_t *tls = NULL;
+    dynstats_tlsctr_t *lc = NULL;
     DEFiRet;
 
     if (!GatherStats) {
@@ -571,10 +793,32 @@ rsRetVal dynstats_inc(dynstats_bucket_t *b, uchar *metric) {
         FINALIZE;
     }
 
+    /* fast path: metric is in this thread's cache */
+    if ((root = dynstats_getTlsRoot()) != NULL) {
+        pthread_mutex_lock(&root->mut);
+        tls = dynstats_findTls(root, b);
+        if (tls != NULL && tls->table != NULL) {
+            lc = (dynstats_tlsctr_t *)hashtable_search(tls->table, metric);
+        }
+        if (lc != NULL) {
+            ++lc->pending;
+        }
+        pthread_mutex_unlock(&root->mut);
+        if (lc != NULL) {
+            FINALIZE;
+        }
+        if (tls == NULL) {
+            tls = dynstats_newTls(root, b);
+        }
+    }
+
     if (pthread_rwlock_tryrdlock(&b->lock) == 0) {
         ctr = (dynstats_ctr_t *)hashtable_search(b->table, metric);
         if (ctr != NULL) {
             STATSCOUNTER_INC(ctr->ctr, ctr->mutCtr);
+            if (tls != NULL) {
+                dynstats_cacheCtr(tls, ctr);
+            }
         }
         pthread_rwlock_unlock(&b->lock);
     } else {
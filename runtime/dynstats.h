@@ -31,6 +31,35 @@ struct dynstats_ctr_s {
     struct dynstats_ctr_s *prev;
 };
 
+/* per-thread cache of a bucket's counters. Increments of cached metrics
+ * are only counted here and added to the bucket's counters when stats are
+ * read, so the hot path does not touch shared memory. The mutex is only
+ * contended while the counts are merged.
+ */
+struct dynstats_tlsctr_s {
+    dynstats_ctr_t *ctr; /* counter in the bucket's table */
+    uint64_t pending; /* increments not yet added to ctr */
+    struct dynstats_tlsctr_s *next;
+};
+
+/* a thread's cache for one bucket */
+struct dynstats_tls_s {
+    struct dynstats_tlsroot_s *root; /* owning thread; its mutex protects the cache */
+    htable *table; /* metric -> dynstats_tlsctr_t, NULL if empty */
+    struct dynstats_tlsctr_s *ctrs;
+    dynstats_bucket_t *bucket;
+    struct dynstats_tls_s *next; /* bucket's list, protected by its mutTls */
+    struct dynstats_tls_s *prev;
+    struct dynstats_tls_s *thrNext; /* thread's list, protected by root's mut */
+    struct dynstats_tls_s *thrPrev;
+};
+
+/* all caches of a thread, the value of the dynstats TLS key */
+struct dynstats_tlsroot_s {
+    pthread_mutex_t mut; /* only contended while counts are merged or a bucket is destroyed */
+    struct dynstats_tls_s *caches;
+};
+
 struct dynstats_bucket_s {
     htable *table;
     uchar *name;
@@ -63,6 +92,9 @@ struct dynstats_bucket_s {
     uint32_t lastResetTs;
     struct timespec metricCleanupTimeout;
     uint8_t resettable;
+    /* per-thread caches; lock order: lock, then mutTls, then a cache's root mut */
+    pthread_mutex_t mutTls;
+    struct dynstats_tls_s *tls;
 };
 
 struct dynstats_buckets_s {
@@ -179,8 +179,17 @@ static struct cnfparamdescr cnfparamdescr[] = {
     {"default.ruleset.queue.timeoutworkerthreadshutdown", eCmdHdlrInt, 0},
     {"reverselookup.cache.ttl.default", eCmdHdlrNonNegInt, 0},
     {"reverselookup.cache.ttl.enable", eCmdHdlrBinary, 0},
+    {"reverselookup.cache.ttl.negative", eCmdHdlrNonNegInt, 0},
+    {"reverselookup.cache.ttl.jitter", eCmdHdlrNonNegInt, 0},
+    {"reverselookup.cache.maxsize", eCmdHdlrNonNegInt, 0},
+    {"reverselookup.async.resolvers", eCmdHdlrNonNegInt, 0},
+    {"reverselookup.async.maxwait", eCmdHdlrNonNegInt, 0},
     {"parser.supportcompressionextension", eCmdHdlrBinary, 0},
     {"shutdown.queue.doublesize", eCmdHdlrBinary, 0},
+    {"message.finalizebeforefanout", eCmdHdlrBinary, 0},
+    {"rainerscript.bytecode", eCmdHdlrBinary, 0},
+    {"rainerscript.batchexecution", eCmdHdlrBinary, 0},
+    {"template.compile", eCmdHdlrBinary, 0},
     {"debug.files", eCmdHdlrArray, 0},
     {"debug.whitelist", eCmdHdlrBinary, 0},
     {"libcapng.default", eCmdHdlrBinary, 0},
@@ -1049,6 +1058,14 @@ void glblProcessCnf(struct cnfobj *o) {
         } else if (!strcmp(paramblk.descr[i].name, "security.abortonidresolutionfail")) {
             loadConf->globals.abortOnIDResolutionFail = (int)cnfparamvals[i].val.d.n;
             cnfparamvals[i].bUsed = TRUE;
+        } else if (!strcmp(paramblk.descr[i].name, "rainerscript.bytecode")) {
+            /* this one and the next are used by the ruleset optimizer, which
+             * runs before glblDoneLoadCnf() */
+            loadConf->globals.bScriptBytecode = (int)cnfparamvals[i].val.d.n;
+            cnfparamvals[i].bUsed = TRUE;
+        } else if (!strcmp(paramblk.descr[i].name, "rainerscript.batchexecution")) {
+            loadConf->globals.bScriptBatchExec = (int)cnfparamvals[i].val.d.n;
+            cnfparamvals[i].bUsed = TRUE;
         }
     }
 done:
@@ -1347,6 +1364,14 @@ rsRetVal glblDoneLoadCnf(void) {
             glblDbgWhitelist = (int)cnfparamvals[i].val.d.n;
         } else if (!strcmp(paramblk.descr[i].name, "shutdown.queue.doublesize")) {
             loadConf->globals.shutdownQueueDoubleSize = (int)cnfparamvals[i].val.d.n;
+        } else if (!strcmp(paramblk.descr[i].name, "message.finalizebeforefanout")) {
+            loadConf->globals.bFinalizeMsgBeforeFanOut = (int)cnfparamvals[i].val.d.n;
+        } else if (!strcmp(paramblk.descr[i].name, "rainerscript.bytecode")) {
+            loadConf->globals.bScriptBytecode = (int)cnfparamvals[i].val.d.n;
+        } else if (!strcmp(paramblk.descr[i].name, "rainerscript.batchexecution")) {
+            loadConf->globals.bScriptBatchExec = (int)cnfparamvals[i].val.d.n;
+        } else if (!strcmp(paramblk.descr[i].name, "template.compile")) {
+            loadConf->globals.bTplCompile = (int)cnfparamvals[i].val.d.n;
         } else if (!strcmp(paramblk.descr[i].name, "umask")) {
             loadConf->globals.umask = (int)cnfparamvals[i].val.d.n;
         } else if (!strcmp(paramblk.descr[i].name, "shutdown.enable.ctlc")) {
@@ -1371,6 +1396,29 @@ rsRetVal glblDoneLoadCnf(void) {
             loadConf->globals.dnscacheDefaultTTL = cnfparamvals[i].val.d.n;
         } else if (!strcmp(paramblk.descr[i].name, "reverselookup.cache.ttl.enable")) {
             loadConf->globals.dnscacheEnableTTL = cnfparamvals[i].val.d.n;
+        } else if (!strcmp(paramblk.descr[i].name, "reverselookup.cache.ttl.negative")) {
+            loadConf->globals.dnscacheNegativeTTL = cnfparamvals[i].val.d.n;
+        } else if (!strcmp(paramblk.descr[i].name, "reverselookup.cache.ttl.jitter")) {
+            loadConf->globals.dnscacheTTLJitter = cnfparamvals[i].val.d.n;
+            if (loadConf->globals.dnscacheTTLJitter > 100) {
+                LogError(0, RS_RET_PARAM_ERROR,
+                         "reverselookup.cache.ttl.jitter is a percentage "
+                         "and must not exceed 100, using 100");
+                loadConf->globals.dnscacheTTLJitter = 100;
+            }
+        } else if (!strcmp(paramblk.descr[i].name, "reverselookup.cache.maxsize")) {
+            loadConf->globals.dnscacheMaxSize = cnfparamvals[i].val.d.n;
+        } else if (!strcmp(paramblk.descr[i].name, "reverselookup.async.resolvers")) {
+            loadConf->globals.dnscacheAsyncResolvers = cnfparamvals[i].val.d.n;
+            if (loadConf->globals.dnscacheAsyncResolvers > DNSCACHE_MAX_ASYNC_RESOLVERS) {
+                LogError(0, RS_RET_PARAM_ERROR,
+                         "reverselookup.async.resolvers must not exceed %d, "
+                         "using %d",
+                         DNSCACHE_MAX_ASYNC_RESOLVERS, DNSCACHE_MAX_ASYNC_RESOLVERS);
+                loadConf->globals.dnscacheAsyncResolvers = DNSCACHE_MAX_ASYNC_RESOLVERS;
+            }
+        } else if (!strcmp(paramblk.descr[i].name, "reverselookup.async.maxwait")) {
+            loadConf->globals.dnscacheAsyncMaxWait = cnfparamvals[i].val.d.n;
         } else if (!strcmp(paramblk.descr[i].name, "parser.supportcompressionextension")) {
             loadConf->globals.bSupportCompressionExtension = cnfparamvals[i].val.d.n;
         } else {
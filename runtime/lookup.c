@@ -23,10 +23,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <ctype.h>
+#include <strings.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <arpa/inet.h>
 #include <json.h>
 #include <assert.h>
 
@@ -34,11 +38,13 @@
 #include "srUtils.h"
 #include "errmsg.h"
 #include "lookup.h"
+#include "lookup_bin.h"
 #include "msg.h"
 #include "rsconf.h"
 #include "dirty.h"
 #include "unicode-helper.h"
 #include "regexp.h"
+#include "mregex.h"
 
 PRAGMA_IGNORE_Wdeprecated_declarations
     /* definitions for objects we access */
@@ -182,6 +188,7 @@ static void destructTable_str(lookup_t *pThis) {
         free(entries[i].key);
     }
     free(entries);
+    free(pThis->table.str->slots);
     free(pThis->table.str);
 }
 
@@ -196,6 +203,17 @@ static void destructTable_sparseArr(lookup_t *pThis) {
     free(pThis->table.sprsArr);
 }
 
+static void destructTable_cidr(lookup_t *pThis) {
+    if (pThis->table.cidr == NULL) return;
+    free(pThis->table.cidr->nodes);
+    free(pThis->table.cidr);
+}
+
+static void destructTable_mapped(lookup_t *pThis) {
+    munmap((void *)pThis->table.mapped->base, pThis->table.mapped->len);
+    free(pThis->table.mapped);
+}
+
 #ifdef FEATURE_REGEXP
 static void destructTable_regex(lookup_t *pThis) {
     uint32_t i;
@@ -221,6 +239,7 @@ static void destructTable_regex(lookup_t *pThis) {
         }
     }
     free(entries);
+    mregexDestruct(&pThis->table.regex->pMre);
     free(pThis->table.regex);
 }
 #endif
@@ -236,6 +255,10 @@ static void lookupDestruct(lookup_t *pThis) {
         destructTable_arr(pThis);
     } else if (pThis->type == SPARSE_ARRAY_LOOKUP_TABLE) {
         destructTable_sparseArr(pThis);
+    } else if (pThis->type == MAPPED_LOOKUP_TABLE) {
+        destructTable_mapped(pThis);
+    } else if (pThis->type == CIDR_LOOKUP_TABLE) {
+        destructTable_cidr(pThis);
 #ifdef FEATURE_REGEXP
     } else if (pThis->type == REGEX_LOOKUP_TABLE) {
         destructTable_regex(pThis);
@@ -271,6 +294,10 @@ static int qs_arrcmp_strtab(const void *s1, const void *s2) {
     return ustrcmp(((lookup_string_tab_entry_t *)s1)->key, ((lookup_string_tab_entry_t *)s2)->key);
 }
 
+static int qs_arrcmp_strtab_nocase(const void *s1, const void *s2) {
+    return strcasecmp((char *)((lookup_string_tab_entry_t *)s1)->key, (char *)((lookup_string_tab_entry_t *)s2)->key);
+}
+
 static int qs_arrcmp_ustrs(const void *s1, const void *s2) {
     return ustrcmp(*(uchar **)s1, *(uchar **)s2);
 }
@@ -300,6 +327,10 @@ static int bs_arrcmp_strtab(const void *s1, const void *s2) {
     return strcmp((char *)s1, (char *)((lookup_string_tab_entry_t *)s2)->key);
 }
 
+static int bs_arrcmp_strtab_nocase(const void *s1, const void *s2) {
+    return strcasecmp((char *)s1, (char *)((lookup_string_tab_entry_t *)s2)->key);
+}
+
 static int bs_arrcmp_str(const void *s1, const void *s2) {
     return ustrcmp((uchar *)s1, *(uchar **)s2);
 }
@@ -330,7 +361,7 @@ static es_str_t *lookupKey_str(lookup_t *pThis, lookup_key_t key) {
     } else {
         assert(pThis->table.str->entries);
         entry = bsearch(key.k_str, pThis->table.str->entries, pThis->nmemb, sizeof(lookup_string_tab_entry_t),
-                        bs_arrcmp_strtab);
+                        pThis->table.str->bNoCase ? bs_arrcmp_strtab_nocase : bs_arrcmp_strtab);
     }
     if (entry == NULL) {
         r = defaultVal(pThis);
@@ -340,6 +371,24 @@ static es_str_t *lookupKey_str(lookup_t *pThis, lookup_key_t key) {
     return es_newStrFromCStr(r, strlen(r));
 }
 
+static es_str_t *lookupKey_strHash(lookup_t *pThis, lookup_key_t key) {
+    const lookup_string_tab_t *const tab = pThis->table.str;
+    const uint32_t h = lookupStrHash(key.k_str, tab->bNoCase);
+    const char *r = defaultVal(pThis);
+    uint32_t i;
+
+    for (i = h & tab->slotMask; tab->slots[i].entry != 0; i = (i + 1) & tab->slotMask) {
+        if (tab->slots[i].hash == h) {
+            const lookup_string_tab_entry_t *const entry = &tab->entries[tab->slots[i].entry - 1];
+            if ((tab->bNoCase ? strcasecmp : strcmp)((char *)key.k_str, (char *)entry->key) == 0) {
+                r = (const char *)entry->interned_val_ref;
+                break;
+            }
+        }
+    }
+    return es_newStrFromCStr(r, strlen(r));
+}
+
 static es_str_t *lookupKey_arr(lookup_t *pThis, lookup_key_t key) {
     const char *r;
     uint32_t uint_key = key.k_uint;
@@ -407,10 +456,149 @@ static es_str_t *lookupKey_sprsArr(lookup_t *pThis, lookup_key_t key) {
     return es_newStrFromCStr(r, strlen(r));
 }
 
+/* helpers for cidr tables. Addresses are kept in network byte order,
+ * IPv4 addresses in the first 4 bytes. Bit 0 is the most significant one.
+ */
+#define CIDR_FAMILY_IPV4 0
+#define CIDR_FAMILY_IPV6 1
+
+static inline int cidrBit(const uint8_t *const addr, const unsigned n) {
+    return (addr[n >> 3] >> (7 - (n & 7))) & 1;
+}
+
+/* number of leading bits a and b have in common, at most maxBits */
+static unsigned cidrCommonBits(const uint8_t *const a, const uint8_t *const b, const unsigned maxBits) {
+    unsigned n = 0;
+    unsigned i;
+    uint8_t x;
+
+    for (i = 0; n < maxBits; ++i, n += 8) {
+        if ((x = a[i] ^ b[i]) != 0) {
+            while (!(x & 0x80)) {
+                x <<= 1;
+                ++n;
+            }
+            break;
+        }
+    }
+    return (n < maxBits) ? n : maxBits;
+}
+
+/* parse an IPv4 or IPv6 address; IPv4-mapped IPv6 addresses are
+ * treated as IPv4. Returns the family or -1 if str is no address.
+ */
+static int cidrParseAddr(const char *const str, uint8_t *const addr) {
+    static const uint8_t v4mapped[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+
+    if (strchr(str, ':') == NULL) {
+        return (inet_pton(AF_INET, str, addr) == 1) ? CIDR_FAMILY_IPV4 : -1;
+    }
+    if (inet_pton(AF_INET6, str, addr) != 1) return -1;
+    if (memcmp(addr, v4mapped, sizeof(v4mapped)) == 0) {
+        memmove(addr, addr + 12, 4);
+        return CIDR_FAMILY_IPV4;
+    }
+    return CIDR_FAMILY_IPV6;
+}
+
+/* longest prefix match: walk down the trie as long as the node prefixes
+ * match the address and remember the last node that carries a value.
+ */
+static es_str_t *lookupKey_cidr(lookup_t *pThis, lookup_key_t key) {
+    const lookup_cidr_tab_t *const tab = pThis->table.cidr;
+    const char *r = defaultVal(pThis);
+    uint8_t addr[16];
+    const int family = cidrParseAddr((const char *)key.k_str, addr);
+
+    if (family >= 0) {
+        const unsigned maxBits = (family == CIDR_FAMILY_IPV4) ? 32 : 128;
+        uint32_t n = tab->root[family];
+        while (n != 0) {
+            const lookup_cidr_node_t *const node = &tab->nodes[n - 1];
+            if (cidrCommonBits(addr, node->prefix, node->bits) < node->bits) break;
+            if (node->interned_val_ref != NULL) r = (const char *)node->interned_val_ref;
+            if (node->bits == maxBits) break;
+            n = node->child[cidrBit(addr, node->bits)];
+        }
+    }
+    return es_newStrFromCStr(r, strlen(r));
+}
+
+/* lookup_fns for precompiled (mmap()ed) tables. The image layout was
+ * checked when it was mapped. String offsets are checked on use instead,
+ * so that mapping does not need to touch every page of the image. As the
+ * image ends with a NUL byte, every in-range offset yields a terminated
+ * string.
+ */
+static inline const char *mappedStr(const lookup_mapped_tab_t *const tab, const uint64_t off) {
+    return (off < tab->len) ? (const char *)tab->base + off : "";
+}
+
+static es_str_t *lookupKey_mappedStr(lookup_t *pThis, lookup_key_t key) {
+    const lookup_mapped_tab_t *const tab = pThis->table.mapped;
+    const lookup_bin_str_entry_t *const entries = (const lookup_bin_str_entry_t *)(tab->base + tab->hdr->entriesOff);
+    const lookup_bin_hslot_t *const slots = (const lookup_bin_hslot_t *)(tab->base + tab->hdr->slotsOff);
+    const uint32_t slotMask = tab->hdr->nSlots - 1;
+    const int bNoCase = tab->hdr->flags & LOOKUP_BIN_FLAG_NOCASE;
+    const uint32_t h = lookupStrHash(key.k_str, bNoCase);
+    const char *r = defaultVal(pThis);
+    uint32_t i, n;
+
+    for (i = h & slotMask, n = 0; slots[i].entry != 0 && n <= slotMask; i = (i + 1) & slotMask, ++n) {
+        if (slots[i].hash == h && slots[i].entry <= pThis->nmemb) {
+            const lookup_bin_str_entry_t *const entry = &entries[slots[i].entry - 1];
+            if ((bNoCase ? strcasecmp : strcmp)((char *)key.k_str, mappedStr(tab, entry->keyOff)) == 0) {
+                r = mappedStr(tab, entry->valOff);
+                break;
+            }
+        }
+    }
+    return es_newStrFromCStr(r, strlen(r));
+}
+
+static es_str_t *lookupKey_mappedArr(lookup_t *pThis, lookup_key_t key) {
+    const lookup_mapped_tab_t *const tab = pThis->table.mapped;
+    const lookup_bin_uint_entry_t *const entries = (const lookup_bin_uint_entry_t *)(tab->base + tab->hdr->entriesOff);
+    const char *r = defaultVal(pThis);
+
+    if (pThis->nmemb > 0 && key.k_uint >= entries[0].key && key.k_uint - entries[0].key < pThis->nmemb) {
+        r = mappedStr(tab, entries[key.k_uint - entries[0].key].valOff);
+    }
+    return es_newStrFromCStr(r, strlen(r));
+}
+
+static int bs_arrcmp_mappedUint(const void *s1, const void *s2) {
+    uint32_t key = *(uint32_t *)s1;
+    uint32_t array_member_value = ((const lookup_bin_uint_entry_t *)s2)->key;
+    if (key < array_member_value) {
+        return -1;
+    }
+    return key > array_member_value;
+}
+
+static es_str_t *lookupKey_mappedSprsArr(lookup_t *pThis, lookup_key_t key) {
+    const lookup_mapped_tab_t *const tab = pThis->table.mapped;
+    const lookup_bin_uint_entry_t *entry;
+    const char *r;
+
+    entry = bsearch_lte(&key.k_uint, tab->base + tab->hdr->entriesOff, pThis->nmemb, sizeof(lookup_bin_uint_entry_t),
+                        bs_arrcmp_mappedUint);
+    r = (entry == NULL) ? defaultVal(pThis) : mappedStr(tab, entry->valOff);
+    return es_newStrFromCStr(r, strlen(r));
+}
+
 #ifdef FEATURE_REGEXP
 static es_str_t *lookupKey_regex(lookup_t *pThis, lookup_key_t key) {
     const char *r = defaultVal(pThis);
 
+    if (pThis->table.regex->pMre != NULL) {
+        const int i = mregexFirst(pThis->table.regex->pMre, key.k_str, ustrlen(key.k_str));
+        if (i >= 0) {
+            r = (const char *)pThis->table.regex->entries[i].interned_val_ref;
+        }
+        return es_newStrFromCStr(r, strlen(r));
+    }
+
     for (uint32_t i = 0; i < pThis->nmemb; ++i) {
         if (regexp.regexec(&pThis->table.regex->entries[i].regex, (char *)key.k_str, 0, NULL, 0) == 0) {
             r = (const char *)pThis->table.regex->entries[i].interned_val_ref;
@@ -430,7 +618,34 @@ static es_str_t *lookupKey_regex(lookup_t *pThis, lookup_key_t key) {
              type, name);                                                   \
     ABORT_FINALIZE(RS_RET_INVALID_VALUE);
 
-static rsRetVal build_StringTable(lookup_t *pThis, struct json_object *jtab, const uchar *name) {
+/* build the hash index of a string table. The hash of each key is kept
+ * in the slot, so that most mismatches are detected without touching the
+ * key. With at most 2/3 of the slots used, probe sequences stay short.
+ * If a key occurs more than once, the first entry is found.
+ */
+static rsRetVal build_StringTableHash(lookup_t *pThis) {
+    lookup_string_tab_t *const tab = pThis->table.str;
+    uint32_t nSlots = 2;
+    uint32_t i, j, h;
+    DEFiRet;
+
+    while (nSlots < pThis->nmemb + pThis->nmemb / 2) nSlots <<= 1;
+    CHKmalloc(tab->slots = calloc(nSlots, sizeof(lookup_string_tab_hslot_t)));
+    tab->slotMask = nSlots - 1;
+    for (i = 0; i < pThis->nmemb; i++) {
+        h = lookupStrHash(tab->entries[i].key, tab->bNoCase);
+        for (j = h & tab->slotMask; tab->slots[j].entry != 0; j = (j + 1) & tab->slotMask)
+            ;
+        tab->slots[j].hash = h;
+        tab->slots[j].entry = i + 1;
+    }
+
+finalize_it:
+    RETiRet;
+}
+
+static rsRetVal build_StringTable(
+    lookup_t *pThis, struct json_object *jtab, const uchar *name, const int searchMode, const int bNoCase) {
     uint32_t i;
     struct json_object *jrow, *jindex, *jvalue;
     uchar *value, *canonicalValueRef;
@@ -438,6 +653,7 @@ static rsRetVal build_StringTable(lookup_t *pThis, struct json_object *jtab, con
 
     pThis->table.str = NULL;
     CHKmalloc(pThis->table.str = calloc(1, sizeof(lookup_string_tab_t)));
+    pThis->table.str->bNoCase = (uint8_t)bNoCase;
     if (pThis->nmemb > 0) {
         CHKmalloc(pThis->table.str->entries = calloc(pThis->nmemb, sizeof(lookup_string_tab_entry_t)));
 
@@ -473,10 +689,19 @@ static rsRetVal build_StringTable(lookup_t *pThis, struct json_object *jtab, con
             pThis->table.str->entries[i].interned_val_ref = canonicalValueRef;
 #endif
         }
-        qsort(pThis->table.str->entries, pThis->nmemb, sizeof(lookup_string_tab_entry_t), qs_arrcmp_strtab);
     }
 
-    pThis->lookup = lookupKey_str;
+    if (pThis->nmemb > 0 && (searchMode == LOOKUP_STR_SEARCH_HASH ||
+                             (searchMode == LOOKUP_STR_SEARCH_AUTO && pThis->nmemb >= LOOKUP_STR_HASH_THRESHOLD))) {
+        CHKiRet(build_StringTableHash(pThis));
+        pThis->lookup = lookupKey_strHash;
+    } else {
+        if (pThis->nmemb > 0) {
+            qsort(pThis->table.str->entries, pThis->nmemb, sizeof(lookup_string_tab_entry_t),
+                  bNoCase ? qs_arrcmp_strtab_nocase : qs_arrcmp_strtab);
+        }
+        pThis->lookup = lookupKey_str;
+    }
     pThis->key_type = LOOKUP_KEY_TYPE_STRING;
 finalize_it:
     RETiRet;
@@ -592,8 +817,193 @@ finalize_it:
     RETiRet;
 }
 
+static rsRetVal cidrNewNode(lookup_cidr_tab_t *const tab,
+                            const uint8_t *const prefix,
+                            const unsigned bits,
+                            uchar *const val,
+                            uint32_t *const pIdx) {
+    lookup_cidr_node_t *node;
+    unsigned i;
+    DEFiRet;
+
+    if (tab->nNodes == tab->maxNodes) {
+        const uint32_t newMax = (tab->maxNodes == 0) ? 64 : 2 * tab->maxNodes;
+        CHKmalloc(node = realloc(tab->nodes, newMax * sizeof(lookup_cidr_node_t)));
+        tab->nodes = node;
+        tab->maxNodes = newMax;
+    }
+    node = &tab->nodes[tab->nNodes];
+    memset(node, 0, sizeof(lookup_cidr_node_t));
+    for (i = 0; i < bits; i += 8) {
+        node->prefix[i >> 3] = (bits - i >= 8) ? prefix[i >> 3] : prefix[i >> 3] & (uint8_t)(0xff << (8 - (bits - i)));
+    }
+    node->bits = (uint8_t)bits;
+    node->interned_val_ref = val;
+    *pIdx = ++tab->nNodes;
+
+finalize_it:
+    RETiRet;
+}
+
+/* insert a prefix into the trie of its family. If the same prefix occurs
+ * multiple times, the first one is kept.
+ */
+static rsRetVal cidrInsert(
+    lookup_cidr_tab_t *const tab, const int family, const uint8_t *const prefix, const unsigned bits, uchar *const val) {
+    uint32_t parent = 0; /* 0: the new node becomes the root */
+    int dir = 0;
+    uint32_t n = tab->root[family];
+    uint32_t newIdx, joinIdx;
+    unsigned common = 0;
+    DEFiRet;
+
+    while (n != 0) {
+        const lookup_cidr_node_t *const node = &tab->nodes[n - 1];
+        common = cidrCommonBits(prefix, node->prefix, (bits < node->bits) ? bits : node->bits);
+        if (common < node->bits) break;
+        if (bits == node->bits) {
+            if (node->interned_val_ref == NULL) tab->nodes[n - 1].interned_val_ref = val;
+            FINALIZE;
+        }
+        parent = n;
+        dir = cidrBit(prefix, node->bits);
+        n = node->child[dir];
+    }
+
+    CHKiRet(cidrNewNode(tab, prefix, bits, val, &newIdx));
+    if (n != 0) {
+        /* the new prefix either contains node n or forks off above it */
+        if (common == bits) {
+            tab->nodes[newIdx - 1].child[cidrBit(tab->nodes[n - 1].prefix, bits)] = n;
+        } else {
+            CHKiRet(cidrNewNode(tab, prefix, common, NULL, &joinIdx));
+            tab->nodes[joinIdx - 1].child[cidrBit(prefix, common)] = newIdx;
+            tab->nodes[joinIdx - 1].child[cidrBit(tab->nodes[n - 1].prefix, common)] = n;
+            newIdx = joinIdx;
+        }
+    }
+    if (parent == 0) {
+        tab->root[family] = newIdx;
+    } else {
+        tab->nodes[parent - 1].child[dir] = newIdx;
+    }
+
+finalize_it:
+    RETiRet;
+}
+
+/* parse a "address/length" table index; without length, the index is
+ * a single host.
+ */
+static int cidrParsePrefix(const char *const index, uint8_t *const prefix, unsigned *const pBits) {
+    char addrbuf[INET6_ADDRSTRLEN + 1];
+    const char *const slash = strchr(index, '/');
+    const size_t lenAddr = (slash == NULL) ? strlen(index) : (size_t)(slash - index);
+    int family;
+    unsigned long bits;
+    char *end;
+
+    if (lenAddr >= sizeof(addrbuf)) return -1;
+    memcpy(addrbuf, index, lenAddr);
+    addrbuf[lenAddr] = '\0';
+    if ((family = cidrParseAddr(addrbuf, prefix)) < 0) return -1;
+    if (slash == NULL) {
+        bits = (family == CIDR_FAMILY_IPV4) ? 32 : 128;
+    } else {
+        if (!isdigit((unsigned char)slash[1])) return -1;
+        errno = 0;
+        bits = strtoul(slash + 1, &end, 10);
+        if (errno == ERANGE || *end != '\0') return -1;
+        if (family == CIDR_FAMILY_IPV4 && strchr(addrbuf, ':') != NULL) {
+            /* IPv4-mapped IPv6 prefix */
+            if (bits < 96) return -1;
+            bits -= 96;
+        }
+        if (bits > ((family == CIDR_FAMILY_IPV4) ? 32ul : 128ul)) return -1;
+    }
+    *pBits = (unsigned)bits;
+    return family;
+}
+
+static rsRetVal build_CidrTable(lookup_t *pThis, struct json_object *jtab, const uchar *name) {
+    uint32_t i;
+    struct json_object *jrow, *jindex, *jvalue;
+    const char *index;
+    uchar *value;
+    uint8_t prefix[16];
+    unsigned bits;
+    int family;
+    DEFiRet;
+
+    CHKmalloc(pThis->table.cidr = calloc(1, sizeof(lookup_cidr_tab_t)));
+    for (i = 0; i < pThis->nmemb; i++) {
+        jrow = json_object_array_get_idx(jtab, i);
+        fjson_object_object_get_ex(jrow, "index", &jindex);
+        fjson_object_object_get_ex(jrow, "value", &jvalue);
+        if (jindex == NULL || json_object_is_type(jindex, json_type_null)) {
+            NO_INDEX_ERROR("cidr", name);
+        }
+        index = json_object_get_string(jindex);
+        if ((family = cidrParsePrefix(index, prefix, &bits)) < 0) {
+            LogError(0, RS_RET_INVALID_VALUE,
+                     "'cidr' lookup table named: '%s' has invalid "
+                     "index '%s', must be an IP address or prefix like '10.0.0.0/8'",
+                     name, index);
+            ABORT_FINALIZE(RS_RET_INVALID_VALUE);
+        }
+        value = (uchar *)json_object_get_string(jvalue);
+        uchar *const *const canonicalValueRef_ptr =
+            bsearch(value, pThis->interned_vals, pThis->interned_val_count, sizeof(uchar *), bs_arrcmp_str);
+        if (canonicalValueRef_ptr == NULL) {
+            LogError(0, RS_RET_ERR,
+                     "BUG: canonicalValueRef not found in "
+                     "build_CidrTable(), %s:%d",
+                     __FILE__, __LINE__);
+            ABORT_FINALIZE(RS_RET_ERR);
+        }
+        CHKiRet(cidrInsert(pThis->table.cidr, family, prefix, bits, *canonicalValueRef_ptr));
+    }
+    DBGPRINTF("lookup table '%s': cidr trie with %u nodes for %u prefixes\n", name, pThis->table.cidr->nNodes,
+              pThis->nmemb);
+
+    pThis->lookup = lookupKey_cidr;
+    pThis->key_type = LOOKUP_KEY_TYPE_STRING;
+
+finalize_it:
+    RETiRet;
+}
+
 #ifdef FEATURE_REGEXP
-static rsRetVal build_RegexTable(lookup_t *pThis, struct json_object *jtab, const uchar *name) {
+/* Try to combine all regexes of the table into a single automaton, so that
+ * a lookup needs only one pass over the key instead of one regexec() per
+ * entry. This is not possible for all regexes; then we keep using the
+ * regexec() loop.
+ */
+static void build_RegexAutomaton(lookup_t *pThis, const uchar *name) {
+    lookup_regex_tab_entry_t *const entries = pThis->table.regex->entries;
+    mregex_t *pMre = NULL;
+    uint32_t i;
+
+    if (mregexConstruct(&pMre) != RS_RET_OK) return;
+    for (i = 0; i < pThis->nmemb; ++i) {
+        if (mregexAdd(pMre, (char *)entries[i].regex_str, 0) != RS_RET_OK) {
+            DBGPRINTF("lookup table '%s': regex '%s' cannot be combined, using regexec()\n", name,
+                      entries[i].regex_str);
+            goto fail;
+        }
+    }
+    if (mregexCompile(pMre) != RS_RET_OK) {
+        DBGPRINTF("lookup table '%s': combined automaton too large, using regexec()\n", name);
+        goto fail;
+    }
+    pThis->table.regex->pMre = pMre;
+    return;
+
+fail:
+    mregexDestruct(&pMre);
+}
+
+static rsRetVal build_RegexTable(lookup_t *pThis, struct json_object *jtab, const uchar *name, const int bCombine) {
     uint32_t i;
     struct json_object *jrow, *jregex, *jtag;
     uchar *value, *canonicalValueRef;
@@ -650,6 +1060,10 @@ static rsRetVal build_RegexTable(lookup_t *pThis, struct json_object *jtab, cons
         }
     }
 
+    if (bCombine && pThis->nmemb > 1) {
+        build_RegexAutomaton(pThis, name);
+    }
+
     pThis->lookup = lookupKey_regex;
     pThis->key_type = LOOKUP_KEY_TYPE_STRING;
 
@@ -671,9 +1085,12 @@ finalize_it:
 }
 
 static rsRetVal lookupBuildTable_v1(lookup_t *pThis, struct json_object *jroot, const uchar *name) {
-    struct json_object *jnomatch, *jtype, *jtab;
+    struct json_object *jnomatch, *jtype, *jtab, *jengine, *jsearch, *jnocase;
     struct json_object *jrow, *jvalue;
     const char *table_type, *nomatch_value;
+#ifdef FEATURE_REGEXP
+    const char *engine;
+#endif
     const char *value_key;
     const uchar **all_values;
     const uchar *curr, *prev;
@@ -686,6 +1103,9 @@ static rsRetVal lookupBuildTable_v1(lookup_t *pThis, struct json_object *jroot,
     fjson_object_object_get_ex(jroot, "nomatch", &jnomatch);
     fjson_object_object_get_ex(jroot, "type", &jtype);
     fjson_object_object_get_ex(jroot, "table", &jtab);
+    fjson_object_object_get_ex(jroot, "engine", &jengine);
+    fjson_object_object_get_ex(jroot, "search", &jsearch);
+    fjson_object_object_get_ex(jroot, "nocase", &jnocase);
     if (jtab == NULL || !json_object_is_type(jtab, json_type_array)) {
         LogError(0, RS_RET_INVALID_VALUE, "lookup table named: '%s' has invalid table definition", name);
         ABORT_FINALIZE(RS_RET_INVALID_VALUE);
@@ -748,14 +1168,41 @@ static rsRetVal lookupBuildTable_v1(lookup_t *pThis, struct json_object *jroot,
     } else if (strcmp(table_type, "sparseArray") == 0) {
         pThis->type = SPARSE_ARRAY_LOOKUP_TABLE;
         CHKiRet(build_SparseArrayTable(pThis, jtab, name));
+    } else if (strcmp(table_type, "cidr") == 0) {
+        pThis->type = CIDR_LOOKUP_TABLE;
+        CHKiRet(build_CidrTable(pThis, jtab, name));
 #ifdef FEATURE_REGEXP
     } else if (strcmp(table_type, "regex") == 0) {
         pThis->type = REGEX_LOOKUP_TABLE;
-        CHKiRet(build_RegexTable(pThis, jtab, name));
+        engine = (jengine == NULL) ? "auto" : json_object_get_string(jengine);
+        if (engine == NULL || (strcmp(engine, "auto") != 0 && strcmp(engine, "serial") != 0)) {
+            LogError(0, RS_RET_INVALID_VALUE, "regex lookup table named: '%s' uses unsupported engine: '%s'", name,
+                     engine == NULL ? "(null)" : engine);
+            ABORT_FINALIZE(RS_RET_INVALID_VALUE);
+        }
+        CHKiRet(build_RegexTable(pThis, jtab, name, strcmp(engine, "auto") == 0));
 #endif
     } else if (strcmp(table_type, "string") == 0) {
         pThis->type = STRING_LOOKUP_TABLE;
-        CHKiRet(build_StringTable(pThis, jtab, name));
+        const char *const search = (jsearch == NULL) ? "auto" : json_object_get_string(jsearch);
+        int searchMode;
+        if (search != NULL && !strcmp(search, "auto")) {
+            searchMode = LOOKUP_STR_SEARCH_AUTO;
+        } else if (search != NULL && !strcmp(search, "binary")) {
+            searchMode = LOOKUP_STR_SEARCH_BINARY;
+        } else if (search != NULL && !strcmp(search, "hash")) {
+            searchMode = LOOKUP_STR_SEARCH_HASH;
+        } else {
+            LogError(0, RS_RET_INVALID_VALUE, "string lookup table named: '%s' uses unsupported search: '%s'", name,
+                     search == NULL ? "(null)" : search);
+            ABORT_FINALIZE(RS_RET_INVALID_VALUE);
+        }
+        if (jnocase != NULL && !json_object_is_type(jnocase, json_type_boolean)) {
+            LogError(0, RS_RET_INVALID_VALUE, "string lookup table named: '%s': 'nocase' must be true or false",
+                     name);
+            ABORT_FINALIZE(RS_RET_INVALID_VALUE);
+        }
+        CHKiRet(build_StringTable(pThis, jtab, name, searchMode, jnocase != NULL && json_object_get_boolean(jnocase)));
     } else {
         LogError(0, RS_RET_INVALID_VALUE,
                  "lookup table named: '%s' uses unupported "
@@ -996,6 +1443,91 @@ es_str_t *lookupKey(lookup_ref_t *pThis, lookup_key_t key) {
 }
 
 
+/* check if an array of n elements of the given size at offset off lies
+ * completely inside an image of len bytes
+ */
+static int mappedRangeOk(const uint64_t off, const uint64_t n, const size_t size, const size_t len) {
+    return off <= len && off % sizeof(uint64_t) == 0 && n <= (len - off) / size;
+}
+
+/* check if an open lookup table file is a precompiled image */
+static int lookupIsMappedImage(const int fd, const struct stat *const sb) {
+    char magic[LOOKUP_BIN_MAGIC_LEN];
+
+    return sb->st_size >= (off_t)sizeof(lookup_bin_hdr_t) && pread(fd, magic, sizeof(magic), 0) == sizeof(magic) &&
+           memcmp(magic, LOOKUP_BIN_MAGIC, LOOKUP_BIN_MAGIC_LEN) == 0;
+}
+
+/* map a precompiled lookup table image (as written by rslookupc). The
+ * mapping is read-only and shared, so the image is never copied and all
+ * rsyslog instances using it share the same page cache pages.
+ */
+static rsRetVal ATTR_NONNULL() lookupMapFile(
+    lookup_t *const pThis, const uchar *const name, const uchar *const filename, const int fd, const size_t len) {
+    void *base;
+    const lookup_bin_hdr_t *hdr;
+    size_t entrySize;
+    DEFiRet;
+
+    base = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        LogError(errno, RS_RET_IO_ERROR, "lookup table file '%s' could not be mapped", filename);
+        ABORT_FINALIZE(RS_RET_IO_ERROR);
+    }
+    hdr = (const lookup_bin_hdr_t *)base;
+    if (hdr->version != LOOKUP_BIN_VERSION || hdr->byteOrder != LOOKUP_BIN_BYTEORDER) {
+        LogError(0, RS_RET_INVALID_VALUE,
+                 "lookup table named: '%s': precompiled file '%s' has unsupported "
+                 "version or byte order, please recompile it",
+                 name, filename);
+        munmap(base, len);
+        ABORT_FINALIZE(RS_RET_INVALID_VALUE);
+    }
+
+    entrySize = (hdr->type == LOOKUP_BIN_TYPE_STRING) ? sizeof(lookup_bin_str_entry_t) : sizeof(lookup_bin_uint_entry_t);
+    if ((hdr->type != LOOKUP_BIN_TYPE_STRING && hdr->type != LOOKUP_BIN_TYPE_ARRAY &&
+         hdr->type != LOOKUP_BIN_TYPE_SPARSE_ARRAY) ||
+        hdr->fileSize != len || ((const uint8_t *)base)[len - 1] != '\0' || hdr->nomatchOff >= len ||
+        !mappedRangeOk(hdr->entriesOff, hdr->nmemb, entrySize, len) ||
+        (hdr->type == LOOKUP_BIN_TYPE_STRING &&
+         (hdr->nSlots <= hdr->nmemb || (hdr->nSlots & (hdr->nSlots - 1)) != 0 ||
+          !mappedRangeOk(hdr->slotsOff, hdr->nSlots, sizeof(lookup_bin_hslot_t), len)))) {
+        LogError(0, RS_RET_INVALID_VALUE, "lookup table named: '%s': precompiled file '%s' is corrupt", name,
+                 filename);
+        munmap(base, len);
+        ABORT_FINALIZE(RS_RET_INVALID_VALUE);
+    }
+#ifdef MADV_RANDOM
+    /* lookups hit random pages, read-ahead would only waste page cache */
+    madvise(base, len, MADV_RANDOM);
+#endif
+
+    if ((pThis->table.mapped = calloc(1, sizeof(lookup_mapped_tab_t))) == NULL) {
+        munmap(base, len);
+        ABORT_FINALIZE(RS_RET_OUT_OF_MEMORY);
+    }
+    pThis->table.mapped->base = base;
+    pThis->table.mapped->len = len;
+    pThis->table.mapped->hdr = hdr;
+    pThis->type = MAPPED_LOOKUP_TABLE;
+    pThis->nmemb = hdr->nmemb;
+    if (hdr->nomatchOff != 0) {
+        CHKmalloc(pThis->nomatch = ustrdup(mappedStr(pThis->table.mapped, hdr->nomatchOff)));
+    }
+    if (hdr->type == LOOKUP_BIN_TYPE_STRING) {
+        pThis->lookup = lookupKey_mappedStr;
+        pThis->key_type = LOOKUP_KEY_TYPE_STRING;
+    } else {
+        pThis->lookup = (hdr->type == LOOKUP_BIN_TYPE_ARRAY) ? lookupKey_mappedArr : lookupKey_mappedSprsArr;
+        pThis->key_type = LOOKUP_KEY_TYPE_UINT;
+    }
+    DBGPRINTF("lookup table '%s': mapped precompiled file '%s', %u entries\n", name, filename, pThis->nmemb);
+
+finalize_it:
+    RETiRet;
+}
+
+
 /* note: widely-deployed json_c 0.9 does NOT support incremental
  * parsing. In order to keep compatible with e.g. Ubuntu 12.04LTS,
  * we read the file into one big memory buffer and parse it at once.
@@ -1024,6 +1556,11 @@ static rsRetVal ATTR_NONNULL()
         ABORT_FINALIZE(RS_RET_FILE_NOT_FOUND);
     }
 
+    if (lookupIsMappedImage(fd, &sb)) {
+        CHKiRet(lookupMapFile(pThis, name, filename, fd, (size_t)sb.st_size));
+        FINALIZE;
+    }
+
     CHKmalloc(iobuf = malloc(sb.st_size));
 
     tokener = json_tokener_new();
@@ -28,11 +28,19 @@
 #define SPARSE_ARRAY_LOOKUP_TABLE 3
 #define STUBBED_LOOKUP_TABLE 4
 #define REGEX_LOOKUP_TABLE 5
+#define MAPPED_LOOKUP_TABLE 6 /* precompiled image, see lookup_bin.h */
+#define CIDR_LOOKUP_TABLE 7
 
 #define LOOKUP_KEY_TYPE_STRING 1
 #define LOOKUP_KEY_TYPE_UINT 2
 #define LOOKUP_KEY_TYPE_NONE 3
 
+#define LOOKUP_STR_SEARCH_AUTO 0
+#define LOOKUP_STR_SEARCH_BINARY 1
+#define LOOKUP_STR_SEARCH_HASH 2
+/* string tables with at least this many entries are hashed in "auto" mode */
+#define LOOKUP_STR_HASH_THRESHOLD 1024
+
 struct lookup_tables_s {
     lookup_ref_t *root; /* the root of the template list */
     lookup_ref_t *last; /* points to the last element of the template list */
@@ -57,8 +65,16 @@ struct lookup_string_tab_entry_s {
     uchar *interned_val_ref;
 };
 
+struct lookup_string_tab_hslot_s {
+    uint32_t hash;
+    uint32_t entry; /* index into entries + 1, 0 means empty slot */
+};
+
 struct lookup_string_tab_s {
     lookup_string_tab_entry_t *entries;
+    lookup_string_tab_hslot_t *slots; /* hash index (open addressing), NULL for binary search */
+    uint32_t slotMask;
+    uint8_t bNoCase;
 };
 
 struct lookup_regex_tab_entry_s {
@@ -70,6 +86,28 @@ struct lookup_regex_tab_entry_s {
 
 struct lookup_regex_tab_s {
     lookup_regex_tab_entry_t *entries;
+    struct mregex_s *pMre; /* all entries combined into one automaton, NULL if not possible */
+};
+
+/* node of a path-compressed binary (Patricia) trie over IP prefixes */
+struct lookup_cidr_node_s {
+    uint8_t prefix[16]; /* network address, bits beyond "bits" are zero */
+    uint8_t bits; /* prefix length */
+    uint32_t child[2]; /* index into nodes + 1, 0 means none */
+    uchar *interned_val_ref; /* NULL for nodes that only join two branches */
+};
+
+struct lookup_cidr_tab_s {
+    lookup_cidr_node_t *nodes;
+    uint32_t nNodes;
+    uint32_t maxNodes;
+    uint32_t root[2]; /* IPv4 and IPv6 trie, index into nodes + 1 */
+};
+
+struct lookup_mapped_tab_s {
+    const uint8_t *base; /* the mmap()ed image */
+    size_t len;
+    const struct lookup_bin_hdr_s *hdr;
 };
 
 struct lookup_ref_s {
@@ -102,6 +140,8 @@ struct lookup_s {
         lookup_array_tab_t *arr;
         lookup_sparseArray_tab_t *sprsArr;
         lookup_regex_tab_t *regex;
+        lookup_mapped_tab_t *mapped;
+        lookup_cidr_tab_t *cidr;
     } table;
     uint32_t interned_val_count;
     uchar **interned_vals;
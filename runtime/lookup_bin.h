@@ -0,0 +1,122 @@
+/* Definitions for the precompiled (binary) lookup table format.
+ *
+ * Copyright 2025 Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file lookup_bin.h
+ * @brief On-disk layout of precompiled lookup tables.
+ *
+ * A precompiled table is written by the rslookupc tool from the regular
+ * JSON table and is mmap()ed read-only by rsyslogd. Lookups work directly
+ * on the mapped image, so loading it costs no parsing and no allocations,
+ * and all processes using the same file share its pages.
+ *
+ * The image is:
+ *
+ *   header | entries | hash slots (string tables only) | string pool
+ *
+ * All offsets are relative to the start of the file. Entries are sorted by
+ * key. The string pool starts with an empty string and every string is NUL
+ * terminated, so the last byte of a valid image is always NUL. Numbers are
+ * in the byte order of the machine that compiled the table; the byteOrder
+ * field lets the loader reject images from a machine of other endianness.
+ *
+ * This header is shared between the runtime and the compiler tool and must
+ * not depend on other rsyslog headers.
+ */
+#ifndef INCLUDED_LOOKUP_BIN_H
+#define INCLUDED_LOOKUP_BIN_H
+
+#include <stdint.h>
+#include <ctype.h>
+
+#define LOOKUP_BIN_MAGIC "RSLKPBIN"
+#define LOOKUP_BIN_MAGIC_LEN 8
+#define LOOKUP_BIN_VERSION 1
+#define LOOKUP_BIN_BYTEORDER 0x01020304u
+
+/* table types, same values as the in-memory table types in lookup.h */
+#define LOOKUP_BIN_TYPE_STRING 1
+#define LOOKUP_BIN_TYPE_ARRAY 2
+#define LOOKUP_BIN_TYPE_SPARSE_ARRAY 3
+
+#define LOOKUP_BIN_FLAG_NOCASE 0x01 /* string keys compare case-insensitive */
+
+typedef struct lookup_bin_hdr_s {
+    char magic[LOOKUP_BIN_MAGIC_LEN];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t type;
+    uint32_t flags;
+    uint32_t nmemb;
+    uint32_t nSlots; /* number of hash slots, a power of two; 0 for numeric tables */
+    uint64_t nomatchOff; /* 0 if the table has no nomatch value */
+    uint64_t entriesOff;
+    uint64_t slotsOff;
+    uint64_t fileSize; /* detects truncated images */
+} lookup_bin_hdr_t;
+
+/* entry of a string table */
+typedef struct lookup_bin_str_entry_s {
+    uint64_t keyOff;
+    uint64_t valOff;
+} lookup_bin_str_entry_t;
+
+/* entry of an array or sparseArray table */
+typedef struct lookup_bin_uint_entry_s {
+    uint32_t key;
+    uint32_t pad;
+    uint64_t valOff;
+} lookup_bin_uint_entry_t;
+
+/* hash slot of a string table (open addressing, linear probing) */
+typedef struct lookup_bin_hslot_s {
+    uint32_t hash;
+    uint32_t entry; /* index into entries + 1, 0 means empty slot */
+} lookup_bin_hslot_t;
+
+
+/* hash for string table hash indexes. As the low bits select the slot,
+ * FNV-1a is followed by a final avalanche step. The compiler tool and the
+ * runtime must agree on it, which is why it lives here.
+ */
+static inline uint32_t lookupStrHash(const unsigned char *s, const int bNoCase) {
+    uint32_t h = 2166136261u;
+
+    if (bNoCase) {
+        for (; *s; ++s) {
+            h ^= (uint32_t)tolower(*s);
+            h *= 16777619u;
+        }
+    } else {
+        for (; *s; ++s) {
+            h ^= (uint32_t)*s;
+            h *= 16777619u;
+        }
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+#endif /* #ifndef INCLUDED_LOOKUP_BIN_H */
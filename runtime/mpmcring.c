@@ -0,0 +1,193 @@
+/* Bounded lock-free multi-producer/multi-consumer ring.
+ *
+ * Copyright 2025 Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file mpmcring.c
+ * @brief Implementation of the sequence-numbered lock-free MPMC ring.
+ *
+ * Cell i initially carries sequence number i. A producer at position pos may
+ * write cell pos & mask if its sequence equals pos; it then publishes the
+ * cell by storing pos + 1. A consumer at position pos may read the cell if
+ * its sequence equals pos + 1 and releases it by storing pos + capacity,
+ * which is exactly what the producer one lap later expects.
+ *
+ * Producer and consumer positions live on separate cache lines so that
+ * inputs and queue workers do not false-share.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <sched.h>
+
+#include "rsyslog.h"
+#include "mpmcring.h"
+
+#define RING_CACHELINE 64
+
+#if defined(__ATOMIC_ACQUIRE)
+    #define RING_LOAD_ACQ(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define RING_LOAD_RLX(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+    #define RING_STORE_REL(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+    #define RING_CAS(p, o, n) __atomic_compare_exchange_n((p), &(o), (n), 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+#else
+    /* older compilers: fall back to the full-barrier __sync family */
+    #define RING_LOAD_ACQ(p) __sync_fetch_and_add((p), 0)
+    #define RING_LOAD_RLX(p) __sync_fetch_and_add((p), 0)
+    #define RING_STORE_REL(p, v) \
+        do {                     \
+            __sync_synchronize(); \
+            *(p) = (v);          \
+        } while (0)
+    #define RING_CAS(p, o, n) __sync_bool_compare_and_swap((p), (o), (n))
+#endif
+
+struct mpmcring_cell_s {
+    size_t seq;
+    void *pData;
+};
+
+struct mpmcring_s {
+    struct mpmcring_cell_s *cells;
+    size_t mask;
+    char pad0[RING_CACHELINE - sizeof(void *) - sizeof(size_t)];
+    size_t enqPos; /* next position a producer will claim */
+    char pad1[RING_CACHELINE - sizeof(size_t)];
+    size_t deqPos; /* next position a consumer will claim */
+    char pad2[RING_CACHELINE - sizeof(size_t)];
+};
+
+
+rsRetVal mpmcringConstruct(mpmcring_t **ppThis, size_t minCapacity) {
+    mpmcring_t *pThis = NULL;
+    size_t capacity;
+    size_t i;
+    DEFiRet;
+
+    if (minCapacity == 0 || minCapacity > (SIZE_MAX >> 2)) ABORT_FINALIZE(RS_RET_PARAM_ERROR);
+    for (capacity = 2; capacity < minCapacity; capacity <<= 1)
+        ; /* just search */
+
+    CHKmalloc(pThis = calloc(1, sizeof(mpmcring_t)));
+    CHKmalloc(pThis->cells = malloc(capacity * sizeof(struct mpmcring_cell_s)));
+    for (i = 0; i < capacity; ++i) {
+        pThis->cells[i].seq = i;
+        pThis->cells[i].pData = NULL;
+    }
+    pThis->mask = capacity - 1;
+    pThis->enqPos = 0;
+    pThis->deqPos = 0;
+    *ppThis = pThis;
+
+finalize_it:
+    if (iRet != RS_RET_OK && pThis != NULL) {
+        free(pThis->cells);
+        free(pThis);
+    }
+    RETiRet;
+}
+
+
+void mpmcringDestruct(mpmcring_t **ppThis) {
+    if (*ppThis == NULL) return;
+    free((*ppThis)->cells);
+    free(*ppThis);
+    *ppThis = NULL;
+}
+
+
+size_t mpmcringCapacity(const mpmcring_t *pThis) {
+    return pThis->mask + 1;
+}
+
+
+rsRetVal mpmcringPush(mpmcring_t *pThis, void *pData) {
+    struct mpmcring_cell_s *cell;
+    size_t pos = RING_LOAD_RLX(&pThis->enqPos);
+    size_t seq;
+    intptr_t dif;
+
+    for (;;) {
+        cell = &pThis->cells[pos & pThis->mask];
+        seq = RING_LOAD_ACQ(&cell->seq);
+        dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0) {
+            if (RING_CAS(&pThis->enqPos, pos, pos + 1)) break;
+            /* CAS failed: with __atomic, pos now holds the current value */
+#if !defined(__ATOMIC_ACQUIRE)
+            pos = RING_LOAD_RLX(&pThis->enqPos);
+#endif
+        } else if (dif < 0) {
+            return RS_RET_QUEUE_FULL; /* cell still holds data from the previous lap */
+        } else {
+            pos = RING_LOAD_RLX(&pThis->enqPos);
+        }
+    }
+
+    cell->pData = pData;
+    RING_STORE_REL(&cell->seq, pos + 1);
+    return RS_RET_OK;
+}
+
+
+/* common code for mpmcringPop() and mpmcringTryPop(). If bWait is set,
+ * we yield until a claimed-but-unpublished head slot becomes visible.
+ */
+static rsRetVal doPop(mpmcring_t *const pThis, void **const ppData, const int bWait) {
+    struct mpmcring_cell_s *cell;
+    size_t pos = RING_LOAD_RLX(&pThis->deqPos);
+    size_t seq;
+    intptr_t dif;
+
+    for (;;) {
+        cell = &pThis->cells[pos & pThis->mask];
+        seq = RING_LOAD_ACQ(&cell->seq);
+        dif = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (dif == 0) {
+            if (RING_CAS(&pThis->deqPos, pos, pos + 1)) break;
+#if !defined(__ATOMIC_ACQUIRE)
+            pos = RING_LOAD_RLX(&pThis->deqPos);
+#endif
+        } else if (dif < 0) {
+            /* not yet published: either empty or a producer is mid-push */
+            if (!bWait || RING_LOAD_ACQ(&pThis->enqPos) == pos) {
+                *ppData = NULL;
+                return RS_RET_IDLE;
+            }
+            sched_yield();
+            pos = RING_LOAD_RLX(&pThis->deqPos);
+        } else {
+            pos = RING_LOAD_RLX(&pThis->deqPos);
+        }
+    }
+
+    *ppData = cell->pData;
+    RING_STORE_REL(&cell->seq, pos + pThis->mask + 1);
+    return RS_RET_OK;
+}
+
+
+rsRetVal mpmcringPop(mpmcring_t *pThis, void **ppData) {
+    return doPop(pThis, ppData, 1);
+}
+
+
+rsRetVal mpmcringTryPop(mpmcring_t *pThis, void **ppData) {
+    return doPop(pThis, ppData, 0);
+}
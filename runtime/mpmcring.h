@@ -0,0 +1,93 @@
+/* Definitions for the bounded lock-free multi-producer/multi-consumer ring.
+ *
+ * Copyright 2025 Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file mpmcring.h
+ * @brief Bounded lock-free MPMC ring of opaque pointers.
+ *
+ * This is the storage driver behind `queue.type="ringbuffer"`. It is a
+ * sequence-numbered ring (after D. Vyukov): every cell carries a sequence
+ * number that tells producers and consumers whether the cell is free,
+ * published or consumed, so both sides only ever contend on a single
+ * CAS of their own position counter.
+ *
+ * The ring itself knows nothing about messages, watermarks or flow control.
+ * Those stay in queue.c; the ring only guarantees that concurrent push and
+ * pop operations are safe without a mutex.
+ */
+#ifndef INCLUDED_MPMCRING_H
+#define INCLUDED_MPMCRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** opaque ring object */
+typedef struct mpmcring_s mpmcring_t;
+
+/**
+ * @brief Create a ring that can hold at least @p minCapacity entries.
+ *
+ * The capacity is rounded up to the next power of two.
+ * @param[out] ppThis receives the new ring
+ * @param[in] minCapacity requested minimum number of slots (must be > 0)
+ * @return RS_RET_OK, RS_RET_PARAM_ERROR or RS_RET_OUT_OF_MEMORY
+ */
+rsRetVal mpmcringConstruct(mpmcring_t **ppThis, size_t minCapacity);
+
+/**
+ * @brief Destroy a ring. Any entries still inside are NOT freed.
+ * @param[in,out] ppThis ring to destroy, set to NULL on return
+ */
+void mpmcringDestruct(mpmcring_t **ppThis);
+
+/**
+ * @brief Append one entry. Safe to call from any number of threads.
+ * @return RS_RET_OK or RS_RET_QUEUE_FULL if no slot is free
+ */
+rsRetVal mpmcringPush(mpmcring_t *pThis, void *pData);
+
+/**
+ * @brief Remove the oldest entry. Safe to call from any number of threads.
+ *
+ * If a producer has claimed the next slot but not yet published it, the
+ * call yields the CPU until the entry becomes visible. It only returns
+ * RS_RET_IDLE if no producer has claimed a slot beyond the consumer
+ * position, i.e. the ring is really empty.
+ * @param[out] ppData receives the entry (NULL when idle)
+ * @return RS_RET_OK or RS_RET_IDLE
+ */
+rsRetVal mpmcringPop(mpmcring_t *pThis, void **ppData);
+
+/**
+ * @brief Like mpmcringPop(), but never waits.
+ *
+ * Returns RS_RET_IDLE if the head slot is empty *or* claimed by a producer
+ * that has not yet published it. Used to scan several rings without getting
+ * stuck on one of them.
+ * @param[out] ppData receives the entry (NULL when idle)
+ * @return RS_RET_OK or RS_RET_IDLE
+ */
+rsRetVal mpmcringTryPop(mpmcring_t *pThis, void **ppData);
+
+/** @return number of slots in the ring (power of two) */
+size_t mpmcringCapacity(const mpmcring_t *pThis);
+
+#endif /* #ifndef INCLUDED_MPMCRING_H */
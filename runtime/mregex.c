@@ -0,0 +1,1044 @@
+/* Combined multi-regex matcher.
+ *
+ * Copyright 2025 Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file mregex.c
+ * @brief Regex set -> Thompson NFA -> DFA over byte classes.
+ *
+ * Each pattern is parsed into NFA fragments that all live in one node
+ * array; the accepting node of a pattern carries its ID. The DFA is then
+ * built eagerly by subset construction. As regexec() searches (not only
+ * at the start of the subject), every DFA step also re-enters the start
+ * nodes of all patterns. Anchors are handled during the epsilon closure:
+ * "^" can only be passed at subject start, "$" is only passed when
+ * checking acceptance at the end of the subject. Each DFA state thus
+ * records which patterns have matched at the current position and which
+ * would match if the subject ended here.
+ *
+ * Bytes that no pattern distinguishes share a class, which keeps the
+ * transition table small. If the DFA exceeds MRE_MAX_STATES states or
+ * MRE_MAX_CELLS transitions, compilation fails and the caller falls
+ * back to regexec().
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+
+#include "rsyslog.h"
+#include "mregex.h"
+
+#define MRE_MAX_NODES 32768
+#define MRE_MAX_REPEAT 255
+#define MRE_MAX_STATES 8192
+#define MRE_MAX_CELLS (1 << 21)
+#define MRE_NONE UINT32_MAX
+
+enum mreNodeType { MRE_EPS, MRE_SPLIT, MRE_CHAR, MRE_BOL, MRE_EOL, MRE_MATCH };
+
+typedef struct mreNode_s {
+    uint8_t type;
+    int out; /* successor, -1 if not yet linked */
+    int out1; /* second successor (MRE_SPLIT) or pattern ID (MRE_MATCH) */
+    uint32_t set[8]; /* MRE_CHAR: bytes accepted */
+} mreNode_t;
+
+typedef struct mrePat_s {
+    char *regex;
+    int bIgnoreCase;
+    int start; /* first NFA node */
+} mrePat_t;
+
+struct mregex_s {
+    /* the NFA */
+    mreNode_t *nodes;
+    int nNodes;
+    int maxNodes;
+    mrePat_t *pats;
+    int nPats;
+    int maxPats;
+    /* the DFA, state 0 is the initial one */
+    uint16_t cls[256];
+    unsigned nClasses;
+    uint32_t nStates;
+    uint32_t *delta; /* nStates x nClasses */
+    uint32_t *accMid; /* lowest pattern ID matching at this position */
+    uint32_t *accEnd; /* lowest pattern ID matching if the subject ends here */
+    /* all IDs: accIds[accIdx[2s]..accIdx[2s+1]) match at this position,
+     * accIds[accIdx[2s+1]..accIdx[2s+2]) additionally at the subject end */
+    uint32_t *accIdx;
+    uint32_t *accIds;
+};
+
+typedef struct mreFrag_s {
+    int start;
+    int end; /* an MRE_EPS node whose out is still unlinked */
+} mreFrag_t;
+
+typedef struct mreParse_s {
+    mregex_t *m;
+    const uchar *p;
+    int bIgnoreCase;
+    int depth;
+} mreParse_t;
+
+#define SETBIT(set, c) ((set)[(c) >> 5] |= (1u << ((c)&31)))
+#define HASBIT(set, c) ((set)[(c) >> 5] & (1u << ((c)&31)))
+
+
+/* ------------------------------ NFA ------------------------------ */
+
+static rsRetVal newNode(mregex_t *const m, const uint8_t type, int *const pIdx) {
+    mreNode_t *newNodes;
+    DEFiRet;
+
+    if (m->nNodes == m->maxNodes) {
+        if (m->maxNodes >= MRE_MAX_NODES) ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+        const int newMax = (m->maxNodes == 0) ? 256 : 2 * m->maxNodes;
+        CHKmalloc(newNodes = realloc(m->nodes, newMax * sizeof(mreNode_t)));
+        m->nodes = newNodes;
+        m->maxNodes = newMax;
+    }
+    memset(&m->nodes[m->nNodes], 0, sizeof(mreNode_t));
+    m->nodes[m->nNodes].type = type;
+    m->nodes[m->nNodes].out = -1;
+    m->nodes[m->nNodes].out1 = -1;
+    *pIdx = m->nNodes++;
+
+finalize_it:
+    RETiRet;
+}
+
+static rsRetVal fragEmpty(mregex_t *const m, mreFrag_t *const f) {
+    DEFiRet;
+    CHKiRet(newNode(m, MRE_EPS, &f->start));
+    f->end = f->start;
+finalize_it:
+    RETiRet;
+}
+
+/* a node of the given type followed by the fragment end */
+static rsRetVal fragNode(mregex_t *const m, const uint8_t type, mreFrag_t *const f) {
+    DEFiRet;
+    CHKiRet(newNode(m, type, &f->start));
+    CHKiRet(newNode(m, MRE_EPS, &f->end));
+    m->nodes[f->start].out = f->end;
+finalize_it:
+    RETiRet;
+}
+
+static rsRetVal fragSet(mregex_t *const m, const uint32_t set[8], mreFrag_t *const f) {
+    DEFiRet;
+    CHKiRet(fragNode(m, MRE_CHAR, f));
+    memcpy(m->nodes[f->start].set, set, sizeof(m->nodes[f->start].set));
+finalize_it:
+    RETiRet;
+}
+
+static void fragConcat(mregex_t *const m, mreFrag_t *const f, const mreFrag_t *const next) {
+    m->nodes[f->end].out = next->start;
+    f->end = next->end;
+}
+
+static rsRetVal fragStar(mregex_t *const m, mreFrag_t *const f) {
+    int s, e;
+    DEFiRet;
+    CHKiRet(newNode(m, MRE_SPLIT, &s));
+    CHKiRet(newNode(m, MRE_EPS, &e));
+    m->nodes[s].out = f->start;
+    m->nodes[s].out1 = e;
+    m->nodes[f->end].out = s;
+    f->start = s;
+    f->end = e;
+finalize_it:
+    RETiRet;
+}
+
+static rsRetVal fragPlus(mregex_t *const m, mreFrag_t *const f) {
+    int s, e;
+    DEFiRet;
+    CHKiRet(newNode(m, MRE_SPLIT, &s));
+    CHKiRet(newNode(m, MRE_EPS, &e));
+    m->nodes[s].out = f->start;
+    m->nodes[s].out1 = e;
+    m->nodes[f->end].out = s;
+    f->end = e;
+finalize_it:
+    RETiRet;
+}
+
+static rsRetVal fragOpt(mregex_t *const m, mreFrag_t *const f) {
+    int s, e;
+    DEFiRet;
+    CHKiRet(newNode(m, MRE_SPLIT, &s));
+    CHKiRet(newNode(m, MRE_EPS, &e));
+    m->nodes[s].out = f->start;
+    m->nodes[s].out1 = e;
+    m->nodes[f->end].out = e;
+    f->start = s;
+    f->end = e;
+finalize_it:
+    RETiRet;
+}
+
+static void setIgnoreCase(uint32_t set[8]) {
+    int c;
+    for (c = 0; c < 256; ++c) {
+        if (HASBIT(set, c)) {
+            SETBIT(set, tolower(c));
+            SETBIT(set, toupper(c));
+        }
+    }
+}
+
+static void setNegate(uint32_t set[8]) {
+    int i;
+    for (i = 0; i < 8; ++i) set[i] = ~set[i];
+}
+
+/* add a [:name:] character class; returns 0 if the name is unknown */
+static int setAddClass(uint32_t set[8], const uchar *const name, const size_t len) {
+    static const struct {
+        const char *name;
+        int (*isFn)(int);
+    } classes[] = {{"alpha", isalpha}, {"digit", isdigit}, {"alnum", isalnum}, {"upper", isupper},
+                   {"lower", islower},  {"space", isspace}, {"blank", isblank}, {"punct", ispunct},
+                   {"print", isprint},  {"graph", isgraph}, {"cntrl", iscntrl}, {"xdigit", isxdigit}};
+    size_t i;
+    int c;
+
+    for (i = 0; i < sizeof(classes) / sizeof(classes[0]); ++i) {
+        if (strlen(classes[i].name) == len && !strncmp(classes[i].name, (const char *)name, len)) {
+            for (c = 0; c < 256; ++c) {
+                if (classes[i].isFn(c)) SETBIT(set, c);
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* parse a bracket expression, ps->p is just after the opening "[" */
+static rsRetVal parseBracket(mreParse_t *const ps, uint32_t set[8]) {
+    int bNegate = 0;
+    int lo, hi, c;
+    const uchar *first;
+    DEFiRet;
+
+    memset(set, 0, 8 * sizeof(uint32_t));
+    if (*ps->p == '^') {
+        bNegate = 1;
+        ++ps->p;
+    }
+    /* a "]" right at the start is an ordinary char, it may also start a range */
+    first = ps->p;
+    while (*ps->p != ']' || ps->p == first) {
+        if (*ps->p == '\0') ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+        if (ps->p[0] == '[' && (ps->p[1] == ':' || ps->p[1] == '=' || ps->p[1] == '.')) {
+            /* equivalence classes and collating symbols are not supported */
+            if (ps->p[1] != ':') ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+            const uchar *const name = ps->p + 2;
+            const uchar *end = name;
+            while (*end != '\0' && !(end[0] == ':' && end[1] == ']')) ++end;
+            if (*end == '\0' || !setAddClass(set, name, end - name)) ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+            ps->p = end + 2;
+            continue;
+        }
+        lo = *ps->p++;
+        if (ps->p[0] == '-' && ps->p[1] != ']' && ps->p[1] != '\0') {
+            hi = ps->p[1];
+            if (hi == '[' || hi < lo) ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+            for (c = lo; c <= hi; ++c) SETBIT(set, c);
+            ps->p += 2;
+        } else {
+            SETBIT(set, lo);
+        }
+    }
+    ++ps->p;
+
+    if (ps->bIgnoreCase) setIgnoreCase(set);
+    if (bNegate) setNegate(set);
+
+finalize_it:
+    RETiRet;
+}
+
+static rsRetVal parseRegex(mreParse_t *ps, mreFrag_t *f);
+static rsRetVal parseQuant(mreParse_t *ps, const uchar *atomStart, mreFrag_t *f);
+
+static rsRetVal parseAtom(mreParse_t *const ps, mreFrag_t *const f) {
+    uint32_t set[8];
+    int c;
+    DEFiRet;
+
+    memset(set, 0, sizeof(set));
+    switch (*ps->p) {
+        case '(':
+            ++ps->p;
+            if (*ps->p == ')') {
+                ++ps->p;
+                CHKiRet(fragEmpty(ps->m, f));
+                break;
+            }
+            ++ps->depth;
+            CHKiRet(parseRegex(ps, f));
+            --ps->depth;
+            if (*ps->p != ')') ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+            ++ps->p;
+            break;
+        case '.':
+            ++ps->p;
+            setNegate(set);
+            CHKiRet(fragSet(ps->m, set, f));
+            break;
+        case '[':
+            ++ps->p;
+            CHKiRet(parseBracket(ps, set));
+            CHKiRet(fragSet(ps->m, set, f));
+            break;
+        case '^':
+            ++ps->p;
+            CHKiRet(fragNode(ps->m, MRE_BOL, f));
+            break;
+        case '$':
+            ++ps->p;
+            CHKiRet(fragNode(ps->m, MRE_EOL, f));
+            break;
+        case '\\':
+            c = ps->p[1];
+            if (c == '\0') ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+            ps->p += 2;
+            /* only escaped special chars are plain literals. Everything else
+             * is either a back reference or a GNU extension (word boundaries,
+             * buffer anchors, \w, \s, ...) whose exact semantics we do not
+             * replicate, so leave it to regexec().
+             */
+            if (c > 0x7f || strchr(".[]\\*+?{}()|^$", c) == NULL) ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+            SETBIT(set, c);
+            if (ps->bIgnoreCase) setIgnoreCase(set);
+            CHKiRet(fragSet(ps->m, set, f));
+            break;
+        case '*':
+        case '+':
+        case '?':
+        case '{':
+        case '|':
+        case ')':
+        case '\0':
+            ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+        default:
+            SETBIT(set, *ps->p);
+            ++ps->p;
+            if (ps->bIgnoreCase) setIgnoreCase(set);
+            CHKiRet(fragSet(ps->m, set, f));
+            break;
+    }
+
+finalize_it:
+    RETiRet;
+}
+
+/* parse the text between start and end (an atom plus quantifiers) once
+ * more, used to create the copies needed for bounded repetition.
+ */
+static rsRetVal parseCopy(mreParse_t *const ps, const uchar *const start, const uchar *const end, mreFrag_t *const f) {
+    const uchar *const save = ps->p;
+    DEFiRet;
+
+    ps->p = start;
+    CHKiRet(parseAtom(ps, f));
+    while (ps->p < end) CHKiRet(parseQuant(ps, start, f));
+
+finalize_it:
+    ps->p = save;
+    RETiRet;
+}
+
+static rsRetVal parseNum(mreParse_t *const ps, int *const pNum) {
+    int num = 0;
+    DEFiRet;
+
+    while (isdigit(*ps->p)) {
+        num = num * 10 + (*ps->p++ - '0');
+        if (num > MRE_MAX_REPEAT) ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+    }
+    *pNum = num;
+
+finalize_it:
+    RETiRet;
+}
+
+/* parse "{m}", "{m,}", "{m,n}" or "{,n}", ps->p is just after the "{";
+ * max is -1 if unbounded.
+ */
+static rsRetVal parseBound(mreParse_t *const ps, int *const pMin, int *const pMax) {
+    int min = -1, max;
+    DEFiRet;
+
+    if (isdigit(*ps->p)) CHKiRet(parseNum(ps, &min));
+    if (*ps->p == ',') {
+        ++ps->p;
+        if (isdigit(*ps->p)) {
+            CHKiRet(parseNum(ps, &max));
+        } else {
+            max = -1;
+        }
+    } else {
+        max = min;
+    }
+    if (*ps->p != '}') ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+    ++ps->p;
+    if (min == -1) {
+        if (max == -1) ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+        min = 0;
+    }
+    if (max != -1 && max < min) ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+    *pMin = min;
+    *pMax = max;
+
+finalize_it:
+    RETiRet;
+}
+
+/* f is the first copy of the repeated item, which spans atomStart..quant */
+static rsRetVal parseRepeat(mreParse_t *const ps,
+                            const uchar *const atomStart,
+                            const uchar *const quant,
+                            mreFrag_t *const f,
+                            const int min,
+                            const int max) {
+    mregex_t *const m = ps->m;
+    mreFrag_t res, cp;
+    int i;
+    DEFiRet;
+
+    if (max == 0) {
+        CHKiRet(fragEmpty(m, f));
+        FINALIZE;
+    }
+    res = *f;
+    if (min == 0) {
+        if (max == -1) {
+            CHKiRet(fragStar(m, &res));
+        } else {
+            CHKiRet(fragOpt(m, &res));
+            for (i = 1; i < max; ++i) {
+                CHKiRet(parseCopy(ps, atomStart, quant, &cp));
+                CHKiRet(fragOpt(m, &cp));
+                fragConcat(m, &res, &cp);
+            }
+        }
+    } else {
+        for (i = 1; i < min; ++i) {
+            CHKiRet(parseCopy(ps, atomStart, quant, &cp));
+            fragConcat(m, &res, &cp);
+        }
+        if (max == -1) {
+            CHKiRet(parseCopy(ps, atomStart, quant, &cp));
+            CHKiRet(fragStar(m, &cp));
+            fragConcat(m, &res, &cp);
+        } else {
+            for (i = min; i < max; ++i) {
+                CHKiRet(parseCopy(ps, atomStart, quant, &cp));
+                CHKiRet(fragOpt(m, &cp));
+                fragConcat(m, &res, &cp);
+            }
+        }
+    }
+    *f = res;
+
+finalize_it:
+    RETiRet;
+}
+
+static rsRetVal parseQuant(mreParse_t *const ps, const uchar *const atomStart, mreFrag_t *const f) {
+    const uchar *const quant = ps->p;
+    int min, max;
+    DEFiRet;
+
+    switch (*ps->p++) {
+        case '*':
+            CHKiRet(fragStar(ps->m, f));
+            break;
+        case '+':
+            CHKiRet(fragPlus(ps->m, f));
+            break;
+        case '?':
+            CHKiRet(fragOpt(ps->m, f));
+            break;
+        case '{':
+            CHKiRet(parseBound(ps, &min, &max));
+            CHKiRet(parseRepeat(ps, atomStart, quant, f, min, max));
+            break;
+        default:
+            ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+    }
+
+finalize_it:
+    RETiRet;
+}
+
+static int isQuant(const uchar c) {
+    return c == '*' || c == '+' || c == '?' || c == '{';
+}
+
+static rsRetVal parsePiece(mreParse_t *const ps, mreFrag_t *const f) {
+    const uchar *const atomStart = ps->p;
+    DEFiRet;
+
+    CHKiRet(parseAtom(ps, f));
+    /* regcomp() treats quantified anchors specially, so we do not try */
+    if ((*atomStart == '^' || *atomStart == '$') && isQuant(*ps->p)) ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+    while (isQuant(*ps->p)) CHKiRet(parseQuant(ps, atomStart, f));
+
+finalize_it:
+    RETiRet;
+}
+
+static rsRetVal parseBranch(mreParse_t *const ps, mreFrag_t *const f) {
+    mreFrag_t piece;
+    DEFiRet;
+
+    CHKiRet(fragEmpty(ps->m, f));
+    while (*ps->p != '\0' && *ps->p != '|') {
+        if (*ps->p == ')') {
+            if (ps->depth == 0) ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+            break;
+        }
+        CHKiRet(parsePiece(ps, &piece));
+        fragConcat(ps->m, f, &piece);
+    }
+
+finalize_it:
+    RETiRet;
+}
+
+static rsRetVal parseRegex(mreParse_t *const ps, mreFrag_t *const f) {
+    mregex_t *const m = ps->m;
+    mreFrag_t alt;
+    int s, e;
+    DEFiRet;
+
+    CHKiRet(parseBranch(ps, f));
+    while (*ps->p == '|') {
+        ++ps->p;
+        CHKiRet(parseBranch(ps, &alt));
+        CHKiRet(newNode(m, MRE_SPLIT, &s));
+        CHKiRet(newNode(m, MRE_EPS, &e));
+        m->nodes[s].out = f->start;
+        m->nodes[s].out1 = alt.start;
+        m->nodes[f->end].out = e;
+        m->nodes[alt.end].out = e;
+        f->start = s;
+        f->end = e;
+    }
+
+finalize_it:
+    RETiRet;
+}
+
+
+/* regexec() lets a "^" that is preceded by something in the pattern match
+ * after a newline, and a "$" that is followed by something match before
+ * one (not covered by POSIX). We do not emulate that and reject such
+ * patterns: no "^" may be reached after a byte was consumed, and no byte
+ * may be consumed after a "$".
+ */
+static rsRetVal checkAnchors(const mregex_t *const m, const int first) {
+    const int n = m->nNodes - first;
+    uint8_t *seen = NULL;
+    int *stack = NULL;
+    int sp, i, pass;
+    DEFiRet;
+
+    CHKmalloc(seen = malloc(n));
+    CHKmalloc(stack = malloc(n * sizeof(int)));
+
+#define PUSH(x)                                    \
+    do {                                           \
+        if ((x) >= 0 && !seen[(x)-first]) {        \
+            seen[(x)-first] = 1;                   \
+            stack[sp++] = (x);                     \
+        }                                          \
+    } while (0)
+
+    for (pass = 0; pass < 2; ++pass) {
+        const uint8_t from = (pass == 0) ? MRE_CHAR : MRE_EOL;
+        memset(seen, 0, n);
+        sp = 0;
+        for (i = first; i < m->nNodes; ++i) {
+            if (m->nodes[i].type == from) PUSH(m->nodes[i].out);
+        }
+        while (sp > 0) {
+            const mreNode_t *const node = &m->nodes[stack[--sp]];
+            if ((pass == 0 && node->type == MRE_BOL) || (pass == 1 && node->type == MRE_CHAR))
+                ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+            if (node->type == MRE_CHAR || node->type == MRE_MATCH) continue;
+            PUSH(node->out);
+            if (node->type == MRE_SPLIT) PUSH(node->out1);
+        }
+    }
+#undef PUSH
+
+finalize_it:
+    free(stack);
+    free(seen);
+    RETiRet;
+}
+
+
+rsRetVal mregexConstruct(mregex_t **const ppThis) {
+    mregex_t *pThis;
+    DEFiRet;
+
+    CHKmalloc(pThis = calloc(1, sizeof(mregex_t)));
+    *ppThis = pThis;
+
+finalize_it:
+    RETiRet;
+}
+
+
+rsRetVal mregexAdd(mregex_t *const pThis, const char *const regex, const int bIgnoreCase) {
+    const int nNodesSave = pThis->nNodes;
+    mreParse_t ps;
+    mreFrag_t f;
+    mrePat_t *newPats;
+    int match;
+    DEFiRet;
+
+    ps.m = pThis;
+    ps.p = (const uchar *)regex;
+    ps.bIgnoreCase = bIgnoreCase;
+    ps.depth = 0;
+    CHKiRet(parseRegex(&ps, &f));
+    if (*ps.p != '\0') ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+    CHKiRet(newNode(pThis, MRE_MATCH, &match));
+    pThis->nodes[match].out1 = pThis->nPats;
+    pThis->nodes[f.end].out = match;
+    CHKiRet(checkAnchors(pThis, nNodesSave));
+
+    if (pThis->nPats == pThis->maxPats) {
+        const int newMax = (pThis->maxPats == 0) ? 16 : 2 * pThis->maxPats;
+        CHKmalloc(newPats = realloc(pThis->pats, newMax * sizeof(mrePat_t)));
+        pThis->pats = newPats;
+        pThis->maxPats = newMax;
+    }
+    CHKmalloc(pThis->pats[pThis->nPats].regex = strdup(regex));
+    pThis->pats[pThis->nPats].bIgnoreCase = bIgnoreCase;
+    pThis->pats[pThis->nPats].start = f.start;
+    ++pThis->nPats;
+
+finalize_it:
+    if (iRet != RS_RET_OK) {
+        /* drop what we have built for this pattern */
+        pThis->nNodes = nNodesSave;
+    }
+    RETiRet;
+}
+
+
+rsRetVal mregexAddSet(mregex_t *const pThis, const mregex_t *const pSrc) {
+    int i;
+    DEFiRet;
+
+    for (i = 0; i < pSrc->nPats; ++i) CHKiRet(mregexAdd(pThis, pSrc->pats[i].regex, pSrc->pats[i].bIgnoreCase));
+
+finalize_it:
+    RETiRet;
+}
+
+
+int mregexNumPatterns(const mregex_t *const pThis) {
+    return pThis->nPats;
+}
+
+
+/* ------------------------------ DFA ------------------------------ */
+
+typedef struct mreBuild_s {
+    mregex_t *m;
+    uint32_t *mark; /* per NFA node: generation in which it was visited */
+    uint32_t gen;
+    int *stack;
+    int *cur; /* recorded nodes of the set currently being built */
+    int nCur;
+    int *startSet; /* closure of all pattern starts, not at subject start */
+    int nStart;
+    int *pool; /* sorted node sets of all DFA states */
+    size_t poolLen;
+    size_t poolMax;
+    size_t *setOff;
+    int *setLen;
+    uint8_t *atStart;
+    uint32_t *hash; /* state + 1, 0 is empty */
+    uint32_t maxStates;
+    uint32_t maxDelta;
+} mreBuild_t;
+
+#define MRE_HASH_SIZE (2 * MRE_MAX_STATES)
+
+/* add the epsilon closure of node to b->cur. Only nodes that are
+ * relevant to the DFA (byte matches, unpassed "$" and accepting nodes)
+ * are recorded.
+ */
+static void closure(mreBuild_t *const b, const int node, const int bAtStart, const int bAtEnd) {
+    const mreNode_t *const nodes = b->m->nodes;
+    int sp = 0;
+
+#define PUSH(x)                                       \
+    do {                                              \
+        if ((x) >= 0 && b->mark[(x)] != b->gen) {     \
+            b->mark[(x)] = b->gen;                    \
+            b->stack[sp++] = (x);                     \
+        }                                             \
+    } while (0)
+
+    PUSH(node);
+    while (sp > 0) {
+        const int idx = b->stack[--sp];
+        const mreNode_t *const n = &nodes[idx];
+        switch (n->type) {
+            case MRE_EPS:
+                PUSH(n->out);
+                break;
+            case MRE_SPLIT:
+                PUSH(n->out);
+                PUSH(n->out1);
+                break;
+            case MRE_BOL:
+                if (bAtStart) PUSH(n->out);
+                break;
+            case MRE_EOL:
+                if (bAtEnd)
+                    PUSH(n->out);
+                else
+                    b->cur[b->nCur++] = idx;
+                break;
+            case MRE_CHAR:
+            case MRE_MATCH:
+            default:
+                b->cur[b->nCur++] = idx;
+                break;
+        }
+    }
+#undef PUSH
+}
+
+static int cmpInt(const void *a, const void *b) {
+    return *(const int *)a - *(const int *)b;
+}
+
+static uint32_t hashSet(const int *const set, const int len, const int bAtStart) {
+    uint32_t h = 2166136261u ^ (uint32_t)bAtStart;
+    int i;
+    for (i = 0; i < len; ++i) {
+        h ^= (uint32_t)set[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* find the DFA state for the set in b->cur or create it */
+static rsRetVal findOrAddState(mreBuild_t *const b, const int bAtStart, uint32_t *const pState) {
+    mregex_t *const m = b->m;
+    uint32_t h, s;
+    int *newPool;
+    uint32_t *newDelta;
+    DEFiRet;
+
+    qsort(b->cur, b->nCur, sizeof(int), cmpInt);
+    h = hashSet(b->cur, b->nCur, bAtStart) & (MRE_HASH_SIZE - 1);
+    while (b->hash[h] != 0) {
+        s = b->hash[h] - 1;
+        if (b->setLen[s] == b->nCur && b->atStart[s] == bAtStart &&
+            !memcmp(b->pool + b->setOff[s], b->cur, b->nCur * sizeof(int))) {
+            *pState = s;
+            FINALIZE;
+        }
+        h = (h + 1) & (MRE_HASH_SIZE - 1);
+    }
+
+    if (m->nStates == b->maxStates) ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+    if (b->poolLen + b->nCur > b->poolMax) {
+        const size_t newMax = 2 * (b->poolLen + b->nCur);
+        CHKmalloc(newPool = realloc(b->pool, newMax * sizeof(int)));
+        b->pool = newPool;
+        b->poolMax = newMax;
+    }
+    if (m->nStates == b->maxDelta) {
+        const uint32_t newMax = (b->maxDelta == 0) ? 64 : 2 * b->maxDelta;
+        CHKmalloc(newDelta = realloc(m->delta, (size_t)newMax * m->nClasses * sizeof(uint32_t)));
+        m->delta = newDelta;
+        b->maxDelta = newMax;
+    }
+    s = m->nStates++;
+    memcpy(b->pool + b->poolLen, b->cur, b->nCur * sizeof(int));
+    b->setOff[s] = b->poolLen;
+    b->setLen[s] = b->nCur;
+    b->atStart[s] = (uint8_t)bAtStart;
+    b->poolLen += b->nCur;
+    b->hash[h] = s + 1;
+    *pState = s;
+
+finalize_it:
+    RETiRet;
+}
+
+/* assign a class to each byte; bytes that are in exactly the same
+ * character sets share a class. rep receives one byte per class.
+ */
+static void buildClasses(mregex_t *const m, uint8_t *const rep) {
+    int map[512];
+    uint16_t tmp[256];
+    unsigned n;
+    int i, c;
+
+    memset(m->cls, 0, sizeof(m->cls));
+    m->nClasses = 1;
+    for (i = 0; i < m->nNodes; ++i) {
+        if (m->nodes[i].type != MRE_CHAR) continue;
+        for (c = 0; c < (int)(2 * m->nClasses); ++c) map[c] = -1;
+        n = 0;
+        for (c = 0; c < 256; ++c) {
+            const int key = 2 * m->cls[c] + (HASBIT(m->nodes[i].set, c) ? 1 : 0);
+            if (map[key] == -1) map[key] = n++;
+            tmp[c] = (uint16_t)map[key];
+        }
+        memcpy(m->cls, tmp, sizeof(m->cls));
+        m->nClasses = n;
+    }
+    for (c = 255; c >= 0; --c) rep[m->cls[c]] = (uint8_t)c;
+}
+
+static void freeAutomaton(mregex_t *const m) {
+    free(m->delta);
+    free(m->accMid);
+    free(m->accEnd);
+    free(m->accIdx);
+    free(m->accIds);
+    m->delta = NULL;
+    m->accMid = m->accEnd = m->accIdx = m->accIds = NULL;
+    m->nStates = 0;
+}
+
+/* compute the accepted pattern IDs of all states */
+static rsRetVal buildAccept(mreBuild_t *const b) {
+    mregex_t *const m = b->m;
+    size_t nIds = 0, maxIds = 0;
+    uint32_t *newIds;
+    uint32_t s;
+    int i;
+    DEFiRet;
+
+    CHKmalloc(m->accMid = malloc(m->nStates * sizeof(uint32_t)));
+    CHKmalloc(m->accEnd = malloc(m->nStates * sizeof(uint32_t)));
+    CHKmalloc(m->accIdx = malloc((2 * m->nStates + 1) * sizeof(uint32_t)));
+    for (s = 0; s < m->nStates; ++s) {
+        const int *const set = b->pool + b->setOff[s];
+        const int len = b->setLen[s];
+        uint32_t minMid = MRE_NONE, minEnd;
+
+        /* matches at this position; they also mark the accepting nodes
+         * so that the end-of-subject closure does not record them again
+         */
+        b->nCur = 0;
+        ++b->gen;
+        for (i = 0; i < len; ++i) {
+            if (m->nodes[set[i]].type == MRE_MATCH) {
+                b->cur[b->nCur++] = set[i];
+                b->mark[set[i]] = b->gen;
+            }
+        }
+        const int nMid = b->nCur;
+        for (i = 0; i < len; ++i) {
+            if (m->nodes[set[i]].type == MRE_EOL) closure(b, set[i], b->atStart[s], 1);
+        }
+
+        if (nIds + b->nCur > maxIds) {
+            maxIds = 2 * (nIds + b->nCur);
+            CHKmalloc(newIds = realloc(m->accIds, maxIds * sizeof(uint32_t)));
+            m->accIds = newIds;
+        }
+        m->accIdx[2 * s] = nIds;
+        for (i = 0; i < nMid; ++i) {
+            const uint32_t id = (uint32_t)m->nodes[b->cur[i]].out1;
+            m->accIds[nIds++] = id;
+            if (id < minMid) minMid = id;
+        }
+        m->accIdx[2 * s + 1] = nIds;
+        minEnd = minMid;
+        for (i = nMid; i < b->nCur; ++i) {
+            if (m->nodes[b->cur[i]].type != MRE_MATCH) continue;
+            const uint32_t id = (uint32_t)m->nodes[b->cur[i]].out1;
+            m->accIds[nIds++] = id;
+            if (id < minEnd) minEnd = id;
+        }
+        m->accMid[s] = minMid;
+        m->accEnd[s] = minEnd;
+    }
+    m->accIdx[2 * m->nStates] = nIds;
+
+finalize_it:
+    RETiRet;
+}
+
+
+rsRetVal mregexCompile(mregex_t *const pThis) {
+    mreBuild_t b;
+    uint8_t rep[256];
+    uint32_t s, t;
+    unsigned c;
+    int i;
+    DEFiRet;
+
+    memset(&b, 0, sizeof(b));
+    b.m = pThis;
+    freeAutomaton(pThis);
+    buildClasses(pThis, rep);
+    b.maxStates = MRE_MAX_CELLS / pThis->nClasses;
+    if (b.maxStates > MRE_MAX_STATES) b.maxStates = MRE_MAX_STATES;
+
+    const size_t nNodes = (pThis->nNodes > 0) ? pThis->nNodes : 1;
+    CHKmalloc(b.mark = calloc(nNodes, sizeof(uint32_t)));
+    CHKmalloc(b.stack = malloc(nNodes * sizeof(int)));
+    CHKmalloc(b.cur = malloc(nNodes * sizeof(int)));
+    CHKmalloc(b.startSet = malloc(nNodes * sizeof(int)));
+    CHKmalloc(b.pool = malloc(nNodes * sizeof(int)));
+    b.poolMax = nNodes;
+    CHKmalloc(b.setOff = malloc(b.maxStates * sizeof(size_t)));
+    CHKmalloc(b.setLen = malloc(b.maxStates * sizeof(int)));
+    CHKmalloc(b.atStart = malloc(b.maxStates));
+    CHKmalloc(b.hash = calloc(MRE_HASH_SIZE, sizeof(uint32_t)));
+
+    /* the start nodes as re-entered at every position after the first */
+    ++b.gen;
+    b.nCur = 0;
+    for (i = 0; i < pThis->nPats; ++i) closure(&b, pThis->pats[i].start, 0, 0);
+    memcpy(b.startSet, b.cur, b.nCur * sizeof(int));
+    b.nStart = b.nCur;
+
+    /* initial state */
+    ++b.gen;
+    b.nCur = 0;
+    for (i = 0; i < pThis->nPats; ++i) closure(&b, pThis->pats[i].start, 1, 0);
+    CHKiRet(findOrAddState(&b, 1, &t));
+
+    /* states are appended while we go, so this visits all of them */
+    for (s = 0; s < pThis->nStates; ++s) {
+        for (c = 0; c < pThis->nClasses; ++c) {
+            ++b.gen;
+            b.nCur = 0;
+            for (i = 0; i < b.setLen[s]; ++i) {
+                const mreNode_t *const n = &pThis->nodes[b.pool[b.setOff[s] + i]];
+                if (n->type == MRE_CHAR && HASBIT(n->set, rep[c])) closure(&b, n->out, 0, 0);
+            }
+            for (i = 0; i < b.nStart; ++i) {
+                if (b.mark[b.startSet[i]] != b.gen) {
+                    b.mark[b.startSet[i]] = b.gen;
+                    b.cur[b.nCur++] = b.startSet[i];
+                }
+            }
+            CHKiRet(findOrAddState(&b, 0, &t));
+            pThis->delta[s * pThis->nClasses + c] = t;
+        }
+    }
+
+    CHKiRet(buildAccept(&b));
+    DBGPRINTF("mregex: compiled %d patterns, %d NFA nodes into %u DFA states, %u byte classes\n", pThis->nPats,
+              pThis->nNodes, pThis->nStates, pThis->nClasses);
+
+finalize_it:
+    if (iRet != RS_RET_OK) {
+        DBGPRINTF("mregex: cannot build automaton for %d patterns, error %d\n", pThis->nPats, iRet);
+        freeAutomaton(pThis);
+    }
+    free(b.mark);
+    free(b.stack);
+    free(b.cur);
+    free(b.startSet);
+    free(b.pool);
+    free(b.setOff);
+    free(b.setLen);
+    free(b.atStart);
+    free(b.hash);
+    RETiRet;
+}
+
+
+int mregexFirst(const mregex_t *const pThis, const uchar *const buf, const size_t len) {
+    const uint32_t *const delta = pThis->delta;
+    const uint32_t *const accMid = pThis->accMid;
+    const unsigned nCls = pThis->nClasses;
+    uint32_t s = 0;
+    uint32_t best = accMid[0];
+    size_t i;
+
+    for (i = 0; i < len && best != 0; ++i) {
+        s = delta[s * nCls + pThis->cls[buf[i]]];
+        if (accMid[s] < best) best = accMid[s];
+    }
+    if (pThis->accEnd[s] < best) best = pThis->accEnd[s];
+    return (best == MRE_NONE) ? -1 : (int)best;
+}
+
+
+int mregexAll(const mregex_t *const pThis, const uchar *const buf, const size_t len, uint8_t *const matched) {
+    const uint32_t *const delta = pThis->delta;
+    const unsigned nCls = pThis->nClasses;
+    uint32_t s = 0;
+    uint32_t j;
+    size_t i;
+    int n = 0;
+
+    memset(matched, 0, pThis->nPats);
+    for (i = 0; i <= len; ++i) {
+        if (i > 0) s = delta[s * nCls + pThis->cls[buf[i - 1]]];
+        for (j = pThis->accIdx[2 * s]; j < pThis->accIdx[2 * s + 1]; ++j) {
+            if (!matched[pThis->accIds[j]]) {
+                matched[pThis->accIds[j]] = 1;
+                ++n;
+            }
+        }
+    }
+    for (j = pThis->accIdx[2 * s + 1]; j < pThis->accIdx[2 * s + 2]; ++j) {
+        if (!matched[pThis->accIds[j]]) {
+            matched[pThis->accIds[j]] = 1;
+            ++n;
+        }
+    }
+    return n;
+}
+
+
+void mregexDestruct(mregex_t **const ppThis) {
+    mregex_t *const pThis = *ppThis;
+    int i;
+
+    if (pThis == NULL) return;
+    freeAutomaton(pThis);
+    for (i = 0; i < pThis->nPats; ++i) free(pThis->pats[i].regex);
+    free(pThis->pats);
+    free(pThis->nodes);
+    free(pThis);
+    *ppThis = NULL;
+}
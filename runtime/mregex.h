@@ -0,0 +1,86 @@
+/* Definitions for the combined multi-regex matcher.
+ *
+ * Copyright 2025 Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file mregex.h
+ * @brief Match a string against a whole set of POSIX extended regular
+ *        expressions in a single pass.
+ *
+ * All patterns of a set are compiled into one deterministic automaton.
+ * Matching then costs one table lookup per subject byte, no matter how
+ * many patterns the set contains, and tells which patterns matched. The
+ * result is the same as calling regexec() for each pattern (compiled with
+ * REG_EXTENDED and, optionally, REG_ICASE) in the "C" locale, which is
+ * what rsyslogd runs under.
+ *
+ * Only a subset of the syntax accepted by regcomp() is supported: back
+ * references, collating elements and GNU escapes (word boundaries, \w,
+ * \s, ...) are not; a backslash may only quote a special char. Also, the
+ * automaton of some pattern sets would become too large. In both cases
+ * the caller is told so and must keep using regexec(); so the matcher is
+ * purely an optimization and never changes results.
+ *
+ * A compiled matcher is read-only and may be used by many threads
+ * concurrently.
+ */
+#ifndef INCLUDED_MREGEX_H
+#define INCLUDED_MREGEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct mregex_s mregex_t;
+
+/** @brief Create an empty pattern set. */
+rsRetVal mregexConstruct(mregex_t **ppThis);
+
+/**
+ * @brief Add a pattern to the set; its ID is the number of patterns added before.
+ * @return RS_RET_NOT_IMPLEMENTED if the pattern uses unsupported syntax,
+ *         in which case the set is unchanged.
+ */
+rsRetVal mregexAdd(mregex_t *pThis, const char *regex, int bIgnoreCase);
+
+/** @brief Add all patterns of another set, keeping their order. */
+rsRetVal mregexAddSet(mregex_t *pThis, const mregex_t *pSrc);
+
+/**
+ * @brief Build the automaton; must be called again after patterns were added.
+ * @return RS_RET_NOT_IMPLEMENTED if the automaton would be too large.
+ */
+rsRetVal mregexCompile(mregex_t *pThis);
+
+int mregexNumPatterns(const mregex_t *pThis);
+
+/** @brief Return the lowest ID of all matching patterns, or -1 if none matches. */
+int mregexFirst(const mregex_t *pThis, const uchar *buf, size_t len);
+
+/**
+ * @brief Find all matching patterns.
+ * @param matched array with one entry per pattern, set to 1 for each
+ *        matching pattern and to 0 for the others
+ * @return number of matching patterns
+ */
+int mregexAll(const mregex_t *pThis, const uchar *buf, size_t len, uint8_t *matched);
+
+void mregexDestruct(mregex_t **ppThis);
+
+#endif /* #ifndef INCLUDED_MREGEX_H */
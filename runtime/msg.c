@@ -63,9 +63,11 @@
 #include "prop.h"
 #include "net.h"
 #include "var.h"
+#include "stream.h"
 #include "rsconf.h"
 #include "parserif.h"
 #include "errmsg.h"
+#include "msgpool.h"
 
 #define DEV_DEBUG 0 /* set to 1 to enable very verbose developer debugging messages */
 
@@ -81,6 +83,7 @@ struct json_object *global_var_root = NULL;
 /* static data */
 DEFobjStaticHelpers;
 DEFobjCurrIf(datetime) DEFobjCurrIf(glbl) DEFobjCurrIf(regexp) DEFobjCurrIf(prop) DEFobjCurrIf(net) DEFobjCurrIf(var)
+    DEFobjCurrIf(strm)
 
     static const char *one_digit[10] = {"0", "1", "2", "3", "4", "5", "6", "7", "8", "9"};
 
@@ -254,6 +257,15 @@ static inline void MsgUnlock(smsg_t *pThis) {
 }
 
 
+/* The header fields of a finalized message do not change any longer,
+ * so readers need not lock it. Callers must evaluate this once and use
+ * the result for both lock and unlock.
+ */
+static inline sbool msgNeedsLock(const smsg_t *const pM, const sbool bLockMutex) {
+    return (bLockMutex == LOCK_MUTEX && !pM->bFinalized) ? LOCK_MUTEX : MUTEX_ALREADY_LOCKED;
+}
+
+
 /* set RcvFromIP name in msg object WITHOUT calling AddRef.
  * rgerhards, 2013-01-22
  */
@@ -283,8 +295,7 @@ static void MsgSetRcvFromWithoutAddRef(smsg_t *pThis, prop_t *new) {
  * pRuleset pointer inside msg is updated. If ruleset cannot be found,
  * no update is done and an error message emitted.
  */
-static void ATTR_NONNULL() MsgSetRulesetByName(smsg_t *const pMsg, cstr_t *const rulesetName) {
-    uchar *const rs_name = rsCStrGetSzStrNoNULL(rulesetName);
+static void ATTR_NONNULL() MsgSetRulesetByName(smsg_t *const pMsg, uchar *const rs_name) {
     const rsRetVal localRet = rulesetGetRuleset(runConf, &(pMsg->pRuleset), rs_name);
 
     if (localRet != RS_RET_OK) {
@@ -305,20 +316,33 @@ static rsRetVal resolveDNS(smsg_t *const pMsg) {
     prop_t *propFromHost = NULL;
     prop_t *ip;
     prop_t *localName;
+    struct sockaddr_storage addr;
     DEFiRet;
 
     MsgLock(pMsg);
     CHKiRet(objUse(net, CORE_COMPONENT));
     if (pMsg->msgFlags & NEEDS_DNSRESOL) {
+        /* the lookup may take long, so we do not hold the message lock
+         * while doing it. If another thread was quicker, we just discard
+         * our result.
+         */
+        memcpy(&addr, pMsg->rcvFrom.pfrominet, sizeof(addr));
+        MsgUnlock(pMsg);
         if (pMsg->msgFlags & PRESERVE_CASE) {
-            localRet = net.cvthname(pMsg->rcvFrom.pfrominet, NULL, &localName, &ip);
+            localRet = net.cvthname(&addr, NULL, &localName, &ip);
         } else {
-            localRet = net.cvthname(pMsg->rcvFrom.pfrominet, &localName, NULL, &ip);
+            localRet = net.cvthname(&addr, &localName, NULL, &ip);
         }
+        MsgLock(pMsg);
         if (localRet == RS_RET_OK) {
-            /* we pass down the props, so no need for AddRef */
-            MsgSetRcvFromWithoutAddRef(pMsg, localName);
-            MsgSetRcvFromIPWithoutAddRef(pMsg, ip);
+            if (pMsg->msgFlags & NEEDS_DNSRESOL) {
+                /* we pass down the props, so no need for AddRef */
+                MsgSetRcvFromWithoutAddRef(pMsg, localName);
+                MsgSetRcvFromIPWithoutAddRef(pMsg, ip);
+            } else {
+                prop.Destruct(&localName);
+                prop.Destruct(&ip);
+            }
         }
     }
 finalize_it:
@@ -619,63 +643,53 @@ uchar *propIDToName(propid_t propID) {
  * is the right thing to do with pointers, as they are not neccessarily
  * a binary 0 on all machines [but today almost always...]).
  * rgerhards, 2008-10-06
+ * The object now comes from the message pool. A recycled object still
+ * has its mutex initialized, so we do not need to do that again.
  */
 static rsRetVal msgBaseConstruct(smsg_t **ppThis) {
     DEFiRet;
     smsg_t *pM;
+    int bRecycled;
 
     assert(ppThis != NULL);
-    CHKmalloc(pM = malloc(sizeof(smsg_t)));
+    CHKmalloc(pM = msgpoolAllocMsg(&bRecycled));
     objConstructSetObjInfo(pM); /* intialize object helper entities */
 
     /* initialize members in ORDER they appear in structure (think "cache line"!) */
-    pM->flowCtlType = 0;
-    pM->bParseSuccess = 0;
     pM->iRefCount = 1;
+    pM->msgFlags = 0;
     pM->iSeverity = LOG_DEBUG;
     pM->iFacility = LOG_INVLD;
-    pM->iLenPROGNAME = -1;
+    pM->iProtocolVersion = 0;
+    pM->bParseSuccess = 0;
+    pM->bFinalized = 0;
+    pM->flowCtlType = 0;
     pM->offAfterPRI = 0;
     pM->offMSG = -1;
-    pM->iProtocolVersion = 0;
-    pM->msgFlags = 0;
     pM->iLenRawMsg = 0;
     pM->iLenMSG = 0;
     pM->iLenTAG = 0;
     pM->iLenHOSTNAME = 0;
+    pM->iLenPROGNAME = -1;
     pM->pszRawMsg = NULL;
     pM->pszHOSTNAME = NULL;
-    pM->pszRcvdAt3164 = NULL;
-    pM->pszRcvdAt3339 = NULL;
-    pM->pszRcvdAt_MySQL = NULL;
-    pM->pszRcvdAt_PgSQL = NULL;
-    pM->pszTIMESTAMP3164 = NULL;
-    pM->pszTIMESTAMP3339 = NULL;
-    pM->pszTIMESTAMP_MySQL = NULL;
-    pM->pszTIMESTAMP_PgSQL = NULL;
-    pM->pszStrucData = NULL;
-    pM->lenStrucData = 0;
-    pM->pCSAPPNAME = NULL;
-    pM->pCSPROCID = NULL;
-    pM->pCSMSGID = NULL;
+    pM->pRuleset = NULL;
     pM->pInputName = NULL;
     pM->pRcvFromIP = NULL;
     pM->rcvFrom.pRcvFrom = NULL;
-    pM->pRuleset = NULL;
     pM->json = NULL;
     pM->localvars = NULL;
-    pM->dfltTZ[0] = '\0';
+    pM->pCSAPPNAME = NULL;
+    pM->pCSPROCID = NULL;
+    pM->pCSMSGID = NULL;
+    pM->TAG.pszTAG = NULL;
+    if (!bRecycled) pthread_mutex_init(&pM->mut, NULL);
     memset(&pM->tRcvdAt, 0, sizeof(pM->tRcvdAt));
     memset(&pM->tTIMESTAMP, 0, sizeof(pM->tTIMESTAMP));
-    pM->TAG.pszTAG = NULL;
-    pM->pszTimestamp3164[0] = '\0';
-    pM->pszTimestamp3339[0] = '\0';
-    pM->pszTIMESTAMP_SecFrac[0] = '\0';
-    pM->pszRcvdAt_SecFrac[0] = '\0';
-    pM->pszTIMESTAMP_Unix[0] = '\0';
-    pM->pszRcvdAt_Unix[0] = '\0';
-    pM->pszUUID = NULL;
-    pthread_mutex_init(&pM->mut, NULL);
+    pM->pszStrucData = NULL;
+    pM->lenStrucData = 0;
+    pM->dfltTZ[0] = '\0';
+    pM->pCold = NULL;
 
 #if DEV_DEBUG == 1
     dbgprintf("msgConstruct\t0x%x, ref 1\n", (int)pM);
@@ -749,10 +763,62 @@ rsRetVal msgConstructForDeserializer(smsg_t **ppThis) {
  * with an empty element.
  */
 static inline void freeTAG(smsg_t *pThis) {
-    if (pThis->iLenTAG >= CONF_TAG_BUFSIZE) free(pThis->TAG.pszTAG);
+    if (pThis->iLenTAG >= CONF_TAG_BUFSIZE) msgpoolFreeBuf(pThis->TAG.pszTAG);
 }
 static inline void freeHOSTNAME(smsg_t *pThis) {
-    if (pThis->iLenHOSTNAME >= CONF_HOSTNAME_BUFSIZE) free(pThis->pszHOSTNAME);
+    if (pThis->iLenHOSTNAME >= CONF_HOSTNAME_BUFSIZE) msgpoolFreeBuf(pThis->pszHOSTNAME);
+}
+
+
+/* duplicate a string into a pool buffer (TAG, HOSTNAME and rawmsg
+ * buffers must all come from the message pool).
+ */
+static uchar *poolStrDup(const uchar *const psz, const size_t len) {
+    uchar *pNew;
+    if ((pNew = msgpoolAllocBuf(len + 1)) != NULL) memcpy(pNew, psz, len + 1);
+    return pNew;
+}
+
+/* The SecFrac getters peek at pCold without the message lock. So it is
+ * published with release semantics and read there with acquire semantics,
+ * which guarantees the reader sees the cleared extension.
+ */
+#if defined(__ATOMIC_ACQUIRE)
+    #define COLD_LOAD_ACQ(pM) __atomic_load_n(&(pM)->pCold, __ATOMIC_ACQUIRE)
+    #define COLD_STORE_REL(pM, p) __atomic_store_n(&(pM)->pCold, (p), __ATOMIC_RELEASE)
+#else
+    /* older compilers: fall back to full barriers */
+    #define COLD_LOAD_ACQ(pM) __sync_fetch_and_add(&(pM)->pCold, 0)
+    #define COLD_STORE_REL(pM, p) \
+        do {                      \
+            __sync_synchronize(); \
+            (pM)->pCold = (p);    \
+        } while (0)
+#endif
+
+/* obtain the cold extension of a message, allocating it if needed. Must
+ * be called with the message locked (or by its sole owner).
+ * Returns NULL if we are out of memory.
+ */
+static msgCold_t *getCold(smsg_t *const pM) {
+    msgCold_t *pCold;
+    if (pM->pCold == NULL) {
+        /* clear before publishing, the SecFrac getters peek without lock */
+        if ((pCold = msgpoolAllocBuf(sizeof(msgCold_t))) == NULL) return NULL;
+        memset(pCold, 0, sizeof(msgCold_t));
+        COLD_STORE_REL(pM, pCold);
+    }
+    return pM->pCold;
+}
+
+static inline uchar *getColdUUID(const smsg_t *const pM) {
+    return (pM->pCold == NULL) ? NULL : pM->pCold->pszUUID;
+}
+
+/* called by the message pool when an object finally leaves it */
+static void msgPoolRelease(void *const p) {
+    pthread_mutex_destroy(&((smsg_t *)p)->mut);
+    free(p);
 }
 
 
@@ -780,7 +846,7 @@ rsRetVal msgDestruct(smsg_t **ppThis) {
 #if DEV_DEBUG == 1
         dbgprintf("msgDestruct\t0x%lx, RefCount now 0, doing DESTROY\n", (unsigned long)pThis);
 #endif
-        if (pThis->pszRawMsg != pThis->szRawMsg) free(pThis->pszRawMsg);
+        if (pThis->pszRawMsg != pThis->szRawMsg) msgpoolFreeBuf(pThis->pszRawMsg);
         freeTAG(pThis);
         freeHOSTNAME(pThis);
         if (pThis->pInputName != NULL) prop.Destruct(&pThis->pInputName);
@@ -790,12 +856,6 @@ rsRetVal msgDestruct(smsg_t **ppThis) {
             free(pThis->rcvFrom.pfrominet);
         }
         if (pThis->pRcvFromIP != NULL) prop.Destruct(&pThis->pRcvFromIP);
-        free(pThis->pszRcvdAt3164);
-        free(pThis->pszRcvdAt3339);
-        free(pThis->pszRcvdAt_MySQL);
-        free(pThis->pszRcvdAt_PgSQL);
-        free(pThis->pszTIMESTAMP_MySQL);
-        free(pThis->pszTIMESTAMP_PgSQL);
         free(pThis->pszStrucData);
         if (pThis->iLenPROGNAME >= CONF_PROGNAME_BUFSIZE) free(pThis->PROGNAME.ptr);
         if (pThis->pCSAPPNAME != NULL) rsCStrDestruct(&pThis->pCSAPPNAME);
@@ -803,11 +863,19 @@ rsRetVal msgDestruct(smsg_t **ppThis) {
         if (pThis->pCSMSGID != NULL) rsCStrDestruct(&pThis->pCSMSGID);
         if (pThis->json != NULL) json_object_put(pThis->json);
         if (pThis->localvars != NULL) json_object_put(pThis->localvars);
-        if (pThis->pszUUID != NULL) free(pThis->pszUUID);
+        if (pThis->pCold != NULL) {
+            free(pThis->pCold->pszUUID);
+            msgpoolFreeBuf(pThis->pCold);
+        }
 #ifndef HAVE_ATOMIC_BUILTINS
         MsgUnlock(pThis);
 #endif
-        pthread_mutex_destroy(&pThis->mut);
+        /* the object goes back to the pool with its mutex intact, so we
+         * must not let the framework free() it.
+         */
+        obj.DestructObjSelf((obj_t *)pThis);
+        msgpoolFreeMsg(pThis);
+        pThis = NULL;
         /* now we need to do our own optimization. Testing has shown that at least the glibc
          * malloc() subsystem returns memory to the OS far too late in our case. So we need
          * to help it a bit, by calling malloc_trim(), which will tell the alloc subsystem
@@ -842,7 +910,7 @@ ENDobjDestruct
  */
 #define tmpCOPYSZ(name)                                                                    \
     if (pOld->psz##name != NULL) {                                                         \
-        if ((pNew->psz##name = srUtilStrDup(pOld->psz##name, pOld->iLen##name)) == NULL) { \
+        if ((pNew->psz##name = poolStrDup(pOld->psz##name, pOld->iLen##name)) == NULL) {   \
             msgDestruct(&pNew);                                                            \
             return NULL;                                                                   \
         }                                                                                  \
@@ -919,7 +987,7 @@ ENDobjDestruct
         if (pOld->iLenTAG < CONF_TAG_BUFSIZE) {
             memcpy(pNew->TAG.szBuf, pOld->TAG.szBuf, pOld->iLenTAG + 1);
         } else {
-            if ((pNew->TAG.pszTAG = srUtilStrDup(pOld->TAG.pszTAG, pOld->iLenTAG)) == NULL) {
+            if ((pNew->TAG.pszTAG = poolStrDup(pOld->TAG.pszTAG, pOld->iLenTAG)) == NULL) {
                 msgDestruct(&pNew);
                 return NULL;
             }
@@ -1026,7 +1094,7 @@ static rsRetVal MsgSerialize(smsg_t *pThis, strm_t *pStrm) {
     objSerializePTR(pStrm, pCSPROCID, CSTR);
     objSerializePTR(pStrm, pCSMSGID, CSTR);
 
-    objSerializePTR(pStrm, pszUUID, PSZ);
+    CHKiRet(obj.SerializeProp(pStrm, UCHAR_CONSTANT("pszUUID"), PROPTYPE_PSZ, getColdUUID(pThis)));
 
     if (pThis->pRuleset != NULL) {
         CHKiRet(obj.SerializeProp(pStrm, UCHAR_CONSTANT("pszRuleset"), PROPTYPE_PSZ, rulesetGetName(pThis->pRuleset)));
@@ -1184,12 +1252,13 @@ rsRetVal MsgDeserialize(smsg_t *const pMsg, strm_t *pStrm) {
         CHKiRet(objDeserializeProperty(pVar, pStrm));
     }
     if (isProp("pszUUID")) {
-        pMsg->pszUUID = ustrdup(rsCStrGetSzStrNoNULL(pVar->val.pStr));
+        CHKmalloc(getCold(pMsg));
+        pMsg->pCold->pszUUID = ustrdup(rsCStrGetSzStrNoNULL(pVar->val.pStr));
         reinitVar(pVar);
         CHKiRet(objDeserializeProperty(pVar, pStrm));
     }
     if (isProp("pszRuleset")) {
-        MsgSetRulesetByName(pMsg, pVar->val.pStr);
+        MsgSetRulesetByName(pMsg, rsCStrGetSzStrNoNULL(pVar->val.pStr));
         reinitVar(pVar);
         CHKiRet(objDeserializeProperty(pVar, pStrm));
     }
@@ -1213,6 +1282,391 @@ finalize_it:
 #undef isProp
 
 
+/* ---------- compact binary serialization ----------
+ * The property-bag format above is self-describing, but expensive: every
+ * field carries its name and type as text and is parsed octet by octet.
+ * For high-volume disk queues we therefore support a compact binary record:
+ *
+ *   cookie (1 octet) | format version (1 octet) | payload length (varint)
+ *   | payload | '\n'
+ *
+ * The payload holds the fields in fixed order. Numbers are zigzag-encoded
+ * varints. Strings are stored as varint (length + 1) followed by the raw
+ * octets and a terminating NUL, with length 0 meaning "not present". The
+ * NUL lets the deserializer hand the payload buffer directly to the setters
+ * that expect C strings. New fields may only ever be appended; the version
+ * octet must be bumped if the layout changes otherwise.
+ */
+#define MSG_BINREC_MAX_PAYLOAD (512 * 1024 * 1024) /* sanity limit, guards against corrupt files */
+#define MSG_BINREC_STACKBUF 4096 /* records up to this size do not need malloc() */
+
+typedef struct binBuf_s {
+    uchar *buf;
+    size_t len;
+    size_t size;
+    sbool bAlloced; /* buf is heap-allocated (else it is the caller's stack buffer) */
+} binBuf_t;
+
+static rsRetVal ATTR_NONNULL() binBufEnsure(binBuf_t *const pB, const size_t lenAdd) {
+    uchar *newBuf;
+    size_t newSize;
+    DEFiRet;
+
+    if (pB->len + lenAdd <= pB->size) FINALIZE;
+    newSize = pB->size * 2;
+    while (newSize < pB->len + lenAdd) newSize *= 2;
+    if (pB->bAlloced) {
+        CHKmalloc(newBuf = realloc(pB->buf, newSize));
+    } else {
+        CHKmalloc(newBuf = malloc(newSize));
+        memcpy(newBuf, pB->buf, pB->len);
+        pB->bAlloced = 1;
+    }
+    pB->buf = newBuf;
+    pB->size = newSize;
+
+finalize_it:
+    RETiRet;
+}
+
+/* caller must ensure at least 10 octets are available */
+static size_t binPutVarint(uchar *const p, uint64_t v) {
+    size_t i = 0;
+    while (v >= 0x80) {
+        p[i++] = (uchar)(v | 0x80);
+        v >>= 7;
+    }
+    p[i++] = (uchar)v;
+    return i;
+}
+
+static rsRetVal ATTR_NONNULL() binAddNum(binBuf_t *const pB, const int64_t num) {
+    DEFiRet;
+    CHKiRet(binBufEnsure(pB, 10));
+    pB->len += binPutVarint(pB->buf + pB->len, ((uint64_t)num << 1) ^ (uint64_t)(num >> 63));
+finalize_it:
+    RETiRet;
+}
+
+static rsRetVal ATTR_NONNULL(1) binAddStr(binBuf_t *const pB, const uchar *const psz, const size_t len) {
+    DEFiRet;
+    CHKiRet(binBufEnsure(pB, 10 + len + 1));
+    if (psz == NULL) {
+        pB->buf[pB->len++] = 0;
+        FINALIZE;
+    }
+    pB->len += binPutVarint(pB->buf + pB->len, (uint64_t)len + 1);
+    memcpy(pB->buf + pB->len, psz, len);
+    pB->len += len;
+    pB->buf[pB->len++] = '\0';
+finalize_it:
+    RETiRet;
+}
+
+static rsRetVal ATTR_NONNULL() binAddTime(binBuf_t *const pB, const struct syslogTime *const t) {
+    DEFiRet;
+    CHKiRet(binAddNum(pB, t->timeType));
+    CHKiRet(binAddNum(pB, t->year));
+    CHKiRet(binAddNum(pB, t->month));
+    CHKiRet(binAddNum(pB, t->day));
+    CHKiRet(binAddNum(pB, t->hour));
+    CHKiRet(binAddNum(pB, t->minute));
+    CHKiRet(binAddNum(pB, t->second));
+    CHKiRet(binAddNum(pB, t->secfrac));
+    CHKiRet(binAddNum(pB, t->secfracPrecision));
+    CHKiRet(binAddNum(pB, t->OffsetMode));
+    CHKiRet(binAddNum(pB, t->OffsetHour));
+    CHKiRet(binAddNum(pB, t->OffsetMinute));
+finalize_it:
+    RETiRet;
+}
+
+static rsRetVal ATTR_NONNULL(1) binAddPsz(binBuf_t *const pB, const uchar *const psz) {
+    return binAddStr(pB, psz, (psz == NULL) ? 0 : ustrlen(psz));
+}
+
+static rsRetVal ATTR_NONNULL(1) binAddCStr(binBuf_t *const pB, cstr_t *const pCStr) {
+    if (pCStr == NULL) return binAddStr(pB, NULL, 0);
+    return binAddStr(pB, rsCStrGetSzStrNoNULL(pCStr), cstrLen(pCStr));
+}
+
+/* Serialize a message into a binary record, see above for the format. The
+ * record is built in memory and handed to the stream with a single write.
+ */
+rsRetVal MsgSerializeBinary(smsg_t *const pThis, strm_t *const pStrm) {
+    uchar stackBuf[MSG_BINREC_STACKBUF];
+    binBuf_t b = {stackBuf, 0, sizeof(stackBuf), 0};
+    uchar hdr[2 + 10];
+    size_t lenHdr;
+    uchar *psz;
+    int len;
+    DEFiRet;
+
+    assert(pThis != NULL);
+    ISOBJ_TYPE_assert(pStrm, strm);
+
+    CHKiRet(binAddNum(&b, pThis->iProtocolVersion));
+    CHKiRet(binAddNum(&b, pThis->iSeverity));
+    CHKiRet(binAddNum(&b, pThis->iFacility));
+    CHKiRet(binAddNum(&b, pThis->msgFlags));
+    CHKiRet(binAddNum(&b, pThis->ttGenTime));
+    CHKiRet(binAddTime(&b, &pThis->tRcvdAt));
+    CHKiRet(binAddTime(&b, &pThis->tTIMESTAMP));
+    CHKiRet(binAddNum(&b, pThis->offMSG));
+
+    CHKiRet(binAddStr(&b, (pThis->iLenTAG < CONF_TAG_BUFSIZE) ? pThis->TAG.szBuf : pThis->TAG.pszTAG,
+                      pThis->iLenTAG));
+    CHKiRet(binAddStr(&b, pThis->pszRawMsg, pThis->iLenRawMsg));
+    CHKiRet(binAddStr(&b, pThis->pszHOSTNAME, pThis->iLenHOSTNAME));
+    getInputName(pThis, &psz, &len);
+    CHKiRet(binAddStr(&b, psz, len));
+    CHKiRet(binAddPsz(&b, getRcvFrom(pThis)));
+    CHKiRet(binAddPsz(&b, getRcvFromIP(pThis)));
+    CHKiRet(binAddPsz(&b, pThis->pszStrucData));
+    MsgLock(pThis);
+    psz = (pThis->json == NULL) ? NULL : (uchar *)json_object_get_string(pThis->json);
+    iRet = binAddPsz(&b, psz);
+    if (iRet == RS_RET_OK) {
+        psz = (pThis->localvars == NULL) ? NULL : (uchar *)json_object_get_string(pThis->localvars);
+        iRet = binAddPsz(&b, psz);
+    }
+    MsgUnlock(pThis);
+    CHKiRet(iRet);
+    CHKiRet(binAddCStr(&b, pThis->pCSAPPNAME));
+    CHKiRet(binAddCStr(&b, pThis->pCSPROCID));
+    CHKiRet(binAddCStr(&b, pThis->pCSMSGID));
+    CHKiRet(binAddPsz(&b, getColdUUID(pThis)));
+    CHKiRet(binAddPsz(&b, (pThis->pRuleset == NULL) ? NULL : rulesetGetName(pThis->pRuleset)));
+
+    hdr[0] = MSG_BINREC_COOKIE;
+    hdr[1] = MSG_BINREC_VERSION;
+    lenHdr = 2 + binPutVarint(hdr + 2, b.len);
+
+    CHKiRet(strm.RecordBegin(pStrm));
+    CHKiRet(strm.Write(pStrm, hdr, lenHdr));
+    CHKiRet(strm.Write(pStrm, b.buf, b.len));
+    CHKiRet(strm.WriteChar(pStrm, '\n'));
+    CHKiRet(strm.RecordEnd(pStrm));
+
+finalize_it:
+    if (b.bAlloced) free(b.buf);
+    RETiRet;
+}
+
+
+/* read-side cursor over a binary record payload */
+typedef struct binCurs_s {
+    const uchar *p;
+    const uchar *end;
+} binCurs_t;
+
+static rsRetVal ATTR_NONNULL() binGetVarint(binCurs_t *const pC, uint64_t *const pVal) {
+    uint64_t v = 0;
+    int shift = 0;
+    DEFiRet;
+
+    while (1) {
+        if (pC->p >= pC->end || shift > 63) ABORT_FINALIZE(RS_RET_INVALID_PROPFRAME);
+        v |= (uint64_t)(*pC->p & 0x7f) << shift;
+        if (!(*pC->p++ & 0x80)) break;
+        shift += 7;
+    }
+    *pVal = v;
+
+finalize_it:
+    RETiRet;
+}
+
+static rsRetVal ATTR_NONNULL() binGetNum(binCurs_t *const pC, int64_t *const pNum) {
+    uint64_t v;
+    DEFiRet;
+    CHKiRet(binGetVarint(pC, &v));
+    *pNum = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+finalize_it:
+    RETiRet;
+}
+
+/* *ppsz points into the payload (NUL-terminated) or is NULL if the string was absent */
+static rsRetVal ATTR_NONNULL() binGetStr(binCurs_t *const pC, const uchar **const ppsz, size_t *const pLen) {
+    uint64_t v;
+    DEFiRet;
+
+    CHKiRet(binGetVarint(pC, &v));
+    if (v == 0) {
+        *ppsz = NULL;
+        *pLen = 0;
+        FINALIZE;
+    }
+    --v;
+    if (v >= (uint64_t)(pC->end - pC->p) || pC->p[v] != '\0') ABORT_FINALIZE(RS_RET_INVALID_PROPFRAME);
+    *ppsz = pC->p;
+    *pLen = (size_t)v;
+    pC->p += v + 1;
+
+finalize_it:
+    RETiRet;
+}
+
+static rsRetVal ATTR_NONNULL() binGetTime(binCurs_t *const pC, struct syslogTime *const t) {
+    int64_t n[12];
+    int i;
+    DEFiRet;
+
+    for (i = 0; i < 12; ++i) CHKiRet(binGetNum(pC, &n[i]));
+    memset(t, 0, sizeof(*t));
+    t->timeType = n[0];
+    t->year = n[1];
+    t->month = n[2];
+    t->day = n[3];
+    t->hour = n[4];
+    t->minute = n[5];
+    t->second = n[6];
+    t->secfrac = n[7];
+    t->secfracPrecision = n[8];
+    t->OffsetMode = n[9];
+    t->OffsetHour = n[10];
+    t->OffsetMinute = n[11];
+
+finalize_it:
+    RETiRet;
+}
+
+static rsRetVal ATTR_NONNULL() binDecodeMsg(smsg_t *const pMsg, binCurs_t *const pC) {
+    int64_t n;
+    int64_t offMSG;
+    const uchar *psz;
+    size_t len;
+    prop_t *myProp = NULL;
+    struct json_tokener *tokener;
+    DEFiRet;
+
+    CHKiRet(binGetNum(pC, &n));
+    setProtocolVersion(pMsg, (int)n);
+    CHKiRet(binGetNum(pC, &n));
+    pMsg->iSeverity = n;
+    CHKiRet(binGetNum(pC, &n));
+    pMsg->iFacility = n;
+    CHKiRet(binGetNum(pC, &n));
+    pMsg->msgFlags = n;
+    CHKiRet(binGetNum(pC, &n));
+    pMsg->ttGenTime = n;
+    CHKiRet(binGetTime(pC, &pMsg->tRcvdAt));
+    CHKiRet(binGetTime(pC, &pMsg->tTIMESTAMP));
+    CHKiRet(binGetNum(pC, &offMSG));
+
+    CHKiRet(binGetStr(pC, &psz, &len));
+    if (psz != NULL) MsgSetTAG(pMsg, psz, len);
+    CHKiRet(binGetStr(pC, &psz, &len));
+    if (psz != NULL) MsgSetRawMsg(pMsg, (const char *)psz, len);
+    CHKiRet(binGetStr(pC, &psz, &len));
+    if (psz != NULL) MsgSetHOSTNAME(pMsg, psz, len);
+    CHKiRet(binGetStr(pC, &psz, &len));
+    if (psz != NULL) {
+        CHKiRet(prop.Construct(&myProp));
+        CHKiRet(prop.SetString(myProp, psz, len));
+        CHKiRet(prop.ConstructFinalize(myProp));
+        MsgSetInputName(pMsg, myProp);
+        prop.Destruct(&myProp);
+    }
+    CHKiRet(binGetStr(pC, &psz, &len));
+    if (psz != NULL) {
+        MsgSetRcvFromStr(pMsg, psz, len, &myProp);
+        prop.Destruct(&myProp);
+    }
+    CHKiRet(binGetStr(pC, &psz, &len));
+    if (psz != NULL) {
+        MsgSetRcvFromIPStr(pMsg, psz, len, &myProp);
+        prop.Destruct(&myProp);
+    }
+    CHKiRet(binGetStr(pC, &psz, &len));
+    if (psz != NULL) MsgSetStructuredData(pMsg, (const char *)psz);
+    CHKiRet(binGetStr(pC, &psz, &len));
+    if (psz != NULL) {
+        tokener = json_tokener_new();
+        pMsg->json = json_tokener_parse_ex(tokener, (const char *)psz, len);
+        json_tokener_free(tokener);
+    }
+    CHKiRet(binGetStr(pC, &psz, &len));
+    if (psz != NULL) {
+        tokener = json_tokener_new();
+        pMsg->localvars = json_tokener_parse_ex(tokener, (const char *)psz, len);
+        json_tokener_free(tokener);
+    }
+    CHKiRet(binGetStr(pC, &psz, &len));
+    if (psz != NULL) MsgSetAPPNAME(pMsg, (const char *)psz);
+    CHKiRet(binGetStr(pC, &psz, &len));
+    if (psz != NULL) MsgSetPROCID(pMsg, (const char *)psz);
+    CHKiRet(binGetStr(pC, &psz, &len));
+    if (psz != NULL) MsgSetMSGID(pMsg, (const char *)psz);
+    CHKiRet(binGetStr(pC, &psz, &len));
+    if (psz != NULL) {
+        CHKmalloc(getCold(pMsg));
+        CHKmalloc(pMsg->pCold->pszUUID = ustrdup(psz));
+    }
+    CHKiRet(binGetStr(pC, &psz, &len));
+    if (psz != NULL) MsgSetRulesetByName(pMsg, (uchar *)psz);
+
+    /* must be done after the raw message is set, see MsgSerialize() */
+    MsgSetMSGoffs(pMsg, (int)offMSG);
+
+finalize_it:
+    if (myProp != NULL) prop.Destruct(&myProp);
+    RETiRet;
+}
+
+
+/* Deserialize a message from a binary record written by MsgSerializeBinary().
+ * The stream must be positioned at the record cookie. On success, *ppMsg
+ * receives a newly constructed message.
+ */
+rsRetVal MsgDeserializeBinary(smsg_t **const ppMsg, strm_t *const pStrm) {
+    uchar stackBuf[MSG_BINREC_STACKBUF];
+    uchar *pBuf = stackBuf;
+    smsg_t *pMsg = NULL;
+    binCurs_t curs;
+    uint64_t lenPayload = 0;
+    int shift = 0;
+    uchar c;
+    DEFiRet;
+
+    ISOBJ_TYPE_assert(pStrm, strm);
+
+    CHKiRet(strm.ReadChar(pStrm, &c));
+    if (c != MSG_BINREC_COOKIE) ABORT_FINALIZE(RS_RET_INVALID_HEADER);
+    CHKiRet(strm.ReadChar(pStrm, &c));
+    if (c != MSG_BINREC_VERSION) ABORT_FINALIZE(RS_RET_INVALID_HEADER_VERS);
+    do {
+        CHKiRet(strm.ReadChar(pStrm, &c));
+        lenPayload |= (uint64_t)(c & 0x7f) << shift;
+        shift += 7;
+        if (shift > 35) ABORT_FINALIZE(RS_RET_INVALID_HEADER);
+    } while (c & 0x80);
+    if (lenPayload > MSG_BINREC_MAX_PAYLOAD) ABORT_FINALIZE(RS_RET_INVALID_HEADER);
+
+    if (lenPayload > sizeof(stackBuf)) {
+        CHKmalloc(pBuf = malloc(lenPayload));
+    }
+    CHKiRet(strm.Read(pStrm, pBuf, lenPayload));
+    CHKiRet(strm.ReadChar(pStrm, &c));
+    if (c != '\n') ABORT_FINALIZE(RS_RET_INVALID_TRAILER);
+
+    CHKiRet(msgConstructForDeserializer(&pMsg));
+    curs.p = pBuf;
+    curs.end = pBuf + lenPayload;
+    CHKiRet(binDecodeMsg(pMsg, &curs));
+    *ppMsg = pMsg;
+    pMsg = NULL;
+
+finalize_it:
+    if (pMsg != NULL) msgDestruct(&pMsg);
+    if (pBuf != stackBuf) free(pBuf);
+    if (Debug && iRet != RS_RET_OK) {
+        dbgprintf("MsgDeserializeBinary error %d\n", iRet);
+    }
+    RETiRet;
+}
+
+
 /* Increment reference count - see description of the "msg"
  * structure for details. As a convenience to developers,
  * this method returns the msg pointer that is passed to it.
@@ -1370,21 +1824,23 @@ static void msgSetUUID(smsg_t *const pM) {
     char hex_char[] = "0123456789ABCDEF";
     unsigned int byte_nbr;
     uuid_t uuid;
+    msgCold_t *pCold;
+    uchar *pszUUID;
 
     dbgprintf("[MsgSetUUID] START, lenRes %llu\n", (long long unsigned)lenRes);
     assert(pM != NULL);
 
-    if ((pM->pszUUID = (uchar *)malloc(lenRes)) == NULL) {
-        pM->pszUUID = (uchar *)"";
-    } else {
+    /* on out of memory, the UUID simply stays unset */
+    if ((pCold = getCold(pM)) != NULL && (pszUUID = (uchar *)malloc(lenRes)) != NULL) {
         call_uuid_generate(uuid);
         for (byte_nbr = 0; byte_nbr < sizeof(uuid_t); byte_nbr++) {
-            pM->pszUUID[byte_nbr * 2 + 0] = hex_char[uuid[byte_nbr] >> 4];
-            pM->pszUUID[byte_nbr * 2 + 1] = hex_char[uuid[byte_nbr] & 15];
+            pszUUID[byte_nbr * 2 + 0] = hex_char[uuid[byte_nbr] >> 4];
+            pszUUID[byte_nbr * 2 + 1] = hex_char[uuid[byte_nbr] & 15];
         }
 
-        pM->pszUUID[lenRes - 1] = '\0';
-        dbgprintf("[MsgSetUUID] UUID : %s LEN: %d \n", pM->pszUUID, (int)lenRes);
+        pszUUID[lenRes - 1] = '\0';
+        pCold->pszUUID = pszUUID;
+        dbgprintf("[MsgSetUUID] UUID : %s LEN: %d \n", pszUUID, (int)lenRes);
     }
     dbgprintf("[MsgSetUUID] END\n");
 }
@@ -1396,17 +1852,21 @@ static void getUUID(smsg_t *const pM, uchar **pBuf, int *piLen) {
         *pBuf = UCHAR_CONSTANT("");
         *piLen = 0;
     } else {
-        if (pM->pszUUID == NULL) {
+        if (getColdUUID(pM) == NULL) {
             dbgprintf("[getUUID] pM->pszUUID is NULL\n");
             MsgLock(pM);
             /* re-query, things may have changed in the mean time... */
-            if (pM->pszUUID == NULL) msgSetUUID(pM);
+            if (getColdUUID(pM) == NULL) msgSetUUID(pM);
             MsgUnlock(pM);
         } else { /* UUID already there we reuse it */
             dbgprintf("[getUUID] pM->pszUUID already exists\n");
         }
-        *pBuf = pM->pszUUID;
-        *piLen = sizeof(uuid_t) * 2;
+        if ((*pBuf = getColdUUID(pM)) == NULL) {
+            *pBuf = UCHAR_CONSTANT("");
+            *piLen = 0;
+        } else {
+            *piLen = sizeof(uuid_t) * 2;
+        }
     }
     dbgprintf("[getUUID] END\n");
 }
@@ -1528,6 +1988,7 @@ static const char *formatISOWeekOrYear(enum tplFormatTypes eFmt, struct syslogTi
 }
 
 const char *getTimeReported(smsg_t *const pM, enum tplFormatTypes eFmt) {
+    msgCold_t *pCold;
     if (pM == NULL) return "";
 
     switch (eFmt) {
@@ -1535,59 +1996,75 @@ const char *getTimeReported(smsg_t *const pM, enum tplFormatTypes eFmt) {
         case tplFmtRFC3164Date:
         case tplFmtRFC3164BuggyDate:
             MsgLock(pM);
-            if (pM->pszTIMESTAMP3164 == NULL) {
-                pM->pszTIMESTAMP3164 = pM->pszTimestamp3164;
-                datetime.formatTimestamp3164(&pM->tTIMESTAMP, pM->pszTIMESTAMP3164, (eFmt == tplFmtRFC3164BuggyDate));
+            if ((pCold = getCold(pM)) == NULL) {
+                MsgUnlock(pM);
+                return "";
+            }
+            if (pCold->pszTIMESTAMP3164[0] == '\0') {
+                datetime.formatTimestamp3164(&pM->tTIMESTAMP, pCold->pszTIMESTAMP3164,
+                                             (eFmt == tplFmtRFC3164BuggyDate));
             }
             MsgUnlock(pM);
-            return (pM->pszTIMESTAMP3164);
+            return (pCold->pszTIMESTAMP3164);
         case tplFmtMySQLDate:
             MsgLock(pM);
-            if (pM->pszTIMESTAMP_MySQL == NULL) {
-                if ((pM->pszTIMESTAMP_MySQL = malloc(15)) == NULL) {
-                    MsgUnlock(pM);
-                    return "";
-                }
-                datetime.formatTimestampToMySQL(&pM->tTIMESTAMP, pM->pszTIMESTAMP_MySQL);
+            if ((pCold = getCold(pM)) == NULL) {
+                MsgUnlock(pM);
+                return "";
+            }
+            if (pCold->pszTIMESTAMP_MySQL[0] == '\0') {
+                datetime.formatTimestampToMySQL(&pM->tTIMESTAMP, pCold->pszTIMESTAMP_MySQL);
             }
             MsgUnlock(pM);
-            return (pM->pszTIMESTAMP_MySQL);
+            return (pCold->pszTIMESTAMP_MySQL);
         case tplFmtPgSQLDate:
             MsgLock(pM);
-            if (pM->pszTIMESTAMP_PgSQL == NULL) {
-                if ((pM->pszTIMESTAMP_PgSQL = malloc(21)) == NULL) {
-                    MsgUnlock(pM);
-                    return "";
-                }
-                datetime.formatTimestampToPgSQL(&pM->tTIMESTAMP, pM->pszTIMESTAMP_PgSQL);
+            if ((pCold = getCold(pM)) == NULL) {
+                MsgUnlock(pM);
+                return "";
+            }
+            if (pCold->pszTIMESTAMP_PgSQL[0] == '\0') {
+                datetime.formatTimestampToPgSQL(&pM->tTIMESTAMP, pCold->pszTIMESTAMP_PgSQL);
             }
             MsgUnlock(pM);
-            return (pM->pszTIMESTAMP_PgSQL);
+            return (pCold->pszTIMESTAMP_PgSQL);
         case tplFmtRFC3339Date:
             MsgLock(pM);
-            if (pM->pszTIMESTAMP3339 == NULL) {
-                pM->pszTIMESTAMP3339 = pM->pszTimestamp3339;
-                datetime.formatTimestamp3339(&pM->tTIMESTAMP, pM->pszTIMESTAMP3339);
+            if ((pCold = getCold(pM)) == NULL) {
+                MsgUnlock(pM);
+                return "";
+            }
+            if (pCold->pszTIMESTAMP3339[0] == '\0') {
+                datetime.formatTimestamp3339(&pM->tTIMESTAMP, pCold->pszTIMESTAMP3339);
             }
             MsgUnlock(pM);
-            return (pM->pszTIMESTAMP3339);
+            return (pCold->pszTIMESTAMP3339);
         case tplFmtUnixDate:
             MsgLock(pM);
-            if (pM->pszTIMESTAMP_Unix[0] == '\0') {
-                datetime.formatTimestampUnix(&pM->tTIMESTAMP, pM->pszTIMESTAMP_Unix);
+            if ((pCold = getCold(pM)) == NULL) {
+                MsgUnlock(pM);
+                return "";
+            }
+            if (pCold->pszTIMESTAMP_Unix[0] == '\0') {
+                datetime.formatTimestampUnix(&pM->tTIMESTAMP, pCold->pszTIMESTAMP_Unix);
             }
             MsgUnlock(pM);
-            return (pM->pszTIMESTAMP_Unix);
+            return (pCold->pszTIMESTAMP_Unix);
         case tplFmtSecFrac:
-            if (pM->pszTIMESTAMP_SecFrac[0] == '\0') {
+            pCold = COLD_LOAD_ACQ(pM);
+            if (pCold == NULL || pCold->pszTIMESTAMP_SecFrac[0] == '\0') {
                 MsgLock(pM);
                 /* re-check, may have changed while we did not hold lock */
-                if (pM->pszTIMESTAMP_SecFrac[0] == '\0') {
-                    datetime.formatTimestampSecFrac(&pM->tTIMESTAMP, pM->pszTIMESTAMP_SecFrac);
+                if ((pCold = getCold(pM)) == NULL) {
+                    MsgUnlock(pM);
+                    return "";
+                }
+                if (pCold->pszTIMESTAMP_SecFrac[0] == '\0') {
+                    datetime.formatTimestampSecFrac(&pM->tTIMESTAMP, pCold->pszTIMESTAMP_SecFrac);
                 }
                 MsgUnlock(pM);
             }
-            return (pM->pszTIMESTAMP_SecFrac);
+            return (pCold->pszTIMESTAMP_SecFrac);
         case tplFmtWDayName:
             return wdayNames[getWeekdayNbr(&pM->tTIMESTAMP)];
         case tplFmtWDay:
@@ -1735,82 +2212,92 @@ static const char *getTimeUTC(struct syslogTime *const __restrict__ pTmIn,
 
 static const char *getTimeGenerated(smsg_t *const __restrict__ pM, const enum tplFormatTypes eFmt) {
     struct syslogTime *const pTm = &pM->tRcvdAt;
+    msgCold_t *pCold;
     if (pM == NULL) return "";
 
     switch (eFmt) {
         case tplFmtDefault:
             MsgLock(pM);
-            if (pM->pszRcvdAt3164 == NULL) {
-                if ((pM->pszRcvdAt3164 = malloc(16)) == NULL) {
-                    MsgUnlock(pM);
-                    return "";
-                }
-                datetime.formatTimestamp3164(pTm, pM->pszRcvdAt3164, 0);
+            if ((pCold = getCold(pM)) == NULL) {
+                MsgUnlock(pM);
+                return "";
+            }
+            if (pCold->pszRcvdAt3164[0] == '\0') {
+                datetime.formatTimestamp3164(pTm, pCold->pszRcvdAt3164, 0);
             }
             MsgUnlock(pM);
-            return (pM->pszRcvdAt3164);
+            return (pCold->pszRcvdAt3164);
         case tplFmtMySQLDate:
             MsgLock(pM);
-            if (pM->pszRcvdAt_MySQL == NULL) {
-                if ((pM->pszRcvdAt_MySQL = malloc(15)) == NULL) {
-                    MsgUnlock(pM);
-                    return "";
-                }
-                datetime.formatTimestampToMySQL(pTm, pM->pszRcvdAt_MySQL);
+            if ((pCold = getCold(pM)) == NULL) {
+                MsgUnlock(pM);
+                return "";
+            }
+            if (pCold->pszRcvdAt_MySQL[0] == '\0') {
+                datetime.formatTimestampToMySQL(pTm, pCold->pszRcvdAt_MySQL);
             }
             MsgUnlock(pM);
-            return (pM->pszRcvdAt_MySQL);
+            return (pCold->pszRcvdAt_MySQL);
         case tplFmtPgSQLDate:
             MsgLock(pM);
-            if (pM->pszRcvdAt_PgSQL == NULL) {
-                if ((pM->pszRcvdAt_PgSQL = malloc(21)) == NULL) {
-                    MsgUnlock(pM);
-                    return "";
-                }
-                datetime.formatTimestampToPgSQL(pTm, pM->pszRcvdAt_PgSQL);
+            if ((pCold = getCold(pM)) == NULL) {
+                MsgUnlock(pM);
+                return "";
+            }
+            if (pCold->pszRcvdAt_PgSQL[0] == '\0') {
+                datetime.formatTimestampToPgSQL(pTm, pCold->pszRcvdAt_PgSQL);
             }
             MsgUnlock(pM);
-            return (pM->pszRcvdAt_PgSQL);
+            return (pCold->pszRcvdAt_PgSQL);
         case tplFmtRFC3164Date:
         case tplFmtRFC3164BuggyDate:
             MsgLock(pM);
-            if (pM->pszRcvdAt3164 == NULL) {
-                if ((pM->pszRcvdAt3164 = malloc(16)) == NULL) {
-                    MsgUnlock(pM);
-                    return "";
-                }
-                datetime.formatTimestamp3164(pTm, pM->pszRcvdAt3164, (eFmt == tplFmtRFC3164BuggyDate));
+            if ((pCold = getCold(pM)) == NULL) {
+                MsgUnlock(pM);
+                return "";
+            }
+            if (pCold->pszRcvdAt3164[0] == '\0') {
+                datetime.formatTimestamp3164(pTm, pCold->pszRcvdAt3164, (eFmt == tplFmtRFC3164BuggyDate));
             }
             MsgUnlock(pM);
-            return (pM->pszRcvdAt3164);
+            return (pCold->pszRcvdAt3164);
         case tplFmtRFC3339Date:
             MsgLock(pM);
-            if (pM->pszRcvdAt3339 == NULL) {
-                if ((pM->pszRcvdAt3339 = malloc(33)) == NULL) {
-                    MsgUnlock(pM);
-                    return "";
-                }
-                datetime.formatTimestamp3339(pTm, pM->pszRcvdAt3339);
+            if ((pCold = getCold(pM)) == NULL) {
+                MsgUnlock(pM);
+                return "";
+            }
+            if (pCold->pszRcvdAt3339[0] == '\0') {
+                datetime.formatTimestamp3339(pTm, pCold->pszRcvdAt3339);
             }
             MsgUnlock(pM);
-            return (pM->pszRcvdAt3339);
+            return (pCold->pszRcvdAt3339);
         case tplFmtUnixDate:
             MsgLock(pM);
-            if (pM->pszRcvdAt_Unix[0] == '\0') {
-                datetime.formatTimestampUnix(pTm, pM->pszRcvdAt_Unix);
+            if ((pCold = getCold(pM)) == NULL) {
+                MsgUnlock(pM);
+                return "";
+            }
+            if (pCold->pszRcvdAt_Unix[0] == '\0') {
+                datetime.formatTimestampUnix(pTm, pCold->pszRcvdAt_Unix);
             }
             MsgUnlock(pM);
-            return (pM->pszRcvdAt_Unix);
+            return (pCold->pszRcvdAt_Unix);
         case tplFmtSecFrac:
-            if (pM->pszRcvdAt_SecFrac[0] == '\0') {
+            pCold = COLD_LOAD_ACQ(pM);
+            if (pCold == NULL || pCold->pszRcvdAt_SecFrac[0] == '\0') {
                 MsgLock(pM);
                 /* re-check, may have changed while we did not hold lock */
-                if (pM->pszRcvdAt_SecFrac[0] == '\0') {
-                    datetime.formatTimestampSecFrac(pTm, pM->pszRcvdAt_SecFrac);
+                if ((pCold = getCold(pM)) == NULL) {
+                    MsgUnlock(pM);
+                    return "";
+                }
+                if (pCold->pszRcvdAt_SecFrac[0] == '\0') {
+                    datetime.formatTimestampSecFrac(pTm, pCold->pszRcvdAt_SecFrac);
                 }
                 MsgUnlock(pM);
             }
-            return (pM->pszRcvdAt_SecFrac);
+            return (pCold->pszRcvdAt_SecFrac);
         case tplFmtWDayName:
             return wdayNames[getWeekdayNbr(pTm)];
         case tplFmtWDay:
@@ -1981,7 +2468,7 @@ finalize_it:
  * rgerhards, 2009-06-26
  */
 static void preparePROCID(smsg_t *const pM, sbool bLockMutex) {
-    if (pM->pCSPROCID == NULL) {
+    if (pM->pCSPROCID == NULL && !pM->bFinalized) {
         if (bLockMutex == LOCK_MUTEX) MsgLock(pM);
         /* re-query, things may have changed in the mean time... */
         if (pM->pCSPROCID == NULL) acquirePROCIDFromTAG(pM);
@@ -2008,6 +2495,7 @@ char *getPROCID(smsg_t *const pM, sbool bLockMutex) {
     uchar *pszRet;
 
     ISOBJ_TYPE_assert(pM, msg);
+    bLockMutex = msgNeedsLock(pM, bLockMutex);
     if (bLockMutex == LOCK_MUTEX) MsgLock(pM);
     preparePROCID(pM, MUTEX_ALREADY_LOCKED);
     if (pM->pCSPROCID == NULL)
@@ -2050,6 +2538,8 @@ static const char *getParseSuccess(smsg_t *const pM) {
 static const char *getMSGID(smsg_t *const pM) {
     if (pM->pCSMSGID == NULL) {
         return "-";
+    } else if (pM->bFinalized) {
+        return (char *)rsCStrGetSzStrNoNULL(pM->pCSMSGID);
     } else {
         MsgLock(pM);
         char *pszreturn = (char *)rsCStrGetSzStrNoNULL(pM->pCSMSGID);
@@ -2136,7 +2626,7 @@ const uchar *msgGetJSONMESG(smsg_t *__restrict__ const pMsg) {
     json_object_object_add(json, "msgid", jval);
 
 #ifdef USE_LIBUUID
-    if (pMsg->pszUUID == NULL) {
+    if (getColdUUID(pMsg) == NULL) {
         jval = NULL;
     } else {
         getUUID(pMsg, &pRes, &bufLen);
@@ -2174,7 +2664,7 @@ void MsgSetTAG(smsg_t *__restrict__ const pMsg, const uchar *pszBuf, const size_
         /* small enough: use fixed buffer (faster!) */
         pBuf = pMsg->TAG.szBuf;
     } else {
-        if ((pBuf = (uchar *)malloc(pMsg->iLenTAG + 1)) == NULL) {
+        if ((pBuf = (uchar *)msgpoolAllocBuf(pMsg->iLenTAG + 1)) == NULL) {
             /* truncate message, better than completely loosing it... */
             pBuf = pMsg->TAG.szBuf;
             pMsg->iLenTAG = CONF_TAG_BUFSIZE - 1;
@@ -2200,6 +2690,7 @@ static void ATTR_NONNULL(1) tryEmulateTAG(smsg_t *const pM, const sbool bLockMut
     uchar bufTAG[CONF_TAG_MAXSIZE];
     assert(pM != NULL);
 
+    if (pM->bFinalized) return; /* already emulated, if possible at all */
     if (bLockMutex == LOCK_MUTEX) MsgLock(pM);
     if (pM->iLenTAG > 0) {
         if (bLockMutex == LOCK_MUTEX) MsgUnlock(pM);
@@ -2224,7 +2715,8 @@ static void ATTR_NONNULL(1) tryEmulateTAG(smsg_t *const pM, const sbool bLockMut
 }
 
 
-void ATTR_NONNULL(2, 3) getTAG(smsg_t *const pM, uchar **const ppBuf, int *const piLen, const sbool bLockMutex) {
+void ATTR_NONNULL(2, 3) getTAG(smsg_t *const pM, uchar **const ppBuf, int *const piLen, sbool bLockMutex) {
+    if (pM != NULL) bLockMutex = msgNeedsLock(pM, bLockMutex);
     if (bLockMutex == LOCK_MUTEX) MsgLock(pM);
 
     if (pM == NULL) {
@@ -2310,19 +2802,21 @@ finalize_it:
 
 /* get the "STRUCTURED-DATA" as sz string, including length */
 void MsgGetStructuredData(smsg_t *const pM, uchar **pBuf, rs_size_t *len) {
-    MsgLock(pM);
+    const sbool bLockMutex = msgNeedsLock(pM, LOCK_MUTEX);
+    if (bLockMutex == LOCK_MUTEX) MsgLock(pM);
     if (pM->pszStrucData == NULL) {
         *pBuf = UCHAR_CONSTANT("-"), *len = 1;
     } else {
         *pBuf = pM->pszStrucData, *len = pM->lenStrucData;
     }
-    MsgUnlock(pM);
+    if (bLockMutex == LOCK_MUTEX) MsgUnlock(pM);
 }
 
 /* get the "programname" as sz string
  * rgerhards, 2005-10-19
  */
-uchar *ATTR_NONNULL(1) getProgramName(smsg_t *const pM, const sbool bLockMutex) {
+uchar *ATTR_NONNULL(1) getProgramName(smsg_t *const pM, sbool bLockMutex) {
+    bLockMutex = msgNeedsLock(pM, bLockMutex);
     if (bLockMutex == LOCK_MUTEX) {
         MsgLock(pM);
     }
@@ -2347,7 +2841,7 @@ uchar *ATTR_NONNULL(1) getProgramName(smsg_t *const pM, const sbool bLockMutex)
  * rgerhards, 2009-06-26
  */
 static void ATTR_NONNULL(1) prepareAPPNAME(smsg_t *const pM, const sbool bLockMutex) {
-    if (pM->pCSAPPNAME == NULL) {
+    if (pM->pCSAPPNAME == NULL && !pM->bFinalized) {
         if (bLockMutex == LOCK_MUTEX) MsgLock(pM);
 
         /* re-query as things might have changed during locking */
@@ -2364,10 +2858,11 @@ static void ATTR_NONNULL(1) prepareAPPNAME(smsg_t *const pM, const sbool bLockMu
 
 /* rgerhards, 2005-11-24
  */
-char *getAPPNAME(smsg_t *const pM, const sbool bLockMutex) {
+char *getAPPNAME(smsg_t *const pM, sbool bLockMutex) {
     uchar *pszRet;
 
     assert(pM != NULL);
+    bLockMutex = msgNeedsLock(pM, bLockMutex);
     if (bLockMutex == LOCK_MUTEX) MsgLock(pM);
     prepareAPPNAME(pM, MUTEX_ALREADY_LOCKED);
     if (pM->pCSAPPNAME == NULL)
@@ -2386,6 +2881,26 @@ static int getAPPNAMELen(smsg_t *const pM, const sbool bLockMutex) {
     return (pM->pCSAPPNAME == NULL) ? 0 : rsCStrLen(pM->pCSAPPNAME);
 }
 
+
+/* Finalize a message before it is handed to other threads (action
+ * queues). All header fields that are otherwise derived lazily (TAG,
+ * PROGNAME, APP-NAME, PROCID) are computed now, after which readers of
+ * these fields do not need to lock the message any longer. The JSON
+ * trees and the DNS resolution of fromhost are still guarded by the
+ * message lock. If a field cannot be computed (out of memory), the
+ * message simply stays non-finalized.
+ */
+void MsgFinalize(smsg_t *const pM) {
+    if (pM->bFinalized) return;
+    MsgLock(pM);
+    tryEmulateTAG(pM, MUTEX_ALREADY_LOCKED);
+    getProgramName(pM, MUTEX_ALREADY_LOCKED);
+    prepareAPPNAME(pM, MUTEX_ALREADY_LOCKED);
+    preparePROCID(pM, MUTEX_ALREADY_LOCKED);
+    if (pM->iLenPROGNAME != -1) pM->bFinalized = 1;
+    MsgUnlock(pM);
+}
+
 /* rgerhards 2008-09-10: set pszInputName in msg object. This calls AddRef()
  * on the property, because this must be done in all current cases and there
  * is no case expected where this may not be necessary.
@@ -2509,7 +3024,7 @@ void MsgSetHOSTNAME(smsg_t *pThis, const uchar *pszHOSTNAME, const int lenHOSTNA
     if (pThis->iLenHOSTNAME < CONF_HOSTNAME_BUFSIZE) {
         /* small enough: use fixed buffer (faster!) */
         pThis->pszHOSTNAME = pThis->szHOSTNAME;
-    } else if ((pThis->pszHOSTNAME = (uchar *)malloc(pThis->iLenHOSTNAME + 1)) == NULL) {
+    } else if ((pThis->pszHOSTNAME = (uchar *)msgpoolAllocBuf(pThis->iLenHOSTNAME + 1)) == NULL) {
         /* truncate message, better than completely loosing it... */
         pThis->pszHOSTNAME = pThis->szHOSTNAME;
         pThis->iLenHOSTNAME = CONF_HOSTNAME_BUFSIZE - 1;
@@ -2559,9 +3074,9 @@ rsRetVal MsgReplaceMSG(smsg_t *pThis, const uchar *pszMSG, int lenMSG) {
     lenNew = pThis->iLenRawMsg + lenMSG - pThis->iLenMSG;
     if (lenMSG > pThis->iLenMSG && lenNew >= CONF_RAWMSG_BUFSIZE) {
         /*  we have lost our "bet" and need to alloc a new buffer ;) */
-        CHKmalloc(bufNew = malloc(lenNew + 1));
+        CHKmalloc(bufNew = msgpoolAllocBuf(lenNew + 1));
         memcpy(bufNew, pThis->pszRawMsg, pThis->offMSG);
-        if (pThis->pszRawMsg != pThis->szRawMsg) free(pThis->pszRawMsg);
+        if (pThis->pszRawMsg != pThis->szRawMsg) msgpoolFreeBuf(pThis->pszRawMsg);
         pThis->pszRawMsg = bufNew;
     }
 
@@ -2603,14 +3118,14 @@ void ATTR_NONNULL() MsgTruncateToMaxSize(smsg_t *const pThis) {
 void ATTR_NONNULL() MsgSetRawMsg(smsg_t *const pThis, const char *const pszRawMsg, const size_t lenMsg) {
     ISOBJ_TYPE_assert(pThis, msg);
     int deltaSize;
-    if (pThis->pszRawMsg != pThis->szRawMsg) free(pThis->pszRawMsg);
+    if (pThis->pszRawMsg != pThis->szRawMsg) msgpoolFreeBuf(pThis->pszRawMsg);
 
     deltaSize = (int)lenMsg - pThis->iLenRawMsg; /* value < 0 in truncation case! */
     pThis->iLenRawMsg = lenMsg;
     if (pThis->iLenRawMsg < CONF_RAWMSG_BUFSIZE) {
         /* small enough: use fixed buffer (faster!) */
         pThis->pszRawMsg = pThis->szRawMsg;
-    } else if ((pThis->pszRawMsg = (uchar *)malloc(pThis->iLenRawMsg + 1)) == NULL) {
+    } else if ((pThis->pszRawMsg = (uchar *)msgpoolAllocBuf(pThis->iLenRawMsg + 1)) == NULL) {
         /* truncate message, better than completely loosing it... */
         pThis->pszRawMsg = pThis->szRawMsg;
         pThis->iLenRawMsg = CONF_RAWMSG_BUFSIZE - 1;
@@ -3228,6 +3743,148 @@ finalize_it:
 }
 
 
+/* Direct property accessors for compiled templates. They return the same
+ * values as MsgGetProp() for entries without complex processing, but skip
+ * the property switch. None of them allocates, so the result must never
+ * be freed.
+ */
+static uchar *propGetMSG(smsg_t *const pMsg, const struct templateEntry *const pTpe, rs_size_t *const pLen) {
+    (void)pTpe;
+    *pLen = getMSGLen(pMsg);
+    return getMSG(pMsg);
+}
+
+static uchar *propGetHOSTNAME(smsg_t *const pMsg, const struct templateEntry *const pTpe, rs_size_t *const pLen) {
+    (void)pTpe;
+    *pLen = getHOSTNAMELen(pMsg);
+    return (uchar *)getHOSTNAME(pMsg);
+}
+
+static uchar *propGetSYSLOGTAG(smsg_t *const pMsg, const struct templateEntry *const pTpe, rs_size_t *const pLen) {
+    uchar *pRes;
+    (void)pTpe;
+    getTAG(pMsg, &pRes, pLen, LOCK_MUTEX);
+    return pRes;
+}
+
+static uchar *propGetRAWMSG(smsg_t *const pMsg, const struct templateEntry *const pTpe, rs_size_t *const pLen) {
+    uchar *pRes;
+    (void)pTpe;
+    getRawMsg(pMsg, &pRes, pLen);
+    return pRes;
+}
+
+static uchar *propGetFROMHOST(smsg_t *const pMsg, const struct templateEntry *const pTpe, rs_size_t *const pLen) {
+    uchar *const pRes = getRcvFrom(pMsg);
+    (void)pTpe;
+    *pLen = ustrlen(pRes);
+    return pRes;
+}
+
+static uchar *propGetFROMHOST_IP(smsg_t *const pMsg, const struct templateEntry *const pTpe, rs_size_t *const pLen) {
+    uchar *const pRes = getRcvFromIP(pMsg);
+    (void)pTpe;
+    *pLen = ustrlen(pRes);
+    return pRes;
+}
+
+static uchar *propGetPROGRAMNAME(smsg_t *const pMsg, const struct templateEntry *const pTpe, rs_size_t *const pLen) {
+    uchar *const pRes = getProgramName(pMsg, LOCK_MUTEX);
+    (void)pTpe;
+    *pLen = ustrlen(pRes);
+    return pRes;
+}
+
+static uchar *propGetPRI(smsg_t *const pMsg, const struct templateEntry *const pTpe, rs_size_t *const pLen) {
+    uchar *const pRes = (uchar *)getPRI(pMsg);
+    (void)pTpe;
+    *pLen = ustrlen(pRes);
+    return pRes;
+}
+
+static uchar *propGetTIMESTAMP(smsg_t *const pMsg, const struct templateEntry *const pTpe, rs_size_t *const pLen) {
+    uchar *const pRes = (uchar *)getTimeReported(pMsg, pTpe->data.field.eDateFormat);
+    *pLen = ustrlen(pRes);
+    return pRes;
+}
+
+static uchar *propGetTIMEGENERATED(smsg_t *const pMsg, const struct templateEntry *const pTpe, rs_size_t *const pLen) {
+    uchar *const pRes = (uchar *)getTimeGenerated(pMsg, pTpe->data.field.eDateFormat);
+    *pLen = ustrlen(pRes);
+    return pRes;
+}
+
+static uchar *propGetAPP_NAME(smsg_t *const pMsg, const struct templateEntry *const pTpe, rs_size_t *const pLen) {
+    uchar *const pRes = (uchar *)getAPPNAME(pMsg, LOCK_MUTEX);
+    (void)pTpe;
+    *pLen = ustrlen(pRes);
+    return pRes;
+}
+
+static uchar *propGetPROCID(smsg_t *const pMsg, const struct templateEntry *const pTpe, rs_size_t *const pLen) {
+    uchar *const pRes = (uchar *)getPROCID(pMsg, LOCK_MUTEX);
+    (void)pTpe;
+    *pLen = ustrlen(pRes);
+    return pRes;
+}
+
+static uchar *propGetMSGID(smsg_t *const pMsg, const struct templateEntry *const pTpe, rs_size_t *const pLen) {
+    uchar *const pRes = (uchar *)getMSGID(pMsg);
+    (void)pTpe;
+    *pLen = ustrlen(pRes);
+    return pRes;
+}
+
+static uchar *propGetSTRUCTURED_DATA(smsg_t *const pMsg,
+                                     const struct templateEntry *const pTpe,
+                                     rs_size_t *const pLen) {
+    uchar *pRes;
+    (void)pTpe;
+    MsgGetStructuredData(pMsg, &pRes, pLen);
+    return pRes;
+}
+
+/* Obtain the direct accessor for the property of a template entry, or NULL
+ * if the property must be obtained via MsgGetProp(). Complex processing
+ * options are not applied by the accessors, the caller must check for them.
+ */
+msgPropGetter_t MsgGetPropGetter(const struct templateEntry *const pTpe) {
+    switch (pTpe->data.field.msgProp.id) {
+        case PROP_MSG:
+            return propGetMSG;
+        case PROP_HOSTNAME:
+            return propGetHOSTNAME;
+        case PROP_SYSLOGTAG:
+            return propGetSYSLOGTAG;
+        case PROP_RAWMSG:
+            return propGetRAWMSG;
+        case PROP_FROMHOST:
+            return propGetFROMHOST;
+        case PROP_FROMHOST_IP:
+            return propGetFROMHOST_IP;
+        case PROP_PROGRAMNAME:
+            return propGetPROGRAMNAME;
+        case PROP_PRI:
+            return propGetPRI;
+        case PROP_TIMESTAMP:
+            /* UTC time strings are generated on each call */
+            return pTpe->data.field.options.bDateInUTC ? NULL : propGetTIMESTAMP;
+        case PROP_TIMEGENERATED:
+            return pTpe->data.field.options.bDateInUTC ? NULL : propGetTIMEGENERATED;
+        case PROP_APP_NAME:
+            return propGetAPP_NAME;
+        case PROP_PROCID:
+            return propGetPROCID;
+        case PROP_MSGID:
+            return propGetMSGID;
+        case PROP_STRUCTURED_DATA:
+            return propGetSTRUCTURED_DATA;
+        default:
+            return NULL;
+    }
+}
+
+
 /* This function returns a string-representation of the
  * requested message property. This is a generic function used
  * to abstract properties so that these can be easier
@@ -5041,6 +5698,7 @@ BEGINObjClassInit(msg, 1, OBJ_IS_CORE_MODULE)
     CHKiRet(objUse(glbl, CORE_COMPONENT));
     CHKiRet(objUse(prop, CORE_COMPONENT));
     CHKiRet(objUse(var, CORE_COMPONENT));
+    CHKiRet(objUse(strm, CORE_COMPONENT));
 
     /* set our own handlers */
     OBJSetMethodHandler(objMethod_SERIALIZE, MsgSerialize);
@@ -5048,4 +5706,12 @@ BEGINObjClassInit(msg, 1, OBJ_IS_CORE_MODULE)
 #ifdef HAVE_MALLOC_TRIM
     INIT_ATOMIC_HELPER_MUT(mutTrimCtr);
 #endif
+    CHKiRet(msgpoolInit(sizeof(smsg_t), msgPoolRelease));
 ENDObjClassInit(msg)
+
+
+/* Exit the message class.
+ */
+BEGINObjClassExit(msg, OBJ_IS_CORE_MODULE)
+    msgpoolExit();
+ENDObjClassExit(msg)
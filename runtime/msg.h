@@ -56,22 +56,30 @@
  * adding new fields. You need to initialize them in
  * msgBaseConstruct(). That function header comment also describes
  * why this is the case.
+ *
+ * The structure is laid out by access frequency: the first two cache
+ * lines hold what filters and property access touch for (almost) every
+ * message, followed by the TAG/PROGNAME buffers, the timestamps and the
+ * inline buffers. Rarely used properties and format caches live in a
+ * separate, lazily allocated msgCold_t.
  */
+struct msgCold_s;
 struct msg {
     BEGINobjInstance
         ; /* Data to implement generic object - MUST be the first data element! */
-        flowControl_t flowCtlType;
-        /**< type of flow control we can apply, for enqueueing, needs not to be persisted because
-                            once data has entered the queue, this property is no longer needed. */
-        pthread_mutex_t mut;
+        /* --- hot part: used by filters and most property accesses --- */
         int iRefCount; /* reference counter (0 = unused) */
-        sbool bParseSuccess; /* set to reflect state of last executed higher level parser */
+        int msgFlags; /* flags associated with this message */
         unsigned short iSeverity; /* the severity  */
         unsigned short iFacility; /* Facility code */
+        short iProtocolVersion; /* protocol version of message received 0 - legacy, 1 syslog-protocol) */
+        sbool bParseSuccess; /* set to reflect state of last executed higher level parser */
+        sbool bFinalized; /* header fields are final, readers need not lock, see MsgFinalize() */
+        flowControl_t flowCtlType;
+        /**< type of flow control we can apply, for enqueueing, needs not to be persisted because
+                            once data has entered the queue, this property is no longer needed. */
         int offAfterPRI; /* offset, at which raw message WITHOUT PRI part starts in pszRawMsg */
         int offMSG; /* offset at which the MSG part starts in pszRawMsg */
-        short iProtocolVersion; /* protocol version of message received 0 - legacy, 1 syslog-protocol) */
-        int msgFlags; /* flags associated with this message */
         int iLenRawMsg; /* length of raw message */
         int iLenMSG; /* Length of the MSG part */
         int iLenTAG; /* Length of the TAG part */
@@ -80,27 +88,28 @@ struct msg {
         uchar *pszRawMsg; /* message as it was received on the wire. This is important in case we
                            * need to preserve cryptographic verifiers.  */
         uchar *pszHOSTNAME; /* HOSTNAME from syslog message */
-        char *pszRcvdAt3164; /* time as RFC3164 formatted string (always 15 characters) */
-        char *pszRcvdAt3339; /* time as RFC3164 formatted string (32 characters at most) */
-        char *pszRcvdAt_MySQL; /* rcvdAt as MySQL formatted string (always 14 characters) */
-        char *pszRcvdAt_PgSQL; /* rcvdAt as PgSQL formatted string (always 21 characters) */
-        char *pszTIMESTAMP3164; /* TIMESTAMP as RFC3164 formatted string (always 15 characters) */
-        char *pszTIMESTAMP3339; /* TIMESTAMP as RFC3339 formatted string (32 characters at most) */
-        char *pszTIMESTAMP_MySQL; /* TIMESTAMP as MySQL formatted string (always 14 characters) */
-        char *pszTIMESTAMP_PgSQL; /* TIMESTAMP as PgSQL formatted string (always 21 characters) */
-        uchar *pszStrucData; /* STRUCTURED-DATA */
-        uint16_t lenStrucData; /* (cached) length of STRUCTURED-DATA */
-        cstr_t *pCSAPPNAME; /* APP-NAME */
-        cstr_t *pCSPROCID; /* PROCID */
-        cstr_t *pCSMSGID; /* MSGID */
+        ruleset_t *pRuleset; /* ruleset to be used for processing this message */
         prop_t *pInputName; /* input name property */
         prop_t *pRcvFromIP; /* IP of system message was received from */
         union {
             prop_t *pRcvFrom; /* name of system message was received from */
             struct sockaddr_storage *pfrominet; /* unresolved name */
         } rcvFrom;
-
-        ruleset_t *pRuleset; /* ruleset to be used for processing this message */
+        struct json_object *json;
+        struct json_object *localvars;
+        cstr_t *pCSAPPNAME; /* APP-NAME */
+        cstr_t *pCSPROCID; /* PROCID */
+        cstr_t *pCSMSGID; /* MSGID */
+        union {
+            uchar *pszTAG; /* pointer to tag value */
+            uchar szBuf[CONF_TAG_BUFSIZE];
+        } TAG;
+        union {
+            uchar *ptr; /* pointer to progname value */
+            uchar szBuf[CONF_PROGNAME_BUFSIZE];
+        } PROGNAME;
+        /* --- warm part --- */
+        pthread_mutex_t mut;
         time_t ttGenTime; /* time msg object was generated, same as tRcvdAt, but a Unix timestamp.
                      While this field looks redundant, it is required because a Unix timestamp
                      is used at later processing stages (namely in the output arena). Thanks to
@@ -110,32 +119,37 @@ struct msg {
                      it obviously is solved in way or another...). */
         struct syslogTime tRcvdAt; /* time the message entered this program */
         struct syslogTime tTIMESTAMP; /* (parsed) value of the timestamp */
-        struct json_object *json;
-        struct json_object *localvars;
+        uchar *pszStrucData; /* STRUCTURED-DATA */
+        uint16_t lenStrucData; /* (cached) length of STRUCTURED-DATA */
+        char dfltTZ[8]; /* 7 chars max, less overhead than ptr! */
+        struct msgCold_s *pCold; /* rarely used data, NULL until first needed */
         /* some fixed-size buffers to save malloc()/free() for frequently used fields (from the default templates) */
-        uchar szRawMsg[CONF_RAWMSG_BUFSIZE];
         /* most messages are small, and these are stored here (without malloc/free!) */
         uchar szHOSTNAME[CONF_HOSTNAME_BUFSIZE];
-        union {
-            uchar *ptr; /* pointer to progname value */
-            uchar szBuf[CONF_PROGNAME_BUFSIZE];
-        } PROGNAME;
-        union {
-            uchar *pszTAG; /* pointer to tag value */
-            uchar szBuf[CONF_TAG_BUFSIZE];
-        } TAG;
-        char pszTimestamp3164[CONST_LEN_TIMESTAMP_3164 + 1];
-        char pszTimestamp3339[CONST_LEN_TIMESTAMP_3339 + 1];
-        char pszTIMESTAMP_SecFrac[7];
-        /* Note: a pointer is 64 bits/8 char, so this is actually fewer than a pointer! */
-        char pszRcvdAt_SecFrac[7];
-        /* same as above. Both are fractional seconds for their respective timestamp */
-        char pszTIMESTAMP_Unix[12]; /* almost as small as a pointer! */
-        char pszRcvdAt_Unix[12];
-        char dfltTZ[8]; /* 7 chars max, less overhead than ptr! */
-        uchar *pszUUID; /* The message's UUID */
+        uchar szRawMsg[CONF_RAWMSG_BUFSIZE];
 };
 
+/* The cold extension of a message. It holds the UUID and the formatted
+ * timestamp caches, which most configurations never use. It is allocated
+ * on first use (with the message locked) and is freed together with the
+ * message. Timestamp caches are empty strings until first formatted.
+ */
+typedef struct msgCold_s {
+    uchar *pszUUID; /* The message's UUID */
+    char pszTIMESTAMP3164[CONST_LEN_TIMESTAMP_3164 + 1];
+    char pszTIMESTAMP3339[CONST_LEN_TIMESTAMP_3339 + 1];
+    char pszTIMESTAMP_MySQL[15];
+    char pszTIMESTAMP_PgSQL[21];
+    char pszTIMESTAMP_SecFrac[7];
+    char pszTIMESTAMP_Unix[12];
+    char pszRcvdAt3164[16];
+    char pszRcvdAt3339[33];
+    char pszRcvdAt_MySQL[15];
+    char pszRcvdAt_PgSQL[21];
+    char pszRcvdAt_SecFrac[7];
+    char pszRcvdAt_Unix[12];
+} msgCold_t;
+
 
     /* message flags (msgFlags), not an enum for historical reasons */
     #define NOFLAG 0x000
@@ -166,14 +180,20 @@ struct msg {
 
     #define MAX_VARIABLE_NAME_LEN 1024
 
+    /* binary on-disk record format, see MsgSerializeBinary() */
+    #define MSG_BINREC_COOKIE 0xB1 /* never a valid first octet of a text-serialized record */
+    #define MSG_BINREC_VERSION 1
+
 /* function prototypes
  */
 PROTOTYPEObjClassInit(msg);
+PROTOTYPEObjClassExit(msg);
 rsRetVal msgConstruct(smsg_t **ppThis);
 rsRetVal msgConstructWithTime(smsg_t **ppThis, const struct syslogTime *stTime, const time_t ttGenTime);
 rsRetVal msgConstructForDeserializer(smsg_t **ppThis);
 rsRetVal msgConstructFinalizer(smsg_t *pThis);
 rsRetVal msgDestruct(smsg_t **ppM);
+void MsgFinalize(smsg_t *pM);
 smsg_t *MsgDup(smsg_t *pOld);
 smsg_t *MsgAddRef(smsg_t *pM);
 void setProtocolVersion(smsg_t *pM, int iNewVersion);
@@ -206,6 +226,8 @@ uchar *MsgGetProp(smsg_t *pMsg,
                   rs_size_t *pPropLen,
                   unsigned short *pbMustBeFreed,
                   struct syslogTime *ttNow);
+typedef uchar *(*msgPropGetter_t)(smsg_t *pMsg, const struct templateEntry *pTpe, rs_size_t *pLen);
+msgPropGetter_t MsgGetPropGetter(const struct templateEntry *pTpe);
 void getTAG(smsg_t *pM, uchar **ppBuf, int *piLen, sbool);
 const char *getTimeReported(smsg_t *pM, enum tplFormatTypes eFmt);
 const char *getPRI(smsg_t *pMsg);
@@ -218,6 +240,8 @@ rsRetVal msgAddMetadata(smsg_t *msg, uchar *metaname, uchar *metaval);
 rsRetVal msgAddMultiMetadata(smsg_t *msg, const uchar **metaname, const uchar **metaval, const int count);
 rsRetVal MsgGetSeverity(smsg_t *pThis, int *piSeverity);
 rsRetVal MsgDeserialize(smsg_t *pMsg, strm_t *pStrm);
+rsRetVal MsgSerializeBinary(smsg_t *const pThis, strm_t *const pStrm);
+rsRetVal MsgDeserializeBinary(smsg_t **const ppMsg, strm_t *const pStrm);
 rsRetVal MsgSetPropsViaJSON(smsg_t *__restrict__ const pMsg, const uchar *__restrict__ const json);
 rsRetVal MsgSetPropsViaJSON_Object(smsg_t *__restrict__ const pMsg, struct json_object *json);
 const uchar *msgGetJSONMESG(smsg_t *__restrict__ const pMsg);
@@ -0,0 +1,380 @@
+/* Recycling allocator for message objects and their buffers.
+ *
+ * Copyright 2025 Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file msgpool.c
+ * @brief Per-thread magazine caches on top of a global depot.
+ *
+ * Class 0 holds message objects, classes 1..POOL_NBUFCLASSES hold buffers
+ * of 64, 128, ... bytes (including a small header that records the class,
+ * so buffers can be freed without knowing their size).
+ *
+ * Each thread owns a cache with one free list per class. When a list grows
+ * beyond two magazines, one magazine is moved to the depot; when it runs
+ * empty, a magazine is fetched from the depot. The depot is bounded per
+ * class, anything beyond that is really freed. So the mutex is taken once
+ * per POOL_MAGSIZE objects, not once per object.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#ifdef HAVE_VALGRIND_VALGRIND_H
+    #include <valgrind/valgrind.h>
+#endif
+
+#include "rsyslog.h"
+#include "obj.h"
+#include "statsobj.h"
+#include "msgpool.h"
+#include "unicode-helper.h"
+
+/* pooling hides use-after-free from the address sanitizer, so we do
+ * not pool in such builds. The same is true for valgrind, which is checked
+ * at runtime. Debug builds do not pool by default either, but the
+ * RSYSLOG_MSGPOOL environment variable ("on"/"off") overrides that.
+ */
+#if defined(__SANITIZE_ADDRESS__)
+    #define MSGPOOL_DISABLED 1
+#elif defined(__has_feature)
+    #if __has_feature(address_sanitizer)
+        #define MSGPOOL_DISABLED 1
+    #endif
+#endif
+#ifdef DEBUG
+    #define MSGPOOL_DFLT_ACTIVE 0
+#else
+    #define MSGPOOL_DFLT_ACTIVE 1
+#endif
+
+#define POOL_MAGSIZE 32
+#define POOL_NBUFCLASSES 9 /* 64 ... 16384 bytes */
+#define POOL_NCLASSES (1 + POOL_NBUFCLASSES)
+#define POOL_MINBUFSHIFT 6
+#define POOL_DEPOTMAX (4 * 1024 * 1024) /* max bytes kept in the depot per class */
+#define POOL_BUFHDRSIZE 16 /* keeps returned buffers max-aligned */
+#define POOL_NOCLASS 0xff /* buffer header: plain malloc(), oversized */
+
+/* definitions for objects we access */
+DEFobjStaticHelpers;
+DEFobjCurrIf(statsobj)
+
+/* an object while it sits in the pool. The first object of a magazine
+ * also links the magazines inside the depot.
+ */
+typedef struct poolObj_s {
+    struct poolObj_s *pNext;
+    struct poolObj_s *pNextMag;
+    unsigned nMag;
+} poolObj_t;
+
+typedef struct poolCache_s {
+    poolObj_t *pFree[POOL_NCLASSES];
+    unsigned nFree[POOL_NCLASSES];
+} poolCache_t;
+
+static struct {
+    size_t size; /* full block size */
+    pthread_mutex_t mut;
+    poolObj_t *pMags;
+    unsigned nMags;
+    unsigned nMagsMax;
+} depot[POOL_NCLASSES];
+
+static int bPoolActive = 0;
+static pthread_key_t keyCache;
+static void (*pfnMsgRelease)(void *);
+
+static statsobj_t *stats;
+STATSCOUNTER_DEF(ctrMalloc, mutCtrMalloc)
+STATSCOUNTER_DEF(ctrFreed, mutCtrFreed)
+STATSCOUNTER_DEF(ctrDepotGet, mutCtrDepotGet)
+STATSCOUNTER_DEF(ctrDepotPut, mutCtrDepotPut)
+
+
+/* really free an object that leaves the pool */
+static void releaseObj(const int cls, poolObj_t *const p) {
+    if (cls == 0)
+        pfnMsgRelease(p);
+    else
+        free(p);
+}
+
+static void releaseList(const int cls, poolObj_t *p) {
+    poolObj_t *pNext;
+    for (; p != NULL; p = pNext) {
+        pNext = p->pNext;
+        releaseObj(cls, p);
+        STATSCOUNTER_INC(ctrFreed, mutCtrFreed);
+    }
+}
+
+
+/* hand a magazine (a list of nMag objects headed by pMag) to the depot */
+static void depotPut(const int cls, poolObj_t *const pMag, const unsigned nMag) {
+    pMag->nMag = nMag;
+    pthread_mutex_lock(&depot[cls].mut);
+    if (depot[cls].nMags < depot[cls].nMagsMax) {
+        pMag->pNextMag = depot[cls].pMags;
+        depot[cls].pMags = pMag;
+        ++depot[cls].nMags;
+        pthread_mutex_unlock(&depot[cls].mut);
+        STATSCOUNTER_INC(ctrDepotPut, mutCtrDepotPut);
+    } else {
+        pthread_mutex_unlock(&depot[cls].mut);
+        releaseList(cls, pMag);
+    }
+}
+
+
+/* refill an empty cache list from the depot, if possible */
+static void depotGet(const int cls, poolCache_t *const pCache) {
+    poolObj_t *pMag;
+
+    pthread_mutex_lock(&depot[cls].mut);
+    pMag = depot[cls].pMags;
+    if (pMag != NULL) {
+        depot[cls].pMags = pMag->pNextMag;
+        --depot[cls].nMags;
+    }
+    pthread_mutex_unlock(&depot[cls].mut);
+
+    if (pMag != NULL) {
+        pCache->pFree[cls] = pMag;
+        pCache->nFree[cls] = pMag->nMag;
+        STATSCOUNTER_INC(ctrDepotGet, mutCtrDepotGet);
+    }
+}
+
+
+static void cacheFlush(poolCache_t *const pCache) {
+    int cls;
+    for (cls = 0; cls < POOL_NCLASSES; ++cls) {
+        if (pCache->pFree[cls] != NULL) depotPut(cls, pCache->pFree[cls], pCache->nFree[cls]);
+        pCache->pFree[cls] = NULL;
+        pCache->nFree[cls] = 0;
+    }
+}
+
+/* pthread key destructor: a thread terminates, give its objects to others */
+static void cacheDestruct(void *p) {
+    if (p == NULL) return;
+    cacheFlush((poolCache_t *)p);
+    free(p);
+}
+
+/* returns the calling thread's cache or NULL if the pool cannot be used */
+static poolCache_t *getCache(void) {
+    poolCache_t *pCache;
+
+    if (!bPoolActive) return NULL;
+    pCache = pthread_getspecific(keyCache);
+    if (pCache == NULL) {
+        if ((pCache = calloc(1, sizeof(poolCache_t))) == NULL) return NULL;
+        if (pthread_setspecific(keyCache, pCache) != 0) {
+            free(pCache);
+            return NULL;
+        }
+    }
+    return pCache;
+}
+
+
+static void *poolAlloc(const int cls, int *const pbRecycled) {
+    poolCache_t *const pCache = getCache();
+    poolObj_t *p;
+
+    if (pCache != NULL) {
+        if (pCache->pFree[cls] == NULL) depotGet(cls, pCache);
+        if ((p = pCache->pFree[cls]) != NULL) {
+            pCache->pFree[cls] = p->pNext;
+            --pCache->nFree[cls];
+            *pbRecycled = 1;
+            return p;
+        }
+    }
+
+    *pbRecycled = 0;
+    STATSCOUNTER_INC(ctrMalloc, mutCtrMalloc);
+    return malloc(depot[cls].size);
+}
+
+
+static void poolFree(const int cls, void *const pObj) {
+    poolCache_t *const pCache = getCache();
+    poolObj_t *const p = (poolObj_t *)pObj;
+    poolObj_t *pLast;
+    unsigned i;
+
+    if (pCache == NULL) {
+        releaseObj(cls, p);
+        return;
+    }
+
+    p->pNext = pCache->pFree[cls];
+    pCache->pFree[cls] = p;
+    if (++pCache->nFree[cls] < 2 * POOL_MAGSIZE) return;
+
+    /* cache full: the most recently freed objects stay (they are likely
+     * still in the CPU cache), the older ones go to the depot.
+     */
+    for (pLast = p, i = 1; i < POOL_MAGSIZE; ++i) pLast = pLast->pNext;
+    depotPut(cls, pLast->pNext, pCache->nFree[cls] - POOL_MAGSIZE);
+    pLast->pNext = NULL;
+    pCache->nFree[cls] = POOL_MAGSIZE;
+}
+
+
+void *msgpoolAllocMsg(int *const pbRecycled) {
+    return poolAlloc(0, pbRecycled);
+}
+
+void msgpoolFreeMsg(void *const p) {
+    poolFree(0, p);
+}
+
+
+void *msgpoolAllocBuf(const size_t size) {
+    const size_t need = size + POOL_BUFHDRSIZE;
+    unsigned char *pBuf;
+    int bRecycled;
+    int cls;
+
+    for (cls = 1; cls < POOL_NCLASSES && depot[cls].size < need; ++cls)
+        ; /* just search */
+
+    if (cls == POOL_NCLASSES || !bPoolActive) {
+        if ((pBuf = malloc(need)) == NULL) return NULL;
+        pBuf[0] = POOL_NOCLASS;
+    } else {
+        if ((pBuf = poolAlloc(cls, &bRecycled)) == NULL) return NULL;
+        pBuf[0] = (unsigned char)cls;
+    }
+    return pBuf + POOL_BUFHDRSIZE;
+}
+
+void msgpoolFreeBuf(void *const p) {
+    unsigned char *pBuf;
+
+    if (p == NULL) return;
+    pBuf = (unsigned char *)p - POOL_BUFHDRSIZE;
+    if (pBuf[0] == POOL_NOCLASS)
+        free(pBuf);
+    else
+        poolFree(pBuf[0], pBuf);
+}
+
+
+/* decide whether objects are to be recycled, see top of file */
+static int ATTR_UNUSED wantPool(void) {
+    const char *const pszEnv = getenv("RSYSLOG_MSGPOOL");
+    int bWant = MSGPOOL_DFLT_ACTIVE;
+
+    if (pszEnv != NULL) bWant = !strcmp(pszEnv, "on");
+#ifdef HAVE_VALGRIND_VALGRIND_H
+    if (RUNNING_ON_VALGRIND) bWant = 0;
+#endif
+    return bWant;
+}
+
+
+rsRetVal msgpoolInit(const size_t msgSize, void (*const pfnRelease)(void *)) {
+    size_t maxMags;
+    int cls;
+    DEFiRet;
+
+    pfnMsgRelease = pfnRelease;
+    for (cls = 0; cls < POOL_NCLASSES; ++cls) {
+        depot[cls].size = (cls == 0) ? msgSize : ((size_t)1 << (POOL_MINBUFSHIFT + cls - 1));
+        if (depot[cls].size < sizeof(poolObj_t)) depot[cls].size = sizeof(poolObj_t);
+        maxMags = POOL_DEPOTMAX / (depot[cls].size * POOL_MAGSIZE);
+        depot[cls].nMagsMax = (maxMags < 2) ? 2 : (unsigned)maxMags;
+        depot[cls].pMags = NULL;
+        depot[cls].nMags = 0;
+        pthread_mutex_init(&depot[cls].mut, NULL);
+    }
+
+    CHKiRet(objGetObjInterface(&obj));
+    CHKiRet(objUse(statsobj, CORE_COMPONENT));
+    CHKiRet(statsobj.Construct(&stats));
+    CHKiRet(statsobj.SetName(stats, (uchar *)"msgpool"));
+    CHKiRet(statsobj.SetOrigin(stats, (uchar *)"core.msgpool"));
+    STATSCOUNTER_INIT(ctrMalloc, mutCtrMalloc);
+    CHKiRet(statsobj.AddCounter(stats, UCHAR_CONSTANT("malloc"), ctrType_IntCtr, CTR_FLAG_RESETTABLE, &ctrMalloc));
+    STATSCOUNTER_INIT(ctrFreed, mutCtrFreed);
+    CHKiRet(statsobj.AddCounter(stats, UCHAR_CONSTANT("freed"), ctrType_IntCtr, CTR_FLAG_RESETTABLE, &ctrFreed));
+    STATSCOUNTER_INIT(ctrDepotGet, mutCtrDepotGet);
+    CHKiRet(statsobj.AddCounter(stats, UCHAR_CONSTANT("depot.get"), ctrType_IntCtr, CTR_FLAG_RESETTABLE,
+                                &ctrDepotGet));
+    STATSCOUNTER_INIT(ctrDepotPut, mutCtrDepotPut);
+    CHKiRet(statsobj.AddCounter(stats, UCHAR_CONSTANT("depot.put"), ctrType_IntCtr, CTR_FLAG_RESETTABLE,
+                                &ctrDepotPut));
+    CHKiRet(statsobj.ConstructFinalize(stats));
+
+#ifndef MSGPOOL_DISABLED
+    if (!wantPool()) FINALIZE;
+    if (pthread_key_create(&keyCache, cacheDestruct) != 0) {
+        DBGPRINTF("msgpool: pthread_key_create failed, running without pool\n");
+        FINALIZE;
+    }
+    bPoolActive = 1;
+#endif
+
+finalize_it:
+    DBGPRINTF("msgpool: object recycling %s\n", bPoolActive ? "enabled" : "disabled");
+    RETiRet;
+}
+
+
+/* Called on runtime shutdown, when the worker threads are gone. Caches of
+ * threads that are still alive at this point (and never terminate before
+ * the process does) are not reclaimed.
+ */
+void msgpoolExit(void) {
+    poolCache_t *pCache;
+    poolObj_t *pMag, *pNextMag;
+    int cls;
+
+    if (bPoolActive) {
+        if ((pCache = pthread_getspecific(keyCache)) != NULL) {
+            cacheFlush(pCache);
+            free(pCache);
+            pthread_setspecific(keyCache, NULL);
+        }
+        bPoolActive = 0;
+        pthread_key_delete(keyCache);
+    }
+
+    for (cls = 0; cls < POOL_NCLASSES; ++cls) {
+        pthread_mutex_lock(&depot[cls].mut);
+        for (pMag = depot[cls].pMags; pMag != NULL; pMag = pNextMag) {
+            pNextMag = pMag->pNextMag;
+            releaseList(cls, pMag);
+        }
+        depot[cls].pMags = NULL;
+        depot[cls].nMags = 0;
+        pthread_mutex_unlock(&depot[cls].mut);
+        pthread_mutex_destroy(&depot[cls].mut);
+    }
+
+    if (stats != NULL) statsobj.Destruct(&stats);
+    objRelease(statsobj, CORE_COMPONENT);
+}
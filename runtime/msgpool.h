@@ -0,0 +1,78 @@
+/* Definitions for the message object and buffer pool.
+ *
+ * Copyright 2025 Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file msgpool.h
+ * @brief Recycling allocator for smsg_t objects and their out-of-line buffers.
+ *
+ * Messages are usually constructed by an input thread and destructed by a
+ * queue worker, so a plain per-thread free list would only ever grow on one
+ * side. The pool therefore keeps a small per-thread cache per size class
+ * and exchanges whole "magazines" of objects with a mutex-protected global
+ * depot. In steady state an input refills its cache from magazines the
+ * workers have handed back, and neither side calls malloc() or free().
+ *
+ * Message objects are returned to the pool with their mutex still
+ * initialized, so recycling also saves the pthread_mutex_init()/destroy()
+ * pair. The pool does not touch the object contents otherwise.
+ */
+#ifndef INCLUDED_MSGPOOL_H
+#define INCLUDED_MSGPOOL_H
+
+#include <stddef.h>
+
+/**
+ * @brief Initialize the pool. Called once from the msg class initializer.
+ * @param[in] msgSize size of the message objects handed out by msgpoolAllocMsg()
+ * @param[in] pfnRelease called for message objects that leave the pool for
+ *            good; must undo whatever state the caller keeps across recycling
+ *            and free() the object
+ */
+rsRetVal msgpoolInit(size_t msgSize, void (*pfnRelease)(void *));
+
+/** @brief Release all cached objects. Objects freed afterwards bypass the pool. */
+void msgpoolExit(void);
+
+/**
+ * @brief Obtain a message object.
+ * @param[out] pbRecycled set to 1 if the object was handed out before and
+ *             still carries the state preserved by the caller, 0 if it is
+ *             freshly malloc()ed
+ * @return the object or NULL if out of memory
+ */
+void *msgpoolAllocMsg(int *pbRecycled);
+
+/** @brief Return a message object obtained via msgpoolAllocMsg(). */
+void msgpoolFreeMsg(void *p);
+
+/**
+ * @brief Obtain a buffer of at least @p size bytes.
+ *
+ * Buffers obtained here MUST be released via msgpoolFreeBuf() and MUST NOT
+ * be realloc()ed. Oversized requests are served by malloc() transparently.
+ * @return the buffer or NULL if out of memory
+ */
+void *msgpoolAllocBuf(size_t size);
+
+/** @brief Release a buffer obtained via msgpoolAllocBuf(). NULL is permitted. */
+void msgpoolFreeBuf(void *p);
+
+#endif /* #ifndef INCLUDED_MSGPOOL_H */
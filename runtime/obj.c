@@ -1304,6 +1304,7 @@ rsRetVal objClassExit(void) {
     objRelease(strm, CORE_COMPONENT);
     objRelease(var, CORE_COMPONENT);
     objRelease(module, CORE_COMPONENT);
+    strmClassExit();
 
     /* TODO: implement the class exits! */
 #if 0
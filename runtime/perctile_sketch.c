@@ -0,0 +1,211 @@
+/* The percentile sketch (DDSketch), see perctile_sketch.h.
+ *
+ * Copyright 2025 Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "perctile_sketch.h"
+
+#define SKETCH_INITIAL_BINS 64
+
+perctile_sketch_t *perctile_sketch_new(unsigned accuracy, uint32_t maxBins) {
+    perctile_sketch_t *sk;
+    double a;
+
+    if (accuracy < 1 || accuracy > 50 || maxBins < 2) {
+        return NULL;
+    }
+    if ((sk = calloc(1, sizeof(perctile_sketch_t))) == NULL) {
+        return NULL;
+    }
+    a = accuracy / 100.0;
+    sk->gamma = (1.0 + a) / (1.0 - a);
+    sk->lnGamma = log(sk->gamma);
+    sk->maxBins = maxBins;
+    return sk;
+}
+
+void perctile_sketch_del(perctile_sketch_t *sk) {
+    if (sk != NULL) {
+        free(sk->pos.bins);
+        free(sk->neg.bins);
+        free(sk);
+    }
+}
+
+/* make the store cover bin idx, collapsing the lowest bins if the store
+ * would otherwise need more than maxBins. Returns the bin that idx must be
+ * counted in, or INT32_MIN if out of memory.
+ */
+static int32_t storeCover(perctile_sketch_store_t *st, int32_t idx, const uint32_t maxBins) {
+    int64_t curLo, curHi, newLo, newHi, span, want, extra;
+    uint64_t *bins;
+    uint32_t i;
+
+    if (st->len > 0 && idx >= st->offset && idx < st->offset + (int64_t)st->len) {
+        return idx;
+    }
+    if (st->len > 0) {
+        curLo = st->offset;
+        curHi = st->offset + (int64_t)st->len - 1;
+        if (idx < curLo && curHi - idx + 1 > maxBins) {
+            /* store already spans maxBins, idx belongs to the collapsed lowest bin */
+            if (st->len == maxBins) return st->offset;
+            idx = curHi - maxBins + 1;
+        }
+    } else {
+        curLo = curHi = idx;
+    }
+    newLo = (idx < curLo) ? idx : curLo;
+    newHi = (idx > curHi) ? idx : curHi;
+    if (newHi - newLo + 1 > maxBins) {
+        newLo = newHi - maxBins + 1;
+    }
+
+    /* leave some room in the direction we grow to avoid frequent reallocs */
+    span = newHi - newLo + 1;
+    want = 2 * (int64_t)st->len;
+    if (want < SKETCH_INITIAL_BINS) want = SKETCH_INITIAL_BINS;
+    if (want > maxBins) want = maxBins;
+    extra = (want > span) ? want - span : 0;
+    if (st->len == 0) {
+        newLo -= extra / 2;
+        newHi += extra - extra / 2;
+    } else if (idx < curLo) {
+        newLo -= extra;
+    } else {
+        newHi += extra;
+    }
+    if (newLo < INT32_MIN + 1 || newHi > INT32_MAX) {
+        return INT32_MIN;
+    }
+
+    if ((bins = calloc(newHi - newLo + 1, sizeof(uint64_t))) == NULL) {
+        return INT32_MIN;
+    }
+    for (i = 0; i < st->len; ++i) {
+        const int64_t j = (int64_t)st->offset + i;
+        bins[(j < newLo) ? 0 : j - newLo] += st->bins[i];
+    }
+    free(st->bins);
+    st->bins = bins;
+    st->offset = (int32_t)newLo;
+    st->len = (uint32_t)(newHi - newLo + 1);
+    return (idx < st->offset) ? st->offset : idx;
+}
+
+static int storeAdd(perctile_sketch_store_t *st, int32_t idx, uint64_t n, const uint32_t maxBins) {
+    if ((idx = storeCover(st, idx, maxBins)) == INT32_MIN) {
+        return -1;
+    }
+    st->bins[idx - st->offset] += n;
+    return 0;
+}
+
+int perctile_sketch_add(perctile_sketch_t *sk, int64_t value) {
+    double mag;
+
+    if (value == 0) {
+        ++sk->zeroCount;
+    } else {
+        mag = (value > 0) ? (double)value : -(double)value;
+        if (storeAdd((value > 0) ? &sk->pos : &sk->neg, (int32_t)ceil(log(mag) / sk->lnGamma), 1, sk->maxBins) !=
+            0) {
+            return -1;
+        }
+    }
+    ++sk->count;
+    return 0;
+}
+
+static int storeMerge(perctile_sketch_store_t *dst, const perctile_sketch_store_t *src, const uint32_t maxBins) {
+    uint32_t i;
+
+    for (i = 0; i < src->len; ++i) {
+        if (src->bins[i] != 0 && storeAdd(dst, src->offset + (int32_t)i, src->bins[i], maxBins) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int perctile_sketch_merge(perctile_sketch_t *dst, const perctile_sketch_t *src) {
+    if (storeMerge(&dst->pos, &src->pos, dst->maxBins) != 0 || storeMerge(&dst->neg, &src->neg, dst->maxBins) != 0) {
+        return -1;
+    }
+    dst->zeroCount += src->zeroCount;
+    dst->count += src->count;
+    return 0;
+}
+
+/* representative value of a bin: the one with the least relative error.
+ * As we only count integers, it is limited to the integers the bin can
+ * contain, which makes small values exact.
+ */
+static int64_t binValue(const perctile_sketch_t *sk, int32_t idx) {
+    const double hi = exp(idx * sk->lnGamma);
+    const double v = 2.0 * hi / (sk->gamma + 1.0);
+    int64_t r, lo;
+
+    if (v >= 9.2e18) return INT64_MAX;
+    r = llround(v);
+    lo = (int64_t)floor(hi / sk->gamma) + 1;
+    if (r < lo) r = lo;
+    if (r > (int64_t)floor(hi)) r = (int64_t)floor(hi);
+    return r;
+}
+
+int64_t perctile_sketch_value(const perctile_sketch_t *sk, unsigned percentile) {
+    uint64_t rank, cum = 0;
+    uint32_t i;
+
+    if (sk->count == 0) {
+        return 0;
+    }
+    if (percentile > 100) percentile = 100;
+    /* nearest rank, 0-based */
+    rank = (uint64_t)ceil(percentile / 100.0 * sk->count);
+    if (rank > 0) --rank;
+
+    /* negative values, from the largest magnitude down */
+    for (i = sk->neg.len; i > 0; --i) {
+        cum += sk->neg.bins[i - 1];
+        if (cum > rank) return -binValue(sk, sk->neg.offset + (int32_t)(i - 1));
+    }
+    cum += sk->zeroCount;
+    if (cum > rank) return 0;
+    for (i = 0; i < sk->pos.len; ++i) {
+        cum += sk->pos.bins[i];
+        if (cum > rank) return binValue(sk, sk->pos.offset + (int32_t)i);
+    }
+    /* not reached unless counts are inconsistent; return the largest value */
+    for (i = sk->pos.len; i > 0; --i) {
+        if (sk->pos.bins[i - 1] != 0) return binValue(sk, sk->pos.offset + (int32_t)(i - 1));
+    }
+    return 0;
+}
+
+void perctile_sketch_reset(perctile_sketch_t *sk) {
+    if (sk->pos.bins != NULL) memset(sk->pos.bins, 0, sk->pos.len * sizeof(uint64_t));
+    if (sk->neg.bins != NULL) memset(sk->neg.bins, 0, sk->neg.len * sizeof(uint64_t));
+    sk->count = 0;
+    sk->zeroCount = 0;
+}
@@ -0,0 +1,81 @@
+/* Definitions for the percentile sketch.
+ *
+ * Copyright 2025 Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file perctile_sketch.h
+ * @brief Quantile sketch with bounded relative error (DDSketch).
+ *
+ * Values are counted in logarithmically sized bins: bin i holds all values
+ * v with gamma^(i-1) < |v| <= gamma^i, where gamma = (1+a)/(1-a) for the
+ * relative accuracy a. Any quantile can then be estimated with a relative
+ * error of at most a, no matter how many values were added, and adding a
+ * value costs a logarithm and an increment. Negative values are counted in
+ * a second, mirrored set of bins, zero separately.
+ *
+ * Bins are allocated for the range of values actually seen. If more than
+ * maxBins would be needed, the bins of the smallest magnitudes are
+ * collapsed into one, so memory stays bounded while the accuracy of the
+ * high quantiles, which are usually the interesting ones, is kept.
+ *
+ * A sketch is not thread-safe; the caller must serialize access.
+ */
+#ifndef INCLUDED_PERCTILE_SKETCH_H
+#define INCLUDED_PERCTILE_SKETCH_H
+
+#include <stdint.h>
+
+typedef struct perctile_sketch_store_s {
+    uint64_t *bins;
+    int32_t offset; /* bin index of bins[0] */
+    uint32_t len; /* allocated bins */
+} perctile_sketch_store_t;
+
+typedef struct perctile_sketch_s {
+    double gamma;
+    double lnGamma;
+    uint32_t maxBins; /* per store */
+    uint64_t count;
+    uint64_t zeroCount;
+    perctile_sketch_store_t pos;
+    perctile_sketch_store_t neg;
+} perctile_sketch_t;
+
+/** @brief Create a sketch; accuracy is the relative error in percent (1..50). */
+perctile_sketch_t *perctile_sketch_new(unsigned accuracy, uint32_t maxBins);
+void perctile_sketch_del(perctile_sketch_t *sk);
+
+/** @return 0 on success, -1 if out of memory (the value is then not counted) */
+int perctile_sketch_add(perctile_sketch_t *sk, int64_t value);
+
+/** @brief Add all values of src to dst; both must use the same accuracy. */
+int perctile_sketch_merge(perctile_sketch_t *dst, const perctile_sketch_t *src);
+
+/**
+ * @brief Estimate the value at a percentile, using the nearest-rank method.
+ * @param percentile in [0,100]
+ * @return the estimate, 0 if the sketch is empty
+ */
+int64_t perctile_sketch_value(const perctile_sketch_t *sk, unsigned percentile);
+
+/** @brief Remove all values, but keep the bins allocated. */
+void perctile_sketch_reset(perctile_sketch_t *sk);
+
+#endif /* #ifndef INCLUDED_PERCTILE_SKETCH_H */
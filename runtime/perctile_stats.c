@@ -29,6 +29,7 @@
 #include "perctile_stats.h"
 #include "hashtable_itr.h"
 #include "perctile_ringbuf.h"
+#include "perctile_sketch.h"
 #include "datetime.h"
 
 #include <stdio.h>
@@ -54,6 +55,12 @@ DEFobjCurrIf(statsobj) DEFobjCurrIf(datetime)
 #define PERCTILE_CONF_PARAM_PERCENTILES "percentiles"
 #define PERCTILE_CONF_PARAM_WINDOW_SIZE "windowsize"
 #define PERCTILE_CONF_PARAM_DELIM "delimiter"
+#define PERCTILE_CONF_PARAM_ALGORITHM "algorithm"
+#define PERCTILE_CONF_PARAM_ACCURACY "accuracy"
+#define PERCTILE_CONF_PARAM_MAX_BINS "maxbins"
+
+#define PERCTILE_DEFAULT_ACCURACY 1 /* percent */
+#define PERCTILE_DEFAULT_MAX_BINS 2048
 
 #define PERCTILE_MAX_BUCKET_NS_METRIC_LENGTH 128
 #define PERCTILE_METRIC_NAME_SEPARATOR '.'
@@ -63,6 +70,9 @@ DEFobjCurrIf(statsobj) DEFobjCurrIf(datetime)
         {PERCTILE_CONF_PARAM_DELIM, eCmdHdlrString, 0},
         {PERCTILE_CONF_PARAM_PERCENTILES, eCmdHdlrArray, 0},
         {PERCTILE_CONF_PARAM_WINDOW_SIZE, eCmdHdlrPositiveInt, 0},
+        {PERCTILE_CONF_PARAM_ALGORITHM, eCmdHdlrGetWord, 0},
+        {PERCTILE_CONF_PARAM_ACCURACY, eCmdHdlrPositiveInt, 0},
+        {PERCTILE_CONF_PARAM_MAX_BINS, eCmdHdlrPositiveInt, 0},
 };
 
 static struct cnfparamblk modpblk = {CNFPARAMBLK_VERSION, sizeof(modpdescr) / sizeof(struct cnfparamdescr), modpdescr};
@@ -89,6 +99,8 @@ static void perctileStatDestruct(perctile_bucket_t *b, perctile_stat_t *pstat) {
         if (pstat->rb_observed_stats) {
             ringbuf_del(pstat->rb_observed_stats);
         }
+        perctile_sketch_del(pstat->sketch);
+        perctile_sketch_del(pstat->sketchSpare);
 
         if (pstat->ctrs) {
             for (size_t i = 0; i < pstat->perctile_ctrs_count; ++i) {
@@ -277,9 +289,15 @@ static rsRetVal perctile_observe(perctile_bucket_t *bkt, uchar *key, int64_t val
     time_t now;
     datetime.GetTime(&now);
 
-    pthread_rwlock_wrlock(&bkt->lock);
+    /* the bucket lock is only needed exclusively to add a new stat */
+    pthread_rwlock_rdlock(&bkt->lock);
     lock_initialized = 1;
     perctile_stat_t *pstat = (perctile_stat_t *)hashtable_search(bkt->htable, key);
+    if (!pstat) {
+        pthread_rwlock_unlock(&bkt->lock);
+        pthread_rwlock_wrlock(&bkt->lock);
+        pstat = (perctile_stat_t *)hashtable_search(bkt->htable, key);
+    }
     if (!pstat) {
         PERCTILE_STATS_LOG("perctile_observe(): key '%s' not found - creating new pstat", key);
         // create the pstat if not found
@@ -290,11 +308,23 @@ static rsRetVal perctile_observe(perctile_bucket_t *bkt, uchar *key, int64_t val
             ABORT_FINALIZE(RS_RET_OUT_OF_MEMORY);
         }
         pstat->perctile_ctrs_count = bkt->perctile_values_count;
-        pstat->rb_observed_stats = ringbuf_new(bkt->window_size);
-        if (!pstat->rb_observed_stats) {
-            free(pstat->ctrs);
-            free(pstat);
-            ABORT_FINALIZE(RS_RET_OUT_OF_MEMORY);
+        if (bkt->bSketch) {
+            pstat->sketch = perctile_sketch_new(bkt->sketch_accuracy, bkt->sketch_max_bins);
+            pstat->sketchSpare = perctile_sketch_new(bkt->sketch_accuracy, bkt->sketch_max_bins);
+            if (!pstat->sketch || !pstat->sketchSpare) {
+                perctile_sketch_del(pstat->sketch);
+                perctile_sketch_del(pstat->sketchSpare);
+                free(pstat->ctrs);
+                free(pstat);
+                ABORT_FINALIZE(RS_RET_OUT_OF_MEMORY);
+            }
+        } else {
+            pstat->rb_observed_stats = ringbuf_new(bkt->window_size);
+            if (!pstat->rb_observed_stats) {
+                free(pstat->ctrs);
+                free(pstat);
+                ABORT_FINALIZE(RS_RET_OUT_OF_MEMORY);
+            }
         }
         pstat->bReported = 0;
         pthread_rwlock_init(&pstat->stats_lock, NULL);
@@ -321,16 +351,23 @@ static rsRetVal perctile_observe(perctile_bucket_t *bkt, uchar *key, int64_t val
         STATSCOUNTER_INC(bkt->ctrNewKeyAdd, bkt->mutCtrNewKeyAdd);
     }
 
-    // add this value into the ringbuffer
-    assert(pstat->rb_observed_stats);
-    if (ringbuf_append_with_overwrite(pstat->rb_observed_stats, value) != 0) {
-        // ringbuffer is operating in overwrite mode, so should never see this.
-        ABORT_FINALIZE(RS_RET_ERR);
-    }
-
     // update perctile specific stats
     pthread_rwlock_wrlock(&pstat->stats_lock);
     {
+        if (pstat->sketch) {
+            if (perctile_sketch_add(pstat->sketch, value) != 0) {
+                pthread_rwlock_unlock(&pstat->stats_lock);
+                ABORT_FINALIZE(RS_RET_OUT_OF_MEMORY);
+            }
+        } else {
+            // add this value into the ringbuffer
+            assert(pstat->rb_observed_stats);
+            if (ringbuf_append_with_overwrite(pstat->rb_observed_stats, value) != 0) {
+                // ringbuffer is operating in overwrite mode, so should never see this.
+                pthread_rwlock_unlock(&pstat->stats_lock);
+                ABORT_FINALIZE(RS_RET_ERR);
+            }
+        }
         if (pstat->bReported) {
             // reset window values
             pstat->ctrWindowCount = pstat->ctrWindowSum = 0;
@@ -370,6 +407,35 @@ static int cmp(const void *p1, const void *p2) {
     return (*(ITEM *)p1) - (*(ITEM *)p2);
 }
 
+/* report a stat of a sketch bucket. The sketch that collected the values
+ * since the last report is swapped with an empty one, so observations only
+ * wait for the swap, not for the percentile calculation.
+ */
+static void report_perctile_sketch(perctile_stat_t *perc_stat) {
+    perctile_sketch_t *sketch;
+
+    pthread_rwlock_wrlock(&perc_stat->stats_lock);
+    sketch = perc_stat->sketch;
+    if (sketch->count != 0) {
+        perc_stat->sketch = perc_stat->sketchSpare;
+        perc_stat->sketchSpare = sketch;
+        perc_stat->bReported = 1;
+    }
+    pthread_rwlock_unlock(&perc_stat->stats_lock);
+    if (sketch->count == 0) {
+        return;
+    }
+
+    /* the spare sketch is only accessed by the (single) reporting thread */
+    for (size_t i = 0; i < perc_stat->perctile_ctrs_count; ++i) {
+        perctile_ctr_t *pctr = &perc_stat->ctrs[i];
+        pctr->ctr_perctile_stat = perctile_sketch_value(sketch, pctr->percentile);
+        PERCTILE_STATS_LOG("report_perctile_sketch() - perctile stat [%s, %d, %llu]", perc_stat->name,
+                           pctr->percentile, pctr->ctr_perctile_stat);
+    }
+    perctile_sketch_reset(sketch);
+}
+
 static rsRetVal report_perctile_stats(perctile_bucket_t *pbkt) {
     ITEM *buf = NULL;
     struct hashtable_itr *itr = NULL;
@@ -378,12 +444,23 @@ static rsRetVal report_perctile_stats(perctile_bucket_t *pbkt) {
     pthread_rwlock_rdlock(&pbkt->lock);
     if (hashtable_count(pbkt->htable)) {
         itr = hashtable_iterator(pbkt->htable);
-        CHKmalloc(buf = malloc(pbkt->window_size * sizeof(ITEM)));
+        if (!pbkt->bSketch) {
+            CHKmalloc(buf = malloc(pbkt->window_size * sizeof(ITEM)));
+        }
         do {
-            memset(buf, 0, pbkt->window_size * sizeof(ITEM));
             perctile_stat_t *perc_stat = hashtable_iterator_value(itr);
+            if (pbkt->bSketch) {
+                report_perctile_sketch(perc_stat);
+                continue;
+            }
+            memset(buf, 0, pbkt->window_size * sizeof(ITEM));
             // ringbuffer read
+            pthread_rwlock_wrlock(&perc_stat->stats_lock);
             size_t count = ringbuf_read_to_end(perc_stat->rb_observed_stats, buf, pbkt->window_size);
+            if (count) {
+                perc_stat->bReported = 1;
+            }
+            pthread_rwlock_unlock(&perc_stat->stats_lock);
             if (!count) {
                 continue;
             }
@@ -421,7 +498,6 @@ static rsRetVal report_perctile_stats(perctile_bucket_t *pbkt) {
                 PERCTILE_STATS_LOG("report_perctile_stats() - index: %d, perctile stat [%s, %d, %llu]", index,
                                    perc_stat->name, pctr->percentile, pctr->ctr_perctile_stat);
             }
-            perc_stat->bReported = 1;
         } while (hashtable_iterator_advance(itr));
     }
 
@@ -497,8 +573,14 @@ finalize_it:
 
 /* Create new perctile bucket, and add it to our list of perctile buckets.
  */
-static rsRetVal perctile_newBucket(
-    const uchar *name, const uchar *delim, uint8_t *perctiles, uint32_t perctilesCount, uint32_t windowSize) {
+static rsRetVal perctile_newBucket(const uchar *name,
+                                   const uchar *delim,
+                                   uint8_t *perctiles,
+                                   uint32_t perctilesCount,
+                                   uint32_t windowSize,
+                                   sbool bSketch,
+                                   unsigned accuracy,
+                                   uint32_t maxBins) {
     perctile_buckets_t *bkts;
     perctile_bucket_t *b = NULL;
     pthread_rwlockattr_t bucket_lock_attr;
@@ -524,6 +606,9 @@ static rsRetVal perctile_newBucket(
         b->perctile_values_count = perctilesCount;
         memcpy(b->perctile_values, perctiles, perctilesCount * sizeof(uint8_t));
         b->window_size = windowSize;
+        b->bSketch = bSketch;
+        b->sketch_accuracy = accuracy;
+        b->sketch_max_bins = maxBins;
         b->next = NULL;
         PERCTILE_STATS_LOG(
             "perctile_newBucket: create new bucket for %s,"
@@ -567,6 +652,10 @@ rsRetVal perctile_processCnf(struct cnfobj *o) {
     uint8_t *perctiles = NULL;
     uint32_t perctilesCount = 0;
     uint64_t windowSize = 0;
+    sbool bSketch = 0;
+    unsigned accuracy = PERCTILE_DEFAULT_ACCURACY;
+    uint32_t maxBins = PERCTILE_DEFAULT_MAX_BINS;
+    char *algorithm = NULL;
     DEFiRet;
 
     pvals = nvlstGetParams(o->nvlst, &modpblk, NULL);
@@ -595,6 +684,32 @@ rsRetVal perctile_processCnf(struct cnfobj *o) {
             }
         } else if (!strcmp(modpblk.descr[i].name, PERCTILE_CONF_PARAM_WINDOW_SIZE)) {
             windowSize = pvals[i].val.d.n;
+        } else if (!strcmp(modpblk.descr[i].name, PERCTILE_CONF_PARAM_ALGORITHM)) {
+            CHKmalloc(algorithm = es_str2cstr(pvals[i].val.d.estr, NULL));
+            if (!strcasecmp(algorithm, "sketch")) {
+                bSketch = 1;
+            } else if (!strcasecmp(algorithm, "window")) {
+                bSketch = 0;
+            } else {
+                LogError(0, RS_RET_CONF_PARAM_INVLD,
+                         "percentile_stats: invalid algorithm '%s', "
+                         "must be 'window' or 'sketch'",
+                         algorithm);
+                ABORT_FINALIZE(RS_RET_CONF_PARAM_INVLD);
+            }
+        } else if (!strcmp(modpblk.descr[i].name, PERCTILE_CONF_PARAM_ACCURACY)) {
+            accuracy = pvals[i].val.d.n;
+            if (accuracy > 50) {
+                LogError(0, RS_RET_CONF_PARAM_INVLD,
+                         "percentile_stats: accuracy must be between 1 and 50 (percent), "
+                         "using 50");
+                accuracy = 50;
+            }
+        } else if (!strcmp(modpblk.descr[i].name, PERCTILE_CONF_PARAM_MAX_BINS)) {
+            maxBins = pvals[i].val.d.n;
+            if (maxBins < 2) {
+                maxBins = 2;
+            }
         } else {
             dbgprintf(
                 "perctile: program error, non-handled "
@@ -604,10 +719,11 @@ rsRetVal perctile_processCnf(struct cnfobj *o) {
     }
 
     if (name != NULL && perctiles != NULL) {
-        CHKiRet(perctile_newBucket(name, delim, perctiles, perctilesCount, windowSize));
+        CHKiRet(perctile_newBucket(name, delim, perctiles, perctilesCount, windowSize, bSketch, accuracy, maxBins));
     }
 
 finalize_it:
+    free(algorithm);
     free(name);
     free(delim);
     free(perctiles);
@@ -33,12 +33,14 @@ struct perctile_ctr_s {
 struct perctile_stat_s {
     uchar name[128];
     sbool bReported;
-    struct ringbuf_s *rb_observed_stats;
+    struct ringbuf_s *rb_observed_stats; /* window algorithm only */
+    struct perctile_sketch_s *sketch; /* sketch algorithm only, receives observations */
+    struct perctile_sketch_s *sketchSpare; /* swapped with sketch on report */
     // array of requested perctile to track
     struct perctile_ctr_s *ctrs;
     size_t perctile_ctrs_count;
 
-    pthread_rwlock_t stats_lock;
+    pthread_rwlock_t stats_lock; /* guards observations and window counters */
     intctr_t ctrWindowCount;
     ctr_t *refCtrWindowCount;
     intctr_t ctrWindowMin;
@@ -62,6 +64,9 @@ struct perctile_bucket_s {
     STATSCOUNTER_DEF(ctrOpsOverflow, mutCtrOpsOverflow);
     ctr_t *pOpsOverflowCtr;
     uint32_t window_size;
+    sbool bSketch; /* use sketches instead of a window of raw values */
+    unsigned sketch_accuracy; /* relative error in percent */
+    uint32_t sketch_max_bins;
     // These percentile values apply to all perctile stats in this bucket.
     uint8_t *perctile_values;
     size_t perctile_values_count;
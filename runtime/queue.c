@@ -87,7 +87,7 @@
  * - **Warning:** If a Direct-queued action blocks, it stalls the worker
  * thread, potentially halting all processing for that worker.
  *
- * 2.  **In-Memory (LinkedList and FixedArray)**
+ * 2.  **In-Memory (LinkedList, FixedArray and RingBuffer)**
  * - **Behavior:** Buffers messages in RAM. Extremely fast but offers no
  * persistence across restarts.
  * - **Sub-Types:**
@@ -96,6 +96,12 @@
  * - `FixedArray`: A legacy option that pre-allocates a static array of
  * pointers. It can be slightly faster under constant load but is
  * less memory-efficient. It remains the default for ruleset queues.
+ * - `RingBuffer`: A pre-allocated, bounded lock-free MPMC ring (see
+ * mpmcring.c). While the queue is below its flow control, discard and
+ * high water marks, producers enqueue without taking the queue mutex;
+ * above them, the regular mutex-protected path takes over, so all
+ * watermark semantics are retained. Workers still dequeue whole batches
+ * under the mutex, which is amortized over the batch size.
  * - **Use Case:** High-performance buffering where a potential loss of
  * in-flight messages on crash is acceptable.
  *
@@ -191,6 +197,7 @@
 #include <time.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <sched.h>
 
 #include "rsyslog.h"
 #include "queue.h"
@@ -238,10 +245,12 @@ static rsRetVal ConsumerDA(qqueue_t *pThis, wti_t *pWti);
 static rsRetVal batchProcessed(qqueue_t *pThis, wti_t *pWti);
 static rsRetVal qqueueMultiEnqObjNonDirect(qqueue_t *pThis, multi_submit_t *pMultiSub);
 static rsRetVal qqueueMultiEnqObjDirect(qqueue_t *pThis, multi_submit_t *pMultiSub);
+static rsRetVal qqueueMultiEnqObjRingBuffer(qqueue_t *pThis, multi_submit_t *pMultiSub);
 static rsRetVal qAddDirect(qqueue_t *pThis, smsg_t *pMsg);
 static rsRetVal qDestructDirect(qqueue_t __attribute__((unused)) * pThis);
 static rsRetVal qConstructDirect(qqueue_t __attribute__((unused)) * pThis);
 static rsRetVal qDestructDisk(qqueue_t *pThis);
+static void drainLedgerFree(qqueue_t *const pThis);
 rsRetVal qqueueSetSpoolDir(qqueue_t *pThis, uchar *pszSpoolDir, int lenSpoolDir);
 
 /* some constants for queuePersist () */
@@ -278,7 +287,11 @@ static struct cnfparamdescr cnfpdescr[] = {{"queue.filename", eCmdHdlrGetWord, 0
                                            {"queue.dequeuetimeend", eCmdHdlrInt, 0},
                                            {"queue.cry.provider", eCmdHdlrGetWord, 0},
                                            {"queue.samplinginterval", eCmdHdlrInt, 0},
-                                           {"queue.takeflowctlfrommsg", eCmdHdlrBinary, 0}};
+                                           {"queue.takeflowctlfrommsg", eCmdHdlrBinary, 0},
+                                           {"queue.shards", eCmdHdlrPositiveInt, 0},
+                                           {"queue.spoolformat", eCmdHdlrGetWord, 0},
+                                           {"queue.mmap", eCmdHdlrBinary, 0},
+                                           {"queue.paralleldrain", eCmdHdlrBinary, 0}};
 static struct cnfparamblk pblk = {CNFPARAMBLK_VERSION, sizeof(cnfpdescr) / sizeof(struct cnfparamdescr), cnfpdescr};
 
 /* support to detect duplicate queue file names */
@@ -408,6 +421,9 @@ static const char *getQueueTypeName(queueType_t t) {
         case QUEUETYPE_LINKEDLIST:
             r = "LinkedList";
             break;
+        case QUEUETYPE_RINGBUFFER:
+            r = "RingBuffer";
+            break;
         case QUEUETYPE_DISK:
             r = "Disk";
             break;
@@ -451,6 +467,10 @@ void qqueueDbgPrint(qqueue_t *pThis) {
     dbgoprint((obj_t *)pThis, "queue.dequeueslowdown: %d\n", pThis->iDeqSlowdown);
     dbgoprint((obj_t *)pThis, "queue.dequeuetimebegin: %d\n", pThis->iDeqtWinFromHr);
     dbgoprint((obj_t *)pThis, "queue.dequeuetimeend: %d\n", pThis->iDeqtWinToHr);
+    dbgoprint((obj_t *)pThis, "queue.shards: %d\n", pThis->iNumShards);
+    dbgoprint((obj_t *)pThis, "queue.spoolformat: %s\n", pThis->bBinarySpool ? "binary" : "text");
+    dbgoprint((obj_t *)pThis, "queue.mmap: %d\n", pThis->bUseMmap);
+    dbgoprint((obj_t *)pThis, "queue.paralleldrain: %d\n", pThis->bParallelDrain);
 }
 
 
@@ -593,6 +613,9 @@ static rsRetVal StartDA(qqueue_t *pThis) {
     pThis->pqDA->iMinDeqBatchSize = pThis->iMinDeqBatchSize;
     pThis->pqDA->iMinMsgsPerWrkr = pThis->iMinMsgsPerWrkr;
     pThis->pqDA->iLowWtrMrk = pThis->iLowWtrMrk;
+    pThis->pqDA->bBinarySpool = pThis->bBinarySpool;
+    pThis->pqDA->bUseMmap = pThis->bUseMmap;
+    pThis->pqDA->bParallelDrain = pThis->bParallelDrain;
     if (pThis->useCryprov) {
         /* hand over cryprov to DA queue - in-mem queue does no longer need it
          * and DA queue will be kept active from now on until termination.
@@ -857,6 +880,156 @@ static rsRetVal qDelLinkedList(qqueue_t *pThis) {
 }
 
 
+/* -------------------- ring buffer  -------------------- */
+/* The ring buffer releases its slot already at dequeue time (the message
+ * pointer lives on in the worker's batch), so qDel() has nothing to do. As
+ * a consequence, the rings never hold more entries than iQueueSize says.
+ * Each ring is sized with some headroom above queue.size because producers
+ * on the lock-free path check the size limit without the mutex and thus
+ * may overshoot it by a few entries.
+ *
+ * With queue.shards > 1, there is one ring per shard. A producer uses the
+ * shard selected by a hash of its thread id, so each input thread keeps
+ * hitting the same ring (and cache lines). Each shard is sized for an even
+ * share of queue.size (plus headroom), so a producer whose shard is full
+ * spills over into the other shards. A worker gets a home shard on its
+ * first dequeue and only steals from other shards if its own is empty.
+ */
+static rsRetVal qConstructRingBuffer(qqueue_t *pThis) {
+    size_t shardSize;
+    int i;
+    DEFiRet;
+
+    assert(pThis != NULL);
+
+    if (pThis->iMaxQueueSize == 0) ABORT_FINALIZE(RS_RET_QSIZE_ZERO);
+
+    pThis->tVars.ringbuf.nShards = (pThis->iNumShards < 1) ? 1 : pThis->iNumShards;
+    shardSize = ((size_t)pThis->iMaxQueueSize + pThis->tVars.ringbuf.nShards - 1) / pThis->tVars.ringbuf.nShards;
+    CHKmalloc(pThis->tVars.ringbuf.ppRings = calloc(pThis->tVars.ringbuf.nShards, sizeof(mpmcring_t *)));
+    for (i = 0; i < pThis->tVars.ringbuf.nShards; ++i) {
+        CHKiRet(mpmcringConstruct(&pThis->tVars.ringbuf.ppRings[i], shardSize + 1024));
+    }
+    pThis->tVars.ringbuf.nIdleWrkr = 0;
+    pThis->tVars.ringbuf.iDeqShard = 0;
+    pThis->tVars.ringbuf.iNextWrkrShard = 0;
+
+    qqueueChkIsDA(pThis);
+
+finalize_it:
+    RETiRet;
+}
+
+
+static rsRetVal qDestructRingBuffer(qqueue_t *pThis) {
+    int i;
+    DEFiRet;
+
+    assert(pThis != NULL);
+
+    queueDrain(pThis); /* discard any remaining queue entries */
+    if (pThis->tVars.ringbuf.ppRings != NULL) {
+        for (i = 0; i < pThis->tVars.ringbuf.nShards; ++i) {
+            mpmcringDestruct(&pThis->tVars.ringbuf.ppRings[i]);
+        }
+        free(pThis->tVars.ringbuf.ppRings);
+        pThis->tVars.ringbuf.ppRings = NULL;
+    }
+
+    RETiRet;
+}
+
+
+/* push a message into the producer shard of the calling thread or, if
+ * that one is full, into the next shard with a free slot.
+ */
+static rsRetVal ringBufferPush(qqueue_t *const pThis, smsg_t *const pMsg) {
+    const int nShards = pThis->tVars.ringbuf.nShards;
+    int i, iShard;
+
+    if (nShards == 1) return mpmcringPush(pThis->tVars.ringbuf.ppRings[0], pMsg);
+    /* Fibonacci hashing; thread ids are usually aligned pointers, so low bits are useless */
+    const uint64_t h = (uint64_t)(uintptr_t)pthread_self() * UINT64_C(0x9E3779B97F4A7C15);
+    iShard = (h >> 32) % (unsigned)nShards;
+    for (i = 0; i < nShards; ++i) {
+        if (mpmcringPush(pThis->tVars.ringbuf.ppRings[(iShard + i) % nShards], pMsg) == RS_RET_OK) {
+            return RS_RET_OK;
+        }
+    }
+    return RS_RET_QUEUE_FULL;
+}
+
+
+/* set the home shard of the worker that is about to dequeue. Must be
+ * called with the queue mutex locked.
+ */
+static void ATTR_NONNULL() ringBufferSetDeqShard(qqueue_t *const pThis, wti_t *const pWti) {
+    if (pWti->iQueueShard < 0 || pWti->iQueueShard >= pThis->tVars.ringbuf.nShards) {
+        pWti->iQueueShard = pThis->tVars.ringbuf.iNextWrkrShard;
+        pThis->tVars.ringbuf.iNextWrkrShard = (pThis->tVars.ringbuf.iNextWrkrShard + 1) % pThis->tVars.ringbuf.nShards;
+    }
+    pThis->tVars.ringbuf.iDeqShard = pWti->iQueueShard;
+}
+
+
+static rsRetVal qAddRingBuffer(qqueue_t *pThis, smsg_t *pMsg) {
+    DEFiRet;
+
+    if (ringBufferPush(pThis, pMsg) != RS_RET_OK) {
+        /* can only happen if lock-free producers overshot queue.size by more than the headroom */
+        DBGOPRINT((obj_t *)pThis, "ring buffer slots exhausted, discarding message\n");
+        STATSCOUNTER_INC(pThis->ctrFDscrd, pThis->mutCtrFDscrd);
+        msgDestruct(&pMsg);
+        ABORT_FINALIZE(RS_RET_QUEUE_FULL);
+    }
+
+finalize_it:
+    RETiRet;
+}
+
+
+/* dequeue from the home shard, stealing from the other shards if it is empty.
+ * As the queue size is only incremented after a message has been published,
+ * there is always a message to be found if the caller saw a non-zero size.
+ * However, it may sit behind a slot that a producer has claimed but not yet
+ * published, so we retry until we find it (or the queue is really empty).
+ */
+static rsRetVal qDeqRingBuffer(qqueue_t *pThis, smsg_t **ppMsg) {
+    const int nShards = pThis->tVars.ringbuf.nShards;
+    int i;
+    DEFiRet;
+
+    if (nShards == 1) {
+        if (mpmcringPop(pThis->tVars.ringbuf.ppRings[0], (void **)ppMsg) != RS_RET_OK) {
+            dbgprintf("qDeqRingBuffer: ring is empty!\n");
+            *ppMsg = NULL;
+        }
+        FINALIZE;
+    }
+
+    while (1) {
+        for (i = 0; i < nShards; ++i) {
+            const int iShard = (pThis->tVars.ringbuf.iDeqShard + i) % nShards;
+            if (mpmcringTryPop(pThis->tVars.ringbuf.ppRings[iShard], (void **)ppMsg) == RS_RET_OK) FINALIZE;
+        }
+        if (getLogicalQueueSize(pThis) <= 0) {
+            dbgprintf("qDeqRingBuffer: all shards are empty!\n");
+            *ppMsg = NULL;
+            FINALIZE;
+        }
+        sched_yield(); /* a producer is mid-push, give it a chance to finish */
+    }
+
+finalize_it:
+    RETiRet;
+}
+
+
+static rsRetVal qDelRingBuffer(qqueue_t __attribute__((unused)) * pThis) {
+    return RS_RET_OK;
+}
+
+
 /* -------------------- disk  -------------------- */
 
 
@@ -1069,6 +1242,9 @@ static rsRetVal qConstructDisk(qqueue_t *pThis) {
     CHKiRet(strm.SetiMaxFileSize(pThis->tVars.disk.pWrite, pThis->iMaxFileSize));
     CHKiRet(strm.SetiMaxFileSize(pThis->tVars.disk.pReadDeq, pThis->iMaxFileSize));
     CHKiRet(strm.SetiMaxFileSize(pThis->tVars.disk.pReadDel, pThis->iMaxFileSize));
+    /* the write stream only preallocates segments, the dequeue stream reads via mmap() */
+    CHKiRet(strm.SetbUseMmap(pThis->tVars.disk.pWrite, pThis->bUseMmap));
+    CHKiRet(strm.SetbUseMmap(pThis->tVars.disk.pReadDeq, pThis->bUseMmap));
 
 finalize_it:
     RETiRet;
@@ -1092,6 +1268,7 @@ static rsRetVal qDestructDisk(qqueue_t *pThis) {
         }
         strm.Destruct(&pThis->tVars.disk.pWrite);
     }
+    drainLedgerFree(pThis);
     if (pThis->tVars.disk.pReadDeq != NULL) strm.Destruct(&pThis->tVars.disk.pReadDeq);
     if (pThis->tVars.disk.pReadDel != NULL) strm.Destruct(&pThis->tVars.disk.pReadDel);
 
@@ -1106,7 +1283,11 @@ static rsRetVal ATTR_NONNULL(1, 2) qAddDisk(qqueue_t *const pThis, smsg_t *pMsg)
     const int oldfile = strmGetCurrFileNum(pThis->tVars.disk.pWrite);
 
     CHKiRet(strm.SetWCntr(pThis->tVars.disk.pWrite, &nWriteCount));
-    CHKiRet((objSerialize(pMsg))(pMsg, pThis->tVars.disk.pWrite));
+    if (pThis->bBinarySpool) {
+        CHKiRet(MsgSerializeBinary(pMsg, pThis->tVars.disk.pWrite));
+    } else {
+        CHKiRet((objSerialize(pMsg))(pMsg, pThis->tVars.disk.pWrite));
+    }
     CHKiRet(strm.Flush(pThis->tVars.disk.pWrite));
     CHKiRet(strm.SetWCntr(pThis->tVars.disk.pWrite, NULL)); /* no more counting for now... */
 
@@ -1140,19 +1321,37 @@ finalize_it:
 }
 
 
-static rsRetVal qDeqDisk(qqueue_t *pThis, smsg_t **ppMsg) {
+/* Records are self-identifying by their first octet, so we can read both
+ * the text and the binary format regardless of queue.spoolformat. This
+ * permits to change the format while a queue still has data on disk.
+ * pStrm is the dequeue stream or, with queue.parallelDrain, a segment stream.
+ */
+static rsRetVal ATTR_NONNULL() qDeqDiskStrm(qqueue_t *const pThis, strm_t *const pStrm, smsg_t **ppMsg) {
+    uchar c;
     DEFiRet;
-    iRet = objDeserializeWithMethods(ppMsg, (uchar *)"msg", 3, pThis->tVars.disk.pReadDeq, NULL, NULL,
-                                     (rsRetVal(*)(void *, ...))msgConstructForDeserializer, NULL,
-                                     (rsRetVal(*)(void *, ...))MsgDeserialize);
+    CHKiRet(strm.ReadChar(pStrm, &c));
+    CHKiRet(strm.UnreadChar(pStrm, c));
+    if (c == MSG_BINREC_COOKIE) {
+        iRet = MsgDeserializeBinary(ppMsg, pStrm);
+    } else {
+        iRet = objDeserializeWithMethods(ppMsg, (uchar *)"msg", 3, pStrm, NULL, NULL,
+                                         (rsRetVal(*)(void *, ...))msgConstructForDeserializer, NULL,
+                                         (rsRetVal(*)(void *, ...))MsgDeserialize);
+    }
+finalize_it:
     if (iRet != RS_RET_OK) {
         LogError(0, iRet, "%s: qDeqDisk error happened at around offset %lld", obj.GetName((obj_t *)pThis),
-                 (long long)pThis->tVars.disk.pReadDeq->iCurrOffs);
+                 (long long)pStrm->iCurrOffs);
     }
     RETiRet;
 }
 
 
+static rsRetVal qDeqDisk(qqueue_t *pThis, smsg_t **ppMsg) {
+    return qDeqDiskStrm(pThis, pThis->tVars.disk.pReadDeq, ppMsg);
+}
+
+
 /* -------------------- direct (no queueing) -------------------- */
 static rsRetVal qConstructDirect(qqueue_t __attribute__((unused)) * pThis) {
     return RS_RET_OK;
@@ -1580,10 +1779,12 @@ rsRetVal qqueueConstruct(qqueue_t **ppThis,
 
     pThis->pszFilePrefix = NULL;
     pThis->qType = qType;
+    pThis->iNumShards = 1;
 
 
     INIT_ATOMIC_HELPER_MUT(pThis->mutQueueSize);
     INIT_ATOMIC_HELPER_MUT(pThis->mutLogDeq);
+    INIT_ATOMIC_HELPER_MUT(pThis->mutIdleWrkr);
 
 finalize_it:
     OBJCONSTRUCT_CHECK_SUCCESS_AND_CLEANUP
@@ -1698,9 +1899,11 @@ finalize_it:
 }
 
 
-/* Finally remove n elements from the queue store.
+/* Finally remove n elements from the queue store. For disk queues, deqFileNum
+ * and deqOffs are the store position right after those elements.
  */
-static rsRetVal ATTR_NONNULL(1) DoDeleteBatchFromQStore(qqueue_t *const pThis, const int nElem) {
+static rsRetVal ATTR_NONNULL(1)
+    DoDeleteBatchFromQStore(qqueue_t *const pThis, const int nElem, const int deqFileNum, const int64 deqOffs) {
     int i;
     off64_t bytesDel = 0; /* keep CLANG static anaylzer happy */
     DEFiRet;
@@ -1709,8 +1912,7 @@ static rsRetVal ATTR_NONNULL(1) DoDeleteBatchFromQStore(qqueue_t *const pThis, c
 
     /* now send delete request to storage driver */
     if (pThis->qType == QUEUETYPE_DISK) {
-        strmMultiFileSeek(pThis->tVars.disk.pReadDel, pThis->tVars.disk.deqFileNumOut, pThis->tVars.disk.deqOffs,
-                          &bytesDel);
+        strmMultiFileSeek(pThis->tVars.disk.pReadDel, deqFileNum, deqOffs, &bytesDel);
         /* We need to correct the on-disk file size. This time it is a bit tricky:
          * we free disk space only upon file deletion. So we need to keep track of what we
          * have read until we get an out-offset that is lower than the in-offset (which
@@ -1755,6 +1957,263 @@ static rsRetVal ATTR_NONNULL(1) DoDeleteBatchFromQStore(qqueue_t *const pThis, c
 }
 
 
+/* ------------------------------ parallel disk queue drain ------------------------------
+ * With queue.parallelDrain, segment files that the writer has already finished are handed
+ * out as a whole to queue workers, which then deserialize them concurrently and without
+ * holding the queue mutex. Only the tail of the store (the file currently being written)
+ * is still read sequentially via pReadDeq. Everything dequeued is recorded in the drain
+ * ledger (see qDrainPiece_t), which replaces the to-delete list for such queues.
+ */
+
+static inline int drainIsParallel(const qqueue_t *const pThis) {
+    return pThis->qType == QUEUETYPE_DISK && pThis->bParallelDrain;
+}
+
+
+static void drainPieceDestruct(qDrainPiece_t *const pPiece) {
+    if (pPiece->pStrm != NULL) strm.Destruct(&pPiece->pStrm);
+    free(pPiece);
+}
+
+
+/* free the drain ledger on queue destruction. Anything not yet released is still
+ * contained in the store and will be read again on restart.
+ */
+static void drainLedgerFree(qqueue_t *const pThis) {
+    qDrainPiece_t *pPiece;
+    while ((pPiece = pThis->tVars.disk.pDrainRoot) != NULL) {
+        pThis->tVars.disk.pDrainRoot = pPiece->pNext;
+        drainPieceDestruct(pPiece);
+    }
+    pThis->tVars.disk.pDrainLast = NULL;
+    pThis->tVars.disk.nSegsOpen = 0;
+}
+
+
+static void ATTR_NONNULL() drainLedgerAppend(qqueue_t *const pThis, qDrainPiece_t *const pPiece) {
+    if (pThis->tVars.disk.pDrainLast == NULL) {
+        pThis->tVars.disk.pDrainRoot = pPiece;
+    } else {
+        pThis->tVars.disk.pDrainLast->pNext = pPiece;
+    }
+    pThis->tVars.disk.pDrainLast = pPiece;
+}
+
+
+/* delete the completed prefix of the drain ledger from the store. Pieces completed
+ * out of order stay in the ledger until everything in front of them is done, so
+ * that the persisted read position never skips unprocessed messages.
+ * Must be called with the queue mutex locked.
+ */
+static void ATTR_NONNULL() drainLedgerRelease(qqueue_t *const pThis) {
+    qDrainPiece_t *pPiece;
+
+    while ((pPiece = pThis->tVars.disk.pDrainRoot) != NULL && pPiece->bSealed && !pPiece->bBusy &&
+           pPiece->nDone >= pPiece->nElem) {
+        pThis->tVars.disk.pDrainRoot = pPiece->pNext;
+        if (pThis->tVars.disk.pDrainRoot == NULL) pThis->tVars.disk.pDrainLast = NULL;
+        const int nElem = pPiece->nElem;
+        const int endFNum = pPiece->endFNum;
+        const int64 endOffs = pPiece->endOffs;
+        drainPieceDestruct(pPiece); /* closes the segment file before it is deleted */
+        DBGOPRINT((obj_t *)pThis, "drain ledger: releasing %d elements up to file %d, offset %lld\n", nElem,
+                  endFNum, (long long)endOffs);
+        DoDeleteBatchFromQStore(pThis, nElem, endFNum, endOffs);
+    }
+}
+
+
+/* hand out the segment file the dequeue stream is currently positioned in to the
+ * parallel readers. The dequeue stream itself moves on to the next file.
+ * Must be called with the queue mutex locked.
+ */
+static rsRetVal ATTR_NONNULL() drainClaimSegment(qqueue_t *const pThis, qDrainPiece_t **const ppPiece) {
+    qDrainPiece_t *pPiece = NULL;
+    strm_t *pStrm = NULL;
+    const int fileNum = strmGetCurrFileNum(pThis->tVars.disk.pReadDeq);
+    DEFiRet;
+
+    CHKmalloc(pPiece = calloc(1, sizeof(qDrainPiece_t)));
+    CHKiRet(strm.Dup(pThis->tVars.disk.pReadDeq, &pStrm));
+    CHKiRet(strm.SetbDeleteOnClose(pStrm, 0));
+    CHKiRet(strm.SetbSegmentOnly(pStrm, 1));
+    CHKiRet(strm.ConstructFinalize(pStrm));
+    if (pThis->useCryprov) {
+        CHKiRet(strm.Setcryprov(pStrm, &pThis->cryprov));
+        CHKiRet(strm.SetcryprovData(pStrm, pThis->cryprovData));
+    }
+    CHKiRet(strm.SeekCurrOffs(pStrm));
+    CHKiRet(strmSkipToFile(pThis->tVars.disk.pReadDeq, fileNum + 1));
+
+    pPiece->endFNum = fileNum + 1;
+    pPiece->endOffs = 0;
+    pPiece->pStrm = pStrm;
+    pStrm = NULL;
+    drainLedgerAppend(pThis, pPiece);
+    ++pThis->tVars.disk.nSegsOpen;
+    DBGOPRINT((obj_t *)pThis, "drain ledger: segment file %d handed out to parallel readers\n", fileNum);
+    *ppPiece = pPiece;
+    pPiece = NULL;
+
+finalize_it:
+    if (pStrm != NULL) strm.Destruct(&pStrm);
+    free(pPiece);
+    RETiRet;
+}
+
+
+/* find a segment for a parallel reader: one that is already handed out but
+ * currently not read by anyone, or else the next complete segment file.
+ * Returns RS_RET_NOT_FOUND if there is none. Must be called with the queue
+ * mutex locked.
+ */
+static rsRetVal ATTR_NONNULL() drainFindSegment(qqueue_t *const pThis, qDrainPiece_t **const ppPiece) {
+    qDrainPiece_t *pPiece;
+    DEFiRet;
+
+    for (pPiece = pThis->tVars.disk.pDrainRoot; pPiece != NULL; pPiece = pPiece->pNext) {
+        if (pPiece->pStrm != NULL && !pPiece->bSealed && !pPiece->bBusy) {
+            *ppPiece = pPiece;
+            FINALIZE;
+        }
+    }
+
+    if (pThis->tVars.disk.nSegsOpen < pThis->iNumWorkerThreads &&
+        strmGetCurrFileNum(pThis->tVars.disk.pReadDeq) != strmGetCurrFileNum(pThis->tVars.disk.pWrite)) {
+        CHKiRet(drainClaimSegment(pThis, ppPiece));
+        FINALIZE;
+    }
+
+    iRet = RS_RET_NOT_FOUND;
+
+finalize_it:
+    RETiRet;
+}
+
+
+/* read up to one batch of messages from a segment into the worker's batch. This is
+ * called WITHOUT the queue mutex, the piece is protected by its bBusy flag. *pbEOF
+ * is set if the segment is exhausted.
+ */
+static rsRetVal ATTR_NONNULL()
+    drainReadSegment(qqueue_t *const pThis, qDrainPiece_t *const pPiece, wti_t *const pWti, int *const pnRead,
+                     int *const pbEOF) {
+    int nRead = 0;
+    uchar c;
+    rsRetVal localRet;
+    DEFiRet;
+
+    *pbEOF = 0;
+    while (nRead < pThis->iDeqBatchSize) {
+        localRet = strm.ReadChar(pPiece->pStrm, &c);
+        if (localRet == RS_RET_EOF) {
+            *pbEOF = 1;
+            break;
+        }
+        CHKiRet(localRet);
+        CHKiRet(strm.UnreadChar(pPiece->pStrm, c));
+        CHKiRet(qDeqDiskStrm(pThis, pPiece->pStrm, &pWti->batch.pElem[nRead].pMsg));
+        ++nRead;
+    }
+
+finalize_it:
+    *pnRead = nRead;
+    RETiRet;
+}
+
+
+/* dequeue the next batch from a segment file, if there is one. The queue mutex
+ * is temporarily released while the segment is read. Returns RS_RET_NOT_FOUND if
+ * no segment is available, in which case the caller reads from the tail.
+ */
+static rsRetVal ATTR_NONNULL() drainDequeueSegment(qqueue_t *const pThis,
+                                                   wti_t *const pWti,
+                                                   int *const pnDequeued,
+                                                   int *const pnDiscarded) {
+    qDrainPiece_t *pPiece;
+    smsg_t *pMsg;
+    int nRead;
+    int bEOF;
+    int nDequeued = 0;
+    int nDiscarded = 0;
+    int i;
+    rsRetVal localRet;
+    DEFiRet;
+
+    do {
+        CHKiRet(drainFindSegment(pThis, &pPiece));
+        pPiece->bBusy = 1;
+        d_pthread_mutex_unlock(pThis->mut);
+        localRet = drainReadSegment(pThis, pPiece, pWti, &nRead, &bEOF);
+        d_pthread_mutex_lock(pThis->mut);
+        pPiece->bBusy = 0;
+        ATOMIC_ADD_int(&pThis->nLogDeq, nRead, &pThis->mutLogDeq);
+        pPiece->nElem += nRead;
+        if (localRet != RS_RET_OK) {
+            /* we cannot re-sync inside a segment, so give up on the rest of it */
+            LogError(0, localRet,
+                     "%s: error reading queue segment, remaining messages "
+                     "of that segment are lost",
+                     obj.GetName((obj_t *)pThis));
+            bEOF = 1;
+        }
+        if (bEOF) {
+            pPiece->bSealed = 1;
+            strm.Destruct(&pPiece->pStrm);
+            --pThis->tVars.disk.nSegsOpen;
+            drainLedgerRelease(pThis);
+        }
+    } while (nRead == 0);
+
+    for (i = 0; i < nRead; ++i) {
+        pMsg = pWti->batch.pElem[i].pMsg;
+        if (qqueueChkDiscardMsg(pThis, pThis->iQueueSize, pMsg) == RS_RET_QUEUE_FULL) {
+            ++nDiscarded;
+            continue;
+        }
+        pWti->batch.pElem[nDequeued].pMsg = pMsg;
+        pWti->batch.eltState[nDequeued] = BATCH_STATE_RDY;
+        ++nDequeued;
+    }
+    pWti->batch.pDrainPiece = pPiece;
+    *pnDequeued = nDequeued;
+    *pnDiscarded = nDiscarded;
+
+finalize_it:
+    RETiRet;
+}
+
+
+/* record a batch read from the tail of the store in the drain ledger. */
+static rsRetVal ATTR_NONNULL() drainAddTailBatch(qqueue_t *const pThis, batch_t *const pBatch, const int nElemDeq) {
+    qDrainPiece_t *pPiece;
+    DEFiRet;
+
+    CHKmalloc(pPiece = calloc(1, sizeof(qDrainPiece_t)));
+    pPiece->endFNum = pThis->tVars.disk.deqFileNumOut;
+    pPiece->endOffs = pThis->tVars.disk.deqOffs;
+    pPiece->nElem = nElemDeq;
+    pPiece->bSealed = 1;
+    drainLedgerAppend(pThis, pPiece);
+    pBatch->pDrainPiece = pPiece;
+
+finalize_it:
+    RETiRet;
+}
+
+
+/* a batch from a parallel-drain queue is fully processed */
+static void ATTR_NONNULL() drainBatchDone(qqueue_t *const pThis, batch_t *const pBatch) {
+    qDrainPiece_t *const pPiece = pBatch->pDrainPiece;
+
+    if (pPiece == NULL) return; /* empty batch */
+    pPiece->nDone += pBatch->nElemDeq;
+    pBatch->pDrainPiece = NULL;
+    drainLedgerRelease(pThis);
+}
+/* ---------------------------- END parallel disk queue drain ---------------------------- */
+
+
 /* remove messages from the physical queue store that are fully processed. This is
  * controlled via the to-delete list.
  */
@@ -1767,20 +2226,25 @@ static rsRetVal DeleteBatchFromQStore(qqueue_t *pThis, batch_t *pBatch) {
     assert(pBatch != NULL);
 
     dbgprintf("rger: deleteBatchFromQStore, nElem %d\n", (int)pBatch->nElem);
+    if (drainIsParallel(pThis)) {
+        drainBatchDone(pThis, pBatch);
+        FINALIZE;
+    }
     pTdl = tdlPeek(pThis); /* get current head element */
     if (pTdl == NULL) { /* to-delete list empty */
-        DoDeleteBatchFromQStore(pThis, pBatch->nElem);
+        DoDeleteBatchFromQStore(pThis, pBatch->nElem, pThis->tVars.disk.deqFileNumOut, pThis->tVars.disk.deqOffs);
     } else if (pBatch->deqID == pThis->deqIDDel) {
         deqIDDel = pThis->deqIDDel;
         pTdl = tdlPeek(pThis);
         while (pTdl != NULL && deqIDDel == pTdl->deqID) {
-            DoDeleteBatchFromQStore(pThis, pTdl->nElemDeq);
+            DoDeleteBatchFromQStore(pThis, pTdl->nElemDeq, pThis->tVars.disk.deqFileNumOut,
+                                    pThis->tVars.disk.deqOffs);
             tdlPop(pThis);
             ++deqIDDel;
             pTdl = tdlPeek(pThis);
         }
         /* old entries deleted, now delete current ones... */
-        DoDeleteBatchFromQStore(pThis, pBatch->nElem);
+        DoDeleteBatchFromQStore(pThis, pBatch->nElem, pThis->tVars.disk.deqFileNumOut, pThis->tVars.disk.deqOffs);
     } else {
         /* can not delete, insert into to-delete list */
         DBGPRINTF("not at head of to-delete list, enqueue %d\n", (int)pBatch->deqID);
@@ -1856,6 +2320,7 @@ static rsRetVal ATTR_NONNULL() DequeueConsumableElements(qqueue_t *const pThis,
     struct timespec timeout;
     smsg_t *pMsg;
     rsRetVal localRet;
+    int bSegBatch = 0; /* batch was read from a segment file (queue.parallelDrain)? */
     DEFiRet;
 
     nDeleted = pWti->batch.nElemDeq;
@@ -1864,6 +2329,8 @@ static rsRetVal ATTR_NONNULL() DequeueConsumableElements(qqueue_t *const pThis,
     nDequeued = nDiscarded = 0;
     if (pThis->qType == QUEUETYPE_DISK) {
         pThis->tVars.disk.deqFileNumIn = strmGetCurrFileNum(pThis->tVars.disk.pReadDeq);
+    } else if (pThis->qType == QUEUETYPE_RINGBUFFER) {
+        ringBufferSetDeqShard(pThis, pWti);
     }
 
     /* work-around clang static analyzer false positive, we need a const value */
@@ -1872,7 +2339,17 @@ static rsRetVal ATTR_NONNULL() DequeueConsumableElements(qqueue_t *const pThis,
         timeoutComp(&timeout, pThis->toMinDeqBatchSize); /* get absolute timeout */
     }
 
-    while ((iQueueSize = getLogicalQueueSize(pThis)) > 0 && nDequeued < pThis->iDeqBatchSize) {
+    if (drainIsParallel(pThis) && getLogicalQueueSize(pThis) > 0) {
+        localRet = drainDequeueSegment(pThis, pWti, &nDequeued, &nDiscarded);
+        if (localRet == RS_RET_OK) {
+            bSegBatch = 1;
+            iQueueSize = getLogicalQueueSize(pThis);
+        } else if (localRet != RS_RET_NOT_FOUND) {
+            ABORT_FINALIZE(localRet);
+        }
+    }
+
+    while (!bSegBatch && (iQueueSize = getLogicalQueueSize(pThis)) > 0 && nDequeued < pThis->iDeqBatchSize) {
         int rd_fd = -1;
         int64_t rd_offs = 0;
         int wr_fd = -1;
@@ -1886,6 +2363,10 @@ static rsRetVal ATTR_NONNULL() DequeueConsumableElements(qqueue_t *const pThis,
             wr_offs = pThis->tVars.disk.pWrite->iCurrOffs;
         }
         if (rd_fd != -1 && rd_fd == wr_fd && rd_offs == wr_offs) {
+            if (pThis->tVars.disk.nSegsOpen > 0) {
+                /* tail is drained, the rest is in segments currently read by other workers */
+                break;
+            }
             DBGPRINTF(
                 "problem on disk queue '%s': "
                 //"queue size log %d, phys %d, but rd_fd=wr_rd=%d and offs=%lld\n",
@@ -1944,6 +2425,9 @@ static rsRetVal ATTR_NONNULL() DequeueConsumableElements(qqueue_t *const pThis,
     if (pThis->qType == QUEUETYPE_DISK) {
         strm.GetCurrOffset(pThis->tVars.disk.pReadDeq, &pThis->tVars.disk.deqOffs);
         pThis->tVars.disk.deqFileNumOut = strmGetCurrFileNum(pThis->tVars.disk.pReadDeq);
+        if (drainIsParallel(pThis) && !bSegBatch && nDequeued + nDiscarded > 0) {
+            CHKiRet(drainAddTailBatch(pThis, &pWti->batch, nDequeued + nDiscarded));
+        }
     }
 
     /* it is sufficient to persist only when the bulk of work is done */
@@ -2165,6 +2649,22 @@ static rsRetVal batchProcessed(qqueue_t *pThis, wti_t *pWti) {
 }
 
 
+/* called when a regular worker terminates, with the queue mutex locked. A
+ * ring buffer worker that leaves while idle (inactivity timeout, shutdown)
+ * must withdraw its idle announcement, else producers would keep taking
+ * the locked path to wake a worker that no longer exists.
+ */
+static rsRetVal ConsumerRegExit(qqueue_t *pThis, wti_t *pWti) {
+    if (pWti->bAnnouncedIdle) {
+        ATOMIC_DEC(&pThis->tVars.ringbuf.nIdleWrkr, &pThis->mutIdleWrkr);
+        pWti->bAnnouncedIdle = 0;
+        DBGOPRINT((obj_t *)pThis, "worker exits, idle ringbuffer workers now %d\n",
+                  ATOMIC_FETCH_32BIT(&pThis->tVars.ringbuf.nIdleWrkr, &pThis->mutIdleWrkr));
+    }
+    return RS_RET_OK;
+}
+
+
 /* This is the queue consumer in the regular (non-DA) case. It is
  * protected by the queue mutex, but MUST release it as soon as possible.
  * rgerhards, 2008-01-21
@@ -2179,6 +2679,18 @@ static rsRetVal ConsumerReg(qqueue_t *pThis, wti_t *pWti) {
     ISOBJ_TYPE_assert(pThis, qqueue);
     ISOBJ_TYPE_assert(pWti, wti);
 
+    /* Ring buffer producers do not take the mutex and thus only wake workers
+     * if one may be sleeping. To avoid lost wakeups, we must announce ourselves
+     * as (potentially) idle *before* looking at the queue size. The announcement
+     * is kept while we sleep and withdrawn once we obtained work or the worker
+     * terminates (see ConsumerRegExit()).
+     */
+    const int isRingBuffer = (pThis->qType == QUEUETYPE_RINGBUFFER);
+    if (isRingBuffer && !pWti->bAnnouncedIdle) {
+        ATOMIC_INC(&pThis->tVars.ringbuf.nIdleWrkr, &pThis->mutIdleWrkr);
+        pWti->bAnnouncedIdle = 1;
+    }
+
     iRet = DequeueForConsumer(pThis, pWti, &skippedMsgs);
     if (iRet == RS_RET_FILE_NOT_FOUND) {
         /* This is a fatal condition and means the queue is almost unusable */
@@ -2192,6 +2704,11 @@ static rsRetVal ConsumerReg(qqueue_t *pThis, wti_t *pWti) {
         FINALIZE;
     }
 
+    if (isRingBuffer) {
+        ATOMIC_DEC(&pThis->tVars.ringbuf.nIdleWrkr, &pThis->mutIdleWrkr);
+        pWti->bAnnouncedIdle = 0;
+    }
+
     /* we now have a non-idle batch of work, so we can release the queue mutex and process it */
     d_pthread_mutex_unlock(pThis->mut);
     bNeedReLock = 1;
@@ -2417,6 +2934,14 @@ rsRetVal qqueueStart(rsconf_t *cnf, qqueue_t *pThis) /* this is the Construction
             pThis->qDel = qDelLinkedList;
             pThis->MultiEnq = qqueueMultiEnqObjNonDirect;
             break;
+        case QUEUETYPE_RINGBUFFER:
+            pThis->qConstruct = qConstructRingBuffer;
+            pThis->qDestruct = qDestructRingBuffer;
+            pThis->qAdd = qAddRingBuffer;
+            pThis->qDeq = qDeqRingBuffer;
+            pThis->qDel = qDelRingBuffer;
+            pThis->MultiEnq = qqueueMultiEnqObjRingBuffer;
+            break;
         case QUEUETYPE_DISK:
             pThis->qConstruct = qConstructDisk;
             pThis->qDestruct = qDestructDisk;
@@ -2475,6 +3000,18 @@ rsRetVal qqueueStart(rsconf_t *cnf, qqueue_t *pThis) /* this is the Construction
         if (wrk < pThis->iFullDlyMrk) pThis->iFullDlyMrk = wrk;
     }
 
+    if (pThis->qType == QUEUETYPE_RINGBUFFER) {
+        /* the lock-free enqueue path must stay below every mark that requires
+         * action under the queue mutex (flow control, discarding, DA activation).
+         */
+        wrk = pThis->iMaxQueueSize;
+        if (pThis->iLightDlyMrk > 0 && pThis->iLightDlyMrk < wrk) wrk = pThis->iLightDlyMrk;
+        if (pThis->iFullDlyMrk > 0 && pThis->iFullDlyMrk < wrk) wrk = pThis->iFullDlyMrk;
+        if (pThis->iDiscardMrk > 0 && pThis->iDiscardMrk < wrk) wrk = pThis->iDiscardMrk;
+        if (pThis->bIsDA && pThis->iHighWtrMrk > 0 && pThis->iHighWtrMrk < wrk) wrk = pThis->iHighWtrMrk;
+        pThis->tVars.ringbuf.iFastEnqMrk = (pThis->iSmpInterval > 0) ? 0 : wrk;
+    }
+
     DBGOPRINT((obj_t *)pThis,
               "params: type %d, enq-only %d, disk assisted %d, spoolDir '%s', maxFileSz %lld, "
               "maxQSize %d, lqsize %d, pqsize %d, child %d, full delay %d, "
@@ -2510,6 +3047,7 @@ rsRetVal qqueueStart(rsconf_t *cnf, qqueue_t *pThis) /* this is the Construction
     CHKiRet(wtpSetpfGetDeqBatchSize(pThis->pWtpReg, (rsRetVal(*)(void *pUsr, int *))GetDeqBatchSize));
     CHKiRet(wtpSetpfDoWork(pThis->pWtpReg, (rsRetVal(*)(void *pUsr, void *pWti))ConsumerReg));
     CHKiRet(wtpSetpfObjProcessed(pThis->pWtpReg, (rsRetVal(*)(void *pUsr, wti_t *pWti))batchProcessed));
+    CHKiRet(wtpSetpfWrkrExit(pThis->pWtpReg, (rsRetVal(*)(void *pUsr, wti_t *pWti))ConsumerRegExit));
     CHKiRet(wtpSetpmutUsr(pThis->pWtpReg, pThis->mut));
     CHKiRet(wtpSetiNumWorkerThreads(pThis->pWtpReg, pThis->iNumWorkerThreads));
     CHKiRet(wtpSettoWrkShutdown(pThis->pWtpReg, pThis->toWrkShutdown));
@@ -2830,6 +3368,7 @@ BEGINobjDestruct(qqueue) /* be sure to specify the object type also in END and C
 
         DESTROY_ATOMIC_HELPER_MUT(pThis->mutQueueSize);
         DESTROY_ATOMIC_HELPER_MUT(pThis->mutLogDeq);
+        DESTROY_ATOMIC_HELPER_MUT(pThis->mutIdleWrkr);
 
         /* type-specific destructor */
         iRet = pThis->qDestruct(pThis);
@@ -3117,6 +3656,107 @@ static rsRetVal qqueueMultiEnqObjDirect(qqueue_t *pThis, multi_submit_t *pMultiS
 finalize_it:
     RETiRet;
 }
+
+
+/* Try to enqueue a message into a ring buffer queue without taking the queue
+ * mutex. This is only done while the queue is below all marks that require
+ * flow control, discarding or DA activation; above them, we return 0 and the
+ * caller must use the regular, mutex-protected doEnqSingleObj().
+ * Note: the size is incremented only after the message has been published
+ * in the ring, so a worker that sees the new size can always dequeue it.
+ */
+static int ATTR_NONNULL() qqueueTryEnqRingBufferFast(qqueue_t *const pThis, smsg_t *const pMsg) {
+    if (pThis->bEnqOnly || getPhysicalQueueSize(pThis) >= pThis->tVars.ringbuf.iFastEnqMrk) return 0;
+
+    if (ringBufferPush(pThis, pMsg) != RS_RET_OK) return 0;
+
+    STATSCOUNTER_INC(pThis->ctrEnqueued, pThis->mutCtrEnqueued);
+    ATOMIC_INC(&pThis->iQueueSize, &pThis->mutQueueSize);
+#ifdef ENABLE_IMDIAG
+    #ifdef HAVE_ATOMIC_BUILTINS
+    ATOMIC_INC(&iOverallQueueSize, &NULL);
+    #else
+    ++iOverallQueueSize; /* racy, but we can't wait for a mutex! */
+    #endif
+#endif
+    STATSCOUNTER_SETMAX_NOMUT(pThis->ctrMaxqsize, pThis->iQueueSize);
+    return 1;
+}
+
+
+/* After lock-free enqueues, make sure enough workers are active. The queue
+ * mutex is only taken if a worker may be sleeping (see ConsumerReg()) or if
+ * the queue has grown enough to warrant an additional worker. Otherwise the
+ * running workers will pick up the new messages with their next batch.
+ */
+static void ATTR_NONNULL() qqueueRingBufferAdviseWorkers(qqueue_t *const pThis) {
+    int iWantWrkrs;
+
+    if (pThis->bEnqOnly) return;
+
+    if (pThis->iMinMsgsPerWrkr <= 0) {
+        iWantWrkrs = 1;
+    } else {
+        iWantWrkrs = getLogicalQueueSize(pThis) / pThis->iMinMsgsPerWrkr + 1;
+    }
+    if (iWantWrkrs > pThis->iNumWorkerThreads) iWantWrkrs = pThis->iNumWorkerThreads;
+
+    if (ATOMIC_FETCH_32BIT(&pThis->tVars.ringbuf.nIdleWrkr, &pThis->mutIdleWrkr) > 0 ||
+        ATOMIC_FETCH_32BIT(&pThis->pWtpReg->iCurNumWrkThrd, &pThis->pWtpReg->mutCurNumWrkThrd) < iWantWrkrs) {
+        d_pthread_mutex_lock(pThis->mut);
+        qqueueAdviseMaxWorkers(pThis);
+        d_pthread_mutex_unlock(pThis->mut);
+    }
+}
+
+
+/* enqueue to a ring buffer queue. As long as possible, messages are enqueued
+ * lock-free. Once a message needs the regular path, it and all remaining
+ * messages are enqueued under the queue mutex, so the submission order is kept.
+ * pFlowCtlType is NULL if the flow control type shall be taken from each message.
+ */
+static rsRetVal ATTR_NONNULL(1, 2) qqueueEnqRingBuffer(qqueue_t *const pThis,
+                                                       smsg_t **const ppMsgs,
+                                                       const int nElem,
+                                                       const flowControl_t *const pFlowCtlType) {
+    int iCancelStateSave;
+    int i;
+    rsRetVal localRet;
+    DEFiRet;
+
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &iCancelStateSave);
+    for (i = 0; i < nElem; ++i) {
+        if (!qqueueTryEnqRingBufferFast(pThis, ppMsgs[i])) break;
+    }
+
+    if (i == nElem) {
+        qqueueRingBufferAdviseWorkers(pThis);
+        FINALIZE;
+    }
+
+    d_pthread_mutex_lock(pThis->mut);
+    for (; i < nElem; ++i) {
+        localRet = doEnqSingleObj(pThis, (pFlowCtlType == NULL) ? ppMsgs[i]->flowCtlType : *pFlowCtlType, ppMsgs[i]);
+        if (localRet != RS_RET_OK && localRet != RS_RET_QUEUE_FULL) {
+            iRet = localRet;
+            break;
+        }
+    }
+    qqueueChkPersist(pThis, nElem);
+    qqueueAdviseMaxWorkers(pThis);
+    d_pthread_mutex_unlock(pThis->mut);
+
+finalize_it:
+    pthread_setcancelstate(iCancelStateSave, NULL);
+    RETiRet;
+}
+
+
+static rsRetVal qqueueMultiEnqObjRingBuffer(qqueue_t *pThis, multi_submit_t *pMultiSub) {
+    ISOBJ_TYPE_assert(pThis, qqueue);
+    assert(pMultiSub != NULL);
+    return qqueueEnqRingBuffer(pThis, pMultiSub->ppMsgs, pMultiSub->nElem, NULL);
+}
 /* ------------------------------ END multi-enqueue functions ------------------------------ */
 
 
@@ -3128,6 +3768,12 @@ rsRetVal qqueueEnqMsg(qqueue_t *pThis, flowControl_t flowCtlType, smsg_t *pMsg)
     int iCancelStateSave;
     ISOBJ_TYPE_assert(pThis, qqueue);
 
+    if (pThis->qType == QUEUETYPE_RINGBUFFER) {
+        /* ring buffer queues do their own (mostly lock-free) locking */
+        iRet = qqueueEnqRingBuffer(pThis, &pMsg, 1, &flowCtlType);
+        RETiRet;
+    }
+
     const int isNonDirectQ = pThis->qType != QUEUETYPE_DIRECT;
 
     if (isNonDirectQ) {
@@ -3254,7 +3900,8 @@ finalize_it:
 void qqueueCorrectParams(qqueue_t *pThis) {
     int goodval; /* a "good value" to use for comparisons (different objects) */
 
-    if (pThis->iMaxQueueSize < 100 && (pThis->qType == QUEUETYPE_LINKEDLIST || pThis->qType == QUEUETYPE_FIXED_ARRAY)) {
+    if (pThis->iMaxQueueSize < 100 && (pThis->qType == QUEUETYPE_LINKEDLIST || pThis->qType == QUEUETYPE_FIXED_ARRAY ||
+                                       pThis->qType == QUEUETYPE_RINGBUFFER)) {
         LogMsg(0, RS_RET_OK_WARN, LOG_WARNING,
                "Note: queue.size=\"%d\" is very "
                "low and can lead to unpredictable results. See also "
@@ -3477,6 +4124,25 @@ rsRetVal qqueueApplyCnfParam(qqueue_t *pThis, struct nvlst *lst) {
             pThis->iSmpInterval = pvals[i].val.d.n;
         } else if (!strcmp(pblk.descr[i].name, "queue.takeflowctlfrommsg")) {
             pThis->takeFlowCtlFromMsg = pvals[i].val.d.n;
+        } else if (!strcmp(pblk.descr[i].name, "queue.shards")) {
+            pThis->iNumShards = pvals[i].val.d.n;
+        } else if (!strcmp(pblk.descr[i].name, "queue.mmap")) {
+            pThis->bUseMmap = pvals[i].val.d.n;
+        } else if (!strcmp(pblk.descr[i].name, "queue.paralleldrain")) {
+            pThis->bParallelDrain = pvals[i].val.d.n;
+        } else if (!strcmp(pblk.descr[i].name, "queue.spoolformat")) {
+            if (!es_strcasebufcmp(pvals[i].val.d.estr, (uchar *)"binary", sizeof("binary") - 1)) {
+                pThis->bBinarySpool = 1;
+            } else if (!es_strcasebufcmp(pvals[i].val.d.estr, (uchar *)"text", sizeof("text") - 1)) {
+                pThis->bBinarySpool = 0;
+            } else {
+                char *const fmt = es_str2cstr(pvals[i].val.d.estr, NULL);
+                parser_errmsg(
+                    "queue.spoolformat '%s' is invalid, must be \"text\" or "
+                    "\"binary\" - using \"text\"",
+                    fmt);
+                free(fmt);
+            }
         } else {
             DBGPRINTF(
                 "queue: program error, non-handled "
@@ -3487,6 +4153,22 @@ rsRetVal qqueueApplyCnfParam(qqueue_t *pThis, struct nvlst *lst) {
 
     checkUniqueDiskFile(pThis);
 
+    if (pThis->iNumShards > 1 && pThis->qType != QUEUETYPE_RINGBUFFER) {
+        LogMsg(0, RS_RET_CONF_PARAM_INVLD, LOG_WARNING,
+               "warning on queue '%s': queue.shards is only supported "
+               "for queue.type=\"RingBuffer\" and will be ignored",
+               obj.GetName((obj_t *)pThis));
+        pThis->iNumShards = 1;
+    }
+
+    if (pThis->bParallelDrain && pThis->qType != QUEUETYPE_DISK && pThis->pszFilePrefix == NULL) {
+        LogMsg(0, RS_RET_CONF_PARAM_INVLD, LOG_WARNING,
+               "warning on queue '%s': queue.parallelDrain is only supported "
+               "for disk and disk-assisted queues and will be ignored",
+               obj.GetName((obj_t *)pThis));
+        pThis->bParallelDrain = 0;
+    }
+
     if (pThis->qType == QUEUETYPE_DIRECT) {
         if (n_params_set > 0) {
             LogMsg(0, RS_RET_OK, LOG_WARNING,
@@ -3533,8 +4215,9 @@ int queuesEqual(qqueue_t *pOld, qqueue_t *pNew) {
             NUM_EQUALS(toActShutdown) && NUM_EQUALS(toEnq) && NUM_EQUALS(toWrkShutdown) &&
             NUM_EQUALS(iMinMsgsPerWrkr) && NUM_EQUALS(iMaxFileSize) && NUM_EQUALS(bSaveOnShutdown) &&
             NUM_EQUALS(iDeqSlowdown) && NUM_EQUALS(iDeqtWinFromHr) && NUM_EQUALS(iDeqtWinToHr) &&
-            NUM_EQUALS(iSmpInterval) && NUM_EQUALS(takeFlowCtlFromMsg) && USTR_EQUALS(pszFilePrefix) &&
-            USTR_EQUALS(cryprovName));
+            NUM_EQUALS(iSmpInterval) && NUM_EQUALS(takeFlowCtlFromMsg) && NUM_EQUALS(iNumShards) &&
+            NUM_EQUALS(bBinarySpool) && NUM_EQUALS(bUseMmap) && NUM_EQUALS(bParallelDrain) &&
+            USTR_EQUALS(pszFilePrefix) && USTR_EQUALS(cryprovName));
 }
 
 
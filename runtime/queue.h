@@ -48,6 +48,7 @@
 #include "stream.h"
 #include "statsobj.h"
 #include "cryprov.h"
+#include "mpmcring.h"
 
 /* support for the toDelete list */
 typedef struct toDeleteLst_s toDeleteLst_t;
@@ -57,13 +58,32 @@ struct toDeleteLst_s {
     struct toDeleteLst_s *pNext;
 };
 
+/* support for parallel disk queue drain: the "drain ledger" lists everything that
+ * has been read from the disk store but not yet deleted, in store order. An entry
+ * is either a whole segment file read by parallel workers or a single batch read
+ * from the tail (the file currently being written). Entries may complete out of
+ * order, but store space is only released for a completed prefix of the ledger.
+ */
+typedef struct qDrainPiece_s qDrainPiece_t;
+struct qDrainPiece_s {
+    int endFNum; /* store position right after this piece */
+    int64 endOffs;
+    int nElem; /* elements dequeued from this piece so far */
+    int nDone; /* elements of those that are fully processed */
+    sbool bSealed; /* no more elements will be dequeued from this piece */
+    sbool bBusy; /* a worker currently reads from this piece (outside the queue mutex) */
+    strm_t *pStrm; /* private read stream for segment pieces, NULL for tail batches */
+    qDrainPiece_t *pNext;
+};
+
 
 /* queue types */
 typedef enum {
     QUEUETYPE_FIXED_ARRAY = 0, /* a simple queue made out of a fixed (initially malloced) array fast but memoryhog */
     QUEUETYPE_LINKEDLIST = 1, /* linked list used as buffer, lower fixed memory overhead but slower */
     QUEUETYPE_DISK = 2, /* disk files used as buffer */
-    QUEUETYPE_DIRECT = 3 /* no queuing happens, consumer is directly called */
+    QUEUETYPE_DIRECT = 3, /* no queuing happens, consumer is directly called */
+    QUEUETYPE_RINGBUFFER = 4 /* bounded lock-free ring, producers do not need the queue mutex */
 } queueType_t;
 
 /* list member definition for linked list types of queues: */
@@ -187,6 +207,14 @@ struct queue_s {
                 qLinkedList_t *pDelRoot;
                 qLinkedList_t *pLast;
             } linklist;
+            struct {
+                mpmcring_t **ppRings; /* the lock-free rings (one per shard) holding the queued messages */
+                int nShards; /* number of entries in ppRings */
+                int iDeqShard; /* home shard of the worker currently dequeueing (guarded by mutex) */
+                int iNextWrkrShard; /* next home shard to hand out to a worker (guarded by mutex) */
+                int iFastEnqMrk; /* below this size, producers enqueue without the queue mutex */
+                int nIdleWrkr; /* workers that may be about to sleep, see ConsumerReg() */
+            } ringbuf;
             struct {
                 int64 sizeOnDisk; /* current amount of disk space used */
                 int64 deqOffs; /* offset after dequeue batch - used for file deleter */
@@ -196,6 +224,9 @@ struct queue_s {
                 strm_t *pReadDeq; /* current file for dequeueing */
                 strm_t *pReadDel; /* current file for deleting */
                 int nForcePersist; /* force persist of .qi file the next "n" times */
+                qDrainPiece_t *pDrainRoot; /* drain ledger, only used with queue.parallelDrain */
+                qDrainPiece_t *pDrainLast;
+                int nSegsOpen; /* unsealed segment pieces in the ledger */
             } disk;
         } tVars;
         sbool useCryprov; /* quicker than checkig ptr (1 vs 8 bytes!) */
@@ -205,6 +236,7 @@ struct queue_s {
         uchar *cryprovNameFull; /* full internal crypto provider name */
         DEF_ATOMIC_HELPER_MUT(mutQueueSize)
         DEF_ATOMIC_HELPER_MUT(mutLogDeq)
+        DEF_ATOMIC_HELPER_MUT(mutIdleWrkr)
         /* for statistics subsystem */
         statsobj_t *statsobj;
         STATSCOUNTER_DEF(ctrEnqueued, mutCtrEnqueued)
@@ -213,6 +245,10 @@ struct queue_s {
         STATSCOUNTER_DEF(ctrNFDscrd, mutCtrNFDscrd)
         int ctrMaxqsize; /* NOT guarded by a mutex */
         int iSmpInterval; /* line interval of sampling logs */
+        int iNumShards; /* number of ring shards (RingBuffer queues only) */
+        sbool bBinarySpool; /* write disk records in compact binary instead of text format */
+        sbool bUseMmap; /* preallocate disk segments and read them via mmap() */
+        sbool bParallelDrain; /* let multiple workers read complete disk segments concurrently */
         int isRunning;
 };
 
@@ -220,7 +220,16 @@ static void cnfSetDefaults(rsconf_t *pThis) {
 
     pThis->globals.dnscacheDefaultTTL = 24 * 60 * 60;
     pThis->globals.dnscacheEnableTTL = 0;
+    pThis->globals.dnscacheNegativeTTL = -1;
+    pThis->globals.dnscacheTTLJitter = 0;
+    pThis->globals.dnscacheMaxSize = 0;
+    pThis->globals.dnscacheAsyncResolvers = 0;
+    pThis->globals.dnscacheAsyncMaxWait = 0;
     pThis->globals.shutdownQueueDoubleSize = 0;
+    pThis->globals.bFinalizeMsgBeforeFanOut = 0;
+    pThis->globals.bScriptBytecode = 0;
+    pThis->globals.bScriptBatchExec = 0;
+    pThis->globals.bTplCompile = 1;
     pThis->globals.optionDisallowWarning = 1;
     pThis->globals.bSupportCompressionExtension = 1;
 #ifdef ENABLE_LIBLOGGING_STDLOG
@@ -1031,6 +1040,9 @@ static rsRetVal setMainMsgQueType(void __attribute__((unused)) * pVal, uchar *ps
     } else if (!strcasecmp((char *)pszType, "linkedlist")) {
         loadConf->globals.mainQ.MainMsgQueType = QUEUETYPE_LINKEDLIST;
         DBGPRINTF("main message queue type set to LINKEDLIST\n");
+    } else if (!strcasecmp((char *)pszType, "ringbuffer")) {
+        loadConf->globals.mainQ.MainMsgQueType = QUEUETYPE_RINGBUFFER;
+        DBGPRINTF("main message queue type set to RINGBUFFER\n");
     } else if (!strcasecmp((char *)pszType, "disk")) {
         loadConf->globals.mainQ.MainMsgQueType = QUEUETYPE_DISK;
         DBGPRINTF("main message queue type set to DISK\n");
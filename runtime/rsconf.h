@@ -155,7 +155,16 @@ struct globals_s {
 
     unsigned dnscacheDefaultTTL; /* 24 hrs default TTL */
     int dnscacheEnableTTL; /* expire entries or not (0) ? */
+    int dnscacheNegativeTTL; /* TTL for failed lookups, -1: same as others */
+    int dnscacheTTLJitter; /* randomly shorten TTL by up to this percentage */
+    int dnscacheMaxSize; /* max number of cache entries, 0: unlimited */
+    int dnscacheAsyncResolvers; /* number of resolver threads, 0: resolve synchronously */
+    int dnscacheAsyncMaxWait; /* ms to wait for an async lookup, 0: do not wait */
     int shutdownQueueDoubleSize;
+    int bFinalizeMsgBeforeFanOut; /* finalize messages before they are enqueued into action queues */
+    int bScriptBytecode; /* compile script filter expressions to bytecode */
+    int bScriptBatchExec; /* execute scripts batch-at-a-time */
+    int bTplCompile; /* use the compiled form of templates */
     int optionDisallowWarning; /* complain if message from disallowed sender is received */
     int bSupportCompressionExtension;
 #ifdef ENABLE_LIBLOGGING_STDLOG
@@ -263,6 +263,7 @@ rsRetVal rsrtExit(void) {
         wtiClassExit();
         wtpClassExit();
         strgenClassExit();
+        msgClassExit();
         propClassExit();
         statsobjClassExit();
 
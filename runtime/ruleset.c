@@ -31,6 +31,7 @@
  */
 #include "config.h"
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <ctype.h>
 
@@ -46,6 +47,7 @@
 #include "rsconf.h"
 #include "action.h"
 #include "rainerscript.h"
+#include "rscriptvm.h"
 #include "srUtils.h"
 #include "modules.h"
 #include "wti.h"
@@ -259,10 +261,17 @@ finalize_it:
     RETiRet;
 }
 
+static sbool evalIf(struct cnfstmt *const stmt, smsg_t *const pMsg, wti_t *const pWti) {
+    if (stmt->d.s_if.prog != NULL)
+        return rsvmExecBool(stmt->d.s_if.prog, pMsg, pWti);
+    else
+        return cnfexprEvalBool(stmt->d.s_if.expr, pMsg, pWti);
+}
+
 static rsRetVal execIf(struct cnfstmt *const stmt, smsg_t *const pMsg, wti_t *const pWti) {
     sbool bRet;
     DEFiRet;
-    bRet = cnfexprEvalBool(stmt->d.s_if.expr, pMsg, pWti);
+    bRet = evalIf(stmt, pMsg, pWti);
     DBGPRINTF("if condition result is %d\n", bRet);
     if (bRet) {
         if (stmt->d.s_if.t_then != NULL) CHKiRet(scriptExec(stmt->d.s_if.t_then, pMsg, pWti));
@@ -366,14 +375,18 @@ finalize_it:
     RETiRet;
 }
 
-static rsRetVal execPRIFILT(struct cnfstmt *stmt, smsg_t *pMsg, wti_t *pWti) {
-    int bRet;
-    DEFiRet;
+static inline int evalPRIFILT(const struct cnfstmt *const stmt, const smsg_t *const pMsg) {
     if ((stmt->d.s_prifilt.pmask[pMsg->iFacility] == TABLE_NOPRI) ||
         ((stmt->d.s_prifilt.pmask[pMsg->iFacility] & (1 << pMsg->iSeverity)) == 0))
-        bRet = 0;
+        return 0;
     else
-        bRet = 1;
+        return 1;
+}
+
+static rsRetVal execPRIFILT(struct cnfstmt *stmt, smsg_t *pMsg, wti_t *pWti) {
+    int bRet;
+    DEFiRet;
+    bRet = evalPRIFILT(stmt, pMsg);
 
     DBGPRINTF("PRIFILT condition result is %d\n", bRet);
     if (bRet) {
@@ -493,6 +506,53 @@ finalize_it:
     RETiRet;
 }
 
+/* execute a single statement for a single message */
+static rsRetVal ATTR_NONNULL(1, 2, 3) execStmt(struct cnfstmt *const stmt, smsg_t *const pMsg, wti_t *const pWti) {
+    DEFiRet;
+    switch (stmt->nodetype) {
+        case S_NOP:
+            break;
+        case S_STOP:
+            ABORT_FINALIZE(RS_RET_DISCARDMSG);
+            break;
+        case S_ACT:
+            CHKiRet(execAct(stmt, pMsg, pWti));
+            break;
+        case S_SET:
+            CHKiRet(execSet(stmt, pMsg, pWti));
+            break;
+        case S_UNSET:
+            CHKiRet(execUnset(stmt, pMsg));
+            break;
+        case S_CALL:
+            CHKiRet(execCall(stmt, pMsg, pWti));
+            break;
+        case S_CALL_INDIRECT:
+            CHKiRet(execCallIndirect(stmt, pMsg, pWti));
+            break;
+        case S_IF:
+            CHKiRet(execIf(stmt, pMsg, pWti));
+            break;
+        case S_FOREACH:
+            CHKiRet(execForeach(stmt, pMsg, pWti));
+            break;
+        case S_PRIFILT:
+            CHKiRet(execPRIFILT(stmt, pMsg, pWti));
+            break;
+        case S_PROPFILT:
+            CHKiRet(execPROPFILT(stmt, pMsg, pWti));
+            break;
+        case S_RELOAD_LOOKUP_TABLE:
+            CHKiRet(execReloadLookupTable(stmt));
+            break;
+        default:
+            dbgprintf("error: unknown stmt type %u during exec\n", (unsigned)stmt->nodetype);
+            break;
+    }
+finalize_it:
+    RETiRet;
+}
+
 /* The rainerscript execution engine. It is debatable if that would be better
  * contained in grammer/rainerscript.c, HOWEVER, that file focusses primarily
  * on the parsing and object creation part. So as an actual executor, it is
@@ -513,48 +573,230 @@ static rsRetVal ATTR_NONNULL(2, 3) scriptExec(struct cnfstmt *const root, smsg_t
         if (Debug) {
             cnfstmtPrintOnly(stmt, 2, 0);
         }
+        CHKiRet(execStmt(stmt, pMsg, pWti));
+    }
+finalize_it:
+    RETiRet;
+}
+
+
+/* Batch-at-a-time script execution. Instead of running the whole script
+ * for one message after the other, each statement is run for all
+ * messages of the batch that reach it. The messages are tracked via a
+ * selection vector of (ascending) batch indexes. Filters split the
+ * vector into the then and else part, so each filter condition is
+ * evaluated in a tight loop over the selection.
+ *
+ * Messages whose script execution ends early (stop, errors) are removed
+ * from the selection and their result is recorded in pRet. Statements
+ * that have no batch implementation (actions, set, foreach, call, ...)
+ * are still executed per message, but in batch order.
+ *
+ * Note: this changes the order in which the messages of one batch reach
+ * the statements. It is only enabled for rulesets that do not depend on
+ * per-message worker state (see rulesetOptimize()).
+ */
+typedef struct batchExec_s {
+    batch_t *pBatch;
+    wti_t *pWti;
+    rsRetVal *pRet; /* per batch element: result of script execution */
+} batchExec_t;
+
+static int scriptExecBatch(struct cnfstmt *root, batchExec_t *pCtx, int *sel, int nSel);
+
+/* run a statement per message, keep those that continue in sel */
+static int ATTR_NONNULL() execStmtEach(struct cnfstmt *const stmt, batchExec_t *const pCtx, int *const sel,
+                                       const int nSel) {
+    rsRetVal localRet;
+    int i, nOut = 0;
+
+    for (i = 0; i < nSel; ++i) {
+        localRet = execStmt(stmt, pCtx->pBatch->pElem[sel[i]].pMsg, pCtx->pWti);
+        if (localRet == RS_RET_OK)
+            sel[nOut++] = sel[i];
+        else
+            pCtx->pRet[sel[i]] = localRet;
+    }
+    return nOut;
+}
+
+/* fallback if we run out of memory: run the rest of the script per message */
+static int ATTR_NONNULL() scriptExecEach(struct cnfstmt *const root, batchExec_t *const pCtx, int *const sel,
+                                         const int nSel) {
+    rsRetVal localRet;
+    int i, nOut = 0;
+
+    for (i = 0; i < nSel; ++i) {
+        localRet = scriptExec(root, pCtx->pBatch->pElem[sel[i]].pMsg, pCtx->pWti);
+        if (localRet == RS_RET_OK)
+            sel[nOut++] = sel[i];
+        else
+            pCtx->pRet[sel[i]] = localRet;
+    }
+    return nOut;
+}
+
+/* execute a filter statement. pTrue[i] holds the condition result for sel[i]. */
+static int ATTR_NONNULL(3, 4, 5) execFilterBatch(struct cnfstmt *const t_then, struct cnfstmt *const t_else,
+                                                 const sbool *const pTrue, batchExec_t *const pCtx, int *const sel,
+                                                 const int nSel) {
+    int *selThen, *selElse;
+    int nThen = 0, nElse = 0;
+    int i, iThen, iElse;
+
+    selThen = malloc(2 * nSel * sizeof(int));
+    if (selThen == NULL) return -1;
+    selElse = selThen + nSel;
+
+    for (i = 0; i < nSel; ++i) {
+        if (pTrue[i])
+            selThen[nThen++] = sel[i];
+        else
+            selElse[nElse++] = sel[i];
+    }
+    if (t_then != NULL && nThen > 0) nThen = scriptExecBatch(t_then, pCtx, selThen, nThen);
+    if (t_else != NULL && nElse > 0) nElse = scriptExecBatch(t_else, pCtx, selElse, nElse);
+
+    /* merge the survivors of both branches, keeping batch order */
+    for (i = iThen = iElse = 0; iThen < nThen || iElse < nElse; ++i) {
+        if (iElse == nElse || (iThen < nThen && selThen[iThen] < selElse[iElse]))
+            sel[i] = selThen[iThen++];
+        else
+            sel[i] = selElse[iElse++];
+    }
+    free(selThen);
+    return i;
+}
+
+static int ATTR_NONNULL() scriptExecBatch(struct cnfstmt *const root, batchExec_t *const pCtx, int *const sel,
+                                          int nSel) {
+    struct cnfstmt *stmt;
+    sbool *pTrue = NULL;
+    int nOut;
+    int i;
+
+    for (stmt = root; stmt != NULL && nSel > 0; stmt = stmt->next) {
+        if (*pCtx->pWti->pbShutdownImmediate) {
+            DBGPRINTF(
+                "scriptExecBatch: ShutdownImmediate set, "
+                "force terminating\n");
+            for (i = 0; i < nSel; ++i) pCtx->pRet[sel[i]] = RS_RET_FORCE_TERM;
+            nSel = 0;
+            break;
+        }
+        if (Debug) {
+            cnfstmtPrintOnly(stmt, 2, 0);
+        }
         switch (stmt->nodetype) {
             case S_NOP:
                 break;
             case S_STOP:
-                ABORT_FINALIZE(RS_RET_DISCARDMSG);
-                break;
-            case S_ACT:
-                CHKiRet(execAct(stmt, pMsg, pWti));
-                break;
-            case S_SET:
-                CHKiRet(execSet(stmt, pMsg, pWti));
-                break;
-            case S_UNSET:
-                CHKiRet(execUnset(stmt, pMsg));
-                break;
-            case S_CALL:
-                CHKiRet(execCall(stmt, pMsg, pWti));
-                break;
-            case S_CALL_INDIRECT:
-                CHKiRet(execCallIndirect(stmt, pMsg, pWti));
+                for (i = 0; i < nSel; ++i) pCtx->pRet[sel[i]] = RS_RET_DISCARDMSG;
+                nSel = 0;
                 break;
             case S_IF:
-                CHKiRet(execIf(stmt, pMsg, pWti));
-                break;
-            case S_FOREACH:
-                CHKiRet(execForeach(stmt, pMsg, pWti));
-                break;
             case S_PRIFILT:
-                CHKiRet(execPRIFILT(stmt, pMsg, pWti));
-                break;
             case S_PROPFILT:
-                CHKiRet(execPROPFILT(stmt, pMsg, pWti));
-                break;
-            case S_RELOAD_LOOKUP_TABLE:
-                CHKiRet(execReloadLookupTable(stmt));
+                if (pTrue == NULL && (pTrue = malloc(nSel * sizeof(sbool))) == NULL) {
+                    nSel = scriptExecEach(stmt, pCtx, sel, nSel);
+                    goto done;
+                }
+                if (stmt->nodetype == S_IF) {
+                    for (i = 0; i < nSel; ++i) pTrue[i] = evalIf(stmt, pCtx->pBatch->pElem[sel[i]].pMsg, pCtx->pWti);
+                    nOut = execFilterBatch(stmt->d.s_if.t_then, stmt->d.s_if.t_else, pTrue, pCtx, sel, nSel);
+                } else if (stmt->nodetype == S_PRIFILT) {
+                    for (i = 0; i < nSel; ++i) pTrue[i] = evalPRIFILT(stmt, pCtx->pBatch->pElem[sel[i]].pMsg);
+                    nOut = execFilterBatch(stmt->d.s_prifilt.t_then, stmt->d.s_prifilt.t_else, pTrue, pCtx, sel,
+                                           nSel);
+                } else {
+                    for (i = 0; i < nSel; ++i) pTrue[i] = evalPROPFILT(stmt, pCtx->pBatch->pElem[sel[i]].pMsg);
+                    nOut = execFilterBatch(stmt->d.s_propfilt.t_then, NULL, pTrue, pCtx, sel, nSel);
+                }
+                if (nOut < 0) { /* out of memory, filter not yet executed */
+                    nSel = scriptExecEach(stmt, pCtx, sel, nSel);
+                    goto done;
+                }
+                nSel = nOut;
                 break;
             default:
-                dbgprintf("error: unknown stmt type %u during exec\n", (unsigned)stmt->nodetype);
+                nSel = execStmtEach(stmt, pCtx, sel, nSel);
                 break;
         }
     }
+done:
+    free(pTrue);
+    return nSel;
+}
+
+static inline ruleset_t *getMsgRuleset(const smsg_t *const pMsg) {
+    return (pMsg->pRuleset == NULL) ? runConf->rulesets.pDflt : pMsg->pRuleset;
+}
+
+/* run the script for one message; on suspension, the message is retried */
+static void processMsg(batch_t *const pBatch, const int i, wti_t *const pWti) {
+    rsRetVal localRet;
+    smsg_t *const pMsg = pBatch->pElem[i].pMsg;
+
+    do {
+        localRet = scriptExec(getMsgRuleset(pMsg)->root, pMsg, pWti);
+    } while (localRet == RS_RET_SUSPENDED && !*(pWti->pbShutdownImmediate));
+    if (localRet == RS_RET_OK) batchSetElemState(pBatch, i, BATCH_STATE_COMM);
+}
+
+/* processBatch() for batch execution mode. Messages are grouped by
+ * ruleset; rulesets that support it run their script once for the
+ * whole group, others are processed message by message.
+ */
+static rsRetVal ATTR_NONNULL() processBatchVectorized(batch_t *const pBatch, wti_t *const pWti) {
+    batchExec_t ctx;
+    ruleset_t *pRuleset;
+    sbool *pPending = NULL;
+    int *sel = NULL;
+    int nSel;
+    int i, j;
+    DEFiRet;
+
+    ctx.pRet = NULL;
+    CHKmalloc(sel = malloc(batchNumMsgs(pBatch) * sizeof(int)));
+    CHKmalloc(ctx.pRet = malloc(batchNumMsgs(pBatch) * sizeof(rsRetVal)));
+    CHKmalloc(pPending = malloc(batchNumMsgs(pBatch) * sizeof(sbool)));
+    memset(pPending, 1, batchNumMsgs(pBatch) * sizeof(sbool));
+    ctx.pBatch = pBatch;
+    ctx.pWti = pWti;
+
+    for (i = 0; i < batchNumMsgs(pBatch) && !*(pWti->pbShutdownImmediate); ++i) {
+        if (!pPending[i]) continue;
+        pRuleset = getMsgRuleset(pBatch->pElem[i].pMsg);
+        if (!pRuleset->bBatchExec) {
+            pPending[i] = 0;
+            processMsg(pBatch, i, pWti);
+            continue;
+        }
+
+        for (nSel = 0, j = i; j < batchNumMsgs(pBatch); ++j) {
+            if (pPending[j] && getMsgRuleset(pBatch->pElem[j].pMsg) == pRuleset) {
+                pPending[j] = 0;
+                ctx.pRet[j] = RS_RET_OK;
+                sel[nSel++] = j;
+            }
+        }
+        DBGPRINTF("processBATCH: executing ruleset '%s' for %d messages at once\n", pRuleset->pszName, nSel);
+        scriptExecBatch(pRuleset->root, &ctx, sel, nSel);
+
+        /* see processBatch() for the meaning of the result codes */
+        for (j = i; j < batchNumMsgs(pBatch); ++j) {
+            if (getMsgRuleset(pBatch->pElem[j].pMsg) != pRuleset) continue;
+            if (ctx.pRet[j] == RS_RET_OK)
+                batchSetElemState(pBatch, j, BATCH_STATE_COMM);
+            else if (ctx.pRet[j] == RS_RET_SUSPENDED)
+                processMsg(pBatch, j, pWti);
+        }
+    }
+
 finalize_it:
+    free(pPending);
+    free(ctx.pRet);
+    free(sel);
     RETiRet;
 }
 
@@ -574,6 +816,13 @@ static rsRetVal processBatch(batch_t *pBatch, wti_t *pWti) {
     wtiResetExecState(pWti, pBatch);
 
     /* execution phase */
+    if (runConf->globals.bScriptBatchExec) {
+        if (processBatchVectorized(pBatch, pWti) == RS_RET_OK) {
+            i = batchNumMsgs(pBatch);
+            goto commit;
+        }
+        DBGPRINTF("processBATCH: batch execution failed, falling back to per-message execution\n");
+    }
     for (i = 0; i < batchNumMsgs(pBatch) && !*(pWti->pbShutdownImmediate); ++i) {
         pMsg = pBatch->pElem[i].pMsg;
         DBGPRINTF("processBATCH: next msg %d: %.128s\n", i, pMsg->pszRawMsg);
@@ -591,6 +840,7 @@ static rsRetVal processBatch(batch_t *pBatch, wti_t *pWti) {
     }
 
     /* commit phase */
+commit:
     DBGPRINTF(
         "END batch execution phase, entering to commit phase "
         "[processed %d of %d messages]\n",
@@ -705,6 +955,7 @@ finalize_it:
 BEGINobjConstruct(ruleset) /* be sure to specify the object type also in END macro! */
     pThis->root = NULL;
     pThis->last = NULL;
+    pThis->bBatchExec = 0;
 ENDobjConstruct(ruleset)
 
 
@@ -834,6 +1085,17 @@ static void rulesetOptimize(ruleset_t *pRuleset) {
         rulesetDebugPrint((ruleset_t *)pRuleset);
     }
     pRuleset->root = cnfstmtOptimize(pRuleset->root);
+    if (loadConf->globals.bScriptBatchExec) {
+        if (cnfstmtUsesExecState(pRuleset->root)) {
+            LogMsg(0, RS_RET_CONF_PARAM_INVLD, LOG_WARNING,
+                   "ruleset '%s' uses script_error(), previous_action_suspended() or "
+                   "action.execOnlyWhenPreviousIsSuspended, batch execution is disabled for it",
+                   pRuleset->pszName);
+        } else {
+            pRuleset->bBatchExec = 1;
+            DBGPRINTF("ruleset '%s': batch execution enabled\n", pRuleset->pszName);
+        }
+    }
     if (Debug) {
         dbgprintf("ruleset '%s' after optimization:\n", pRuleset->pszName);
         rulesetDebugPrint((ruleset_t *)pRuleset);
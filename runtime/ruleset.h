@@ -36,6 +36,7 @@ struct ruleset_s {
         struct cnfstmt *root;
         struct cnfstmt *last;
         parserList_t *pParserLst; /* list of parsers to use for this ruleset */
+        sbool bBatchExec; /* execute script for a whole batch at once? */
 };
 
 /* interfaces */
@@ -130,6 +130,7 @@ BEGINobjConstruct(statsobj) /* be sure to specify the object type also in END ma
     pThis->ctrLast = NULL;
     pThis->ctrRoot = NULL;
     pThis->read_notifier = NULL;
+    pThis->pre_read_notifier = NULL;
     pThis->flags = 0;
 ENDobjConstruct(statsobj)
 
@@ -152,6 +153,17 @@ static rsRetVal setReadNotifier(statsobj_t *pThis, statsobj_read_notifier_t noti
     RETiRet;
 }
 
+/* set pre_read_notifier (a function which is invoked before stats are read).
+ * This permits providers to bring counters up to date that are not
+ * maintained in place, e.g. because they are aggregated per thread.
+ */
+static rsRetVal setPreReadNotifier(statsobj_t *pThis, statsobj_read_notifier_t notifier, void *ctx) {
+    DEFiRet;
+    pThis->pre_read_notifier = notifier;
+    pThis->pre_read_notifier_ctx = ctx;
+    RETiRet;
+}
+
 
 /* set origin (module name, etc).
  * Note that we make our own copy of the memory, caller is
@@ -593,6 +605,9 @@ static rsRetVal getAllStatsLines(rsRetVal (*cb)(void *, const char *),
         // TODO: move to function
         /* For each statsobj in our linked list, emit Prometheus lines. */
         for (o = objRoot; o != NULL; o = o->next) {
+            if (o->pre_read_notifier != NULL) {
+                o->pre_read_notifier(o, o->pre_read_notifier_ctx);
+            }
             emitPrometheusForObject(o, cb, usrptr, bResetCtrs);
             /* If the object has a read_notifier, call it now */
             if (o->read_notifier != NULL) {
@@ -606,6 +621,9 @@ static rsRetVal getAllStatsLines(rsRetVal (*cb)(void *, const char *),
     }
 
     for (o = objRoot; o != NULL; o = o->next) {
+        if (o->pre_read_notifier != NULL) {
+            o->pre_read_notifier(o, o->pre_read_notifier_ctx);
+        }
         switch (fmt) {
             case statsFmt_Legacy:
                 CHKiRet(getStatsLine(o, &cstr, bResetCtrs));
@@ -794,6 +812,7 @@ BEGINobjQueryInterface(statsobj)
     pIf->SetName = setName;
     pIf->SetOrigin = setOrigin;
     pIf->SetReadNotifier = setReadNotifier;
+    pIf->SetPreReadNotifier = setPreReadNotifier;
     pIf->SetReportingNamespace = setReportingNamespace;
     pIf->SetStatsObjFlags = setStatsObjFlags;
     pIf->GetAllStatsLines = getAllStatsLines;
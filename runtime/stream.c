@@ -47,6 +47,7 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h> /* required for HP UX */
+#include <sys/mman.h>
 #include <errno.h>
 #include <pthread.h>
 #include <poll.h>
@@ -239,6 +240,97 @@ finalize_it:
  * strm instance object.
  */
 
+/* ---------- mmap support for queue segments ----------
+ * In mmap mode, the read side does not copy data into pIOBuf. Instead,
+ * pIOBuf is pointed directly into a read-only mapping of the file, so the
+ * usual strmReadChar() & friends consume straight from the page cache.
+ * A mapping covers the file from the current read position up to its size
+ * at the time of mapping (bounded by STRM_MMAP_MAXWIN). When it is used up,
+ * we check whether the file has grown (the writer may still append to it)
+ * and either map the new part or report EOF, exactly like read() would.
+ */
+#define STRM_MMAP_MAXWIN ((off64_t)256 * 1024 * 1024)
+
+static int strmCanMmap(const strm_t *const pThis) {
+    return pThis->bUseMmap && pThis->tOperationsMode == STREAMMODE_READ && pThis->cryprov == NULL &&
+           !pThis->bReopenOnTruncate && !pThis->bAsyncWrite;
+}
+
+
+/* drop the current read mapping (if any) and restore the regular IO buffer */
+static void strmUnmap(strm_t *const pThis) {
+    if (pThis->pMmapBase == NULL) return;
+    munmap(pThis->pMmapBase, pThis->lenMmap);
+    pThis->pMmapBase = NULL;
+    pThis->lenMmap = 0;
+    pThis->pIOBuf = pThis->pIOBufAlloc;
+    pThis->iBufPtr = 0;
+    pThis->iBufPtrMax = 0;
+}
+
+
+/* map the next part of the current file. Returns RS_RET_EOF if there is
+ * nothing left to map. Any other error means mmap cannot be used and the
+ * caller should fall back to read().
+ */
+static rsRetVal strmMapNext(strm_t *const pThis) {
+    struct stat statBuf;
+    off64_t mapOffs;
+    off64_t lenWin;
+    void *pMap;
+    long pageSize;
+    DEFiRet;
+
+    strmUnmap(pThis);
+    if (fstat(pThis->fd, &statBuf) != 0) ABORT_FINALIZE(RS_RET_IO_ERROR);
+    if (statBuf.st_size <= pThis->mmapNextOffs) ABORT_FINALIZE(RS_RET_EOF);
+
+    pageSize = sysconf(_SC_PAGESIZE);
+    mapOffs = pThis->mmapNextOffs - (pThis->mmapNextOffs % pageSize);
+    lenWin = statBuf.st_size - mapOffs;
+    if (lenWin > STRM_MMAP_MAXWIN) lenWin = STRM_MMAP_MAXWIN;
+
+    pMap = mmap(NULL, (size_t)lenWin, PROT_READ, MAP_SHARED, pThis->fd, mapOffs);
+    if (pMap == MAP_FAILED) {
+        LogError(errno, RS_RET_IO_ERROR, "file '%s': mmap() failed, falling back to regular reads",
+                 pThis->pszCurrFName);
+        ABORT_FINALIZE(RS_RET_IO_ERROR);
+    }
+#ifdef HAVE_MADVISE
+    madvise(pMap, (size_t)lenWin, MADV_SEQUENTIAL);
+#endif
+
+    pThis->pMmapBase = pMap;
+    pThis->lenMmap = (size_t)lenWin;
+    pThis->pIOBuf = pThis->pMmapBase + (pThis->mmapNextOffs - mapOffs);
+    pThis->iBufPtr = 0;
+    pThis->iBufPtrMax = (size_t)(mapOffs + lenWin - pThis->mmapNextOffs);
+    pThis->mmapNextOffs = mapOffs + lenWin;
+    DBGOPRINT((obj_t *)pThis, "file %d mapped %zu octets at offset %lld\n", pThis->fd, pThis->iBufPtrMax,
+              (long long)(pThis->mmapNextOffs - (off64_t)pThis->iBufPtrMax));
+
+finalize_it:
+    RETiRet;
+}
+
+
+/* reserve disk space for a whole queue segment when it is opened for writing.
+ * The file size is NOT changed: readers detect the end of a segment by its
+ * size, so it must always reflect the data actually written.
+ */
+static void strmPreallocSegment(strm_t *const pThis) {
+#if defined(HAVE_FALLOCATE) && defined(FALLOC_FL_KEEP_SIZE)
+    if (pThis->iMaxFileSize <= 0) return;
+    if (fallocate(pThis->fd, FALLOC_FL_KEEP_SIZE, 0, pThis->iMaxFileSize) != 0) {
+        DBGOPRINT((obj_t *)pThis, "file '%s': segment preallocation failed, errno %d - ignored\n",
+                  pThis->pszCurrFName, errno);
+    }
+#else
+    (void)pThis;
+#endif
+}
+
+
 /* do the physical open() call on a file.
  */
 static rsRetVal doPhysOpen(strm_t *pThis) {
@@ -384,7 +476,11 @@ static rsRetVal strmOpenFile(strm_t *pThis) {
 
     pThis->iCurrOffs = 0;
     pThis->iBufPtrMax = 0;
+    pThis->mmapNextOffs = 0;
     CHKiRet(getFileSize(pThis->pszCurrFName, &offset));
+    if (pThis->bUseMmap && pThis->tOperationsMode != STREAMMODE_READ && pThis->sType == STREAMTYPE_FILE_CIRCULAR) {
+        strmPreallocSegment(pThis);
+    }
     if (pThis->tOperationsMode == STREAMMODE_WRITE_APPEND) {
         pThis->iCurrOffs = offset;
     } else if (pThis->tOperationsMode == STREAMMODE_WRITE_TRUNC) {
@@ -430,6 +526,40 @@ static void strmWaitAsyncWriterDone(strm_t *pThis) {
     }
 }
 
+/* report (and reset) the error of a failed io_uring write. Writes complete
+ * asynchronously, so the error is passed to the caller of the next write,
+ * flush or close. Must be called with the mutex locked.
+ */
+static rsRetVal strmUringCheckErr(strm_t *pThis) {
+    DEFiRet;
+
+    if (pThis->iUringErr != 0) {
+        pThis->iUringErr = 0;
+        ABORT_FINALIZE(RS_RET_IO_ERROR);
+    }
+
+finalize_it:
+    RETiRet;
+}
+
+/* wait until all buffers handed to io_uring have been written. Must be called
+ * before the file descriptor is closed. A null operation if io_uring is not used.
+ */
+static rsRetVal strmWaitUringDone(strm_t *pThis) {
+    DEFiRet;
+
+    if (pThis->bUringWrite) {
+        d_pthread_mutex_lock(&pThis->mut);
+        while (pThis->iCnt > 0) {
+            d_pthread_cond_wait(&pThis->isEmpty, &pThis->mut);
+        }
+        iRet = strmUringCheckErr(pThis);
+        d_pthread_mutex_unlock(&pThis->mut);
+    }
+
+    RETiRet;
+}
+
 /* stop the writer thread (we MUST be runnnig asynchronously when this method
  * is called!). Note that the mutex must be locked! -- rgerhards, 2009-07-06
  */
@@ -451,6 +581,7 @@ static void stopWriter(strm_t *const pThis) {
  */
 static rsRetVal strmCloseFile(strm_t *pThis) {
     off64_t currOffs;
+    rsRetVal uringRet = RS_RET_OK;
     DEFiRet;
 
     assert(pThis != NULL);
@@ -468,6 +599,7 @@ static rsRetVal strmCloseFile(strm_t *pThis) {
         if (pThis->bAsyncWrite) {
             stopWriter(pThis);
         }
+        uringRet = strmWaitUringDone(pThis);
     }
 
     /* if we have a signature provider, we must make sure that the crypto
@@ -487,6 +619,8 @@ static rsRetVal strmCloseFile(strm_t *pThis) {
     /* the file may already be closed (or never have opened), so guard
      * against this. -- rgerhards, 2010-03-19
      */
+    strmUnmap(pThis);
+
     if (pThis->fd != -1) {
         DBGOPRINT((obj_t *)pThis, "file %d(%s) closing\n", pThis->fd, getFileDebugName(pThis));
         currOffs = lseek64(pThis->fd, 0, SEEK_CUR);
@@ -524,6 +658,7 @@ static rsRetVal strmCloseFile(strm_t *pThis) {
 finalize_it:
     free(pThis->pszCurrFName);
     pThis->pszCurrFName = NULL;
+    if (iRet == RS_RET_OK) iRet = uringRet; /* data written before close was lost */
     RETiRet;
 }
 
@@ -572,8 +707,11 @@ static rsRetVal ATTR_NONNULL() strmHandleEOF(strm_t *const pThis) {
             break;
         case STREAMTYPE_FILE_CIRCULAR:
             /* we have multiple files and need to switch to the next one */
-            /* TODO: think about emulating EOF in this case (not yet needed) */
             DBGOPRINT((obj_t *)pThis, "file %d EOF\n", pThis->fd);
+            if (pThis->bSegmentOnly) {
+                /* reader owns just this one file (parallel disk queue drain) */
+                ABORT_FINALIZE(RS_RET_EOF);
+            }
             CHKiRet(strmNextFile(pThis));
             break;
         case STREAMTYPE_FILE_MONITOR:
@@ -675,6 +813,20 @@ static rsRetVal strmReadBuf(strm_t *pThis, int *padBytes) {
          * rgerhards, 2008-02-13
          */
         CHKiRet(strmOpenFile(pThis));
+        if (strmCanMmap(pThis)) {
+            const rsRetVal localRet = strmMapNext(pThis);
+            if (localRet == RS_RET_OK) {
+                *padBytes = 0;
+                FINALIZE; /* buffer pointers have been set up by strmMapNext() */
+            } else if (localRet == RS_RET_EOF) {
+                CHKiRet(strmHandleEOF(pThis));
+                continue;
+            }
+            /* mmap is not possible, use regular reads from the current position */
+            pThis->bUseMmap = 0;
+            if (lseek64(pThis->fd, pThis->mmapNextOffs, SEEK_SET) != pThis->mmapNextOffs)
+                ABORT_FINALIZE(RS_RET_IO_ERROR);
+        }
         if (pThis->cryprov == NULL) {
             toRead = pThis->sIOBufSize;
         } else {
@@ -790,6 +942,92 @@ static rsRetVal strmUnreadChar(strm_t *pThis, uchar c) {
     return RS_RET_OK;
 }
 
+
+/* read exactly lenBuf octets into pBuf. This is the bulk counterpart of
+ * strmReadChar() and copies straight out of the IO buffer, refilling it
+ * as often as needed. EOF (with the usual circular-file handling) is
+ * reported the same way strmReadChar() does. Partially read data is
+ * consumed from the stream even in the error case.
+ */
+static rsRetVal strmRead(strm_t *pThis, uchar *pBuf, size_t lenBuf) {
+    int padBytes = 0;
+    size_t lenAvail;
+    size_t lenCopy;
+    DEFiRet;
+
+    assert(pThis != NULL);
+    assert(pBuf != NULL || lenBuf == 0);
+
+    if (lenBuf > 0 && pThis->iUngetC != -1) {
+        *pBuf++ = pThis->iUngetC;
+        ++pThis->iCurrOffs;
+        pThis->iUngetC = -1;
+        --lenBuf;
+    }
+
+    while (lenBuf > 0) {
+        if (pThis->iBufPtr >= pThis->iBufPtrMax) {
+            CHKiRet(strmReadBuf(pThis, &padBytes));
+            pThis->iCurrOffs += padBytes;
+        }
+        lenAvail = pThis->iBufPtrMax - pThis->iBufPtr;
+        lenCopy = (lenAvail < lenBuf) ? lenAvail : lenBuf;
+        memcpy(pBuf, pThis->pIOBuf + pThis->iBufPtr, lenCopy);
+        pThis->iBufPtr += lenCopy;
+        pThis->iCurrOffs += lenCopy;
+        pBuf += lenCopy;
+        lenBuf -= lenCopy;
+    }
+
+finalize_it:
+    RETiRet;
+}
+
+/* append the current character c and everything up to (but excluding) the
+ * next LF to pCStr. This is the hot loop of strmReadLine(): instead of moving
+ * each character through strmReadChar(), the IO buffer is scanned with
+ * memchr() (which libc implements with SSE2/AVX2 where available) and each
+ * run is appended in one go. Only at buffer boundaries, or if a character
+ * was ungotten, do we fall back to strmReadChar(). On success, the LF has
+ * been consumed and *pC is '\n'. On error (most importantly EOF), pCStr
+ * holds all data read so far, just as with the character-wise loop.
+ */
+static rsRetVal ATTR_NONNULL() strmReadToLF(strm_t *const pThis, cstr_t *const pCStr, uchar *const pC) {
+    const uchar *pStart;
+    const uchar *pLF;
+    size_t lenAvail;
+    size_t lenRun;
+    DEFiRet;
+
+    while (*pC != '\n') {
+        CHKiRet(cstrAppendChar(pCStr, *pC));
+        if (pThis->iUngetC != -1 || pThis->iBufPtr >= pThis->iBufPtrMax) {
+            CHKiRet(strmReadChar(pThis, pC));
+            continue;
+        }
+        pStart = pThis->pIOBuf + pThis->iBufPtr;
+        lenAvail = pThis->iBufPtrMax - pThis->iBufPtr;
+        pLF = memchr(pStart, '\n', lenAvail);
+        lenRun = (pLF == NULL) ? lenAvail : (size_t)(pLF - pStart);
+        if (lenRun > 0) {
+            CHKiRet(rsCStrAppendStrWithLen(pCStr, pStart, lenRun));
+            pThis->iBufPtr += lenRun;
+            pThis->iCurrOffs += lenRun;
+        }
+        if (pLF == NULL) {
+            /* line continues in next buffer (or file is not yet complete) */
+            CHKiRet(strmReadChar(pThis, pC));
+        } else {
+            ++pThis->iBufPtr;
+            ++pThis->iCurrOffs;
+            *pC = '\n';
+        }
+    }
+
+finalize_it:
+    RETiRet;
+}
+
 /* read a 'paragraph' from a strm file.
  * A paragraph may be terminated by a LF, by a LFLF, or by LF<not whitespace> depending on the option set.
  * The termination LF characters are read, but are
@@ -828,10 +1066,7 @@ static rsRetVal ATTR_NONNULL(1, 2) strmReadLine(strm_t *const pThis,
         cstrDestruct(&pThis->prevLineSegment);
     }
     if (mode == 0) {
-        while (c != '\n') {
-            CHKiRet(cstrAppendChar(*ppCStr, c));
-            CHKiRet(strmReadChar(pThis, &c));
-        }
+        CHKiRet(strmReadToLF(pThis, *ppCStr, &c));
         if (trimLineOverBytes > 0 && (uint32_t)cstrLen(*ppCStr) > trimLineOverBytes) {
             /* Truncate long line at trimLineOverBytes position */
             dbgprintf("Truncate long line at %u, mode %d\n", trimLineOverBytes, mode);
@@ -843,9 +1078,12 @@ static rsRetVal ATTR_NONNULL(1, 2) strmReadLine(strm_t *const pThis,
         finished = 0;
         while (finished == 0) {
             if (c != '\n') {
-                CHKiRet(cstrAppendChar(*ppCStr, c));
-                CHKiRet(strmReadChar(pThis, &c));
+                /* c is part of the paragraph, so the previous char is no LF any
+                 * longer. This must be recorded before reading on: if we hit EOF,
+                 * the flag is kept (and persisted by imfile) with prevLineSegment.
+                 */
                 pThis->bPrevWasNL = 0;
+                CHKiRet(strmReadToLF(pThis, *ppCStr, &c));
             } else {
                 if ((((*ppCStr)->iStrLen) > 0)) {
                     if (pThis->bPrevWasNL && escapeLFString_len > 0) {
@@ -915,10 +1153,10 @@ static rsRetVal ATTR_NONNULL(1, 2) strmReadLine(strm_t *const pThis,
                         } else {
                             CHKiRet(cstrAppendChar(*ppCStr, c));
                         }
+                        CHKiRet(strmReadChar(pThis, &c));
                     } else {
-                        CHKiRet(cstrAppendChar(*ppCStr, c));
+                        CHKiRet(strmReadToLF(pThis, *ppCStr, &c));
                     }
-                    CHKiRet(strmReadChar(pThis, &c));
                 }
             }
         }
@@ -1138,6 +1376,7 @@ BEGINobjConstruct(strm) /* be sure to specify the object type also in END macro!
     pThis->fdDir = -1;
     pThis->iUngetC = -1;
     pThis->bVeryReliableZip = 0;
+    pThis->bUseUring = 0;
     pThis->sType = STREAMTYPE_FILE_SINGLE;
     pThis->sIOBufSize = glblGetIOBufSize();
     pThis->tOpenMode = 0600;
@@ -1192,6 +1431,25 @@ static rsRetVal strmConstructFinalize(strm_t *pThis) {
         CHKmalloc(pThis->pZipBuf = (Bytef *)malloc(pThis->sIOBufSize + 128));
     }
 
+    /* block-parallel compression writes whole blocks in its own order, so it is
+     * only done for plain single files, where nothing else writes behind our back.
+     * If the pool cannot be started, we simply compress inline.
+     */
+    if (pThis->iZipLevel && pThis->iParCompWorkers > 0 && pThis->tOperationsMode != STREAMMODE_READ &&
+        pThis->sType == STREAMTYPE_FILE_SINGLE && strmCompInit(pThis->iParCompWorkers) == RS_RET_OK) {
+        pThis->bParComp = 1;
+        pthread_mutex_init(&pThis->mutComp, NULL);
+        pthread_cond_init(&pThis->compDone, 0);
+        /* one slot more than workers, so that all of them can be busy with
+         * our blocks while we fill the next one */
+        pThis->nCompSlots = pThis->iParCompWorkers + 1;
+        pThis->iCompHead = pThis->iCompCnt = 0;
+        pThis->iCompFill = 0;
+        pThis->lenCompBlock =
+            (pThis->sIOBufSize > STREAM_COMP_BLOCKSIZE) ? pThis->sIOBufSize : STREAM_COMP_BLOCKSIZE;
+        CHKmalloc(pThis->compSlot = (strmCompSlot_t *)calloc(pThis->nCompSlots, sizeof(strmCompSlot_t)));
+    }
+
     /* if we are set to sync, we must obtain a file handle to the directory for fsync() purposes */
     if (pThis->bSync && !pThis->bIsTTY && pThis->pszDir != NULL) {
         pThis->fdDir = open((char *)pThis->pszDir, O_RDONLY | O_CLOEXEC | O_NOCTTY);
@@ -1211,6 +1469,16 @@ static rsRetVal strmConstructFinalize(strm_t *pThis) {
         pThis->bAsyncWrite = 1;
     }
 
+    /* io_uring writes are only done for plain single files. Compressed and
+     * encrypted data is transformed in place in a single buffer, circular files
+     * need to know the real file size when switching files, and async writes
+     * have their own thread (which we would not gain anything from).
+     */
+    if (pThis->bUseUring && pThis->tOperationsMode != STREAMMODE_READ && !pThis->bAsyncWrite &&
+        pThis->iZipLevel == 0 && pThis->cryprov == NULL && pThis->sType == STREAMTYPE_FILE_SINGLE) {
+        pThis->bUringWrite = (strmUringInit() == RS_RET_OK);
+    }
+
     DBGPRINTF("file stream %s params: flush interval %d, async write %d\n", getFileDebugName(pThis),
               pThis->iFlushInterval, pThis->bAsyncWrite);
 
@@ -1233,9 +1501,25 @@ static rsRetVal strmConstructFinalize(strm_t *pThis) {
         pThis->bStopWriter = 0;
         if (pthread_create(&pThis->writerThreadID, &default_thread_attr, asyncWriterThread, pThis) != 0)
             DBGPRINTF("ERROR: stream %p cold not create writer thread\n", pThis);
+    } else if (pThis->bUringWrite) {
+        /* the completion thread hands buffers back, so we need the async
+         * buffer set and its synchronization, but no writer thread.
+         */
+        pthread_mutex_init(&pThis->mut, NULL);
+        pthread_cond_init(&pThis->notFull, 0);
+        pthread_cond_init(&pThis->isEmpty, 0);
+        pThis->iCnt = pThis->iEnq = pThis->iDeq = 0;
+        pThis->bUringBusy = 0;
+        pThis->iUringErr = 0;
+        for (i = 0; i < STREAM_ASYNC_NUMBUFS; ++i) {
+            CHKmalloc(pThis->asyncBuf[i].pBuf = (uchar *)malloc(pThis->sIOBufSize));
+        }
+        pThis->pIOBuf = pThis->asyncBuf[0].pBuf;
+        pThis->pIOBufAlloc = pThis->pIOBuf;
     } else {
         /* we work synchronously, so we need to alloc a fixed pIOBuf */
         CHKmalloc(pThis->pIOBuf = (uchar *)malloc(pThis->sIOBufSize));
+        pThis->pIOBufAlloc = pThis->pIOBuf;
         CHKmalloc(pThis->pIOBuf_truncation = (char *)malloc(pThis->sIOBufSize));
     }
 
@@ -1265,11 +1549,33 @@ BEGINobjDestruct(strm) /* be sure to specify the object type also in END and COD
         for (i = 0; i < STREAM_ASYNC_NUMBUFS; ++i) {
             free(pThis->asyncBuf[i].pBuf);
         }
+    } else if (pThis->bUringWrite) {
+        pthread_mutex_destroy(&pThis->mut);
+        pthread_cond_destroy(&pThis->notFull);
+        pthread_cond_destroy(&pThis->isEmpty);
+        for (i = 0; i < STREAM_ASYNC_NUMBUFS; ++i) {
+            free(pThis->asyncBuf[i].pBuf);
+        }
     } else {
         free(pThis->pIOBuf);
         free(pThis->pIOBuf_truncation);
     }
 
+    if (pThis->bParComp) {
+        /* strmCloseFile() has waited for all blocks, no worker uses the slots */
+        assert(pThis->iCompCnt == 0);
+        if (pThis->compSlot != NULL) {
+            for (i = 0; i < pThis->nCompSlots; ++i) {
+                free(pThis->compSlot[i].job.pIn);
+                free(pThis->compSlot[i].job.pOut);
+            }
+            free(pThis->compSlot);
+        }
+        pthread_mutex_destroy(&pThis->mutComp);
+        pthread_cond_destroy(&pThis->compDone);
+        strmCompExit();
+    }
+
     /* Finally, we can free the resources.
      * IMPORTANT: we MUST free this only AFTER the ansyncWriter has been stopped, else
      * we get random errors...
@@ -1493,6 +1799,126 @@ static rsRetVal doAsyncWriteInternal(strm_t *pThis, size_t lenBuf, const int bFl
 }
 
 
+/* hand the oldest pending buffer to io_uring. Must be called with the mutex
+ * locked, and only if no request of this stream is in flight: requests of
+ * a stream are strictly serialized so that the data is appended in order.
+ */
+static void strmUringSubmitNext(strm_t *pThis) {
+    const int iDeq = pThis->iDeq % STREAM_ASYNC_NUMBUFS;
+
+    pThis->bUringBusy = 1;
+    pThis->uringReq.op = STRMURING_WRITE;
+    pThis->uringReq.fd = pThis->fd;
+    pThis->uringReq.pBuf = pThis->asyncBuf[iDeq].pBuf;
+    pThis->uringReq.lenBuf = pThis->asyncBuf[iDeq].lenBuf;
+    strmUringSubmit(&pThis->uringReq);
+}
+
+
+/* completion callback, called on the io_uring completion thread. It continues
+ * partial writes, issues the syncs if the file is to be synced after each
+ * write and, once a buffer is done, returns it to the producer and starts
+ * the next pending one.
+ */
+static void strmUringDone(strmUringReq_t *pReq, int res) {
+    strm_t *const pThis = (strm_t *)pReq->pUsr;
+
+    d_pthread_mutex_lock(&pThis->mut);
+    if (pReq->op == STRMURING_WRITE) {
+        if (res == -EINTR || res == -EAGAIN) {
+            strmUringSubmit(pReq); /* just retry */
+            goto done;
+        }
+        if (res < 0) {
+            /* same as in the async writer: the buffer is lost, but we do not stall.
+             * The error is reported with the next write, flush or close. */
+            if (pThis->iUringErr == 0) pThis->iUringErr = -res;
+            LogError(-res, RS_RET_IO_ERROR,
+                     "file '%s'[%d] write error - see "
+                     "https://www.rsyslog.com/solving-rsyslog-write-errors/ for help "
+                     "OS error",
+                     pThis->pszCurrFName, pReq->fd);
+        } else if ((size_t)res < pReq->lenBuf) {
+            pReq->pBuf += res;
+            pReq->lenBuf -= res;
+            strmUringSubmit(pReq);
+            goto done;
+        } else if (pThis->bSync && !pThis->bIsTTY) {
+            pReq->op = STRMURING_FDATASYNC;
+            strmUringSubmit(pReq);
+            goto done;
+        }
+    } else {
+        if (res < 0) {
+            DBGPRINTF("sync failed for file %d with error %d - ignoring\n", pReq->fd, -res);
+        }
+        if (pReq->op == STRMURING_FDATASYNC && pThis->fdDir != -1) {
+            pReq->op = STRMURING_FSYNC;
+            pReq->fd = pThis->fdDir;
+            strmUringSubmit(pReq);
+            goto done;
+        }
+    }
+
+    /* buffer is completely processed */
+    ++pThis->iDeq;
+    --pThis->iCnt;
+    pThis->bUringBusy = 0;
+    pthread_cond_signal(&pThis->notFull);
+    if (pThis->iCnt == 0) {
+        pthread_cond_broadcast(&pThis->isEmpty);
+    } else {
+        strmUringSubmitNext(pThis);
+    }
+done:
+    d_pthread_mutex_unlock(&pThis->mut);
+}
+
+
+/* write a buffer via io_uring. The current IO buffer is queued and the
+ * producer continues with the next free one; we only block if all buffers
+ * are in flight. Offsets and write counters are updated right away, as the
+ * data is committed to this file. If the file is to be synced, we wait until
+ * the write and its sync have completed, as the regular write path does.
+ */
+static rsRetVal doUringWrite(strm_t *pThis, const size_t lenBuf) {
+    DEFiRet;
+
+    if (pThis->fd == -1) CHKiRet(strmOpenFile(pThis));
+    if (pThis->bIsTTY) {
+        /* TTYs have their own error recovery, write them synchronously */
+        CHKiRet(strmPhysWrite(pThis, pThis->pIOBuf, lenBuf));
+        FINALIZE;
+    }
+
+    d_pthread_mutex_lock(&pThis->mut);
+    /* the -1 below is important, because we need one buffer for the producer! */
+    while (pThis->iCnt >= STREAM_ASYNC_NUMBUFS - 1) d_pthread_cond_wait(&pThis->notFull, &pThis->mut);
+    pThis->asyncBuf[pThis->iEnq % STREAM_ASYNC_NUMBUFS].lenBuf = lenBuf;
+    pThis->pIOBuf = pThis->asyncBuf[++pThis->iEnq % STREAM_ASYNC_NUMBUFS].pBuf;
+    ++pThis->iCnt;
+    if (!pThis->bUringBusy) {
+        pThis->uringReq.cbDone = strmUringDone;
+        pThis->uringReq.pUsr = pThis;
+        strmUringSubmitNext(pThis);
+    }
+    if (pThis->bSync) {
+        while (pThis->iCnt > 0) {
+            d_pthread_cond_wait(&pThis->isEmpty, &pThis->mut);
+        }
+    }
+    /* an error of an earlier buffer (or this one, if synced) */
+    iRet = strmUringCheckErr(pThis);
+    d_pthread_mutex_unlock(&pThis->mut);
+
+    pThis->iCurrOffs += lenBuf;
+    if (pThis->pUsrWCntr != NULL) *pThis->pUsrWCntr += lenBuf;
+
+finalize_it:
+    RETiRet;
+}
+
+
 /* schedule writing to the stream. Depending on our concurrency settings,
  * this either directly writes to the stream or schedules writing via
  * the background thread. -- rgerhards, 2009-07-07
@@ -1514,6 +1940,8 @@ static rsRetVal strmSchedWrite(strm_t *pThis, uchar *pBuf, size_t lenBuf, const
     pThis->iBufPtr = 0; /* we are at the begin of a new buffer */
     if (pThis->bAsyncWrite) {
         CHKiRet(doAsyncWriteInternal(pThis, lenBuf, bFlushZip));
+    } else if (pThis->bUringWrite) {
+        CHKiRet(doUringWrite(pThis, lenBuf));
     } else {
         CHKiRet(doWriteInternal(pThis, pBuf, lenBuf, bFlushZip));
     }
@@ -1690,6 +2118,167 @@ finalize_it:
 }
 
 
+/* ---------- block-parallel compression ----------
+ * Instead of running one compression stream over the whole file, data is cut
+ * into blocks of lenCompBlock octets. Each block is compressed into a complete
+ * gzip member or zstd frame by the shared compression pool (strmcomp.c). Both
+ * formats permit concatenation, so the result is a regular compressed file.
+ * Blocks are kept in the compSlot ring in submission order and are written by
+ * the thread that writes the stream (never by a pool worker), so strmPhysWrite()
+ * is called exactly as in inline mode. Compression is a bit less efficient, as
+ * each block starts with an empty dictionary, but as every block is complete,
+ * the file is always readable up to the last block written (much like
+ * veryRobustZip, which therefore is not needed in this mode).
+ */
+
+/* called by a pool worker when the block of a slot has been compressed */
+static void strmCompDone(strmCompJob_t *const pJob) {
+    strmCompSlot_t *const pSlot = (strmCompSlot_t *)pJob->pUsr;
+    strm_t *const pThis = pSlot->pStrm;
+
+    d_pthread_mutex_lock(&pThis->mutComp);
+    pSlot->bDone = 1;
+    pthread_cond_signal(&pThis->compDone);
+    d_pthread_mutex_unlock(&pThis->mutComp);
+}
+
+
+/* allocate the buffers of a slot. This is done on first use, so that streams
+ * with little data (e.g. most dynafiles) do not allocate the full ring.
+ */
+static rsRetVal strmCompInitSlot(strm_t *const pThis, strmCompSlot_t *const pSlot) {
+    DEFiRet;
+
+    if (pThis->compressionDriver == STRM_COMPRESS_ZSTD) {
+        pSlot->job.compress = zstdw.CompressBlock;
+        pSlot->job.freeCtx = zstdw.FreeBlockCtx;
+        pSlot->sizeOut = zstdw.CompressBlockBound(pThis->lenCompBlock);
+    } else {
+        pSlot->job.compress = zlibw.CompressBlock;
+        pSlot->job.freeCtx = zlibw.FreeBlockCtx;
+        pSlot->sizeOut = zlibw.CompressBlockBound(pThis->lenCompBlock);
+    }
+    pSlot->job.iCodec = pThis->compressionDriver;
+    pSlot->job.cbDone = strmCompDone;
+    pSlot->job.pUsr = pSlot;
+    pSlot->pStrm = pThis;
+    CHKmalloc(pSlot->job.pOut = (uchar *)malloc(pSlot->sizeOut));
+    CHKmalloc(pSlot->job.pIn = (uchar *)malloc(pThis->lenCompBlock));
+
+finalize_it:
+    RETiRet;
+}
+
+
+/* hand the slot currently being filled to the compression pool */
+static void strmCompSubmitBlock(strm_t *const pThis) {
+    strmCompSlot_t *const pSlot = &pThis->compSlot[(pThis->iCompHead + pThis->iCompCnt) % pThis->nCompSlots];
+
+    pSlot->job.lenIn = pThis->iCompFill;
+    pSlot->job.lenOut = pSlot->sizeOut;
+    pSlot->job.level = pThis->iZipLevel;
+    pSlot->bDone = 0;
+    pThis->iCompFill = 0;
+    ++pThis->iCompCnt;
+    strmCompSubmit(&pSlot->job);
+}
+
+
+/* write compressed blocks in submission order. We wait for blocks until at
+ * most iKeep blocks remain in flight; after that, only blocks that are already
+ * done are written. A failing block does not stop processing of the others
+ * (its data is lost, as it would be in inline mode), so with iKeep == 0 all
+ * blocks are always finished on return. The first error is returned.
+ */
+static rsRetVal strmCompWriteBlocks(strm_t *const pThis, const int iKeep) {
+    strmCompSlot_t *pSlot;
+    sbool bDone;
+    rsRetVal localRet;
+    DEFiRet;
+
+    while (pThis->iCompCnt > 0) {
+        pSlot = &pThis->compSlot[pThis->iCompHead];
+        d_pthread_mutex_lock(&pThis->mutComp);
+        if (pThis->iCompCnt > iKeep) {
+            while (!pSlot->bDone) {
+                d_pthread_cond_wait(&pThis->compDone, &pThis->mutComp);
+            }
+        }
+        bDone = pSlot->bDone;
+        d_pthread_mutex_unlock(&pThis->mutComp);
+        if (!bDone) break;
+
+        /* the slot is not refilled before this function returns, so
+         * we can release it before its data is written */
+        pThis->iCompHead = (pThis->iCompHead + 1) % pThis->nCompSlots;
+        --pThis->iCompCnt;
+        localRet = pSlot->job.iRet;
+        if (localRet == RS_RET_OK) {
+            localRet = strmPhysWrite(pThis, pSlot->job.pOut, pSlot->job.lenOut);
+        }
+        if (localRet != RS_RET_OK && iRet == RS_RET_OK) {
+            iRet = localRet;
+        }
+    }
+
+    RETiRet;
+}
+
+
+/* submit the partially filled block (if any) and write all blocks */
+static rsRetVal doParZipFinish(strm_t *const pThis) {
+    DEFiRet;
+
+    if (pThis->iCompFill > 0) {
+        strmCompSubmitBlock(pThis);
+    }
+    CHKiRet(strmCompWriteBlocks(pThis, 0));
+
+finalize_it:
+    RETiRet;
+}
+
+
+/* add data to the current block, submitting blocks as they become full. As
+ * the caller re-uses pBuf, data is copied. On flush, the partial block is
+ * submitted and we wait until everything is written, so that flush semantics
+ * are the same as in inline mode.
+ */
+static rsRetVal doParZipWrite(strm_t *const pThis, uchar *pBuf, size_t lenBuf, const int bFlush) {
+    strmCompSlot_t *pSlot;
+    size_t lenCopy;
+    DEFiRet;
+
+    while (lenBuf > 0) {
+        if (pThis->iCompCnt == pThis->nCompSlots) { /* no slot left to fill? */
+            CHKiRet(strmCompWriteBlocks(pThis, pThis->nCompSlots - 1));
+        }
+        pSlot = &pThis->compSlot[(pThis->iCompHead + pThis->iCompCnt) % pThis->nCompSlots];
+        if (pSlot->job.pIn == NULL) {
+            CHKiRet(strmCompInitSlot(pThis, pSlot));
+        }
+        lenCopy = pThis->lenCompBlock - pThis->iCompFill;
+        if (lenCopy > lenBuf) lenCopy = lenBuf;
+        memcpy(pSlot->job.pIn + pThis->iCompFill, pBuf, lenCopy);
+        pThis->iCompFill += lenCopy;
+        pBuf += lenCopy;
+        lenBuf -= lenCopy;
+        if (pThis->iCompFill == pThis->lenCompBlock) {
+            strmCompSubmitBlock(pThis);
+            /* write whatever is already done, without waiting */
+            CHKiRet(strmCompWriteBlocks(pThis, pThis->nCompSlots));
+        }
+    }
+
+    if (bFlush) {
+        CHKiRet(doParZipFinish(pThis));
+    }
+
+finalize_it:
+    RETiRet;
+}
+
+
 /* write the output buffer in zip mode
  * This means we compress it first and then do a physical write.
  * Note that we always do a full deflateInit ... deflate ... deflateEnd
@@ -1702,7 +2291,9 @@ finalize_it:
  * rgerhards, 2009-06-04
  */
 static rsRetVal doZipWrite(strm_t *pThis, uchar *pBuf, size_t lenBuf, const int bFlush) {
-    if (pThis->compressionDriver == STRM_COMPRESS_ZSTD) {
+    if (pThis->bParComp) {
+        return doParZipWrite(pThis, pBuf, lenBuf, bFlush);
+    } else if (pThis->compressionDriver == STRM_COMPRESS_ZSTD) {
         return zstdw.doStrmWrite(pThis, pBuf, lenBuf, bFlush, strmPhysWrite);
     } else {
         return zlibw.doStrmWrite(pThis, pBuf, lenBuf, bFlush, strmPhysWrite);
@@ -1714,7 +2305,9 @@ static rsRetVal doZipWrite(strm_t *pThis, uchar *pBuf, size_t lenBuf, const int
  * running in stream mode).
  */
 static rsRetVal doZipFinish(strm_t *pThis) {
-    if (pThis->compressionDriver == STRM_COMPRESS_ZSTD) {
+    if (pThis->bParComp) {
+        return doParZipFinish(pThis);
+    } else if (pThis->compressionDriver == STRM_COMPRESS_ZSTD) {
         return zstdw.doCompressFinish(pThis, strmPhysWrite);
     } else {
         return zlibw.doCompressFinish(pThis, strmPhysWrite);
@@ -1755,6 +2348,12 @@ static rsRetVal strmFlush(strm_t *pThis) {
 
     if (pThis->bAsyncWrite) d_pthread_mutex_lock(&pThis->mut);
     CHKiRet(strmFlushInternal(pThis, 1));
+    if (pThis->bUringWrite) {
+        /* report write errors of earlier buffers even if there was nothing to flush */
+        d_pthread_mutex_lock(&pThis->mut);
+        iRet = strmUringCheckErr(pThis);
+        d_pthread_mutex_unlock(&pThis->mut);
+    }
 
 finalize_it:
     if (pThis->bAsyncWrite) d_pthread_mutex_unlock(&pThis->mut);
@@ -1788,6 +2387,10 @@ static rsRetVal ATTR_NONNULL() strmSeek(strm_t *pThis, const off64_t offs) {
     }
     pThis->strtOffs = pThis->iCurrOffs = offs; /* we are now at *this* offset */
     pThis->iBufPtr = 0; /* buffer invalidated */
+    if (pThis->pMmapBase != NULL) {
+        strmUnmap(pThis);
+    }
+    pThis->mmapNextOffs = offs;
 
 finalize_it:
     RETiRet;
@@ -1851,6 +2454,31 @@ finalize_it:
 }
 
 
+/* position a circular read stream at the begin of file number FNum. Other than
+ * strmMultiFileSeek(), this never deletes anything: the skipped files are
+ * handed out to parallel readers by the disk queue, which deletes them once
+ * they are fully processed. Again, a queue support function only.
+ */
+rsRetVal strmSkipToFile(strm_t *pThis, unsigned int FNum) {
+    DEFiRet;
+    ISOBJ_TYPE_assert(pThis, strm);
+    assert(pThis->sType == STREAMTYPE_FILE_CIRCULAR);
+    assert(pThis->tOperationsMode == STREAMMODE_READ);
+
+    if (pThis->fd != -1) {
+        CHKiRet(strmCloseFile(pThis));
+    }
+    pThis->iCurrFNum = FNum;
+    pThis->strtOffs = pThis->iCurrOffs = 0;
+    pThis->iBufPtr = pThis->iBufPtrMax = 0;
+    pThis->iUngetC = -1;
+    DBGOPRINT((obj_t *)pThis, "strmSkipToFile: now at file number %u\n", FNum);
+
+finalize_it:
+    RETiRet;
+}
+
+
 /* seek to current offset. This is primarily a helper to readjust the OS file
  * pointer after a strm object has been deserialized.
  */
@@ -2003,6 +2631,9 @@ DEFpropSetMeth(strm, iMaxFileSize, int64) DEFpropSetMeth(strm, iFileNumDigits, i
                     DEFpropSetMeth(strm, sIOBufSize, size_t) DEFpropSetMeth(strm, iSizeLimit, off_t)
                         DEFpropSetMeth(strm, iFlushInterval, int) DEFpropSetMeth(strm, pszSizeLimitCmd, uchar *)
                             DEFpropSetMeth(strm, cryprov, cryprov_if_t *) DEFpropSetMeth(strm, cryprovData, void *)
+                                DEFpropSetMeth(strm, bUseMmap, int) DEFpropSetMeth(strm, bSegmentOnly, int)
+                                    DEFpropSetMeth(strm, bUseUring, int)
+                                        DEFpropSetMeth(strm, iParCompWorkers, int)
 
     /* sets timeout in seconds */
     void ATTR_NONNULL() strmSetReadTimeout(strm_t *const __restrict__ pThis, const int val) {
@@ -2214,6 +2845,8 @@ static rsRetVal strmDup(strm_t *const pThis, strm_t **ppNew) {
     pNew->iMaxFiles = pThis->iMaxFiles;
     pNew->iFileNumDigits = pThis->iFileNumDigits;
     pNew->bDeleteOnClose = pThis->bDeleteOnClose;
+    pNew->bUseMmap = pThis->bUseMmap;
+    pNew->iParCompWorkers = pThis->iParCompWorkers;
     pNew->iCurrOffs = pThis->iCurrOffs;
 
     *ppNew = pNew;
@@ -2341,6 +2974,7 @@ BEGINobjQueryInterface(strm)
     pIf->ConstructFinalize = strmConstructFinalize;
     pIf->Destruct = strmDestruct;
     pIf->ReadChar = strmReadChar;
+    pIf->Read = strmRead;
     pIf->UnreadChar = strmUnreadChar;
     pIf->ReadLine = strmReadLine;
     pIf->SeekCurrOffs = strmSeekCurrOffs;
@@ -2378,10 +3012,22 @@ BEGINobjQueryInterface(strm)
     pIf->SetpszSizeLimitCmd = strmSetpszSizeLimitCmd;
     pIf->Setcryprov = strmSetcryprov;
     pIf->SetcryprovData = strmSetcryprovData;
+    pIf->SetbUseMmap = strmSetbUseMmap;
+    pIf->SetbSegmentOnly = strmSetbSegmentOnly;
+    pIf->SetbUseUring = strmSetbUseUring;
+    pIf->SetiParCompWorkers = strmSetiParCompWorkers;
 finalize_it:
 ENDobjQueryInterface(strm)
 
 
+/* Exit the stream class. All streams must have been destructed.
+ */
+BEGINObjClassExit(strm, OBJ_IS_CORE_MODULE) /* CHANGE class also in END MACRO! */
+    CODESTARTObjClassExit(strm);
+    strmUringExit();
+ENDObjClassExit(strm)
+
+
 /* Initialize the stream class. Must be called as the very first method
  * before anything else is called inside this class.
  * rgerhards, 2008-01-09
@@ -76,6 +76,8 @@ typedef struct strm_s strm_t; /* forward reference because of zlib... */
 #include "stream.h"
 #include "zlibw.h"
 #include "cryprov.h"
+#include "strmuring.h"
+#include "strmcomp.h"
 
 /* stream types */
 typedef enum {
@@ -95,6 +97,16 @@ typedef enum { /* when extending, do NOT change existing modes! */
 typedef enum { STRM_COMPRESS_ZIP = 0, STRM_COMPRESS_ZSTD = 1 } strm_compressionDriver_t;
 
 #define STREAM_ASYNC_NUMBUFS 2 /* must be a power of 2 -- TODO: make configurable */
+#define STREAM_COMP_BLOCKSIZE (128 * 1024) /* min size of a block for parallel compression */
+
+/* a block handed to the compression pool (block-parallel compression) */
+typedef struct strmCompSlot_s {
+    strmCompJob_t job;
+    strm_t *pStrm;
+    size_t sizeOut; /* size of job.pOut */
+    sbool bDone; /* compression finished -- protected by the stream's mutComp */
+} strmCompSlot_t;
+
 /* The strm_t data structure */
 struct strm_s {
     BEGINobjInstance
@@ -175,6 +187,34 @@ struct strm_s {
         int noRepeatedErrorOutput; /* if a file is missing the Error is only given once */
         int ignoringMsg;
         strm_compressionDriver_t compressionDriver;
+        /* queue segment mode: reads go through mmap(), writes preallocate the segment */
+        sbool bUseMmap;
+        uchar *pMmapBase; /* current read mapping, NULL if none */
+        size_t lenMmap; /* length of current read mapping */
+        uchar *pIOBufAlloc; /* saved pIOBuf while pIOBuf points into the mapping */
+        sbool bSegmentOnly; /* circular read stream: report EOF at end of current file, do not switch */
+        off64_t mmapNextOffs; /* file offset of the first octet not yet mapped */
+        /* io_uring writes: buffers are handed to the shared ring in asyncBuf order,
+         * one at a time; iCnt/iDeq/mut/notFull/isEmpty are used as in async mode */
+        sbool bUseUring; /* io_uring writes requested */
+        sbool bUringWrite; /* io_uring writes active (requested and possible) */
+        sbool bUringBusy; /* a request of this stream is in flight */
+        int iUringErr; /* errno of a failed write not yet reported to the caller, 0 if none */
+        strmUringReq_t uringReq;
+        /* block-parallel compression: data is cut into blocks which the shared
+         * compression pool turns into independent gzip members/zstd frames. The
+         * blocks are kept in the compSlot ring and written in order; the slot
+         * following the submitted ones is the one currently being filled. */
+        int iParCompWorkers; /* compression pool size requested, 0 = compress inline */
+        sbool bParComp; /* block-parallel compression active */
+        strmCompSlot_t *compSlot;
+        int nCompSlots;
+        int iCompHead; /* oldest submitted slot */
+        int iCompCnt; /* nbr of submitted slots not yet written */
+        size_t lenCompBlock; /* size of a compression block */
+        size_t iCompFill; /* octets in the slot being filled */
+        pthread_mutex_t mutComp; /* protects bDone of the slots */
+        pthread_cond_t compDone;
 };
 
 
@@ -226,19 +266,36 @@ BEGINinterface(strm) /* name must also be changed in ENDinterface macro! */
     /* v9 added  2013-04-04 */
     INTERFACEpropSetMeth(strm, cryprov, cryprov_if_t *);
     INTERFACEpropSetMeth(strm, cryprovData, void *);
+    /* v15 added  2025-07-21 */
+    rsRetVal (*Read)(strm_t *pThis, uchar *pBuf, size_t lenBuf);
+    /* v16 added  2025-07-22 */
+    INTERFACEpropSetMeth(strm, bUseMmap, int);
+    /* v17 added  2025-07-23 */
+    INTERFACEpropSetMeth(strm, bSegmentOnly, int);
+    /* v18 added  2025-07-24 */
+    INTERFACEpropSetMeth(strm, bUseUring, int);
+    /* v19 added  2025-07-26 */
+    INTERFACEpropSetMeth(strm, iParCompWorkers, int);
 ENDinterface(strm)
-#define strmCURR_IF_VERSION 14 /* increment whenever you change the interface structure! */
+#define strmCURR_IF_VERSION 19 /* increment whenever you change the interface structure! */
     /* V10, 2013-09-10: added new parameter bEscapeLF, changed mode to uint8_t (rgerhards) */
     /* V11, 2015-12-03: added new parameter bReopenOnTruncate */
     /* V12, 2015-12-11: added new parameter trimLineOverBytes, changed mode to uint32_t */
     /* V13, 2017-09-06: added new parameter strtoffs to ReadLine() */
     /* V14, 2019-11-13: added new parameter bEscapeLFString (rgerhards) */
+    /* V15, 2025-07-21: added Read() for bulk reads of binary records */
+    /* V16, 2025-07-22: added bUseMmap for mmap-backed queue segments */
+    /* V17, 2025-07-23: added bSegmentOnly for parallel disk queue readers */
+    /* V18, 2025-07-24: added bUseUring for io_uring based writes */
+    /* V19, 2025-07-26: added iParCompWorkers for block-parallel compression */
 
 #define strmGetCurrFileNum(pStrm) ((pStrm)->iCurrFNum)
 
 /* prototypes */
 PROTOTYPEObjClassInit(strm);
+PROTOTYPEObjClassExit(strm);
 rsRetVal strmMultiFileSeek(strm_t *pThis, unsigned int fileNum, off64_t offs, off64_t *bytesDel);
+rsRetVal strmSkipToFile(strm_t *pThis, unsigned int fileNum);
 rsRetVal ATTR_NONNULL(1, 2) strmReadMultiLine(strm_t *pThis,
                                               cstr_t **ppCStr,
                                               regex_t *start_preg,
@@ -0,0 +1,166 @@
+/* Block-parallel compression engine of the stream class.
+ *
+ * Copyright 2025 Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file strmcomp.c
+ * @brief Implementation of the shared compression thread pool.
+ *
+ * Jobs are kept in a single FIFO protected by the pool mutex. Workers own
+ * their compression contexts and free them when they terminate, so a
+ * context is never used by two threads.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#ifdef HAVE_SYS_PRCTL_H
+    #include <sys/prctl.h>
+#endif
+
+#include "rsyslog.h"
+#include "errmsg.h"
+#include "debug.h"
+#include "strmcomp.h"
+
+static struct {
+    pthread_mutex_t mutLife; /* serializes init/exit, protects tids, nWorkers, nRefs */
+    pthread_t *tids;
+    int nWorkers;
+    int nRefs;
+    pthread_mutex_t mut; /* protects the job queue and bStop */
+    pthread_cond_t notEmpty;
+    strmCompJob_t *pHead;
+    strmCompJob_t *pTail;
+    sbool bStop;
+} pool = {.mutLife = PTHREAD_MUTEX_INITIALIZER,
+          .mut = PTHREAD_MUTEX_INITIALIZER,
+          .notEmpty = PTHREAD_COND_INITIALIZER};
+
+
+void strmCompSubmit(strmCompJob_t *const pJob) {
+    pJob->pNext = NULL;
+    pthread_mutex_lock(&pool.mut);
+    if (pool.pTail == NULL) {
+        pool.pHead = pJob;
+    } else {
+        pool.pTail->pNext = pJob;
+    }
+    pool.pTail = pJob;
+    pthread_cond_signal(&pool.notEmpty);
+    pthread_mutex_unlock(&pool.mut);
+}
+
+
+static void *workerThread(void __attribute__((unused)) * arg) {
+    void *ctx[STRMCOMP_MAX_CODECS] = {NULL};
+    void (*freeCtx[STRMCOMP_MAX_CODECS])(void *) = {NULL};
+    strmCompJob_t *pJob;
+    int i;
+
+    #if defined(HAVE_PRCTL) && defined(PR_SET_NAME)
+    if (prctl(PR_SET_NAME, "rs:compress", 0, 0, 0) != 0) {
+        DBGPRINTF("prctl failed, not setting thread name for '%s'\n", "rs:compress");
+    }
+    #endif
+
+    pthread_mutex_lock(&pool.mut);
+    while (1) {
+        while (pool.pHead == NULL && !pool.bStop) {
+            pthread_cond_wait(&pool.notEmpty, &pool.mut);
+        }
+        if (pool.pHead == NULL) break; /* stop requested and nothing left to do */
+        pJob = pool.pHead;
+        pool.pHead = pJob->pNext;
+        if (pool.pHead == NULL) pool.pTail = NULL;
+        pthread_mutex_unlock(&pool.mut);
+
+        assert(pJob->iCodec >= 0 && pJob->iCodec < STRMCOMP_MAX_CODECS);
+        pJob->iRet = pJob->compress(&ctx[pJob->iCodec], pJob->level, pJob->pIn, pJob->lenIn, pJob->pOut,
+                                    &pJob->lenOut);
+        freeCtx[pJob->iCodec] = pJob->freeCtx;
+        pJob->cbDone(pJob);
+
+        pthread_mutex_lock(&pool.mut);
+    }
+    pthread_mutex_unlock(&pool.mut);
+
+    for (i = 0; i < STRMCOMP_MAX_CODECS; ++i) {
+        if (ctx[i] != NULL) freeCtx[i](ctx[i]);
+    }
+    DBGPRINTF("strmcomp: worker terminated\n");
+    return NULL;
+}
+
+
+rsRetVal strmCompInit(const int nWorkers) {
+    pthread_t *newTids;
+    int r;
+    DEFiRet;
+
+    pthread_mutex_lock(&pool.mutLife);
+    if (nWorkers > pool.nWorkers) {
+        CHKmalloc(newTids = realloc(pool.tids, nWorkers * sizeof(pthread_t)));
+        pool.tids = newTids;
+        pthread_mutex_lock(&pool.mut);
+        pool.bStop = 0;
+        pthread_mutex_unlock(&pool.mut);
+        while (pool.nWorkers < nWorkers) {
+            if ((r = pthread_create(&pool.tids[pool.nWorkers], NULL, workerThread, NULL)) != 0) {
+                LogError(r, RS_RET_ERR, "cannot create compression worker thread");
+                /* continue with what we have, if anything */
+                if (pool.nWorkers == 0) ABORT_FINALIZE(RS_RET_ERR);
+                break;
+            }
+            ++pool.nWorkers;
+        }
+        DBGPRINTF("strmcomp: pool now has %d workers\n", pool.nWorkers);
+    }
+    ++pool.nRefs;
+
+finalize_it:
+    pthread_mutex_unlock(&pool.mutLife);
+    RETiRet;
+}
+
+
+void strmCompExit(void) {
+    int i;
+
+    pthread_mutex_lock(&pool.mutLife);
+    if (--pool.nRefs > 0) {
+        pthread_mutex_unlock(&pool.mutLife);
+        return;
+    }
+    pthread_mutex_lock(&pool.mut);
+    assert(pool.pHead == NULL);
+    pool.bStop = 1;
+    pthread_cond_broadcast(&pool.notEmpty);
+    pthread_mutex_unlock(&pool.mut);
+
+    for (i = 0; i < pool.nWorkers; ++i) {
+        pthread_join(pool.tids[i], NULL);
+    }
+    free(pool.tids);
+    pool.tids = NULL;
+    pool.nWorkers = 0;
+    pthread_mutex_unlock(&pool.mutLife);
+}
@@ -0,0 +1,84 @@
+/* Definitions for the block-parallel compression engine of the stream class.
+ *
+ * Copyright 2025 Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file strmcomp.h
+ * @brief Process-wide pool of compression threads shared by all output streams.
+ *
+ * Streams cut their output into blocks and hand each block to the pool as a
+ * job. A worker compresses the block into a self-contained unit (a gzip
+ * member or a zstd frame) and calls back into the stream. The pool does not
+ * order jobs; streams keep their jobs in a ring and write the results in
+ * submission order.
+ *
+ * The pool knows nothing about the codecs. A job carries the compression
+ * function and a codec index; each worker keeps one compression context per
+ * codec index and reuses it for all jobs of that codec.
+ */
+#ifndef INCLUDED_STRMCOMP_H
+#define INCLUDED_STRMCOMP_H
+
+#include <stddef.h>
+
+#define STRMCOMP_MAX_CODECS 2 /**< number of distinct codec indexes */
+
+typedef struct strmCompJob_s strmCompJob_t;
+/**
+ * @brief A single compression job. Owned by the caller, must stay valid
+ * until its completion callback has been called.
+ */
+struct strmCompJob_s {
+    int iCodec; /**< index of the per-worker context, < STRMCOMP_MAX_CODECS */
+    /** compress lenIn octets; *pLenOut is the size of pOut on entry and the
+     *  number of octets produced on exit. *ppCtx is the worker's context for
+     *  iCodec, NULL on first use; the function may (re)create it. */
+    rsRetVal (*compress)(void **ppCtx, int level, uchar *pIn, size_t lenIn, uchar *pOut, size_t *pLenOut);
+    void (*freeCtx)(void *pCtx); /**< frees a context created by compress */
+    int level;
+    uchar *pIn;
+    size_t lenIn;
+    uchar *pOut;
+    size_t lenOut; /**< size of pOut when submitted, octets used when done */
+    rsRetVal iRet; /**< result of compress */
+    /** called on the worker thread once the job is done */
+    void (*cbDone)(strmCompJob_t *pJob);
+    void *pUsr; /**< opaque data for the callback */
+    strmCompJob_t *pNext; /**< pool queue link, owned by the pool */
+};
+
+/**
+ * @brief Obtain a reference to the shared pool, creating it if needed.
+ * @param nWorkers number of threads requested; the pool grows to the
+ *        largest number any caller has requested
+ * @return RS_RET_OK, or an error in which case no reference is held
+ */
+rsRetVal strmCompInit(int nWorkers);
+
+/**
+ * @brief Drop a reference obtained by strmCompInit(). The last one stops
+ * the workers. All jobs must have completed.
+ */
+void strmCompExit(void);
+
+/** @brief Queue a job for compression. */
+void strmCompSubmit(strmCompJob_t *pJob);
+
+#endif /* #ifndef INCLUDED_STRMCOMP_H */
@@ -0,0 +1,269 @@
+/* io_uring write engine of the stream class.
+ *
+ * Copyright 2025 Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file strmuring.c
+ * @brief Implementation of the shared io_uring instance.
+ *
+ * The ring is created when the first stream asks for it and lives until the
+ * stream class exits, so dynafile churn does not recreate it. The submission
+ * queue is shared by all stream writers and the completion thread, so it is
+ * protected by a mutex. The completion queue is only ever consumed by the
+ * completion thread and needs no locking. Shutdown is signalled by a NOP
+ * request without user data.
+ *
+ * The completion thread must never wait for a free submission queue entry:
+ * if the kernel refuses to accept more submissions (-EBUSY) because the
+ * completion queue is full, only the completion thread itself can make
+ * room. So requests issued from completion callbacks are put on a deferred
+ * list first and moved to the submission queue after the current batch of
+ * completions has been consumed. Whatever does not fit stays on the list
+ * until the next batch.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#ifdef HAVE_LIBURING
+    #include <liburing.h>
+#endif
+#ifdef HAVE_SYS_PRCTL_H
+    #include <sys/prctl.h>
+#endif
+
+#include "rsyslog.h"
+#include "errmsg.h"
+#include "debug.h"
+#include "strmuring.h"
+
+#ifdef HAVE_LIBURING
+
+    #define STRMURING_ENTRIES 256
+
+static struct {
+    pthread_mutex_t mutLife; /* serializes init/exit, protects bRunning and bFailed */
+    sbool bRunning; /* ring and completion thread exist */
+    sbool bFailed; /* ring could not be created, do not try again */
+    pthread_mutex_t mut; /* protects the submission queue */
+    struct io_uring ring;
+    pthread_t tid;
+    strmUringReq_t *pDeferHead; /* requests from callbacks, only used by the completion thread */
+    strmUringReq_t *pDeferTail;
+} engine = {.mutLife = PTHREAD_MUTEX_INITIALIZER, .mut = PTHREAD_MUTEX_INITIALIZER};
+
+
+/* obtain a submission queue entry. If the queue is full, we submit what
+ * is in it, which frees all entries. Must be called with the mutex locked,
+ * and never on the completion thread, which is the one we may be waiting for.
+ */
+static struct io_uring_sqe *getSqe(void) {
+    struct io_uring_sqe *sqe;
+
+    while ((sqe = io_uring_get_sqe(&engine.ring)) == NULL) {
+        if (io_uring_submit(&engine.ring) < 0) {
+            /* kernel is busy with completions (-EBUSY), let it catch up */
+            pthread_mutex_unlock(&engine.mut);
+            sched_yield();
+            pthread_mutex_lock(&engine.mut);
+        }
+    }
+    return sqe;
+}
+
+
+static void prepSqe(struct io_uring_sqe *const sqe, strmUringReq_t *const pReq) {
+    switch (pReq->op) {
+        case STRMURING_WRITE:
+            /* offset -1: use (and advance) the file position, as write() does */
+            io_uring_prep_write(sqe, pReq->fd, pReq->pBuf, pReq->lenBuf, (__u64)-1);
+            break;
+        case STRMURING_FDATASYNC:
+            io_uring_prep_fsync(sqe, pReq->fd, IORING_FSYNC_DATASYNC);
+            break;
+        case STRMURING_FSYNC:
+        default:
+            io_uring_prep_fsync(sqe, pReq->fd, 0);
+            break;
+    }
+    io_uring_sqe_set_data(sqe, pReq);
+}
+
+
+void strmUringSubmit(strmUringReq_t *const pReq) {
+    if (pthread_equal(pthread_self(), engine.tid)) {
+        /* the completion thread submits after the current batch */
+        pReq->pNext = NULL;
+        if (engine.pDeferTail == NULL) {
+            engine.pDeferHead = pReq;
+        } else {
+            engine.pDeferTail->pNext = pReq;
+        }
+        engine.pDeferTail = pReq;
+        return;
+    }
+
+    pthread_mutex_lock(&engine.mut);
+    prepSqe(getSqe(), pReq);
+    io_uring_submit(&engine.ring);
+    pthread_mutex_unlock(&engine.mut);
+}
+
+
+/* move the deferred requests to the submission queue and submit them. Never
+ * waits: if the kernel does not accept more, completions are pending and
+ * the rest is submitted after they have been consumed. Must be called on the
+ * completion thread with the mutex locked.
+ */
+static void submitDeferred(void) {
+    struct io_uring_sqe *sqe;
+    strmUringReq_t *pReq;
+
+    while ((pReq = engine.pDeferHead) != NULL) {
+        if ((sqe = io_uring_get_sqe(&engine.ring)) == NULL) {
+            if (io_uring_submit(&engine.ring) <= 0) {
+                DBGPRINTF("strmuring: submission queue full, deferring requests\n");
+                return;
+            }
+            continue;
+        }
+        prepSqe(sqe, pReq);
+        engine.pDeferHead = pReq->pNext;
+        if (engine.pDeferHead == NULL) engine.pDeferTail = NULL;
+    }
+    if (io_uring_sq_ready(&engine.ring) > 0) {
+        io_uring_submit(&engine.ring);
+    }
+}
+
+
+static void *completionThread(void __attribute__((unused)) * arg) {
+    struct io_uring_cqe *cqe;
+    strmUringReq_t *pReq;
+    unsigned head;
+    unsigned nCqe;
+    sbool bStop = 0;
+    int r;
+
+    #if defined(HAVE_PRCTL) && defined(PR_SET_NAME)
+    if (prctl(PR_SET_NAME, "rs:uring", 0, 0, 0) != 0) {
+        DBGPRINTF("prctl failed, not setting thread name for '%s'\n", "rs:uring");
+    }
+    #endif
+
+    while (!bStop) {
+        r = io_uring_wait_cqe(&engine.ring, &cqe);
+        if (r < 0) {
+            if (r != -EINTR) {
+                DBGPRINTF("strmuring: io_uring_wait_cqe failed with %d\n", r);
+                sched_yield();
+            }
+            continue;
+        }
+        nCqe = 0;
+        io_uring_for_each_cqe(&engine.ring, head, cqe) {
+            pReq = (strmUringReq_t *)io_uring_cqe_get_data(cqe);
+            if (pReq == NULL) {
+                bStop = 1;
+            } else {
+                pReq->cbDone(pReq, cqe->res);
+            }
+            ++nCqe;
+        }
+        io_uring_cq_advance(&engine.ring, nCqe);
+
+        /* submit all follow-ups the callbacks have queued in one go */
+        pthread_mutex_lock(&engine.mut);
+        submitDeferred();
+        pthread_mutex_unlock(&engine.mut);
+    }
+    DBGPRINTF("strmuring: completion thread terminated\n");
+    return NULL;
+}
+
+
+rsRetVal strmUringInit(void) {
+    int r;
+    DEFiRet;
+
+    pthread_mutex_lock(&engine.mutLife);
+    if (engine.bRunning) {
+        FINALIZE;
+    }
+    if (engine.bFailed) {
+        ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+    }
+    if ((r = io_uring_queue_init(STRMURING_ENTRIES, &engine.ring, 0)) < 0) {
+        engine.bFailed = 1;
+        LogMsg(-r, RS_RET_NOT_IMPLEMENTED, LOG_WARNING,
+               "io_uring not available, files are written with regular write() calls");
+        ABORT_FINALIZE(RS_RET_NOT_IMPLEMENTED);
+    }
+    if ((r = pthread_create(&engine.tid, NULL, completionThread, NULL)) != 0) {
+        io_uring_queue_exit(&engine.ring);
+        LogError(r, RS_RET_ERR, "cannot create io_uring completion thread");
+        ABORT_FINALIZE(RS_RET_ERR);
+    }
+    engine.bRunning = 1;
+    DBGPRINTF("strmuring: ring with %d entries created\n", STRMURING_ENTRIES);
+
+finalize_it:
+    pthread_mutex_unlock(&engine.mutLife);
+    RETiRet;
+}
+
+
+void strmUringExit(void) {
+    struct io_uring_sqe *sqe;
+
+    pthread_mutex_lock(&engine.mutLife);
+    if (!engine.bRunning) {
+        pthread_mutex_unlock(&engine.mutLife);
+        return;
+    }
+    pthread_mutex_lock(&engine.mut);
+    sqe = getSqe();
+    io_uring_prep_nop(sqe);
+    io_uring_sqe_set_data(sqe, NULL);
+    io_uring_submit(&engine.ring);
+    pthread_mutex_unlock(&engine.mut);
+
+    pthread_join(engine.tid, NULL);
+    io_uring_queue_exit(&engine.ring);
+    engine.bRunning = 0;
+    pthread_mutex_unlock(&engine.mutLife);
+}
+
+#else /* #ifdef HAVE_LIBURING */
+
+rsRetVal strmUringInit(void) {
+    return RS_RET_NOT_IMPLEMENTED;
+}
+
+void strmUringExit(void) {}
+
+void strmUringSubmit(strmUringReq_t __attribute__((unused)) *const pReq) {
+    assert(0); /* never called, as strmUringInit() always fails */
+}
+
+#endif /* #ifdef HAVE_LIBURING */
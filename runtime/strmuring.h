@@ -0,0 +1,90 @@
+/* Definitions for the io_uring write engine of the stream class.
+ *
+ * Copyright 2025 Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file strmuring.h
+ * @brief Process-wide io_uring instance shared by all output streams.
+ *
+ * Streams hand write and sync requests to a single ring. One completion
+ * thread reaps the results for all streams and calls back into the stream
+ * that issued the request. Follow-up requests issued from such callbacks
+ * (e.g. the sync after a write, or the next buffer of the same stream) are
+ * collected and submitted in one batch once all available completions have
+ * been processed.
+ *
+ * The engine does not order requests. Callers that need ordering (streams
+ * always do) must keep at most one request per file in flight.
+ *
+ * If rsyslog was built without liburing, or the kernel does not support
+ * io_uring, strmUringInit() fails and streams use their regular write path.
+ */
+#ifndef INCLUDED_STRMURING_H
+#define INCLUDED_STRMURING_H
+
+#include <stddef.h>
+
+/** request types */
+typedef enum {
+    STRMURING_WRITE = 0, /**< write lenBuf octets from pBuf at the current file position */
+    STRMURING_FDATASYNC = 1, /**< fdatasync() fd */
+    STRMURING_FSYNC = 2 /**< fsync() fd (used for directories) */
+} strmUringOp_t;
+
+typedef struct strmUringReq_s strmUringReq_t;
+/**
+ * @brief A single request. Owned by the caller, must stay valid until
+ * its completion callback has been called.
+ */
+struct strmUringReq_s {
+    strmUringOp_t op;
+    int fd;
+    uchar *pBuf;
+    size_t lenBuf;
+    /** called on the completion thread; res is the syscall result or -errno */
+    void (*cbDone)(strmUringReq_t *pReq, int res);
+    void *pUsr; /**< opaque data for the callback */
+    strmUringReq_t *pNext; /**< deferred list link, owned by the engine */
+};
+
+/**
+ * @brief Make sure the shared ring exists, creating it on first use.
+ * The ring is kept until strmUringExit() is called.
+ * @return RS_RET_OK, or an error if io_uring is not available
+ */
+rsRetVal strmUringInit(void);
+
+/**
+ * @brief Stop the completion thread and free the ring, if it was created.
+ * Called when the stream class exits; all requests must have completed.
+ */
+void strmUringExit(void);
+
+/**
+ * @brief Queue a request.
+ *
+ * From any thread but the completion thread, the request is submitted
+ * to the kernel immediately. From within a completion callback, it is
+ * submitted together with all other follow-ups after the current batch
+ * of completions has been processed.
+ */
+void strmUringSubmit(strmUringReq_t *pReq);
+
+#endif /* #ifndef INCLUDED_STRMURING_H */
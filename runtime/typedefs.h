@@ -109,12 +109,16 @@ typedef struct instanceConf_s instanceConf_t;
 typedef struct ratelimit_s ratelimit_t;
 typedef struct lookup_string_tab_entry_s lookup_string_tab_entry_t;
 typedef struct lookup_string_tab_s lookup_string_tab_t;
+typedef struct lookup_string_tab_hslot_s lookup_string_tab_hslot_t;
 typedef struct lookup_array_tab_s lookup_array_tab_t;
 typedef struct lookup_sparseArray_tab_s lookup_sparseArray_tab_t;
 typedef struct lookup_sparseArray_tab_entry_s lookup_sparseArray_tab_entry_t;
 typedef struct lookup_regex_tab_entry_s lookup_regex_tab_entry_t;
 typedef struct lookup_tables_s lookup_tables_t;
 typedef struct lookup_regex_tab_s lookup_regex_tab_t;
+typedef struct lookup_mapped_tab_s lookup_mapped_tab_t;
+typedef struct lookup_cidr_node_s lookup_cidr_node_t;
+typedef struct lookup_cidr_tab_s lookup_cidr_tab_t;
 typedef union lookup_key_u lookup_key_t;
 
 typedef struct lookup_s lookup_t;
@@ -133,6 +137,9 @@ typedef struct dynstats_bucket_s dynstats_bucket_t;
 typedef struct dynstats_buckets_s dynstats_buckets_t;
 typedef struct perctile_buckets_s perctile_buckets_t;
 typedef struct dynstats_ctr_s dynstats_ctr_t;
+typedef struct dynstats_tlsctr_s dynstats_tlsctr_t;
+typedef struct dynstats_tls_s dynstats_tls_t;
+typedef struct dynstats_tlsroot_s dynstats_tlsroot_t;
 
 /* under Solaris (actually only SPARC), we need to redefine some types
  * to be void, so that we get void* pointers. Otherwise, we will see
@@ -237,6 +237,7 @@ ENDobjDestruct(wti)
 BEGINobjConstruct(wti) /* be sure to specify the object type also in END macro! */
     INIT_ATOMIC_HELPER_MUT(pThis->mutIsRunning);
     pthread_cond_init(&pThis->pcondBusy, NULL);
+    pThis->iQueueShard = -1;
 ENDobjConstruct(wti)
 
 
@@ -411,6 +412,9 @@ PRAGMA_IGNORE_Wempty_body rsRetVal wtiWorker(wti_t *__restrict__ const pThis) {
         bInactivityTOOccurred = 0; /* reset for next run */
     }
 
+    if (pWtp->pfWrkrExit != NULL) {
+        pWtp->pfWrkrExit(pWtp->pUsr, pThis);
+    }
     d_pthread_mutex_unlock(pWtp->pmutUsr);
 
     DBGPRINTF("DDDD: wti %p: worker cleanup action instances\n", pThis);
@@ -71,6 +71,8 @@ struct wti_s {
         pthread_t thrdID; /* thread ID */
         int bIsRunning; /* is this thread currently running? (must be int for atomic op!) */
         sbool bAlwaysRunning; /* should this thread always run? */
+        sbool bAnnouncedIdle; /* counted in the ringbuffer queue's idle worker count? */
+        int iQueueShard; /* home shard in sharded ringbuffer queues, -1 if not yet assigned */
         int *pbShutdownImmediate; /* end processing of this batch immediately if set to 1 */
         wtp_t *pWtp; /* my worker thread pool (important if only the work thread instance is passed! */
         batch_t batch; /* pointer to an object array meaningful for current user
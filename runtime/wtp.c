@@ -571,6 +571,7 @@ DEFpropSetMethFP(wtp, pfRateLimiter, rsRetVal (*pVal)(void *));
 DEFpropSetMethFP(wtp, pfGetDeqBatchSize, rsRetVal (*pVal)(void *, int *));
 DEFpropSetMethFP(wtp, pfDoWork, rsRetVal (*pVal)(void *, void *));
 DEFpropSetMethFP(wtp, pfObjProcessed, rsRetVal (*pVal)(void *, wti_t *));
+DEFpropSetMethFP(wtp, pfWrkrExit, rsRetVal (*pVal)(void *, wti_t *));
 
 
 /* set the debug header message
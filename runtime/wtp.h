@@ -68,6 +68,7 @@ struct wtp_s {
         rsRetVal (*pfObjProcessed)(void *pUsr, wti_t *pWti); /* indicate user object is processed */
         rsRetVal (*pfRateLimiter)(void *pUsr);
         rsRetVal (*pfDoWork)(void *pUsr, void *pWti);
+        rsRetVal (*pfWrkrExit)(void *pUsr, wti_t *pWti); /* worker terminates, optional */
         /* end user objects */
         uchar *pszDbgHdr; /* header string for debug messages */
         DEF_ATOMIC_HELPER_MUT(mutCurNumWrkThrd)
@@ -99,6 +100,7 @@ PROTOTYPEpropSetMethFP(wtp, pfRateLimiter, rsRetVal (*pVal)(void *));
 PROTOTYPEpropSetMethFP(wtp, pfGetDeqBatchSize, rsRetVal (*pVal)(void *, int *));
 PROTOTYPEpropSetMethFP(wtp, pfDoWork, rsRetVal (*pVal)(void *, void *));
 PROTOTYPEpropSetMethFP(wtp, pfObjProcessed, rsRetVal (*pVal)(void *, wti_t *));
+PROTOTYPEpropSetMethFP(wtp, pfWrkrExit, rsRetVal (*pVal)(void *, wti_t *));
 PROTOTYPEpropSetMeth(wtp, toWrkShutdown, long);
 PROTOTYPEpropSetMeth(wtp, wtpState, wtpState_t);
 PROTOTYPEpropSetMeth(wtp, iMaxWorkerThreads, int);
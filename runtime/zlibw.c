@@ -22,6 +22,7 @@
  */
 
 #include "config.h"
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <zlib.h>
@@ -163,6 +164,68 @@ finalize_it:
     }
     RETiRet;
 }
+/* per-thread context for block compression */
+typedef struct {
+    z_stream zstrm;
+    int level;
+} zlibwBlockCtx_t;
+
+static void freeBlockCtx(void *const pCtx) {
+    zlibwBlockCtx_t *const pBlkCtx = (zlibwBlockCtx_t *)pCtx;
+    deflateEnd(&pBlkCtx->zstrm);
+    free(pBlkCtx);
+}
+
+/* upper bound of the size of a gzip member created from lenIn octets */
+static size_t compressBlockBound(const size_t lenIn) {
+    return compressBound(lenIn) + 18; /* gzip header and trailer instead of zlib's */
+}
+
+/* compress a block into a complete, self-contained gzip member. Members can
+ * simply be concatenated, so blocks can be compressed independently and in
+ * parallel. *ppCtx is the caller's (thread's) context, created on first use
+ * and reused afterwards. On entry, *pLenOut is the size of pOut, which must
+ * be at least compressBlockBound(lenIn).
+ */
+static rsRetVal compressBlock(
+    void **const ppCtx, const int level, uchar *const pIn, const size_t lenIn, uchar *const pOut, size_t *const pLenOut) {
+    zlibwBlockCtx_t *pCtx = (zlibwBlockCtx_t *)*ppCtx;
+    int zRet; /* zlib return state */
+    DEFiRet;
+
+    if (pCtx != NULL && pCtx->level != level) {
+        freeBlockCtx(pCtx);
+        *ppCtx = pCtx = NULL;
+    }
+    if (pCtx == NULL) {
+        CHKmalloc(pCtx = calloc(1, sizeof(zlibwBlockCtx_t)));
+        zRet = deflateInit2(&pCtx->zstrm, level, Z_DEFLATED, 31, 9, Z_DEFAULT_STRATEGY);
+        if (zRet != Z_OK) {
+            free(pCtx);
+            LogError(0, RS_RET_ZLIB_ERR, "error %d returned from zlib/deflateInit2()", zRet);
+            ABORT_FINALIZE(RS_RET_ZLIB_ERR);
+        }
+        pCtx->level = level;
+        *ppCtx = pCtx;
+    } else {
+        deflateReset(&pCtx->zstrm);
+    }
+
+    pCtx->zstrm.next_in = (Bytef *)pIn;
+    pCtx->zstrm.avail_in = lenIn;
+    pCtx->zstrm.next_out = (Bytef *)pOut;
+    pCtx->zstrm.avail_out = *pLenOut;
+    zRet = deflate(&pCtx->zstrm, Z_FINISH);
+    if (zRet != Z_STREAM_END) {
+        LogError(0, RS_RET_ZLIB_ERR, "error %d returned from zlib/Deflate()", zRet);
+        ABORT_FINALIZE(RS_RET_ZLIB_ERR);
+    }
+    *pLenOut -= pCtx->zstrm.avail_out;
+
+finalize_it:
+    RETiRet;
+}
+
 /* destruction of caller's zlib ressources - a dummy for us */
 static rsRetVal zlib_Destruct(ATTR_UNUSED strm_t *pThis) {
     return RS_RET_OK;
@@ -189,6 +252,9 @@ BEGINobjQueryInterface(zlibw)
     pIf->doStrmWrite = doStrmWrite;
     pIf->doCompressFinish = doCompressFinish;
     pIf->Destruct = zlib_Destruct;
+    pIf->CompressBlock = compressBlock;
+    pIf->CompressBlockBound = compressBlockBound;
+    pIf->FreeBlockCtx = freeBlockCtx;
 finalize_it:
 ENDobjQueryInterface(zlibw)
 
@@ -37,8 +37,12 @@ BEGINinterface(zlibw) /* name must also be changed in ENDinterface macro! */
                             rsRetVal (*strmPhysWrite)(strm_t *pThis, uchar *pBuf, size_t lenBuf));
     rsRetVal (*doCompressFinish)(strm_t *pThis, rsRetVal (*Destruct)(strm_t *pThis, uchar *pBuf, size_t lenBuf));
     rsRetVal (*Destruct)(strm_t *pThis);
+    /* v3 added 2025-07-26: one-shot compression of independent blocks */
+    rsRetVal (*CompressBlock)(void **ppCtx, int level, uchar *pIn, size_t lenIn, uchar *pOut, size_t *pLenOut);
+    size_t (*CompressBlockBound)(size_t lenIn);
+    void (*FreeBlockCtx)(void *pCtx);
 ENDinterface(zlibw)
-#define zlibwCURR_IF_VERSION 2 /* increment whenever you change the interface structure! */
+#define zlibwCURR_IF_VERSION 3 /* increment whenever you change the interface structure! */
 
 
 /* prototypes */
@@ -124,6 +124,49 @@ finalize_it:
     RETiRet;
 }
 
+static void zstd_FreeBlockCtx(void *const pCtx) {
+    ZSTD_freeCCtx((ZSTD_CCtx *)pCtx);
+}
+
+static size_t zstd_CompressBlockBound(const size_t lenIn) {
+    return ZSTD_compressBound(lenIn);
+}
+
+/* compress a block into a complete, self-contained zstd frame. Frames can
+ * simply be concatenated, so blocks can be compressed independently and in
+ * parallel. *ppCtx is the caller's (thread's) context, created on first use
+ * and reused afterwards. On entry, *pLenOut is the size of pOut, which must
+ * be at least zstd_CompressBlockBound(lenIn).
+ */
+static rsRetVal zstd_CompressBlock(
+    void **const ppCtx, const int level, uchar *const pIn, const size_t lenIn, uchar *const pOut, size_t *const pLenOut) {
+    ZSTD_CCtx *cctx = (ZSTD_CCtx *)*ppCtx;
+    DEFiRet;
+
+    if (cctx == NULL) {
+        if ((cctx = ZSTD_createCCtx()) == NULL) {
+            LogError(0, RS_RET_ZLIB_ERR,
+                     "error creating zstd context (ZSTD_createCCtx failed, "
+                     "that's all we know");
+            ABORT_FINALIZE(RS_RET_ZLIB_ERR);
+        }
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1);
+        *ppCtx = cctx;
+    }
+    /* the context is shared by all streams, which may use different levels */
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+
+    const size_t result = ZSTD_compress2(cctx, pOut, *pLenOut, pIn, lenIn);
+    if (ZSTD_isError(result)) {
+        LogError(0, RS_RET_ZLIB_ERR, "error returned from ZSTD_compress2(): %s", ZSTD_getErrorName(result));
+        ABORT_FINALIZE(RS_RET_ZLIB_ERR);
+    }
+    *pLenOut = result;
+
+finalize_it:
+    RETiRet;
+}
+
 /* destruction of caller's zstd ressources */
 static rsRetVal zstd_Destruct(strm_t *const pThis) {
     DEFiRet;
@@ -153,6 +196,9 @@ BEGINobjQueryInterface(zstdw)
     pIf->doStrmWrite = zstd_doStrmWrite;
     pIf->doCompressFinish = zstd_doCompressFinish;
     pIf->Destruct = zstd_Destruct;
+    pIf->CompressBlock = zstd_CompressBlock;
+    pIf->CompressBlockBound = zstd_CompressBlockBound;
+    pIf->FreeBlockCtx = zstd_FreeBlockCtx;
 finalize_it:
 ENDobjQueryInterface(zstdw)
 
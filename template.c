@@ -117,6 +117,194 @@ finalize_it:
 }
 
 
+/* Compiled templates
+ *
+ * When a template is defined, its entry list is translated into a flat
+ * array of operations (see tplCompile()). Adjacent constants are merged
+ * into a single copy, properties that need no complex processing are read
+ * via direct accessors instead of MsgGetProp()'s property switch, and
+ * escaping (the template's sql/stdsql/json options as well as a property's
+ * format="json") is done while copying into the output buffer instead of
+ * via a temporary copy. Output is the same as with the entry list.
+ */
+enum tplOpType {
+    TPLOP_CONSTANT = 0, /* copy constant text */
+    TPLOP_GETTER = 1, /* property via direct accessor */
+    TPLOP_GETTER_JSON = 2, /* property via direct accessor, JSON encoded (format="json") */
+    TPLOP_PROP = 3 /* property via MsgGetProp() */
+};
+
+struct tplOp {
+    enum tplOpType type;
+    int iLenConstant;
+    const uchar *pConstant;
+    struct templateEntry *pTpe;
+    msgPropGetter_t getter;
+};
+
+#define TPL_FIELD_SIZE_ESTIMATE 32 /* expected average size of a property value */
+
+/* copy a property value with the template's escape mode applied, see
+ * doEscape() for the rules. dst must have room for 2 * len bytes.
+ * Returns the number of bytes written.
+ */
+static size_t tplCopyEscaped(uchar *__restrict__ dst,
+                             const uchar *__restrict__ src,
+                             const size_t len,
+                             const int mode) {
+    uchar *const dstStart = dst;
+    size_t i;
+
+    for (i = 0; i < len; ++i) {
+        const uchar c = src[i];
+        if (c == '\'' && (mode == SQL_ESCAPE || mode == STDSQL_ESCAPE)) {
+            *dst++ = (mode == STDSQL_ESCAPE) ? '\'' : '\\';
+        } else if (c == '\\' && (mode == SQL_ESCAPE || mode == JSON_ESCAPE)) {
+            *dst++ = '\\';
+        } else if (c == '"' && mode == JSON_ESCAPE) {
+            *dst++ = '\\';
+        }
+        *dst++ = c;
+    }
+    return dst - dstStart;
+}
+
+/* copy a property value JSON-encoded, with the same result as the
+ * format="json" property option. dst must have room for 6 * len bytes.
+ * Returns the number of bytes written.
+ */
+static size_t tplCopyJSON(uchar *__restrict__ dst, const uchar *__restrict__ src, const size_t len) {
+    static const char hexdigit[16] = "0123456789ABCDEF";
+    uchar *const dstStart = dst;
+    size_t i;
+
+    for (i = 0; i < len; ++i) {
+        const uchar c = src[i];
+        if ((c >= 0x30 && c <= 0x5b) || (c >= 0x23 && c <= 0x2e) || c >= 0x5d || c == 0x20 || c == 0x21) {
+            *dst++ = c;
+            continue;
+        }
+        *dst++ = '\\';
+        switch (c) {
+            case '"':
+            case '/':
+            case '\\':
+                *dst++ = c;
+                break;
+            case '\010':
+                *dst++ = 'b';
+                break;
+            case '\014':
+                *dst++ = 'f';
+                break;
+            case '\n':
+                *dst++ = 'n';
+                break;
+            case '\r':
+                *dst++ = 'r';
+                break;
+            case '\t':
+                *dst++ = 't';
+                break;
+            default:
+                *dst++ = 'u';
+                *dst++ = '0';
+                *dst++ = '0';
+                *dst++ = hexdigit[c >> 4];
+                *dst++ = hexdigit[c & 0x0f];
+                break;
+        }
+    }
+    return dst - dstStart;
+}
+
+/* tplToString() for compiled templates */
+static rsRetVal tplToStringCompiled(struct template *__restrict__ const pTpl,
+                                    smsg_t *__restrict__ const pMsg,
+                                    actWrkrIParams_t *__restrict__ const iparam,
+                                    struct syslogTime *const ttNow) {
+    const struct tplOp *op;
+    const struct tplOp *const opEnd = pTpl->ops + pTpl->nOps;
+    const int bJSONF = (pTpl->optFormatEscape == JSONF);
+    const int escapeMode = bJSONF ? NO_ESCAPE : pTpl->optFormatEscape;
+    unsigned short bMustBeFreed = 0;
+    uchar *pVal = NULL;
+    rs_size_t iLenVal;
+    size_t iBuf = 0;
+    size_t maxLen;
+    int need_comma = 0;
+    DEFiRet;
+
+    if (iparam->lenBuf < pTpl->lenEstimate) CHKiRet(ExtendBuf(iparam, pTpl->lenEstimate));
+    if (bJSONF) {
+        if (iparam->lenBuf < 2) CHKiRet(ExtendBuf(iparam, 2));
+        iparam->param[iBuf++] = '{';
+    }
+
+    for (op = pTpl->ops; op < opEnd; ++op) {
+        switch (op->type) {
+            case TPLOP_CONSTANT:
+                pVal = (uchar *)op->pConstant;
+                iLenVal = op->iLenConstant;
+                break;
+            case TPLOP_GETTER:
+            case TPLOP_GETTER_JSON:
+                pVal = op->getter(pMsg, op->pTpe, &iLenVal);
+                break;
+            case TPLOP_PROP:
+            default:
+                pVal = MsgGetProp(pMsg, op->pTpe, &op->pTpe->data.field.msgProp, &iLenVal, &bMustBeFreed, ttNow);
+                break;
+        }
+
+        if (iLenVal > 0) {
+            /* worst case size of the value once escaped; the extra bytes are
+             * for ", " and "}\n" in jsonf mode and the final \0.
+             */
+            if (op->type == TPLOP_GETTER_JSON)
+                maxLen = 6 * (size_t)iLenVal;
+            else if (op->type != TPLOP_CONSTANT && escapeMode != NO_ESCAPE)
+                maxLen = 2 * (size_t)iLenVal;
+            else
+                maxLen = iLenVal;
+            if (iBuf + maxLen + 5 > iparam->lenBuf) CHKiRet(ExtendBuf(iparam, iBuf + maxLen + 5));
+
+            if (need_comma) {
+                memcpy(iparam->param + iBuf, ", ", 2);
+                iBuf += 2;
+            }
+            if (op->type == TPLOP_GETTER_JSON) {
+                iBuf += tplCopyJSON(iparam->param + iBuf, pVal, iLenVal);
+            } else if (op->type != TPLOP_CONSTANT && escapeMode != NO_ESCAPE) {
+                iBuf += tplCopyEscaped(iparam->param + iBuf, pVal, iLenVal, escapeMode);
+            } else {
+                memcpy(iparam->param + iBuf, pVal, iLenVal);
+                iBuf += iLenVal;
+            }
+            if (bJSONF) need_comma = 1;
+        }
+
+        if (bMustBeFreed) {
+            free(pVal);
+            bMustBeFreed = 0;
+        }
+    }
+
+    if (bJSONF && pTpl->nOps > 0) {
+        if (iBuf + 3 > iparam->lenBuf) CHKiRet(ExtendBuf(iparam, iBuf + 3));
+        memcpy(iparam->param + iBuf, "}\n", 2);
+        iBuf += 2;
+    }
+    if (iBuf == iparam->lenBuf) CHKiRet(ExtendBuf(iparam, iBuf + 1));
+    iparam->param[iBuf] = '\0';
+    iparam->lenStr = iBuf;
+
+finalize_it:
+    if (bMustBeFreed) free(pVal);
+    RETiRet;
+}
+
+
 /* This functions converts a template into a string.
  *
  * The function takes a pointer to a template and a pointer to a msg object
@@ -158,6 +346,10 @@ rsRetVal tplToString(struct template *__restrict__ const pTpl,
     }
 
     /* we have a "regular" template with template entries */
+    if (pTpl->ops != NULL && (runConf == NULL || runConf->globals.bTplCompile)) {
+        iRet = tplToStringCompiled(pTpl, pMsg, iparam, ttNow);
+        FINALIZE;
+    }
 
     /* loop through the template. We obtain one value
      * and copy it over to our dynamic string buffer. Then, we
@@ -479,6 +671,95 @@ static void apply_case_sensitivity(struct template *pTpl) {
 }
 
 
+/* check if format="json" is the only complex processing option of a
+ * property, in which case the JSON encoding can be fused into the copy.
+ */
+static int tpeIsPlainJSON(const struct templateEntry *const pTpe) {
+    if (!pTpe->data.field.options.bJSON) return 0;
+#ifdef FEATURE_REGEXP
+    if (pTpe->data.field.has_regex) return 0;
+#endif
+    return pTpe->data.field.has_fields == 0 && pTpe->data.field.iFromPos == 0 && pTpe->data.field.iToPos == 0 &&
+           pTpe->data.field.eCaseConv == tplCaseConvNo && !pTpe->data.field.options.bSPIffNo1stSP &&
+           !pTpe->data.field.options.bDropCC && !pTpe->data.field.options.bSpaceCC &&
+           !pTpe->data.field.options.bEscapeCC && !pTpe->data.field.options.bSecPathDrop &&
+           !pTpe->data.field.options.bSecPathReplace && !pTpe->data.field.options.bDropLastLF &&
+           !pTpe->data.field.options.bCompressSP && !pTpe->data.field.options.bCSV &&
+           !pTpe->data.field.options.bFixedWidth;
+}
+
+
+/* Compile the entry list of a template into its op array, see
+ * tplToStringCompiled(). If this fails (only possible if we run out of
+ * memory), the template keeps working via the entry list.
+ */
+static void tplCompile(struct template *const pTpl) {
+    struct templateEntry *pTpe;
+    struct tplOp *ops = NULL;
+    struct tplOp *op = NULL;
+    uchar *pConstants = NULL;
+    size_t lenConstants = 0;
+    size_t iConst = 0;
+    int nEntries = 0;
+    int nFields = 0;
+    int nOps = 0;
+    msgPropGetter_t getter;
+    const int bJSONF = (pTpl->optFormatEscape == JSONF);
+
+    if (pTpl->pStrgen != NULL || pTpl->bHaveSubtree) return;
+
+    for (pTpe = pTpl->pEntryRoot; pTpe != NULL; pTpe = pTpe->pNext) {
+        if (pTpe->eEntryType == CONSTANT)
+            lenConstants += pTpe->data.constant.iLenConstant;
+        else if (pTpe->eEntryType != FIELD)
+            return; /* let the interpreter report it */
+        ++nEntries;
+    }
+    if (nEntries == 0) return;
+    if ((ops = calloc(nEntries, sizeof(struct tplOp))) == NULL ||
+        (lenConstants > 0 && (pConstants = malloc(lenConstants)) == NULL)) {
+        DBGPRINTF("template '%s': out of memory, template is not compiled\n", pTpl->pszName);
+        free(ops);
+        return;
+    }
+
+    for (pTpe = pTpl->pEntryRoot; pTpe != NULL; pTpe = pTpe->pNext) {
+        if (pTpe->eEntryType == CONSTANT) {
+            /* in jsonf mode, each entry is a list element of its own */
+            if (op == NULL || op->type != TPLOP_CONSTANT || bJSONF) {
+                op = &ops[nOps++];
+                op->type = TPLOP_CONSTANT;
+                op->pConstant = pConstants + iConst;
+            }
+            memcpy(pConstants + iConst, pTpe->data.constant.pConstant, pTpe->data.constant.iLenConstant);
+            iConst += pTpe->data.constant.iLenConstant;
+            op->iLenConstant += pTpe->data.constant.iLenConstant;
+        } else if (pTpe->eEntryType == FIELD) {
+            op = &ops[nOps++];
+            op->pTpe = pTpe;
+            op->type = TPLOP_PROP;
+            getter = MsgGetPropGetter(pTpe);
+            if (getter != NULL) {
+                if (!pTpe->bComplexProcessing) {
+                    op->type = TPLOP_GETTER;
+                    op->getter = getter;
+                } else if (tpeIsPlainJSON(pTpe) && (bJSONF || pTpl->optFormatEscape == NO_ESCAPE)) {
+                    op->type = TPLOP_GETTER_JSON;
+                    op->getter = getter;
+                }
+            }
+            ++nFields;
+        }
+    }
+
+    pTpl->ops = ops;
+    pTpl->nOps = nOps;
+    pTpl->opConstants = pConstants;
+    pTpl->lenEstimate = lenConstants + nFields * TPL_FIELD_SIZE_ESTIMATE + 4;
+    DBGPRINTF("template '%s' compiled: %d entries, %d ops\n", pTpl->pszName, nEntries, nOps);
+}
+
+
 /* Constructs a template list object. Returns pointer to it
  * or NULL (if it fails).
  */
@@ -1312,6 +1593,7 @@ struct template *tplAddLine(rsconf_t *conf, const char *pName, uchar **ppRestOfC
 
     *ppRestOfConfLine = p;
     apply_case_sensitivity(pTpl);
+    tplCompile(pTpl);
 
     return (pTpl);
 }
@@ -2071,6 +2353,7 @@ rsRetVal ATTR_NONNULL() tplProcessCnf(struct cnfobj *o) {
 
     if (o_casesensitive) pTpl->optCaseSensitive = 1;
     apply_case_sensitivity(pTpl);
+    tplCompile(pTpl);
 finalize_it:
     free(tplStr);
     free(plugin);
@@ -2153,6 +2436,8 @@ void tplDeleteAll(rsconf_t *conf) {
         pTpl = pTpl->pNext;
         free(pTplDel->pszName);
         if (pTplDel->bHaveSubtree) msgPropDescrDestruct(&pTplDel->subtree);
+        free(pTplDel->ops);
+        free(pTplDel->opConstants);
         free(pTplDel);
     }
 }
@@ -2203,6 +2488,8 @@ void tplDeleteNew(rsconf_t *conf) {
         pTpl = pTpl->pNext;
         free(pTplDel->pszName);
         if (pTplDel->bHaveSubtree) msgPropDescrDestruct(&pTplDel->subtree);
+        free(pTplDel->ops);
+        free(pTplDel->opConstants);
         free(pTplDel);
     }
 }
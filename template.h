@@ -56,6 +56,14 @@ struct template {
      * than short...
      */
     char optCaseSensitive; /* case-sensitive variable property references, default False, 0 */
+    /* compiled form of the entry list, built when the template is defined.
+     * NULL for strgen and subtree templates or if compilation failed, in which
+     * case the entry list is interpreted.
+     */
+    struct tplOp *ops;
+    int nOps;
+    uchar *opConstants; /* merged constant text referenced by ops */
+    size_t lenEstimate; /* expected output size, the buffer is sized to it up front */
 };
 
 enum EntryTypes { UNDEFINED = 0, CONSTANT = 1, FIELD = 2 };
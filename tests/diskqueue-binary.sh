@@ -0,0 +1,29 @@
+#!/bin/bash
+# Test for disk-only queue mode with the binary spool format. Message
+# variables and a ruleset are set so that the optional record fields are
+# written and read back as well.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export NUMMESSAGES=20000
+export QUEUE_EMPTY_CHECK_FUNC=wait_file_lines
+generate_conf
+add_conf '
+global(workDirectory="'$RSYSLOG_DYNNAME'.spool")
+
+template(name="outfmt" type="string" string="%$!seq%\n")
+
+ruleset(name="rs" queue.type="disk" queue.filename="rsq" queue.spoolFormat="binary") {
+	action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+}
+
+if $msg contains "msgnum:" then {
+	set $!seq = field($msg, 58, 2);
+	call rs
+}
+'
+startup
+injectmsg
+shutdown_when_empty
+wait_shutdown
+seq_check
+exit_test
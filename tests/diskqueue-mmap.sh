@@ -0,0 +1,26 @@
+#!/bin/bash
+# Test for disk-only queue mode with queue files read via mmap(). A small
+# maxFileSize makes sure the reader has to switch segments many times.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export NUMMESSAGES=20000
+export QUEUE_EMPTY_CHECK_FUNC=wait_file_lines
+generate_conf
+add_conf '
+global(workDirectory="'$RSYSLOG_DYNNAME'.spool")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+
+ruleset(name="rs" queue.type="disk" queue.filename="mmq" queue.mmap="on"
+	queue.maxFileSize="64k") {
+	action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+}
+
+if $msg contains "msgnum:" then call rs
+'
+startup
+injectmsg
+shutdown_when_empty
+wait_shutdown
+seq_check
+exit_test
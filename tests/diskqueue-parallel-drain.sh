@@ -0,0 +1,27 @@
+#!/bin/bash
+# Test for parallel drain of a disk queue. A small maxFileSize creates many
+# completed queue files, which are then read concurrently by the workers.
+# Message order is not preserved, which seq_check does not care about.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export NUMMESSAGES=40000
+export QUEUE_EMPTY_CHECK_FUNC=wait_file_lines
+generate_conf
+add_conf '
+global(workDirectory="'$RSYSLOG_DYNNAME'.spool")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+
+ruleset(name="rs" queue.type="disk" queue.filename="pdq" queue.parallelDrain="on"
+	queue.maxFileSize="32k" queue.workerThreads="4" queue.workerThreadMinimumMessages="1000") {
+	action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+}
+
+if $msg contains "msgnum:" then call rs
+'
+startup
+injectmsg
+shutdown_when_empty
+wait_shutdown
+seq_check
+exit_test
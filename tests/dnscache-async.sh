@@ -0,0 +1,99 @@
+#!/bin/bash
+# check reverse lookups via the async resolver pool with slow and failing
+# DNS. Reverse lookups are answered by a preloaded fake getnameinfo(),
+# which maps a.b.c.d to host-a-b-c-d.example after a delay and fails while
+# a flag file exists. Messages are sent from 8 addresses in 4 rounds:
+# 1. lookups fail: the messages carry the IP (lookups are still pending)
+# 2. the failed lookups are cached: the messages carry the IP
+# 3. DNS works again, the negative entries expired: the messages carry
+#    the IP, as the new lookups are pending
+# 4. the messages carry the host name
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+skip_platform "FreeBSD" "binding to arbitrary 127.0.0.0/8 addresses is not supported"
+skip_platform "Darwin" "binding to arbitrary 127.0.0.0/8 addresses is not supported"
+skip_platform "SunOS" "binding to arbitrary 127.0.0.0/8 addresses is not supported"
+export NUMMESSAGES=32
+export PORT_RCVR="$(get_free_port)"
+export RSYSLOG_PRELOAD=.libs/liboverride_getnameinfo.so
+export OVERRIDE_GETNAMEINFO_DELAY=200
+export OVERRIDE_GETNAMEINFO_FAILFILE=$RSYSLOG_DYNNAME.dnsfail
+generate_conf
+add_conf '
+global(preserveFQDN="on"
+       reverselookup.async.resolvers="2"
+       reverselookup.cache.ttl.enable="on"
+       reverselookup.cache.ttl.default="3600"
+       reverselookup.cache.ttl.negative="3")
+module(load="../plugins/impstats/.libs/impstats" log.file="'$RSYSLOG_DYNNAME'.out.stats.log"
+       interval="1" format="legacy" resetCounters="off")
+module(load="../plugins/imudp/.libs/imudp")
+input(type="imudp" address="127.0.0.1" port="'$PORT_RCVR'")
+
+template(name="outfmt" type="string" string="%fromhost-ip% %fromhost% %msg:F,58:2%\n")
+if $msg contains "msgnum:" then
+	action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+'
+# $1: round, messages are numbered from $1 * 8
+send_round() {
+	$PYTHON -c '
+import socket, sys
+rnd = int(sys.argv[2])
+for i in range(1, 9):
+    s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    s.bind(("127.0.0.%d" % i, 0))
+    s.sendto(b"<13>Oct 16 10:00:00 host tag: msgnum:%8.8d:" % (rnd * 8 + i - 1), ("127.0.0.1", int(sys.argv[1])))
+    s.close()
+' $PORT_RCVR $1 || error_exit 1
+	wait_file_lines $RSYSLOG_OUT_LOG $((($1 + 1) * 8))
+}
+
+# $1: counter name, prints its last value reported by impstats
+get_counter() {
+	grep "origin=core.dnscache" $RSYSLOG_DYNNAME.out.stats.log | tail -1 | sed -e "s/.* $1=\([0-9]*\).*/\1/"
+}
+
+# $1: counter name, $2: value to wait for
+wait_counter() {
+	for ((i = 0; i < 100; ++i)); do
+		if [ "$(get_counter $1)" == "$2" ]; then
+			return
+		fi
+		$TESTTOOL_DIR/msleep 100
+	done
+	echo "FAIL: dnscache counter $1 is '$(get_counter $1)', expected $2"
+	grep "origin=core.dnscache" $RSYSLOG_DYNNAME.out.stats.log
+	error_exit 1
+}
+
+touch $OVERRIDE_GETNAMEINFO_FAILFILE
+startup
+send_round 0
+wait_counter failed 8
+send_round 1
+rm $OVERRIDE_GETNAMEINFO_FAILFILE
+sleep 4 # let the negative entries expire
+send_round 2
+wait_counter resolved 8
+send_round 3
+wait_for_stats_flush $RSYSLOG_DYNNAME.out.stats.log
+shutdown_when_empty
+wait_shutdown
+
+if ! awk '{ ip = $1; gsub(/\./, "-", ip); num = $3 + 0
+	if (num < 24 ? $2 != $1 : $2 != "host-" ip ".example") { print "wrong name: " $0; bad = 1 } }
+	END { exit bad }' < $RSYSLOG_OUT_LOG; then
+	cat $RSYSLOG_OUT_LOG
+	error_exit 1
+fi
+awk '{ print $3 }' < $RSYSLOG_OUT_LOG > $RSYSLOG_DYNNAME.seq
+export SEQ_CHECK_FILE=$RSYSLOG_DYNNAME.seq
+seq_check
+for ctr in async.queued:16 failed:8 resolved:8 expired:8 async.queuefull:0; do
+	if [ "$(get_counter ${ctr%:*})" != "${ctr#*:}" ]; then
+		echo "FAIL: dnscache counter ${ctr%:*} is '$(get_counter ${ctr%:*})', expected ${ctr#*:}"
+		grep "origin=core.dnscache" $RSYSLOG_DYNNAME.out.stats.log
+		error_exit 1
+	fi
+done
+exit_test
@@ -0,0 +1,56 @@
+#!/bin/bash
+# a size-limited DNS cache must evict entries and still return the name
+# of the right address. Messages from 64 different source addresses are
+# sent twice into a cache of 16 entries. Reverse lookups are answered by
+# a preloaded fake getnameinfo(), which maps a.b.c.d to host-a-b-c-d.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+skip_platform "FreeBSD" "binding to arbitrary 127.0.0.0/8 addresses is not supported"
+skip_platform "Darwin" "binding to arbitrary 127.0.0.0/8 addresses is not supported"
+skip_platform "SunOS" "binding to arbitrary 127.0.0.0/8 addresses is not supported"
+export NUMMESSAGES=128
+export PORT_RCVR="$(get_free_port)"
+export RSYSLOG_PRELOAD=.libs/liboverride_getnameinfo.so
+generate_conf
+add_conf '
+global(reverselookup.cache.maxsize="16")
+module(load="../plugins/impstats/.libs/impstats" log.file="'$RSYSLOG_DYNNAME'.out.stats.log"
+       interval="1" format="legacy" resetCounters="off")
+module(load="../plugins/imudp/.libs/imudp")
+input(type="imudp" address="127.0.0.1" port="'$PORT_RCVR'")
+
+template(name="outfmt" type="string" string="%fromhost-ip% %fromhost:F,46:1% %msg:F,58:2%\n")
+if $msg contains "msgnum:" then
+	action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+'
+startup
+$PYTHON -c '
+import socket, sys
+n = 0
+for rnd in range(2):
+    for i in range(1, 65):
+        s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        s.bind(("127.0.0.%d" % i, 0))
+        s.sendto(b"<13>Oct 16 10:00:00 host tag: msgnum:%8.8d:" % n, ("127.0.0.1", int(sys.argv[1])))
+        s.close()
+        n += 1
+' $PORT_RCVR || error_exit 1
+wait_file_lines
+wait_for_stats_flush $RSYSLOG_DYNNAME.out.stats.log
+shutdown_when_empty
+wait_shutdown
+
+if ! awk '{ ip = $1; gsub(/\./, "-", ip); if ($2 != "host-" ip) { print "wrong name: " $0; bad = 1 } } END { exit bad }' \
+	< $RSYSLOG_OUT_LOG; then
+	error_exit 1
+fi
+awk '{ print $3 }' < $RSYSLOG_OUT_LOG > $RSYSLOG_DYNNAME.seq
+export SEQ_CHECK_FILE=$RSYSLOG_DYNNAME.seq
+seq_check
+evicted=$(grep "origin=core.dnscache" $RSYSLOG_DYNNAME.out.stats.log | tail -1 | sed -e 's/.* evicted=\([0-9]*\).*/\1/')
+if [ -z "$evicted" ] || [ "$evicted" -eq 0 ]; then
+	echo "FAIL: no DNS cache entries were evicted"
+	grep "origin=core.dnscache" $RSYSLOG_DYNNAME.out.stats.log
+	error_exit 1
+fi
+exit_test
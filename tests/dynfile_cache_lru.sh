@@ -0,0 +1,32 @@
+#!/bin/bash
+# check that the dynafile cache evicts the least recently used file:
+# with a cache size of 2, the file sequence a b a c a b must evict b
+# (when c is opened) and then c (when b is reopened). So there are
+# exactly 4 misses and 2 evictions; evicting a instead of b would
+# result in an additional miss.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+generate_conf
+add_conf '
+module(load="../plugins/impstats/.libs/impstats" log.file="'$RSYSLOG_DYNNAME'.out.stats.log"
+       interval="1" format="legacy" resetCounters="off")
+
+template(name="outfmt" type="string" string="%msg:F,58:3%\n")
+template(name="dynfile" type="string" string="%msg:F,58:2%.log")
+if $msg contains "msgnum:" then
+	action(type="omfile" dynafile="dynfile" template="outfmt" dynaFileCacheSize="2")
+'
+startup
+i=0
+for f in a b a c a b; do
+	injectmsg_literal "<129>Mar 10 01:00:00 172.20.245.8 tag msgnum:$RSYSLOG_DYNNAME.out.$f:$(printf '%8.8d' $i)"
+	i=$((i + 1))
+done
+wait_queueempty
+wait_for_stats_flush $RSYSLOG_DYNNAME.out.stats.log
+shutdown_when_empty
+wait_shutdown
+cat $RSYSLOG_DYNNAME.out.[abc].log | sort > $RSYSLOG_OUT_LOG
+seq_check 0 5
+custom_content_check 'dynafile cache dynfile: origin=omfile requests=6 level0=0 missed=4 evicted=2' $RSYSLOG_DYNNAME.out.stats.log
+exit_test
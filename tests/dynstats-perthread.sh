@@ -0,0 +1,52 @@
+#!/bin/bash
+# dynstats counters are counted in per-thread caches. With several queue
+# workers that terminate on inactivity between rounds of messages, the
+# caches are merged both on stats reads and on thread exit. The reported
+# values must be exact.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export NUMMESSAGES=14000
+ROUNDSIZE=7000
+generate_conf
+add_conf '
+main_queue(queue.workerThreads="4" queue.workerThreadMinimumMessages="100"
+           queue.dequeueBatchSize="16" queue.timeoutWorkerThreadShutdown="300")
+module(load="../plugins/impstats/.libs/impstats" log.file="'$RSYSLOG_DYNNAME'.out.stats.log"
+       interval="1" format="legacy" resetCounters="off")
+
+dyn_stats(name="msg_stats" resettable="off")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+if $msg contains "msgnum:" then {
+	set $.key = "k" & cnum(field($msg, 58, 2)) % 7;
+	set $.r = dyn_inc("msg_stats", $.key);
+	action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+}
+'
+# $1: expected value of each of the 7 keys
+check_counters() {
+	wait_for_stats_flush $RSYSLOG_DYNNAME.out.stats.log
+	line=$(grep "origin=dynstats.bucket" $RSYSLOG_DYNNAME.out.stats.log | tail -1)
+	for ((k = 0; k < 7; ++k)); do
+		val=$(sed -e "s/.* k$k=\([0-9]*\).*/\1/" <<< "$line")
+		if [ "$val" != "$1" ]; then
+			echo "FAIL: counter k$k is '$val', expected $1: $line"
+			error_exit 1
+		fi
+	done
+}
+
+startup
+injectmsg 0 $ROUNDSIZE
+wait_file_lines $RSYSLOG_OUT_LOG $ROUNDSIZE
+check_counters $((ROUNDSIZE / 7))
+# let the workers terminate, so that their caches are merged on thread exit
+sleep 2
+injectmsg $ROUNDSIZE $ROUNDSIZE
+wait_file_lines $RSYSLOG_OUT_LOG $NUMMESSAGES
+sleep 2
+check_counters $((NUMMESSAGES / 7))
+shutdown_when_empty
+wait_shutdown
+seq_check
+exit_test
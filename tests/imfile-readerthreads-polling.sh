@@ -0,0 +1,4 @@
+#!/bin/bash
+# This is part of the rsyslog testbench, licensed under ASL 2.0
+export IMFILE_MODE="polling"
+source ${srcdir:-.}/imfile-readerthreads.sh
@@ -0,0 +1,65 @@
+#!/bin/bash
+# imfile with a reader thread pool: several files are read in parallel,
+# but each file must still be read completely and in order. The first
+# file is rotated while it is being read.
+# IMFILE_MODE selects the imfile mode, default is inotify.
+# This is part of the rsyslog testbench, licensed under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export IMFILE_MODE=${IMFILE_MODE:-inotify}
+if [ "$IMFILE_MODE" == "inotify" ]; then
+	. $srcdir/diag.sh check-inotify-only
+fi
+export NUMFILES=4
+export NUMMESSAGES=20000 # per file
+export NUMROTATED=200000 # initial content of the first file, large so the rotation hits a busy reader
+
+mkdir $RSYSLOG_DYNNAME.work
+generate_conf
+add_conf '
+global(workDirectory="./'$RSYSLOG_DYNNAME'.work")
+module(load="../plugins/imfile/.libs/imfile" mode="'$IMFILE_MODE'" pollingInterval="1" readerThreads="3")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+template(name="dynfile" type="string" string="'$RSYSLOG_DYNNAME'.out.%programname%.log")
+if $msg contains "msgnum:" then
+	action(type="omfile" dynaFile="dynfile" template="outfmt")
+'
+for i in $(seq 1 $NUMFILES); do
+	add_conf '
+input(type="imfile" File="./'$RSYSLOG_DYNNAME'.input'$i'" Tag="file'$i':")
+'
+done
+./inputfilegen -m $NUMROTATED > $RSYSLOG_DYNNAME.input1
+for i in $(seq 2 $NUMFILES); do
+	./inputfilegen -m $NUMMESSAGES > $RSYSLOG_DYNNAME.input$i
+done
+startup
+
+# rotate the first file as soon as it is being read
+wait_file_exists $RSYSLOG_DYNNAME.out.file1.log
+mv $RSYSLOG_DYNNAME.input1 $RSYSLOG_DYNNAME.input1.rotated
+./inputfilegen -m $NUMMESSAGES -i $NUMROTATED > $RSYSLOG_DYNNAME.input1
+printf 'rotated input1 after %d of %d lines were processed\n' \
+	$(wc -l < $RSYSLOG_DYNNAME.out.file1.log) $NUMROTATED
+
+wait_file_lines $RSYSLOG_DYNNAME.out.file1.log $(( NUMROTATED + NUMMESSAGES ))
+for i in $(seq 2 $NUMFILES); do
+	wait_file_lines $RSYSLOG_DYNNAME.out.file$i.log $NUMMESSAGES
+done
+shutdown_when_empty
+wait_shutdown
+
+for i in $(seq 1 $NUMFILES); do
+	export SEQ_CHECK_FILE=$RSYSLOG_DYNNAME.out.file$i.log
+	if [ $i -eq 1 ]; then
+		seq_check 0 $(( NUMROTATED + NUMMESSAGES - 1 ))
+	else
+		seq_check
+	fi
+	# seq_check sorts, but messages of a single file must also keep their order
+	if ! sort -c -n $SEQ_CHECK_FILE; then
+		echo "FAIL: messages of file$i are out of order"
+		error_exit 1
+	fi
+done
+exit_test
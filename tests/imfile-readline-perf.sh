@@ -0,0 +1,38 @@
+#!/bin/bash
+# Benchmark (not part of the regular testbench run): read a large file
+# via imfile, once with short and once with long lines, and report the
+# time needed until all lines have been written to the output file.
+# Usage: ./imfile-readline-perf.sh [number of lines]
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export NUMMESSAGES=${1:-1000000}
+
+for extra in 0 1000; do
+	# drop the state file of the previous run
+	rm -rf $RSYSLOG_DYNNAME.spool
+	generate_conf
+	add_conf '
+module(load="../plugins/imfile/.libs/imfile")
+input(type="imfile" File="./'$RSYSLOG_DYNNAME'.input" tag="file:")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+action(type="omfile" file="'$RSYSLOG_OUT_LOG'" template="outfmt")
+'
+	rm -f $RSYSLOG_OUT_LOG $RSYSLOG_DYNNAME.input
+	if [ $extra -eq 0 ]; then
+		./inputfilegen -m $NUMMESSAGES > $RSYSLOG_DYNNAME.input
+	else
+		./inputfilegen -m $NUMMESSAGES -d $extra > $RSYSLOG_DYNNAME.input
+	fi
+	size=$(stat -c %s $RSYSLOG_DYNNAME.input)
+	start=$(date +%s%N)
+	startup
+	wait_file_lines $RSYSLOG_OUT_LOG $NUMMESSAGES
+	end=$(date +%s%N)
+	shutdown_when_empty
+	wait_shutdown
+	seq_check
+	ms=$(( (end - start) / 1000000 ))
+	printf 'extra data %-5d: %d lines, %d MiB in %d ms\n' $extra $NUMMESSAGES $(( size / 1048576 )) $ms
+done
+exit_test
@@ -0,0 +1,46 @@
+#!/bin/bash
+# Multi-line records whose last line is only partially written when imfile
+# reads the file must be completed correctly once the rest of the line is
+# appended. This checks readMode 1 and 2, each with a poll between the
+# two writes of the line.
+# This is part of the rsyslog testbench, licensed under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+generate_conf
+add_conf '
+module(load="../plugins/imfile/.libs/imfile" mode="polling" pollingInterval="1")
+
+input(type="imfile" File="./'$RSYSLOG_DYNNAME'.input1" Tag="file1:" ReadMode="1" ruleset="out")
+input(type="imfile" File="./'$RSYSLOG_DYNNAME'.input2" Tag="file2:" ReadMode="2" ruleset="out")
+
+template(name="outfmt" type="string" string="%syslogtag%%msg%\n")
+ruleset(name="out") {
+	action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+}
+'
+# a complete record, followed by a record whose last line is incomplete
+printf 'msgnum:A\n\nmsgnum:0\nmsgnum:1' > $RSYSLOG_DYNNAME.input1
+printf 'msgnum:A\nmsgnum:0\n msgnum:1' > $RSYSLOG_DYNNAME.input2
+startup
+content_check_with_count "msgnum:A" 2 10
+# make sure the partial line has been read as well
+rst_msleep 2500
+
+printf 'X\n\n' >> $RSYSLOG_DYNNAME.input1
+printf 'X\nmsgnum:2\n' >> $RSYSLOG_DYNNAME.input2
+content_check_with_count "msgnum:1X" 2 10
+shutdown_when_empty
+wait_shutdown
+
+export EXPECTED='file1:msgnum:0#012msgnum:1X
+file1:msgnum:A
+file2:msgnum:0#012 msgnum:1X
+file2:msgnum:A'
+LC_ALL=C sort < $RSYSLOG_OUT_LOG > $RSYSLOG_DYNNAME.sorted
+if [ "$(cat $RSYSLOG_DYNNAME.sorted)" != "$EXPECTED" ]; then
+	echo "FAIL: unexpected output, expected:"
+	echo "$EXPECTED"
+	echo "got:"
+	cat $RSYSLOG_DYNNAME.sorted
+	error_exit 1
+fi
+exit_test
@@ -0,0 +1,30 @@
+#!/bin/bash
+# cidr lookup tables must reject prefix lengths that are out of range,
+# including ones that would wrap around to a valid length.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+INDEXES="10.0.0.0/33 10.0.0.0/4294967297 10.0.0.0/4294967328 10.0.0.0/18446744073709551648
+2001:db8::/129 2001:db8::/4294967424 ::ffff:10.0.0.0/4294967393 ::ffff:10.0.0.0/95"
+generate_conf
+n=0
+for index in $INDEXES; do
+	n=$((n + 1))
+	cat > $RSYSLOG_DYNNAME.$n.lkp_tbl <<TABLE
+{ "version": 1, "nomatch": "unk", "type": "cidr",
+  "table": [ {"index": "$index", "value": "bad" } ] }
+TABLE
+	add_conf '
+lookup_table(name="t'$n'" file="'$RSYSLOG_DYNNAME.$n.lkp_tbl'")
+'
+done
+add_conf '
+action(type="omfile" file="'$RSYSLOG_OUT_LOG'")
+'
+# note: we do not need to generate any messages, config error occurs on startup
+startup
+shutdown_when_empty
+wait_shutdown
+for index in $INDEXES; do
+	content_check "has invalid index '$index'"
+done
+exit_test
@@ -0,0 +1,40 @@
+#!/bin/bash
+# test for cidr lookup tables (longest prefix match on IPv4 and IPv6)
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+generate_conf
+add_conf '
+lookup_table(name="net" file="'$srcdir'/testsuites/xlate_cidr.lkp_tbl")
+
+template(name="outfmt" type="string" string="%hostname% %$.net%\n")
+
+set $.net = lookup("net", $hostname);
+action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+'
+startup
+injectmsg_literal '<165>1 2003-03-01T01:00:00.000Z 10.9.9.9 tag - - - test'
+injectmsg_literal '<165>1 2003-03-01T01:00:00.000Z 10.1.7.7 tag - - - test'
+injectmsg_literal '<165>1 2003-03-01T01:00:00.000Z 10.1.2.3 tag - - - test'
+injectmsg_literal '<165>1 2003-03-01T01:00:00.000Z 192.168.17.1 tag - - - test'
+injectmsg_literal '<165>1 2003-03-01T01:00:00.000Z 8.8.8.8 tag - - - test'
+injectmsg_literal '<165>1 2003-03-01T01:00:00.000Z 172.16.5.5 tag - - - test'
+injectmsg_literal '<165>1 2003-03-01T01:00:00.000Z ::ffff:10.1.2.3 tag - - - test'
+injectmsg_literal '<165>1 2003-03-01T01:00:00.000Z 2001:db8:1::1 tag - - - test'
+injectmsg_literal '<165>1 2003-03-01T01:00:00.000Z 2001:db8:aa:1::1 tag - - - test'
+injectmsg_literal '<165>1 2003-03-01T01:00:00.000Z 2001:db9::1 tag - - - test'
+injectmsg_literal '<165>1 2003-03-01T01:00:00.000Z myhost tag - - - test'
+shutdown_when_empty
+wait_shutdown
+export EXPECTED="10.9.9.9 internal
+10.1.7.7 dmz
+10.1.2.3 gateway
+192.168.17.1 office
+8.8.8.8 world4
+172.16.5.5 mapped
+::ffff:10.1.2.3 gateway
+2001:db8:1::1 doc6
+2001:db8:aa:1::1 lab6
+2001:db9::1 unk
+myhost unk"
+cmp_exact
+exit_test
@@ -0,0 +1,48 @@
+#!/bin/bash
+# test for precompiled (mmap()ed) lookup tables and HUP based reloading
+# of them; the image is replaced via rslookupc's atomic rename
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+RSLOOKUPC=../tools/rslookupc
+if [ ! -x $RSLOOKUPC ]; then
+	echo "rslookupc not built (needs --enable-usertools), skipping test"
+	skip_test
+fi
+generate_conf
+add_conf '
+lookup_table(name="xlate" file="'$RSYSLOG_DYNNAME'.xlate.lkp_bin" reloadOnHUP="on")
+
+template(name="outfmt" type="string" string="- %msg% %$.lkp%\n")
+
+set $.lkp = lookup("xlate", $msg);
+
+action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+'
+$RSLOOKUPC -o $RSYSLOG_DYNNAME.xlate.lkp_bin $srcdir/testsuites/xlate.lkp_tbl || error_exit 1
+startup
+injectmsg  0 3
+wait_queueempty
+content_check "msgnum:00000000: foo_old"
+content_check "msgnum:00000001: bar_old"
+assert_content_missing "baz"
+$RSLOOKUPC -o $RSYSLOG_DYNNAME.xlate.lkp_bin $srcdir/testsuites/xlate_more.lkp_tbl || error_exit 1
+issue_HUP
+await_lookup_table_reload
+injectmsg  0 3
+wait_queueempty
+content_check "msgnum:00000000: foo_new"
+content_check "msgnum:00000001: bar_new"
+content_check "msgnum:00000002: baz"
+$RSLOOKUPC -o $RSYSLOG_DYNNAME.xlate.lkp_bin $srcdir/testsuites/xlate_more_with_duplicates_and_nomatch.lkp_tbl \
+	|| error_exit 1
+issue_HUP
+await_lookup_table_reload
+injectmsg  0 10
+shutdown_when_empty
+wait_shutdown
+content_check "msgnum:00000000: foo_latest"
+content_check "msgnum:00000001: quux"
+content_check "msgnum:00000002: baz_latest"
+content_check "msgnum:00000007: baz_latest"
+content_check "msgnum:00000009: quux"
+exit_test
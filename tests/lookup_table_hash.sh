@@ -0,0 +1,40 @@
+#!/bin/bash
+# string lookup tables with hash index (chosen automatically for large
+# tables or explicitly via "search") and case-insensitive keys
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export NUMMESSAGES=5000
+# large table: even message numbers only
+{
+	printf '{ "version" : 1, "nomatch" : "odd", "type" : "string", "table" : [\n'
+	for i in $(seq 0 2 $(( NUMMESSAGES - 4 ))); do
+		printf '  {"index" : " msgnum:%8.8d:", "value" : "even" },\n' $i
+	done
+	printf '  {"index" : " msgnum:%8.8d:", "value" : "even" }]}\n' $(( NUMMESSAGES - 2 ))
+} > $RSYSLOG_DYNNAME.big.lkp_tbl
+generate_conf
+add_conf '
+lookup_table(name="big" file="'$RSYSLOG_DYNNAME'.big.lkp_tbl")
+lookup_table(name="nocase" file="'$srcdir'/testsuites/xlate_nocase.lkp_tbl")
+lookup_table(name="nocase_binary" file="'$srcdir'/testsuites/xlate_nocase_binary.lkp_tbl")
+
+template(name="outfmt" type="string" string="%msg:F,58:2% %$.big% %$.nc% %$.ncb%\n")
+
+set $.big = lookup("big", $msg);
+set $.nc = lookup("nocase", $msg);
+set $.ncb = lookup("nocase_binary", $msg);
+
+action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+'
+startup
+injectmsg
+shutdown_when_empty
+wait_shutdown
+content_count_check " even " 2500
+content_count_check " odd " 2500
+content_check "00000000 even foo foo"
+content_check "00000001 odd bar bar"
+content_check "00000002 even baz baz"
+content_check "00000003 odd unk unk"
+content_check "00004999 odd unk unk"
+exit_test
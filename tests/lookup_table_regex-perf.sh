@@ -0,0 +1,38 @@
+#!/bin/bash
+# Benchmark (not part of the regular testbench run): lookup in a regex
+# table with 200 entries that do not match plus a final catch-all, once
+# with the combined automaton ("auto" engine) and once checking each
+# regex in turn ("serial" engine).
+# Usage: ./lookup_table_regex-perf.sh [number of messages]
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export NUMMESSAGES=${1:-200000}
+
+gen_table() {
+	printf '{ "version" : 1, "nomatch" : "none", "type" : "regex", "engine" : "%s",\n  "table" : [\n' "$1"
+	for i in $(seq 100 299); do
+		printf '    {"regex" : "host%d\\\\.(web|db)[0-9]*\\\\.example\\\\.(com|net)", "tag" : "t%d" },\n' $i $i
+	done
+	printf '    {"regex" : "msgnum:", "tag" : "any" }]}\n'
+}
+
+for engine in serial auto; do
+	gen_table $engine > $RSYSLOG_DYNNAME.lkp_tbl
+	generate_conf
+	add_conf '
+lookup_table(name="xlate" file="'$RSYSLOG_DYNNAME'.lkp_tbl")
+template(name="outfmt" type="string" string="%$.lkp%\n")
+set $.lkp = lookup("xlate", $msg);
+action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+'
+	rm -f $RSYSLOG_OUT_LOG
+	startup
+	start=$(date +%s%N)
+	injectmsg
+	shutdown_when_empty
+	wait_shutdown
+	end=$(date +%s%N)
+	content_count_check "any" $NUMMESSAGES
+	printf 'engine %-6s: %d messages in %d ms\n' $engine $NUMMESSAGES $(( (end - start) / 1000000 ))
+done
+exit_test
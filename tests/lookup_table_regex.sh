@@ -0,0 +1,30 @@
+#!/bin/bash
+# regex lookup table; the combined automaton ("auto" engine) must give
+# the same results as checking each regex in turn ("serial" engine)
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export NUMMESSAGES=50
+generate_conf
+add_conf '
+lookup_table(name="xlate" file="'$srcdir'/testsuites/xlate_regex.lkp_tbl")
+lookup_table(name="xlate_serial" file="'$srcdir'/testsuites/xlate_regex_serial.lkp_tbl")
+
+template(name="outfmt" type="string" string="%msg:F,58:2% %$.a% %$.b%\n")
+
+set $.a = lookup("xlate", $msg);
+set $.b = lookup("xlate_serial", $msg);
+
+action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+'
+startup
+injectmsg
+shutdown_when_empty
+wait_shutdown
+content_count_check " low low" 5
+content_count_check " digit digit" 5
+content_count_check " teens teens" 10
+content_count_check " tt tt" 20
+content_count_check " seven seven" 1
+content_count_check " none none" 9
+content_check "00000047 seven seven"
+exit_test
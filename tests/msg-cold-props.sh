@@ -0,0 +1,30 @@
+#!/bin/bash
+# Filter-heavy ruleset on PRI and header properties, combined with the
+# rarely used timestamp formats that live in the message's cold part.
+# Can also be run under "perf stat -e cache-misses" to compare the hot
+# path of processBatch() between builds.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export NUMMESSAGES=20000
+export QUEUE_EMPTY_CHECK_FUNC=wait_file_lines
+generate_conf
+add_conf '
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+template(name="coldfmt" type="string"
+	 string="%timereported:::date-rfc3339% %timereported:::date-mysql% %timegenerated:::date-pgsql% %timegenerated:::date-unixtimestamp%\n")
+
+if $syslogfacility-text == "local4" and $syslogseverity <= 7 and $hostname == "172.20.245.8"
+   and $programname == "tag" and $msg contains "msgnum:" then {
+	if $syslogseverity-text == "debug" and $syslogtag startswith "tag" then
+		action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+	if $msg contains "msgnum:00000000:" then
+		action(type="omfile" file=`echo $RSYSLOG2_OUT_LOG` template="coldfmt")
+}
+'
+startup
+injectmsg
+shutdown_when_empty
+wait_shutdown
+seq_check
+content_check "-03-01T01:00:00" "$RSYSLOG2_OUT_LOG"
+exit_test
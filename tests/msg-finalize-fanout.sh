@@ -0,0 +1,28 @@
+#!/bin/bash
+# Messages are finalized before they are handed to several action queues,
+# which then read the lazily derived header fields without locking.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export NUMMESSAGES=20000
+export QUEUE_EMPTY_CHECK_FUNC=wait_file_lines
+generate_conf
+add_conf '
+global(message.finalizeBeforeFanOut="on")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+template(name="hdrfmt" type="string" string="%programname%,%app-name%,%procid%,%syslogtag%\n")
+
+if $msg contains "msgnum:" then {
+	action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt"
+	       queue.type="linkedList" queue.workerThreads="2")
+	action(type="omfile" file=`echo $RSYSLOG2_OUT_LOG` template="hdrfmt"
+	       queue.type="linkedList" queue.workerThreads="2")
+}
+'
+startup
+injectmsg
+shutdown_when_empty
+wait_shutdown
+seq_check
+content_check "tag,tag,-," "$RSYSLOG2_OUT_LOG"
+exit_test
@@ -0,0 +1,90 @@
+#!/bin/bash
+# message objects and their TAG/HOSTNAME buffers are recycled via the message
+# pool. Messages with long (out-of-line) TAG and HOSTNAME of varying size are
+# processed both directly and via an action that duplicates them; all output
+# must be intact. Once the pool is warm, hardly any new objects may be
+# allocated, and the depot must be in use.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export RSYSLOG_MSGPOOL=on
+export RSYSLOG_DEBUG="debug nologfuncflow noprintmutexaction nostdout"
+export RSYSLOG_DEBUGLOG="$RSYSLOG_DYNNAME.debug"
+export NUMMESSAGES=20000
+ROUNDSIZE=4000
+generate_conf
+add_conf '
+module(load="../plugins/impstats/.libs/impstats" log.file="'$RSYSLOG_DYNNAME'.out.stats.log"
+       interval="1" format="legacy" resetCounters="off")
+
+template(name="outfmt" type="string" string="%hostname% %syslogtag% %msg:F,58:2%\n")
+if $msg contains "msgnum:" then {
+	action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+	action(type="omfile" file="'$RSYSLOG_DYNNAME'.copy.log" template="outfmt"
+	       action.copyMsg="on" queue.type="LinkedList")
+}
+'
+# $1: first message number; hostname and tag length depend on the number
+gen_round() {
+	awk -v first=$1 -v n=$ROUNDSIZE 'BEGIN {
+		for (i = first; i < first + n; ++i) {
+			h = "h"; for (j = 0; j < i % 50; ++j) h = h "x"
+			t = "t"; for (j = 0; j < i % 60; ++j) t = t "y"
+			printf "<13>Oct 16 10:00:00 %s-%d %s%d: msgnum:%8.8d:\n", h, i, t, i, i
+		}
+	}' > $RSYSLOG_DYNNAME.input
+}
+# print the current value of msgpool counter $1
+get_pool_ctr() {
+	grep "origin=core.msgpool" $RSYSLOG_DYNNAME.out.stats.log | tail -1 | sed -e "s/.* $1=\([0-9]*\).*/\1/"
+}
+
+startup
+for ((first = 0; first < NUMMESSAGES; first += ROUNDSIZE)); do
+	gen_round $first
+	injectmsg_file $RSYSLOG_DYNNAME.input
+	wait_file_lines $RSYSLOG_OUT_LOG $((first + ROUNDSIZE))
+	wait_file_lines $RSYSLOG_DYNNAME.copy.log $((first + ROUNDSIZE))
+	if [ $first -eq 0 ]; then
+		wait_for_stats_flush $RSYSLOG_DYNNAME.out.stats.log
+		malloc_warm=$(get_pool_ctr malloc)
+	fi
+done
+wait_for_stats_flush $RSYSLOG_DYNNAME.out.stats.log
+shutdown_when_empty
+wait_shutdown
+
+for f in $RSYSLOG_OUT_LOG $RSYSLOG_DYNNAME.copy.log; do
+	if ! awk '{ i = $3 + 0
+		    h = "h"; for (j = 0; j < i % 50; ++j) h = h "x"
+		    t = "t"; for (j = 0; j < i % 60; ++j) t = t "y"
+		    if ($1 != h "-" i || $2 != t i ":") { print "corrupted: " $0; bad = 1 }
+		  } END { exit bad }' < $f; then
+		error_exit 1
+	fi
+	awk '{ print $3 }' < $f > $RSYSLOG_DYNNAME.seq
+	export SEQ_CHECK_FILE=$RSYSLOG_DYNNAME.seq
+	seq_check
+done
+
+if ! grep -q "msgpool: object recycling enabled" $RSYSLOG_DEBUGLOG; then
+	echo "message pool disabled in this build/environment, not checking counters"
+	if [ "$(get_pool_ctr depot.put)" != "0" ]; then
+		echo "FAIL: depot used although pool is disabled"
+		error_exit 1
+	fi
+	exit_test
+fi
+malloc_end=$(get_pool_ctr malloc)
+depot_get=$(get_pool_ctr depot.get)
+depot_put=$(get_pool_ctr depot.put)
+echo "msgpool: malloc after first round $malloc_warm, at end $malloc_end, depot get $depot_get put $depot_put"
+if [ "$depot_get" -eq 0 ] || [ "$depot_put" -eq 0 ]; then
+	echo "FAIL: message pool depot not used"
+	error_exit 1
+fi
+# four more rounds of the same size must be served (almost) from the pool
+if [ $((malloc_end - malloc_warm)) -gt $((malloc_warm / 2)) ]; then
+	echo "FAIL: message pool does not recycle, malloc grew from $malloc_warm to $malloc_end"
+	error_exit 1
+fi
+exit_test
@@ -0,0 +1,37 @@
+#!/bin/bash
+# omfile with ioUring="on": all data must be written completely and in order.
+# The dynafile action keeps more requests in flight than the ring has
+# submission queue entries, so the completion thread must defer follow-ups.
+# A third action syncs its file, so each write waits for write and sync.
+# Skipped if the kernel does not permit io_uring.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export NUMMESSAGES=20000
+export RSYSLOG_DEBUG="debug nologfuncflow noprintmutexaction nostdout"
+export RSYSLOG_DEBUGLOG="$RSYSLOG_DYNNAME.debug"
+generate_conf
+add_conf '
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+template(name="dynfile" type="string" string="'$RSYSLOG_DYNNAME'.dyn.%$.n%.log")
+
+set $.n = cnum(field($msg, 58, 2)) % 300;
+action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt" ioUring="on")
+action(type="omfile" dynaFile="dynfile" dynaFileCacheSize="300" template="outfmt"
+       ioBufferSize="4k" flushOnTXEnd="off" ioUring="on")
+action(type="omfile" file="'$RSYSLOG_DYNNAME'.sync.log" template="outfmt" sync="on" ioUring="on")
+'
+startup
+injectmsg
+shutdown_when_empty
+wait_shutdown
+if ! grep -q "strmuring: ring with" $RSYSLOG_DEBUGLOG; then
+	echo "io_uring not available in this environment, skipping test"
+	skip_test
+fi
+seq_check
+cat $RSYSLOG_DYNNAME.dyn.*.log > $RSYSLOG_DYNNAME.dyn-all
+export SEQ_CHECK_FILE=$RSYSLOG_DYNNAME.dyn-all
+seq_check
+export SEQ_CHECK_FILE=$RSYSLOG_DYNNAME.sync.log
+seq_check
+exit_test
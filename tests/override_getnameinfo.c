@@ -0,0 +1,59 @@
+/* fake reverse lookup: every IPv4 address a.b.c.d resolves to
+ * "host-a-b-c-d.example", so tests can check that the DNS cache returns
+ * the name of the right address without depending on real DNS.
+ * For testing slow and failing DNS, name lookups are delayed by
+ * $OVERRIDE_GETNAMEINFO_DELAY milliseconds and fail with EAI_AGAIN while
+ * the file named by $OVERRIDE_GETNAMEINFO_FAILFILE exists.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+
+/* delay and possibly fail a name (non-numeric) lookup as configured */
+static int simulateDNS(void) {
+    const char *const delay = getenv("OVERRIDE_GETNAMEINFO_DELAY");
+    const char *const failFile = getenv("OVERRIDE_GETNAMEINFO_FAILFILE");
+
+    if (delay != NULL) usleep(atoi(delay) * 1000);
+    if (failFile != NULL && access(failFile, F_OK) == 0) return EAI_AGAIN;
+    return 0;
+}
+
+int getnameinfo(const struct sockaddr *sa,
+                socklen_t __attribute__((unused)) salen,
+                char *host,
+                socklen_t hostlen,
+                char *serv,
+                socklen_t servlen,
+                int flags) {
+    const unsigned char *a;
+    int r;
+
+    if (serv != NULL && servlen > 0) *serv = '\0';
+    if (sa->sa_family == AF_INET) {
+        if (flags & NI_NUMERICHOST) {
+            return inet_ntop(AF_INET, &((const struct sockaddr_in *)sa)->sin_addr, host, hostlen) == NULL
+                       ? EAI_OVERFLOW
+                       : 0;
+        }
+        if ((r = simulateDNS()) != 0) return r;
+        a = (const unsigned char *)&((const struct sockaddr_in *)sa)->sin_addr;
+        snprintf(host, hostlen, "host-%u-%u-%u-%u.example", a[0], a[1], a[2], a[3]);
+        return 0;
+    } else if (sa->sa_family == AF_INET6) {
+        if (flags & NI_NUMERICHOST) {
+            return inet_ntop(AF_INET6, &((const struct sockaddr_in6 *)sa)->sin6_addr, host, hostlen) == NULL
+                       ? EAI_OVERFLOW
+                       : 0;
+        }
+        return EAI_NONAME;
+    }
+    return EAI_FAMILY;
+}
@@ -0,0 +1,86 @@
+#!/bin/bash
+# check percentile stats with the sketch algorithm. Values up to 50 are
+# reported exactly at the default accuracy, so we can check exact results.
+# A second statistic receives values from 1 to 10^6 into a sketch with too
+# few bins to cover the whole range; the reported upper percentiles must
+# still be within the configured relative error of the exact ones.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+DELIMITER='|'
+BUCKETNAME='test_bucket'
+STATNAME='test_stat_name'
+generate_conf
+add_conf '
+ruleset(name="stats") {
+  action(type="omfile" file="'${RSYSLOG_DYNNAME}'.out.stats.log")
+}
+
+module(load="../plugins/impstats/.libs/impstats" interval="1" severity="7" Ruleset="stats" bracketing="on")
+template(name="outfmt" type="string" string="%$.timestamp% %msg%  val=%$.val%\n")
+
+percentile_stats(name="'$BUCKETNAME'"
+  percentiles=["95", "50", "99"]
+  algorithm="sketch"
+  delimiter="'${DELIMITER}'"
+  )
+
+percentile_stats(name="wide_bucket"
+  percentiles=["75", "90", "95", "99"]
+  algorithm="sketch"
+  accuracy="2"
+  maxBins="128"
+  delimiter="'${DELIMITER}'"
+  )
+
+if $msg startswith " wide:" then {
+  set $.status = percentile_observe("wide_bucket", "wide_stat", field($msg, 58, 2));
+}
+
+if $msg startswith " msgnum:" then {
+  set $.val = field($msg, 58, 2);
+  set $.status = percentile_observe("'$BUCKETNAME'", "'$STATNAME'", $.val);
+  action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+}
+'
+# log-uniformly distributed values from 1 to 10^6 and their exact
+# percentiles (nearest rank)
+$PYTHON -c '
+import math, random, sys
+random.seed(42)
+n = 2000
+vals = [max(1, int(round(10 ** (6.0 * i / (n - 1))))) for i in range(n)]
+exact = sorted(vals)
+random.shuffle(vals)
+with open(sys.argv[1], "w") as f:
+    for v in vals:
+        f.write("injectmsg literal <167>Mar  1 01:00:00 172.20.245.8 tag wide:%d\n" % v)
+with open(sys.argv[2], "w") as f:
+    for p in (75, 90, 95, 99):
+        f.write("%d %d\n" % (p, exact[int(math.ceil(p / 100.0 * n)) - 1]))
+' $RSYSLOG_DYNNAME.wide.cmds $RSYSLOG_DYNNAME.wide.exact || error_exit 1
+startup
+wait_for_stats_flush ${RSYSLOG_DYNNAME}.out.stats.log
+. $srcdir/diag.sh block-stats-flush
+for i in $(seq 1 20); do shuf -i 1-50; done | sed -e 's/^/injectmsg literal <167>Mar  1 01:00:00 172.20.245.8 tag msgnum:/g' | $TESTTOOL_DIR/diagtalker -p$IMDIAG_PORT || error_exit  $?
+$TESTTOOL_DIR/diagtalker -p$IMDIAG_PORT < $RSYSLOG_DYNNAME.wide.cmds || error_exit $?
+wait_queueempty
+. $srcdir/diag.sh allow-single-stats-flush-after-block-and-wait-for-it
+
+echo doing shutdown
+shutdown_when_empty
+custom_content_check "${STATNAME}${DELIMITER}p95=48" "${RSYSLOG_DYNNAME}.out.stats.log"
+custom_content_check "${STATNAME}${DELIMITER}p50=25" "${RSYSLOG_DYNNAME}.out.stats.log"
+custom_content_check "${STATNAME}${DELIMITER}p99=50" "${RSYSLOG_DYNNAME}.out.stats.log"
+custom_content_check "${STATNAME}${DELIMITER}window_min=1" "${RSYSLOG_DYNNAME}.out.stats.log"
+custom_content_check "${STATNAME}${DELIMITER}window_max=50" "${RSYSLOG_DYNNAME}.out.stats.log"
+custom_content_check "${STATNAME}${DELIMITER}window_sum=25500" "${RSYSLOG_DYNNAME}.out.stats.log"
+custom_content_check "${STATNAME}${DELIMITER}window_count=1000" "${RSYSLOG_DYNNAME}.out.stats.log"
+custom_content_check "wide_stat${DELIMITER}window_count=2000" "${RSYSLOG_DYNNAME}.out.stats.log"
+while read p exact; do
+	reported=$(grep -o "wide_stat${DELIMITER}p$p=[0-9]*" ${RSYSLOG_DYNNAME}.out.stats.log | tail -1 | sed -e 's/.*=//')
+	if ! awk -v r="$reported" -v e="$exact" 'BEGIN { d = r - e; if (d < 0) d = -d; exit !(r != "" && d <= e * 0.02) }'; then
+		echo "FAIL: wide_stat p$p is '$reported', exact value $exact, allowed relative error 2%"
+		error_exit 1
+	fi
+done < $RSYSLOG_DYNNAME.wide.exact
+exit_test
@@ -0,0 +1,37 @@
+#!/bin/bash
+# Test switching queue.spoolFormat while a queue has data on disk. The
+# first instance persists its queue in text format, the second one must
+# read these records back and writes new ones in binary format.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+generate_conf
+add_conf '
+$ModLoad ../plugins/omtesting/.libs/omtesting
+global(workDirectory="'$RSYSLOG_DYNNAME'.spool")
+$IncludeConfig '${RSYSLOG_DYNNAME}'work-queue.conf
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+:msg, contains, "msgnum:" action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+
+$IncludeConfig '${RSYSLOG_DYNNAME}'work-delay.conf
+'
+echo 'main_queue(queue.type="LinkedList" queue.filename="mainq" queue.saveOnShutdown="on"
+	queue.timeoutShutdown="1" queue.spoolFormat="text")' > ${RSYSLOG_DYNNAME}work-queue.conf
+echo "*.*     :omtesting:sleep 0 1000" > ${RSYSLOG_DYNNAME}work-delay.conf
+startup
+injectmsg 0 5000
+shutdown_immediate
+wait_shutdown
+check_mainq_spool
+
+echo "Enter phase 2, rsyslogd restart with binary spool format"
+echo 'main_queue(queue.type="LinkedList" queue.filename="mainq" queue.saveOnShutdown="on"
+	queue.timeoutShutdown="1" queue.spoolFormat="binary")' > ${RSYSLOG_DYNNAME}work-queue.conf
+echo "#" > ${RSYSLOG_DYNNAME}work-delay.conf
+startup
+injectmsg 5000 5000
+shutdown_when_empty
+wait_shutdown
+# duplicates are permitted, see queue-persist-drvr.sh
+seq_check 0 9999 -d
+exit_test
@@ -0,0 +1,26 @@
+#!/bin/bash
+# Test for a sharded RingBuffer queue. The action queue is fed by several
+# main queue workers, so there are multiple producer threads that map to
+# different shards, and the action queue workers need to steal from
+# shards other than their own.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export NUMMESSAGES=40000
+export QUEUE_EMPTY_CHECK_FUNC=wait_file_lines
+generate_conf
+add_conf '
+main_queue(queue.workerThreads="4" queue.workerThreadMinimumMessages="500"
+           queue.dequeueBatchSize="64")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+:msg, contains, "msgnum:" action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt"
+	queue.type="RingBuffer" queue.shards="4" queue.size="5000"
+	queue.workerThreads="3" queue.workerThreadMinimumMessages="200"
+	queue.dequeueBatchSize="128")
+'
+startup
+injectmsg
+shutdown_when_empty
+wait_shutdown
+seq_check
+exit_test
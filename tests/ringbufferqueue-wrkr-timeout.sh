@@ -0,0 +1,38 @@
+#!/bin/bash
+# RingBuffer queue workers that terminate on inactivity timeout must withdraw
+# their idle announcement, so that the idle worker count drops back to 0 and
+# producers return to the lock-free path. New workers must be started for
+# messages that arrive after the timeout.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export NUMMESSAGES=20000
+export RSYSLOG_DEBUG="debug nologfuncflow noprintmutexaction nostdout"
+export RSYSLOG_DEBUGLOG="$RSYSLOG_DYNNAME.debug"
+generate_conf
+add_conf '
+main_queue(queue.type="RingBuffer" queue.size="5000" queue.workerThreads="4"
+           queue.workerThreadMinimumMessages="100" queue.dequeueBatchSize="64"
+           queue.timeoutWorkerThreadShutdown="200")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+:msg, contains, "msgnum:" action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+'
+startup
+injectmsg 0 10000
+wait_file_lines $RSYSLOG_OUT_LOG 10000
+# give all workers time to run into the inactivity timeout
+sleep 2
+last=$(grep "worker exits, idle ringbuffer workers now" $RSYSLOG_DEBUGLOG | tail -1)
+if [ -z "$last" ]; then
+	echo "FAIL: no ringbuffer worker terminated on inactivity timeout"
+	error_exit 1
+fi
+if [ "${last##* }" != "0" ]; then
+	echo "FAIL: idle worker count did not drop to 0 after timeout: $last"
+	error_exit 1
+fi
+injectmsg 10000 10000
+shutdown_when_empty
+wait_shutdown
+seq_check
+exit_test
@@ -0,0 +1,21 @@
+#!/bin/bash
+# Test for RingBuffer queue mode, with multiple workers and a queue small
+# enough that producers also hit the locked (flow-controlled) enqueue path.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export NUMMESSAGES=40000
+export QUEUE_EMPTY_CHECK_FUNC=wait_file_lines
+generate_conf
+add_conf '
+main_queue(queue.type="RingBuffer" queue.size="2000" queue.workerThreads="4"
+           queue.workerThreadMinimumMessages="200" queue.dequeueBatchSize="128")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+:msg, contains, "msgnum:" action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+'
+startup
+injectmsg
+shutdown_when_empty
+wait_shutdown
+seq_check
+exit_test
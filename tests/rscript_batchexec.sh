@@ -0,0 +1,50 @@
+#!/bin/bash
+# Batch-at-a-time script execution: filters, stop, set and call must give
+# the same per-message results as the regular message-by-message mode.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export NUMMESSAGES=10000
+# the debug log tells us whether batch execution was really used
+export RSYSLOG_DEBUG="debug nologfuncflow noprintmutexaction nostdout"
+export RSYSLOG_DEBUGLOG="$RSYSLOG_DYNNAME.debug"
+generate_conf
+add_conf '
+global(rainerscript.batchExecution="on")
+main_queue(queue.dequeueBatchSize="512")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%,%$.path%\n")
+
+ruleset(name="sub") {
+	set $.path = $.path & "s";
+}
+
+if $msg contains "msgnum:0000000" then stop
+if $syslogseverity <= 7 then
+	set $.path = "p";
+else
+	set $.path = "x";
+if $programname == "tag" and $msg endswith "1:" then
+	call sub
+if $msg endswith "9:" then {
+	set $.path = $.path & "n";
+	if not ($hostname startswith "172.") then
+		stop
+}
+action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+'
+startup
+injectmsg
+shutdown_when_empty
+wait_shutdown
+# messages 0..9 are discarded by the first stop
+seq_check 10 $(( NUMMESSAGES - 1 ))
+content_count_check ",ps" 999
+content_count_check ",pn" 999
+content_check "00000012,p"
+content_check "ruleset 'RSYSLOG_DefaultRuleset': batch execution enabled" $RSYSLOG_DEBUGLOG
+content_check "ruleset 'RSYSLOG_DefaultRuleset' for" $RSYSLOG_DEBUGLOG
+if grep -q "falling back to per-message execution" $RSYSLOG_DEBUGLOG; then
+	echo "FAIL: batch execution fell back to per-message execution"
+	error_exit 1
+fi
+exit_test
@@ -0,0 +1,95 @@
+#!/bin/bash
+# Runs the same filter-heavy ruleset with the tree interpreter and with
+# compiled filter bytecode, checks that both produce identical results
+# and reports the time each instance needed. For benchmarking, increase
+# NUMMESSAGES and NUMFILTERS.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export NUMMESSAGES=${NUMMESSAGES:-20000}
+export NUMFILTERS=${NUMFILTERS:-200}
+export QUEUE_EMPTY_CHECK_FUNC=wait_file_lines
+
+# $1 is the instance id
+gen_filters() {
+	add_conf '
+template(name="outfmt" type="string" string="%msg:F,58:2%,%$.hits%\n")
+set $.hits = 0;
+' $1
+	for ((i = 0; i < NUMFILTERS; ++i)); do
+		d=$((i % 10))
+		case $((i % 5)) in
+		0) add_conf 'if $msg contains ":0000'$d'" or $hostname == "host'$i'" then set $.hits = $.hits + 1;
+' $1 ;;
+		1) add_conf 'if $programname == "tag" and not ($msg endswith "'$d':") then set $.hits = $.hits + 2;
+' $1 ;;
+		2) add_conf 'if $syslogseverity-text == "debug" and $hostname startswith "172.20" and $syslogtag <> "x'$i'" then set $.hits = $.hits + 3;
+' $1 ;;
+		3) add_conf 'if $syslogtag startswith_i "TAG" and $msg contains_i "MSGNUM:000'$d'" then set $.hits = $.hits + 5;
+' $1 ;;
+		4) add_conf 'if ($syslogfacility-text == "local4" or $msg contains "none") and $syslogseverity < '$((d % 8))' then set $.hits = $.hits + 7;
+' $1 ;;
+		esac
+	done
+}
+
+generate_conf
+add_conf '
+global(rainerscript.bytecode="off")
+'
+gen_filters
+add_conf '
+action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+'
+generate_conf 2
+add_conf '
+global(rainerscript.bytecode="on")
+' 2
+gen_filters 2
+add_conf '
+action(type="omfile" file=`echo $RSYSLOG2_OUT_LOG` template="outfmt")
+' 2
+
+startup
+tstart=$(date +%s%N)
+injectmsg
+shutdown_when_empty
+wait_shutdown
+ttree=$(( ($(date +%s%N) - tstart) / 1000000 ))
+
+startup 2
+tstart=$(date +%s%N)
+injectmsg2
+shutdown_when_empty 2
+wait_shutdown 2
+tvm=$(( ($(date +%s%N) - tstart) / 1000000 ))
+
+printf 'tree interpreter: %d ms, bytecode: %d ms (%d messages, %d filters)\n' \
+	$ttree $tvm $NUMMESSAGES $NUMFILTERS
+seq_check
+# worker threads may reorder messages
+sort -o "$RSYSLOG_DYNNAME.tree.sorted" "$RSYSLOG_OUT_LOG"
+sort -o "$RSYSLOG_DYNNAME.vm.sorted" "$RSYSLOG2_OUT_LOG"
+if ! cmp "$RSYSLOG_DYNNAME.tree.sorted" "$RSYSLOG_DYNNAME.vm.sorted"; then
+	printf 'FAIL: results of tree interpreter and bytecode differ\n'
+	diff "$RSYSLOG_DYNNAME.tree.sorted" "$RSYSLOG_DYNNAME.vm.sorted" | head -20
+	error_exit 1
+fi
+
+# identical results are only meaningful if the filters really were compiled
+# (and only with bytecode enabled). The config check runs the optimizer.
+check_compiled() {
+	RSYSLOG_DEBUG="debug nostdout" RSYSLOG_DEBUGLOG="$RSYSLOG_DYNNAME.debug$1" \
+		../tools/rsyslogd -C -N1 -f${TESTCONF_NM}$1.conf -M../runtime/.libs:../.libs
+	grep -c "rscriptvm: compiled expression" "$RSYSLOG_DYNNAME.debug$1"
+}
+ncompiled=$(check_compiled)
+if [ "$ncompiled" != "0" ]; then
+	printf 'FAIL: %s filters compiled with rainerscript.bytecode="off"\n' "$ncompiled"
+	error_exit 1
+fi
+ncompiled=$(check_compiled 2)
+if [ "$ncompiled" -lt "$NUMFILTERS" ]; then
+	printf 'FAIL: only %s of %d filters compiled with rainerscript.bytecode="on"\n' "$ncompiled" $NUMFILTERS
+	error_exit 1
+fi
+exit_test
@@ -0,0 +1,45 @@
+#!/bin/bash
+# contains, contains_i, startswith, startswith_i and endswith against
+# constant arrays; these use a multi-pattern matcher instead of
+# comparing each array element.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export NUMMESSAGES=5000
+generate_conf
+add_conf '
+template(name="outfmt" type="string" string="%$.t% %$.n%\n")
+
+set $.n = field($msg, 58, 2);
+if $.n startswith ["00000", "zz9", "x"] then {
+	set $.t = "A";
+	action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+}
+if $.n startswith_i ["0000A", "00001", "Q"] then {
+	set $.t = "B";
+	action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+}
+if $.n contains ["4999", "12345", "0000123"] then {
+	set $.t = "C";
+	action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+}
+if $.n contains_i ["ABC", "0049", "x7"] then {
+	set $.t = "D";
+	action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+}
+if $.n endswith ["99", "777", "y"] then {
+	set $.t = "E";
+	action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+}
+'
+startup
+injectmsg
+shutdown_when_empty
+wait_shutdown
+content_count_check "A " 1000
+content_count_check "B " 1000
+content_count_check "C " 12
+content_count_check "D " 111
+content_count_check "E " 55
+content_check "C 00000123"
+content_check "E 00004777"
+exit_test
@@ -0,0 +1,27 @@
+#!/bin/bash
+# adjacent or-ed re_match()/re_match_i() calls on the same value are
+# combined into a single automaton by the optimizer
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export NUMMESSAGES=50
+generate_conf
+add_conf '
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+
+if re_match($msg, "msgnum:0000000[0-4]") or re_match_i($msg, "MSGNUM:0*1[0-4]:")
+   or re_match($msg, "^ ?msgnum:0{6}2[05]:$") or $msg contains "msgnum:00000030"
+   or re_match($msg, "4[0-9]:") or re_match($msg, "(x|y)\\1") then
+	action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+'
+startup
+injectmsg
+shutdown_when_empty
+wait_shutdown
+content_count_check "000000" 23
+content_check "00000013"
+content_check "00000025"
+content_check "00000030"
+content_check "00000049"
+assert_content_missing "00000005"
+assert_content_missing "00000021"
+exit_test
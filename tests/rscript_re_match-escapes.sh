@@ -0,0 +1,68 @@
+#!/bin/bash
+# combined re_match() chains must give the same results as regexec() for
+# escapes and bracket expressions whose meaning is easy to get wrong. Each
+# regex is checked both in a chain (combined by the optimizer if possible)
+# and alone (always regexec()); the two results must not differ.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export RSYSLOG_DEBUG="debug nologfuncflow noprintmutexaction nostdout"
+export RSYSLOG_DEBUGLOG="$RSYSLOG_DYNNAME.debug"
+# each regex is added as "chain result" followed by "individual result"
+add_regex() {
+	add_conf '
+set $.c = re_match($msg, "'"$1"'") or re_match($msg, "^@@$");
+set $.r = $.r & $.c & re_match($msg, "'"$1"'") & " ";
+'
+}
+generate_conf
+add_conf '
+template(name="outfmt" type="string" string="%msg%|%$.r%\n")
+set $.r = "";
+'
+# GNU escapes, must be left to regexec()
+add_regex '\\<foo'
+add_regex 'foo\\>'
+add_regex '\\bbar'
+add_regex '\\w+-\\w+'
+add_regex '\\s\\S'
+add_regex "z\\\\'"
+# supported by the combined automaton
+add_regex '[]-a]x'
+add_regex '[^]a]z'
+add_regex '[a-]]'
+add_regex 'a\\.b'
+add_regex '\\(q\\)'
+add_conf '
+action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="outfmt")
+'
+startup
+injectmsg_literal "<13>Oct 16 10:00:00 host tag: foo bar
+<13>Oct 16 10:00:00 host tag: xfoo foox
+<13>Oct 16 10:00:00 host tag: foo-bar
+<13>Oct 16 10:00:00 host tag: a.b axb
+<13>Oct 16 10:00:00 host tag: ]x
+<13>Oct 16 10:00:00 host tag: _x bx
+<13>Oct 16 10:00:00 host tag: ]z az
+<13>Oct 16 10:00:00 host tag: yz
+<13>Oct 16 10:00:00 host tag: a-] (q)
+<13>Oct 16 10:00:00 host tag: -]q"
+shutdown_when_empty
+wait_shutdown
+if grep -E '\|(.* )?(01|10) ' $RSYSLOG_OUT_LOG; then
+	echo "FAIL: combined and individual re_match() results differ (above)"
+	error_exit 1
+fi
+# make sure both code paths were really taken and something matched
+content_count_check "|" 10
+content_check "11"
+count=$(grep -c "optimizer: combined re_match() calls into a set of 2 regexes" $RSYSLOG_DEBUGLOG)
+if [ "$count" -lt 5 ]; then
+	echo "FAIL: expected 5 combined re_match() chains, got $count"
+	error_exit 1
+fi
+count=$(grep -c "optimizer: re_match() regexes cannot be combined" $RSYSLOG_DEBUGLOG)
+if [ "$count" -lt 6 ]; then
+	echo "FAIL: expected 6 re_match() chains left to regexec(), got $count"
+	error_exit 1
+fi
+exit_test
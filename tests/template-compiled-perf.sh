@@ -0,0 +1,52 @@
+#!/bin/bash
+# Benchmark (not part of the regular testbench run): write messages with
+# RSYSLOG_FileFormat, a JSON list template built from constants and
+# format="json" properties, and an option.jsonf list template, once with
+# the regular template processing and once with compiled templates. The
+# output of both runs must be identical.
+# Usage: ./template-compiled-perf.sh [number of messages]
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export NUMMESSAGES=${1:-500000}
+
+for tpl in RSYSLOG_FileFormat jsonlist jsonf; do
+	for compile in off on; do
+		generate_conf
+		add_conf '
+global(template.compile="'$compile'")
+template(name="jsonlist" type="list") {
+	constant(value="{\"timestamp\":\"")
+	property(name="timereported" dateFormat="rfc3339" format="json")
+	constant(value="\",\"host\":\"")
+	property(name="hostname" format="json")
+	constant(value="\",\"tag\":\"")
+	property(name="syslogtag" format="json")
+	constant(value="\",\"msg\":\"")
+	property(name="msg" format="json")
+	constant(value="\"}\n")
+}
+template(name="jsonf" type="list" option.jsonf="on") {
+	property(outname="timestamp" name="timereported" dateFormat="rfc3339" format="jsonf")
+	property(outname="host" name="hostname" format="jsonf")
+	property(outname="tag" name="syslogtag" format="jsonf")
+	property(outname="msg" name="msg" format="jsonf")
+}
+action(type="omfile" file=`echo $RSYSLOG_OUT_LOG` template="'$tpl'")
+'
+		rm -f $RSYSLOG_OUT_LOG
+		startup
+		start=$(date +%s%N)
+		injectmsg
+		shutdown_when_empty
+		wait_shutdown
+		end=$(date +%s%N)
+		content_count_check "msgnum:" $NUMMESSAGES
+		mv $RSYSLOG_OUT_LOG $RSYSLOG_DYNNAME.$compile.log
+		printf '%-18s compile=%-3s: %d messages in %d ms\n' $tpl $compile $NUMMESSAGES $(( (end - start) / 1000000 ))
+	done
+	if ! cmp $RSYSLOG_DYNNAME.off.log $RSYSLOG_DYNNAME.on.log; then
+		echo "FAIL: template $tpl: compiled output differs"
+		error_exit 1
+	fi
+done
+exit_test
@@ -0,0 +1,125 @@
+#!/bin/bash
+# compiled templates (template.compile="on") must produce exactly the same
+# output as the regular template processing. A set of string and list
+# templates covering the compiled property getters, the escaping options
+# and properties that are not compiled is run once with template.compile
+# off and once on; the output of each template must be identical.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+TEMPLATES="str fmt pos strjson strsql strstdsql jsonlist jsonf plainjson csv datefmt localvars"
+cat > $RSYSLOG_DYNNAME.input <<'EOF'
+<165>1 2003-10-11T22:14:15.003Z mymachine.example.com evntslog 1234 ID47 [exampleSDID@32473 iut="3" eventSource="Application"] msgnum:1 an event with "quotes", 'ticks' and \backslash
+<13>Oct 11 22:14:15 host1 tag[42]: msgnum:2 MiXeD case:with:colons
+<34>Oct 11 22:14:15 mymachine su: msgnum:3 'su root' failed for lonvick on /dev/pts/8
+<13>2003-10-11T22:14:15.123456+02:00 host2 prog: msgnum:4 umlaut äöü and some more text to get past the substring end
+<191>1 2003-10-11T22:14:15Z host3 - - - - msgnum:5 no app-name, procid, msgid or structured data
+<13>Oct 11 22:14:15 host4 prog:
+EOF
+export RSYSLOG_DEBUG="debug nologfuncflow noprintmutexaction nostdout"
+for compile in off on; do
+	export RSYSLOG_DEBUGLOG="$RSYSLOG_DYNNAME.$compile.debug"
+	generate_conf
+	add_conf '
+global(template.compile="'$compile'")
+template(name="str" type="string"
+	string="%timereported:::date-rfc3339% %hostname% %syslogtag%%msg%\n")
+template(name="fmt" type="string"
+	string="%pri% %programname:::uppercase% %app-name% %procid% %msgid% %structured-data% %fromhost-ip% %rawmsg%\n")
+template(name="pos" type="string"
+	string="%msg:2:10% %msg:R,ERE,0,DFLT:[a-z]+case--end% %msg:F,58:2% %msg:::lowercase,drop-last-lf% %msg:5:$:space-cc%\n")
+template(name="strjson" type="string"
+	string="{\"msg\":\"%msg:::json%\",\"host\":\"%hostname:::json%\",\"ts\":\"%timereported:::date-rfc3339,json%\"}\n")
+template(name="strsql" type="string" option.sql="on"
+	string="insert into t values (%pri%, %syslogtag%, %msg%)\n")
+template(name="strstdsql" type="string" option.stdsql="on"
+	string="insert into t values (%pri%, %syslogtag%, %msg%)\n")
+template(name="jsonlist" type="list") {
+	constant(value="{\"timestamp\":\"")
+	property(name="timereported" dateFormat="rfc3339" format="json")
+	constant(value="\",\"host\":\"")
+	property(name="hostname" format="json")
+	constant(value="\",\"tag\":\"")
+	property(name="syslogtag" format="json")
+	constant(value="\",\"sd\":\"")
+	property(name="structured-data" format="json")
+	constant(value="\",\"msg\":\"")
+	property(name="msg" format="json")
+	constant(value="\"}\n")
+}
+template(name="jsonf" type="list" option.jsonf="on") {
+	property(outname="timestamp" name="timereported" dateFormat="rfc3339" format="jsonf")
+	property(outname="host" name="hostname" format="jsonf")
+	property(outname="tag" name="syslogtag" format="jsonf")
+	property(outname="appname" name="app-name" format="jsonf")
+	property(outname="pri" name="pri" format="jsonf" dataType="number")
+	property(outname="msg" name="msg" format="jsonf")
+	property(outname="upper" name="msg" format="jsonf" caseConversion="upper")
+}
+template(name="plainjson" type="list") {
+	property(name="msg" format="json")
+	constant(value="|")
+	property(name="msg" format="json" position.from="3" position.to="12")
+	constant(value="\n")
+}
+template(name="csv" type="list") {
+	property(name="hostname" format="csv")
+	constant(value=",")
+	property(name="msg" format="csv")
+	constant(value=",")
+	property(name="msg" position.from="1" position.to="20" fixedWidth="on")
+	constant(value="\n")
+}
+template(name="datefmt" type="list") {
+	property(name="timereported" dateFormat="rfc3164")
+	constant(value=" ")
+	property(name="timereported" dateFormat="unixtimestamp")
+	constant(value=" ")
+	property(name="timereported" dateFormat="rfc3339" date.inUTC="on")
+	constant(value=" ")
+	property(name="timereported" dateFormat="year")
+	property(name="timereported" dateFormat="month")
+	property(name="timereported" dateFormat="day")
+	constant(value=" ")
+	property(name="timereported" dateFormat="subseconds")
+	constant(value="\n")
+}
+template(name="localvars" type="string"
+	string="%$.num% %$!% %$!data!word:::uppercase% [%$!missing%]\n")
+
+set $.num = field($msg, 58, 2);
+set $!data!word = "w" & $pri;
+'
+	for tpl in $TEMPLATES; do
+		add_conf '
+action(type="omfile" file="'$RSYSLOG_DYNNAME.$tpl.log'" template="'$tpl'")
+'
+	done
+	rm -f $RSYSLOG_DYNNAME.*.log
+	startup
+	injectmsg_file $RSYSLOG_DYNNAME.input
+	shutdown_when_empty
+	wait_shutdown
+	for tpl in $TEMPLATES; do
+		lines=$(wc -l < $RSYSLOG_DYNNAME.$tpl.log)
+		if [ "$lines" -ne 6 ]; then
+			echo "FAIL: template $tpl, compile=$compile: expected 6 lines, got $lines"
+			cat $RSYSLOG_DYNNAME.$tpl.log
+			error_exit 1
+		fi
+		mv $RSYSLOG_DYNNAME.$tpl.log $RSYSLOG_DYNNAME.$tpl.$compile
+	done
+done
+
+for tpl in $TEMPLATES; do
+	if ! cmp $RSYSLOG_DYNNAME.$tpl.off $RSYSLOG_DYNNAME.$tpl.on; then
+		echo "FAIL: template $tpl: compiled output differs"
+		diff $RSYSLOG_DYNNAME.$tpl.off $RSYSLOG_DYNNAME.$tpl.on
+		error_exit 1
+	fi
+	# make sure the "on" run really had something compiled to use
+	if ! grep -q "template '$tpl' compiled" $RSYSLOG_DYNNAME.on.debug; then
+		echo "FAIL: template $tpl was not compiled"
+		error_exit 1
+	fi
+done
+exit_test
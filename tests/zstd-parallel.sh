@@ -0,0 +1,28 @@
+#!/bin/bash
+# This tests writing large data records in zstd mode with block-parallel
+# compression. The output file consists of many independent zstd frames,
+# which must decompress to the complete sequence.
+# This file is part of the rsyslog project, released under ASL 2.0
+. ${srcdir:=.}/diag.sh init
+export NUMMESSAGES=${NUMMESSAGES:-50000}
+export QUEUE_EMPTY_CHECK_FUNC=wait_seq_check
+generate_conf
+export SEQ_CHECK_FILE=$RSYSLOG_OUT_LOG.zst
+add_conf '
+$MaxMessageSize 10k
+$MainMsgQueueTimeoutShutdown 10000
+
+module(load="builtin:omfile" compression.driver="zstd" compression.workers="4")
+module(load="../plugins/imptcp/.libs/imptcp")
+input(type="imptcp" port="0" listenPortFileName="'$RSYSLOG_DYNNAME'.tcpflood_port")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%,%msg:F,58:3%,%msg:F,58:4%\n")
+local0.* action(type="omfile" file="'$RSYSLOG_OUT_LOG'.zst" template="outfmt" zipLevel="10")
+'
+startup
+assign_tcpflood_port $RSYSLOG_DYNNAME.tcpflood_port
+tcpflood -m$NUMMESSAGES -r -d10000 -P129
+shutdown_when_empty
+wait_shutdown
+seq_check 0 $((NUMMESSAGES - 1)) -E
+exit_test
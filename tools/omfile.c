@@ -71,6 +71,7 @@
 #include "parserif.h"
 #include "janitor.h"
 #include "rsconf.h"
+#include "hashtable.h"
 
 MODULE_TYPE_OUTPUT;
 MODULE_TYPE_NOKEEP;
@@ -84,59 +85,22 @@ static rsRetVal resetConfigVariables(uchar __attribute__((unused)) * pp, void __
 DEF_OMOD_STATIC_DATA;
 DEFobjCurrIf(strm) DEFobjCurrIf(statsobj)
 
-/**
- * @brief Global counter/clock for file access timestamping.
- *
- * This counter is used as a "Lamport logical clock" for the LRU mechanism
- * of the dynamic file cache. It provides a monotonically increasing sequence
- * number to track the access order of files, rather than actual time.
- * It is highly unlikely to wrap within the lifetime of a process.
- */
-#ifdef HAVE_ATOMIC_BUILTINS64
-    static uint64 clockFileAccess = 0;
-#else
-    static unsigned clockFileAccess = 0;
-#endif
-
-/**
- * @brief Mutex for protecting clockFileAccess in non-atomic builtins environments.
- */
-#ifndef HAVE_ATOMIC_BUILTINS
-static pthread_mutex_t mutClock;
-#endif
-
-/**
- * @brief Retrieves and increments the global file access clock.
- *
- * This function provides a monotonically increasing counter used for the LRU
- * mechanism in the dynamic file cache. It is thread-safe.
- *
- * @return The incremented value of the file access clock.
- */
-static uint64 getClockFileAccess(void) {
-#ifdef HAVE_ATOMIC_BUILTINS64
-    return ATOMIC_INC_AND_FETCH_uint64(&clockFileAccess, &mutClock);
-#else
-    return ATOMIC_INC_AND_FETCH_unsigned(&clockFileAccess, &mutClock);
-#endif
-}
-
-
 /**
  * @brief Structure for a dynamic file name cache entry.
  *
  * This structure holds information about a dynamically opened file,
  * including its name, the associated stream, signature provider data,
- * and access timestamp for LRU management.
+ * and its links in the LRU list.
  */
+typedef struct s_dynaFileCacheEntry dynaFileCacheEntry;
 struct s_dynaFileCacheEntry {
-    uchar *pName; /**< name currently open, if dynamic name */
+    uchar *pName; /**< name currently open, also the key in the cache hash table */
     strm_t *pStrm; /**< our output stream */
     void *sigprovFileData; /**< opaque data ptr for provider use */
-    uint64 clkTickAccessed; /**< for LRU - based on clockFileAccess */
     short nInactive; /**< number of minutes not writen - for close timeout */
+    dynaFileCacheEntry *pLRUPrev; /**< more recently used entry, NULL for the head */
+    dynaFileCacheEntry *pLRUNext; /**< less recently used entry, NULL for the tail */
 };
-typedef struct s_dynaFileCacheEntry dynaFileCacheEntry;
 
 
 #define IOBUF_DFLT_SIZE 4096 /**< default size for io buffers */
@@ -179,15 +143,17 @@ typedef struct _instanceData {
     void *cryprovData; /**< opaque data ptr for provider use */
     cryprov_if_t cryprov; /**< ptr to crypto provider interface */
     sbool useCryprov; /**< quicker than checkig ptr (1 vs 8 bytes!) */
-    int iCurrElt; /**< currently active cache element (-1 = none) */
-    int iCurrCacheSize; /**< currently cache size (1-based) */
+    dynaFileCacheEntry *pCurrElt; /**< currently active cache element (NULL = none) */
+    int iCurrCacheSize; /**< current number of cache entries */
     int iDynaFileCacheSize; /**< size of file handle cache */
     /**
-     * The cache is implemented as an array. An empty element is indicated
-     * by a NULL pointer. Memory is allocated as needed. The following
-     * pointer points to the overall structure.
+     * The cache is a hash table that maps file names to entries. All entries
+     * are also kept in a list ordered by last use, so that the least recently
+     * used one can be evicted without searching.
      */
-    dynaFileCacheEntry **dynCache;
+    struct hashtable *dynCache;
+    dynaFileCacheEntry *pLRUHead; /**< most recently used entry */
+    dynaFileCacheEntry *pLRUTail; /**< least recently used entry, evicted first */
     off_t iSizeLimit; /**< file size limit, 0 = no limit */
     uchar *pszSizeLimitCmd; /**< command to carry out when size limit is reached */
     int iZipLevel; /**< zip mode to use for this selector */
@@ -196,6 +162,7 @@ typedef struct _instanceData {
     short iCloseTimeout; /**< after how many *minutes* shall the file be closed if inactive? */
     sbool bFlushOnTXEnd; /**< flush write buffers when transaction has ended? */
     sbool bUseAsyncWriter; /**< use async stream writer? */
+    sbool bUseUring; /**< write via io_uring (if available)? */
     sbool bVeryRobustZip;
     statsobj_t *stats; /**< dynafile, primarily cache stats */
     STATSCOUNTER_DEF(ctrRequests, mutCtrRequests);
@@ -259,6 +226,7 @@ struct modConfData_s {
     int bDynafileDoNotSuspend;
     strm_compressionDriver_t compressionDriver;
     int compressionDriver_workers;
+    int compressionWorkers; /**< size of the block-parallel compression pool, 0 = off */
 };
 
 static modConfData_t *loadModConf = NULL; /**< modConf ptr to use for the current load process */
@@ -270,6 +238,7 @@ static struct cnfparamdescr modpdescr[] = {
     {"template", eCmdHdlrGetWord, 0},
     {"compression.driver", eCmdHdlrGetWord, 0},
     {"compression.zstd.workers", eCmdHdlrPositiveInt, 0},
+    {"compression.workers", eCmdHdlrNonNegInt, 0},
     {"dircreatemode", eCmdHdlrFileCreateMode, 0},
     {"filecreatemode", eCmdHdlrFileCreateMode, 0},
     {"dirowner", eCmdHdlrUID, 0},
@@ -310,6 +279,7 @@ static struct cnfparamdescr actpdescr[] = {{"dynafilecachesize", eCmdHdlrInt, 0}
                                            {"sig.provider", eCmdHdlrGetWord, 0},
                                            {"cry.provider", eCmdHdlrGetWord, 0},
                                            {"closetimeout", eCmdHdlrPositiveInt, 0},
+                                           {"iouring", eCmdHdlrBinary, 0},
                                            {"rotation.sizelimit", eCmdHdlrSize, 0},
                                            {"rotation.sizelimitcommand", eCmdHdlrString, 0},
                                            {"template", eCmdHdlrGetWord, 0}};
@@ -356,6 +326,7 @@ BEGINdbgPrintInstInfo
 
     dbgprintf("\ttemplate='%s'\n", pData->fname);
     dbgprintf("\tuse async writer=%d\n", pData->bUseAsyncWriter);
+    dbgprintf("\tuse io_uring=%d\n", pData->bUseUring);
     dbgprintf("\tflush on TX end=%d\n", pData->bFlushOnTXEnd);
     dbgprintf("\tflush interval=%d\n", pData->iFlushInterval);
     dbgprintf("\tfile cache size=%d\n", pData->iDynaFileCacheSize);
@@ -490,52 +461,81 @@ finalize_it:
 }
 
 
+/**
+ * @brief Removes an entry from the LRU list of the dynamic file cache.
+ *
+ * @param pData Pointer to the instance data containing the dynamic file cache.
+ * @param pEntry The entry to unlink.
+ */
+static void dynaFileLRUUnlink(instanceData *__restrict__ const pData, dynaFileCacheEntry *const pEntry) {
+    if (pEntry->pLRUPrev == NULL) {
+        pData->pLRUHead = pEntry->pLRUNext;
+    } else {
+        pEntry->pLRUPrev->pLRUNext = pEntry->pLRUNext;
+    }
+    if (pEntry->pLRUNext == NULL) {
+        pData->pLRUTail = pEntry->pLRUPrev;
+    } else {
+        pEntry->pLRUNext->pLRUPrev = pEntry->pLRUPrev;
+    }
+    pEntry->pLRUPrev = pEntry->pLRUNext = NULL;
+}
+
+
+/**
+ * @brief Puts an entry at the head (most recently used end) of the LRU list.
+ *
+ * @param pData Pointer to the instance data containing the dynamic file cache.
+ * @param pEntry The entry to insert, must not currently be in the list.
+ */
+static void dynaFileLRUPushHead(instanceData *__restrict__ const pData, dynaFileCacheEntry *const pEntry) {
+    pEntry->pLRUPrev = NULL;
+    pEntry->pLRUNext = pData->pLRUHead;
+    if (pData->pLRUHead == NULL) {
+        pData->pLRUTail = pEntry;
+    } else {
+        pData->pLRUHead->pLRUPrev = pEntry;
+    }
+    pData->pLRUHead = pEntry;
+}
+
+
 /**
  * @brief Deletes an entry from the dynamic file name cache.
  *
- * This function closes the associated file stream, frees memory for the
- * file name, and optionally frees the cache entry structure itself.
+ * This function removes the entry from the hash table and the LRU list,
+ * closes the associated file stream and frees the entry, including its
+ * file name.
  *
  * @param pData Pointer to the instance data containing the dynamic file cache.
- * @param iEntry The index of the entry to be deleted in the cache array.
- * @param bFreeEntry If 1, the cache entry structure itself is free()ed;
- * if 0, only its contents are freed (e.g., if it's being
- * reused for a new entry).
+ * @param pEntry The entry to be deleted.
  * @return RS_RET_OK on success.
  */
-static rsRetVal dynaFileDelCacheEntry(instanceData *__restrict__ const pData, const int iEntry, const int bFreeEntry) {
-    dynaFileCacheEntry **pCache = pData->dynCache;
+static rsRetVal dynaFileDelCacheEntry(instanceData *__restrict__ const pData, dynaFileCacheEntry *const pEntry) {
     DEFiRet;
-    assert(pCache != NULL);
+    assert(pData->dynCache != NULL);
 
-    if (pCache[iEntry] == NULL) FINALIZE;
+    DBGPRINTF("Removing entry for file '%s' from dynaCache.\n", pEntry->pName);
 
-    DBGPRINTF("Removing entry %d for file '%s' from dynaCache.\n", iEntry,
-              pCache[iEntry]->pName == NULL ? UCHAR_CONSTANT("[OPEN FAILED]") : pCache[iEntry]->pName);
+    /* the hash table owns the key, so this also frees pName */
+    hashtable_remove(pData->dynCache, pEntry->pName);
+    pEntry->pName = NULL;
+    dynaFileLRUUnlink(pData, pEntry);
+    --pData->iCurrCacheSize;
 
-    if (pCache[iEntry]->pName != NULL) {
-        free(pCache[iEntry]->pName);
-        pCache[iEntry]->pName = NULL;
+    if (pEntry == pData->pCurrElt) {
+        pData->pCurrElt = NULL;
+        pData->pStrm = NULL;
     }
-
-    if (pCache[iEntry]->pStrm != NULL) {
-        if (iEntry == pData->iCurrElt) {
-            pData->iCurrElt = -1;
-            pData->pStrm = NULL;
-        }
-        strm.Destruct(&pCache[iEntry]->pStrm);
+    if (pEntry->pStrm != NULL) {
+        strm.Destruct(&pEntry->pStrm);
         if (pData->useSigprov) {
-            pData->sigprov.OnFileClose(pCache[iEntry]->sigprovFileData);
-            pCache[iEntry]->sigprovFileData = NULL;
+            pData->sigprov.OnFileClose(pEntry->sigprovFileData);
+            pEntry->sigprovFileData = NULL;
         }
     }
+    free(pEntry);
 
-    if (bFreeEntry) {
-        free(pCache[iEntry]);
-        pCache[iEntry] = NULL;
-    }
-
-finalize_it:
     RETiRet;
 }
 
@@ -549,14 +549,13 @@ finalize_it:
  * @param pData Pointer to the instance data containing the dynamic file cache.
  */
 static void dynaFileFreeCacheEntries(instanceData *__restrict__ const pData) {
-    register int i;
     assert(pData != NULL);
 
-    for (i = 0; i < pData->iCurrCacheSize; ++i) {
-        dynaFileDelCacheEntry(pData, i, 1);
+    while (pData->pLRUHead != NULL) {
+        dynaFileDelCacheEntry(pData, pData->pLRUHead);
     }
     /* invalidate current element */
-    pData->iCurrElt = -1;
+    pData->pCurrElt = NULL;
     pData->pStrm = NULL;
 }
 
@@ -565,15 +564,39 @@ static void dynaFileFreeCacheEntries(instanceData *__restrict__ const pData) {
  * @brief Frees the dynamic file name cache structure.
  *
  * This function first frees all entries within the cache and then
- * deallocates the cache array itself.
+ * deallocates the hash table itself.
  *
  * @param pData Pointer to the instance data containing the dynamic file cache.
  */
 static void dynaFileFreeCache(instanceData *__restrict__ const pData) {
     assert(pData != NULL);
 
-    dynaFileFreeCacheEntries(pData);
-    if (pData->dynCache != NULL) free(pData->dynCache);
+    if (pData->dynCache != NULL) {
+        dynaFileFreeCacheEntries(pData);
+        hashtable_destroy(pData->dynCache, 0);
+        pData->dynCache = NULL;
+    }
+}
+
+
+/**
+ * @brief Creates the (empty) dynamic file name cache.
+ *
+ * @param pData Pointer to the instance data for the file output action.
+ * @return RS_RET_OK on success, RS_RET_OUT_OF_MEMORY otherwise.
+ */
+static rsRetVal dynaFileCreateCache(instanceData *__restrict__ const pData) {
+    DEFiRet;
+
+    /* values are freed by ourselves, never by the hash table */
+    CHKmalloc(pData->dynCache = create_hashtable(pData->iDynaFileCacheSize < 16 ? 16 : pData->iDynaFileCacheSize,
+                                                 hash_from_string, key_equals_string, NULL));
+    pData->pCurrElt = NULL; /* no current element */
+    pData->pLRUHead = pData->pLRUTail = NULL;
+    pData->iCurrCacheSize = 0;
+
+finalize_it:
+    RETiRet;
 }
 
 
@@ -699,7 +722,9 @@ static rsRetVal prepareFile(instanceData *__restrict__ const pData, const uchar
     CHKiRet(strm.SettOpenMode(pData->pStrm, cs.fCreateMode));
     CHKiRet(strm.SetcompressionDriver(pData->pStrm, runModConf->compressionDriver));
     CHKiRet(strm.SetCompressionWorkers(pData->pStrm, runModConf->compressionDriver_workers));
+    CHKiRet(strm.SetiParCompWorkers(pData->pStrm, runModConf->compressionWorkers));
     CHKiRet(strm.SetbSync(pData->pStrm, pData->bSyncFile));
+    CHKiRet(strm.SetbUseUring(pData->pStrm, pData->bUseUring));
     CHKiRet(strm.SetsType(pData->pStrm, STREAMTYPE_FILE_SINGLE));
     CHKiRet(strm.SetiSizeLimit(pData->pStrm, pData->iSizeLimit));
     if (pData->useCryprov) {
@@ -741,25 +766,17 @@ finalize_it:
  */
 static rsRetVal ATTR_NONNULL()
     prepareDynFile(instanceData *__restrict__ const pData, const uchar *__restrict__ const newFileName) {
-    uint64 ctOldest; /* "timestamp" of oldest element */
-    int iOldest;
-    int i;
-    int iFirstFree;
+    dynaFileCacheEntry *pEntry = NULL;
     rsRetVal localRet;
-    dynaFileCacheEntry **pCache;
     DEFiRet;
 
     assert(pData != NULL);
     assert(newFileName != NULL);
 
-    pCache = pData->dynCache;
-
     /* first check, if we still have the current file */
-    if ((pData->iCurrElt != -1) && !ustrcmp(newFileName, pCache[pData->iCurrElt]->pName)) {
-        /* great, we are all set */
-        pCache[pData->iCurrElt]->clkTickAccessed = getClockFileAccess();
+    if (pData->pCurrElt != NULL && !ustrcmp(newFileName, pData->pCurrElt->pName)) {
+        /* great, we are all set - and the current element is already head of the LRU list */
         STATSCOUNTER_INC(pData->ctrLevel0, pData->mutCtrLevel0);
-        /* LRU needs only a strictly monotonically increasing counter, so such a one could do */
         FINALIZE;
     }
 
@@ -774,31 +791,17 @@ static rsRetVal ATTR_NONNULL()
         CHKiRet(strm.Flush(pData->pStrm));
     }
 
-    /* Now let's search the table if we find a matching spot.
-     * While doing so, we also prepare for creation of a new one.
-     */
-    pData->iCurrElt = -1; /* invalid current element pointer */
-    iFirstFree = -1; /* not yet found */
-    iOldest = 0; /* we assume the first element to be the oldest - that will change as we loop */
-    ctOldest = getClockFileAccess(); /* there must always be an older one */
-    for (i = 0; i < pData->iCurrCacheSize; ++i) {
-        if (pCache[i] == NULL || pCache[i]->pName == NULL) {
-            if (iFirstFree == -1) iFirstFree = i;
-        } else { /* got an element, let's see if it matches */
-            if (!ustrcmp(newFileName, pCache[i]->pName)) {
-                /* we found our element! */
-                pData->pStrm = pCache[i]->pStrm;
-                if (pData->useSigprov) pData->sigprovFileData = pCache[i]->sigprovFileData;
-                pData->iCurrElt = i;
-                pCache[i]->clkTickAccessed = getClockFileAccess(); /* update "timestamp" for LRU */
-                FINALIZE;
-            }
-            /* did not find it - so lets keep track of the counters for LRU */
-            if (pCache[i]->clkTickAccessed < ctOldest) {
-                ctOldest = pCache[i]->clkTickAccessed;
-                iOldest = i;
-            }
-        }
+    /* Now let's look up the file in the cache */
+    pData->pCurrElt = NULL; /* invalid current element pointer */
+    pEntry = (dynaFileCacheEntry *)hashtable_search(pData->dynCache, (void *)newFileName);
+    if (pEntry != NULL) {
+        /* we found our element! */
+        pData->pStrm = pEntry->pStrm;
+        if (pData->useSigprov) pData->sigprovFileData = pEntry->sigprovFileData;
+        pData->pCurrElt = pEntry;
+        dynaFileLRUUnlink(pData, pEntry);
+        dynaFileLRUPushHead(pData, pEntry);
+        FINALIZE;
     }
 
     /* we have not found an entry */
@@ -811,24 +814,16 @@ static rsRetVal ATTR_NONNULL()
      */
     pData->pStrm = NULL, pData->sigprovFileData = NULL;
 
-    if (iFirstFree == -1 && (pData->iCurrCacheSize < pData->iDynaFileCacheSize)) {
-        /* there is space left, so set it to that index */
-        iFirstFree = pData->iCurrCacheSize++;
-        STATSCOUNTER_SETMAX_NOMUT(pData->ctrMax, (unsigned)pData->iCurrCacheSize);
+    if (pData->iCurrCacheSize >= pData->iDynaFileCacheSize) {
+        dynaFileDelCacheEntry(pData, pData->pLRUTail);
+        STATSCOUNTER_INC(pData->ctrEvict, pData->mutCtrEvict);
     }
 
     /* Note that the following code sequence does not work with the cache entry itself,
      * but rather with pData->pStrm, the (sole) stream pointer in the non-dynafile case.
-     * The cache array is only updated after the open was successful. -- rgerhards, 2010-03-21
+     * The cache is only updated after the open was successful. -- rgerhards, 2010-03-21
      */
-    if (iFirstFree == -1) {
-        dynaFileDelCacheEntry(pData, iOldest, 0);
-        STATSCOUNTER_INC(pData->ctrEvict, pData->mutCtrEvict);
-        iFirstFree = iOldest; /* this one *is* now free ;) */
-    } else {
-        /* we need to allocate memory for the cache structure */
-        CHKmalloc(pCache[iFirstFree] = (dynaFileCacheEntry *)calloc(1, sizeof(dynaFileCacheEntry)));
-    }
+    CHKmalloc(pEntry = (dynaFileCacheEntry *)calloc(1, sizeof(dynaFileCacheEntry)));
 
     /* Ok, we finally can open the file */
     localRet = prepareFile(pData, newFileName); /* ignore exact error, we check fd below */
@@ -845,18 +840,26 @@ static rsRetVal ATTR_NONNULL()
         ABORT_FINALIZE(localRet);
     }
 
-    if ((pCache[iFirstFree]->pName = ustrdup(newFileName)) == NULL) {
+    if ((pEntry->pName = ustrdup(newFileName)) == NULL ||
+        !hashtable_insert(pData->dynCache, pEntry->pName, pEntry)) {
+        free(pEntry->pName);
         closeFile(pData); /* need to free failed entry! */
         ABORT_FINALIZE(RS_RET_OUT_OF_MEMORY);
     }
-    pCache[iFirstFree]->pStrm = pData->pStrm;
-    if (pData->useSigprov) pCache[iFirstFree]->sigprovFileData = pData->sigprovFileData;
-    pCache[iFirstFree]->clkTickAccessed = getClockFileAccess();
-    pData->iCurrElt = iFirstFree;
-    DBGPRINTF("Added new entry %d for file cache, file '%s'.\n", iFirstFree, newFileName);
+    pEntry->pStrm = pData->pStrm;
+    if (pData->useSigprov) pEntry->sigprovFileData = pData->sigprovFileData;
+    dynaFileLRUPushHead(pData, pEntry);
+    ++pData->iCurrCacheSize;
+    STATSCOUNTER_SETMAX_NOMUT(pData->ctrMax, (unsigned)pData->iCurrCacheSize);
+    pData->pCurrElt = pEntry;
+    DBGPRINTF("Added new entry to file cache, file '%s', now %d entries.\n", newFileName, pData->iCurrCacheSize);
 
 finalize_it:
-    if (iRet == RS_RET_OK) pCache[pData->iCurrElt]->nInactive = 0;
+    if (iRet == RS_RET_OK) {
+        pData->pCurrElt->nInactive = 0;
+    } else if (pEntry != NULL && pData->pCurrElt != pEntry) {
+        free(pEntry); /* not added to the cache */
+    }
     RETiRet;
 }
 
@@ -991,6 +994,8 @@ BEGINsetModCnf
             }
         } else if (!strcmp(modpblk.descr[i].name, "compression.zstd.workers")) {
             loadModConf->compressionDriver_workers = (int)pvals[i].val.d.n;
+        } else if (!strcmp(modpblk.descr[i].name, "compression.workers")) {
+            loadModConf->compressionWorkers = (int)pvals[i].val.d.n;
         } else if (!strcmp(modpblk.descr[i].name, "dircreatemode")) {
             loadModConf->fDirCreateMode = (int)pvals[i].val.d.n;
         } else if (!strcmp(modpblk.descr[i].name, "filecreatemode")) {
@@ -1034,20 +1039,18 @@ ENDsetModCnf
  * @param pData Pointer to the instance data containing the dynamic file cache.
  */
 static void janitorChkDynaFiles(instanceData *__restrict__ const pData) {
-    int i;
-    dynaFileCacheEntry **pCache = pData->dynCache;
-
-    for (i = 0; i < pData->iCurrCacheSize; ++i) {
-        if (pCache[i] == NULL) continue;
-        DBGPRINTF("omfile janitor: checking dynafile %d:%s, inactive since %d\n", i,
-                  pCache[i]->pName == NULL ? UCHAR_CONSTANT("[OPEN FAILED]") : pCache[i]->pName,
-                  (int)pCache[i]->nInactive);
-        if (pCache[i]->nInactive >= pData->iCloseTimeout) {
+    dynaFileCacheEntry *pEntry;
+    dynaFileCacheEntry *pNext;
+
+    for (pEntry = pData->pLRUHead; pEntry != NULL; pEntry = pNext) {
+        pNext = pEntry->pLRUNext; /* pEntry may be deleted */
+        DBGPRINTF("omfile janitor: checking dynafile %s, inactive since %d\n", pEntry->pName,
+                  (int)pEntry->nInactive);
+        if (pEntry->nInactive >= pData->iCloseTimeout) {
             STATSCOUNTER_INC(pData->ctrCloseTimeouts, pData->mutCtrCloseTimeouts);
-            dynaFileDelCacheEntry(pData, i, 1);
-            if (pData->iCurrElt == i) pData->iCurrElt = -1; /* no longer available! */
+            dynaFileDelCacheEntry(pData, pEntry); /* also resets the current element */
         } else {
-            pCache[i]->nInactive += runModConf->pConf->globals.janitorInterval;
+            pEntry->nInactive += runModConf->pConf->globals.janitorInterval;
         }
     }
 }
@@ -1221,6 +1224,7 @@ static void setInstParamDefaults(instanceData *__restrict__ const pData) {
     pData->iIOBufSize = IOBUF_DFLT_SIZE;
     pData->iFlushInterval = FLUSH_INTRVL_DFLT;
     pData->bUseAsyncWriter = USE_ASYNCWRITER_DFLT;
+    pData->bUseUring = 0;
     pData->sigprovName = NULL;
     pData->cryprovName = NULL;
     pData->useSigprov = 0;
@@ -1467,6 +1471,8 @@ BEGINnewActInst
             pData->cryprovName = (uchar *)es_str2cstr(pvals[i].val.d.estr, NULL);
         } else if (!strcmp(actpblk.descr[i].name, "closetimeout")) {
             pData->iCloseTimeout = (int)pvals[i].val.d.n;
+        } else if (!strcmp(actpblk.descr[i].name, "iouring")) {
+            pData->bUseUring = (sbool)pvals[i].val.d.n;
         } else if (!strcmp(actpblk.descr[i].name, "rotation.sizelimit")) {
             pData->iSizeLimit = (int)pvals[i].val.d.n;
         } else if (!strcmp(actpblk.descr[i].name, "rotation.sizelimitcommand")) {
@@ -1524,9 +1530,7 @@ BEGINnewActInst
         pData->iNumTpls = 2;
         // TODO: create unified code for this (legacy+v6 system)
         /* we now allocate the cache table */
-        CHKmalloc(pData->dynCache =
-                      (dynaFileCacheEntry **)calloc(pData->iDynaFileCacheSize, sizeof(dynaFileCacheEntry *)));
-        pData->iCurrElt = -1; /* no current element */
+        CHKiRet(dynaFileCreateCache(pData));
     }
     // TODO: add	pData->iSizeLimit = 0; /* default value, use outchannels to configure! */
     setupInstStatsCtrs(pData);
@@ -1591,14 +1595,13 @@ BEGINparseSelectorAct
             CHKiRet(cflineParseFileName(p, fname, *ppOMSR, 0, OMSR_NO_RQD_TPL_OPTS, getDfltTpl()));
             pData->fname = ustrdup(fname);
             pData->bDynamicName = 1;
-            pData->iCurrElt = -1; /* no current element */
             /* "filename" is actually a template name, we need this as string 1. So let's add it
              * to the pOMSR. -- rgerhards, 2007-07-27
              */
             CHKiRet(OMSRsetEntry(*ppOMSR, 1, ustrdup(pData->fname), OMSR_NO_RQD_TPL_OPTS));
             /* we now allocate the cache table */
-            CHKmalloc(pData->dynCache =
-                          (dynaFileCacheEntry **)calloc(cs.iDynaFileCacheSize, sizeof(dynaFileCacheEntry *)));
+            pData->iDynaFileCacheSize = cs.iDynaFileCacheSize;
+            CHKiRet(dynaFileCreateCache(pData));
             break;
 
         case '/':
@@ -1684,7 +1687,6 @@ BEGINmodExit
     CODESTARTmodExit;
     objRelease(strm, CORE_COMPONENT);
     objRelease(statsobj, CORE_COMPONENT);
-    DESTROY_ATOMIC_HELPER_MUT(mutClock);
 ENDmodExit
 
 
@@ -1706,8 +1708,6 @@ BEGINmodInit(File)
     CHKiRet(objUse(strm, CORE_COMPONENT));
     CHKiRet(objUse(statsobj, CORE_COMPONENT));
 
-    INIT_ATOMIC_HELPER_MUT(mutClock);
-
     INITChkCoreFeature(bCoreSupportsBatching, CORE_FEATURE_BATCHING);
     DBGPRINTF("omfile: %susing transactional output interface.\n", bCoreSupportsBatching ? "" : "not ");
     CHKiRet(omsdRegCFSLineHdlr((uchar *)"dynafilecachesize", 0, eCmdHdlrInt, setDynaFileCacheSize, NULL,
@@ -0,0 +1,433 @@
+/* This is a tool for precompiling rsyslog lookup tables.
+ *
+ * It reads a lookup table in the regular JSON format and writes it as a
+ * binary image (see runtime/lookup_bin.h), which rsyslogd maps into memory
+ * instead of parsing it. The image is written to a temporary file that is
+ * then renamed to the output name, so a running rsyslogd reloading the
+ * table always sees either the old or the new image, never a partial one.
+ *
+ * Copyright 2025 Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of rsyslog.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifdef HAVE_CONFIG_H
+    #include "config.h"
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <json.h>
+#include "lookup_bin.h"
+
+/* a table row while compiling */
+typedef struct row_s {
+    const char *key; /* string tables */
+    uint64_t keyOff; /* offset of the key in the string pool */
+    uint32_t ukey; /* array and sparseArray tables */
+    uint64_t valOff; /* offset of the value in the string pool */
+    uint32_t idx; /* position in the JSON table, keeps the first of duplicate keys */
+} row_t;
+
+/* string pool with value interning */
+typedef struct pool_s {
+    char *buf;
+    uint64_t len;
+    uint64_t size;
+    uint64_t *slots; /* interned value offsets + 1, 0 means empty */
+    uint32_t slotMask;
+} pool_t;
+
+static int verbose = 0;
+static int bNoCase = 0;
+
+
+static int poolInit(pool_t *const pool, const uint32_t nvals) {
+    uint32_t nSlots = 16;
+
+    while (nSlots < nvals * 2) nSlots *= 2;
+    memset(pool, 0, sizeof(*pool));
+    pool->size = 4096;
+    if ((pool->buf = malloc(pool->size)) == NULL || (pool->slots = calloc(nSlots, sizeof(uint64_t))) == NULL) {
+        fprintf(stderr, "rslookupc: out of memory\n");
+        return 1;
+    }
+    pool->slotMask = nSlots - 1;
+    pool->buf[0] = '\0'; /* offset 0 is the empty string */
+    pool->len = 1;
+    return 0;
+}
+
+/* append a string to the pool, returns its offset or 0 on error */
+static uint64_t poolAppend(pool_t *const pool, const char *const str) {
+    const size_t len = strlen(str) + 1;
+    uint64_t off;
+    char *newbuf;
+
+    while (pool->len + len > pool->size) {
+        if ((newbuf = realloc(pool->buf, pool->size * 2)) == NULL) {
+            fprintf(stderr, "rslookupc: out of memory\n");
+            return 0;
+        }
+        pool->buf = newbuf;
+        pool->size *= 2;
+    }
+    off = pool->len;
+    memcpy(pool->buf + off, str, len);
+    pool->len += len;
+    return off;
+}
+
+/* add a value to the pool, values that occur multiple times are stored once */
+static uint64_t poolIntern(pool_t *const pool, const char *const str) {
+    uint64_t off;
+    uint32_t i;
+
+    for (i = lookupStrHash((const unsigned char *)str, 0) & pool->slotMask; pool->slots[i] != 0;
+         i = (i + 1) & pool->slotMask) {
+        if (strcmp(pool->buf + pool->slots[i] - 1, str) == 0) return pool->slots[i] - 1;
+    }
+    if ((off = poolAppend(pool, str)) != 0) pool->slots[i] = off + 1;
+    return off;
+}
+
+
+static int cmpStrRows(const void *r1, const void *r2) {
+    const row_t *const a = r1;
+    const row_t *const b = r2;
+    const int c = bNoCase ? strcasecmp(a->key, b->key) : strcmp(a->key, b->key);
+    if (c != 0) return c;
+    return (a->idx > b->idx) - (a->idx < b->idx);
+}
+
+static int cmpUintRows(const void *r1, const void *r2) {
+    const row_t *const a = r1;
+    const row_t *const b = r2;
+    if (a->ukey != b->ukey) return (a->ukey > b->ukey) - (a->ukey < b->ukey);
+    return (a->idx > b->idx) - (a->idx < b->idx);
+}
+
+/* sort the rows and drop duplicate keys; the first one in the JSON table wins */
+static uint32_t sortRows(row_t *const rows, const uint32_t nrows, const int bString) {
+    uint32_t i, n;
+
+    qsort(rows, nrows, sizeof(row_t), bString ? cmpStrRows : cmpUintRows);
+    for (i = 1, n = (nrows > 0); i < nrows; ++i) {
+        const int dup = bString ? ((bNoCase ? strcasecmp : strcmp)(rows[i].key, rows[n - 1].key) == 0)
+                                : rows[i].ukey == rows[n - 1].ukey;
+        if (dup) {
+            if (bString)
+                fprintf(stderr, "rslookupc: warning: duplicate key '%s', using first occurrence\n", rows[i].key);
+            else
+                fprintf(stderr, "rslookupc: warning: duplicate index %u, using first occurrence\n", rows[i].ukey);
+        } else {
+            rows[n++] = rows[i];
+        }
+    }
+    return n;
+}
+
+
+static int writeAll(const int fd, const void *const buf, size_t len) {
+    const char *p = buf;
+    ssize_t w;
+
+    while (len > 0) {
+        if ((w = write(fd, p, len)) == -1) {
+            if (errno == EINTR) continue;
+            return 1;
+        }
+        p += w;
+        len -= w;
+    }
+    return 0;
+}
+
+/* write the image to a temporary file and rename it to its final name */
+static int writeImage(const char *const outfile,
+                      lookup_bin_hdr_t *const hdr,
+                      const row_t *const rows,
+                      const pool_t *const pool) {
+    const int bString = (hdr->type == LOOKUP_BIN_TYPE_STRING);
+    const size_t entrySize = bString ? sizeof(lookup_bin_str_entry_t) : sizeof(lookup_bin_uint_entry_t);
+    void *entries = NULL;
+    lookup_bin_hslot_t *slots = NULL;
+    uint64_t poolOff;
+    char *tmpname = NULL;
+    int fd = -1;
+    uint32_t i, s;
+    int r = 1;
+
+    if (bString) {
+        hdr->nSlots = 2;
+        while (hdr->nSlots < hdr->nmemb + hdr->nmemb / 2 + 1) hdr->nSlots *= 2;
+    }
+    hdr->entriesOff = sizeof(lookup_bin_hdr_t);
+    hdr->slotsOff = hdr->entriesOff + (uint64_t)hdr->nmemb * entrySize;
+    poolOff = hdr->slotsOff + (uint64_t)hdr->nSlots * sizeof(lookup_bin_hslot_t);
+    hdr->fileSize = poolOff + pool->len;
+    if (hdr->nomatchOff != 0) hdr->nomatchOff += poolOff;
+
+    if ((entries = calloc(hdr->nmemb + 1, entrySize)) == NULL ||
+        (slots = calloc(hdr->nSlots + 1, sizeof(lookup_bin_hslot_t))) == NULL) {
+        fprintf(stderr, "rslookupc: out of memory\n");
+        goto done;
+    }
+    for (i = 0; i < hdr->nmemb; ++i) {
+        if (bString) {
+            lookup_bin_str_entry_t *const e = (lookup_bin_str_entry_t *)entries + i;
+            const uint32_t h = lookupStrHash((const unsigned char *)rows[i].key, bNoCase);
+            e->keyOff = poolOff + rows[i].keyOff;
+            e->valOff = poolOff + rows[i].valOff;
+            for (s = h & (hdr->nSlots - 1); slots[s].entry != 0; s = (s + 1) & (hdr->nSlots - 1))
+                ;
+            slots[s].hash = h;
+            slots[s].entry = i + 1;
+        } else {
+            lookup_bin_uint_entry_t *const e = (lookup_bin_uint_entry_t *)entries + i;
+            e->key = rows[i].ukey;
+            e->valOff = poolOff + rows[i].valOff;
+        }
+    }
+
+    if ((tmpname = malloc(strlen(outfile) + sizeof(".XXXXXX"))) == NULL) {
+        fprintf(stderr, "rslookupc: out of memory\n");
+        goto done;
+    }
+    strcpy(tmpname, outfile);
+    strcat(tmpname, ".XXXXXX");
+    if ((fd = mkstemp(tmpname)) == -1) {
+        perror(tmpname);
+        free(tmpname);
+        tmpname = NULL;
+        goto done;
+    }
+    if (writeAll(fd, hdr, sizeof(*hdr)) || writeAll(fd, entries, hdr->nmemb * entrySize) ||
+        writeAll(fd, slots, hdr->nSlots * sizeof(lookup_bin_hslot_t)) || writeAll(fd, pool->buf, pool->len) ||
+        fchmod(fd, 0644) != 0 || fsync(fd) != 0) {
+        perror(tmpname);
+        goto done;
+    }
+    if (close(fd) != 0) {
+        fd = -1;
+        perror(tmpname);
+        goto done;
+    }
+    fd = -1;
+    if (rename(tmpname, outfile) != 0) {
+        perror(outfile);
+        goto done;
+    }
+    if (verbose)
+        fprintf(stderr, "rslookupc: wrote '%s': %u entries, %llu bytes\n", outfile, hdr->nmemb,
+                (unsigned long long)hdr->fileSize);
+    r = 0;
+
+done:
+    if (fd != -1) close(fd);
+    if (r != 0 && tmpname != NULL) unlink(tmpname);
+    free(tmpname);
+    free(slots);
+    free(entries);
+    return r;
+}
+
+
+static struct json_object *readJSON(const char *const infile) {
+    struct json_tokener *tokener = NULL;
+    struct json_object *json = NULL;
+    char *iobuf = NULL;
+    struct stat sb;
+    int fd;
+
+    if ((fd = open(infile, O_RDONLY)) == -1 || fstat(fd, &sb) == -1) {
+        perror(infile);
+        goto done;
+    }
+    if ((iobuf = malloc(sb.st_size + 1)) == NULL || (tokener = json_tokener_new()) == NULL) {
+        fprintf(stderr, "rslookupc: out of memory\n");
+        goto done;
+    }
+    if (read(fd, iobuf, sb.st_size) != (ssize_t)sb.st_size) {
+        perror(infile);
+        goto done;
+    }
+    if ((json = json_tokener_parse_ex(tokener, iobuf, sb.st_size)) == NULL) {
+        fprintf(stderr, "rslookupc: '%s': json parsing error\n", infile);
+    }
+
+done:
+    if (fd != -1) close(fd);
+    if (tokener != NULL) json_tokener_free(tokener);
+    free(iobuf);
+    return json;
+}
+
+
+static int compile(const char *const infile, const char *const outfile) {
+    struct json_object *json, *jversion, *jtype, *jnomatch, *jnocase, *jtab, *jrow, *jkey, *jvalue;
+    const char *type;
+    lookup_bin_hdr_t hdr;
+    row_t *rows = NULL;
+    pool_t pool;
+    uint32_t i, nrows;
+    int bString;
+    int r = 1;
+
+    memset(&pool, 0, sizeof(pool));
+    if ((json = readJSON(infile)) == NULL) return 1;
+
+    fjson_object_object_get_ex(json, "version", &jversion);
+    fjson_object_object_get_ex(json, "type", &jtype);
+    fjson_object_object_get_ex(json, "nomatch", &jnomatch);
+    fjson_object_object_get_ex(json, "nocase", &jnocase);
+    fjson_object_object_get_ex(json, "table", &jtab);
+    if (jversion != NULL && json_object_get_int(jversion) != 1) {
+        fprintf(stderr, "rslookupc: '%s': unsupported version %d\n", infile, json_object_get_int(jversion));
+        goto done;
+    }
+    if (jtab == NULL || !json_object_is_type(jtab, json_type_array)) {
+        fprintf(stderr, "rslookupc: '%s': invalid table definition\n", infile);
+        goto done;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, LOOKUP_BIN_MAGIC, LOOKUP_BIN_MAGIC_LEN);
+    hdr.version = LOOKUP_BIN_VERSION;
+    hdr.byteOrder = LOOKUP_BIN_BYTEORDER;
+    type = (jtype == NULL) ? "string" : json_object_get_string(jtype);
+    if (type != NULL && strcmp(type, "string") == 0) {
+        hdr.type = LOOKUP_BIN_TYPE_STRING;
+    } else if (type != NULL && strcmp(type, "array") == 0) {
+        hdr.type = LOOKUP_BIN_TYPE_ARRAY;
+    } else if (type != NULL && strcmp(type, "sparseArray") == 0) {
+        hdr.type = LOOKUP_BIN_TYPE_SPARSE_ARRAY;
+    } else {
+        fprintf(stderr, "rslookupc: '%s': table type '%s' cannot be precompiled\n", infile,
+                type == NULL ? "(null)" : type);
+        goto done;
+    }
+    bString = (hdr.type == LOOKUP_BIN_TYPE_STRING);
+    bNoCase = bString && jnocase != NULL && json_object_get_boolean(jnocase);
+    if (bNoCase) hdr.flags |= LOOKUP_BIN_FLAG_NOCASE;
+
+    nrows = json_object_array_length(jtab);
+    if (poolInit(&pool, 2 * nrows + 1) != 0 || (rows = calloc(nrows + 1, sizeof(row_t))) == NULL) {
+        fprintf(stderr, "rslookupc: out of memory\n");
+        goto done;
+    }
+    if (jnomatch != NULL && json_object_get_string(jnomatch) != NULL) {
+        if ((hdr.nomatchOff = poolIntern(&pool, json_object_get_string(jnomatch))) == 0) goto done;
+    }
+    for (i = 0; i < nrows; ++i) {
+        jrow = json_object_array_get_idx(jtab, i);
+        fjson_object_object_get_ex(jrow, "index", &jkey);
+        fjson_object_object_get_ex(jrow, "value", &jvalue);
+        if (jkey == NULL || json_object_is_type(jkey, json_type_null) || jvalue == NULL ||
+            json_object_is_type(jvalue, json_type_null)) {
+            fprintf(stderr, "rslookupc: '%s': record %u lacks 'index' or 'value' field\n", infile, i);
+            goto done;
+        }
+        rows[i].idx = i;
+        if (bString) {
+            rows[i].key = json_object_get_string(jkey);
+        } else {
+            rows[i].ukey = (uint32_t)json_object_get_int(jkey);
+        }
+        if ((rows[i].valOff = poolIntern(&pool, json_object_get_string(jvalue))) == 0) goto done;
+    }
+
+    hdr.nmemb = sortRows(rows, nrows, bString);
+    if (hdr.type == LOOKUP_BIN_TYPE_ARRAY) {
+        for (i = 1; i < hdr.nmemb; ++i) {
+            if (rows[i].ukey != rows[i - 1].ukey + 1) {
+                fprintf(stderr, "rslookupc: '%s': 'array' table has non-contiguous members between index %u and %u\n",
+                        infile, rows[i - 1].ukey, rows[i].ukey);
+                goto done;
+            }
+        }
+    }
+    if (bString) {
+        /* keys are stored in sorted order, so neighbours share pages */
+        for (i = 0; i < hdr.nmemb; ++i) {
+            if ((rows[i].keyOff = poolAppend(&pool, rows[i].key)) == 0) goto done;
+        }
+    }
+
+    r = writeImage(outfile, &hdr, rows, &pool);
+
+done:
+    free(rows);
+    free(pool.buf);
+    free(pool.slots);
+    json_object_put(json);
+    return r;
+}
+
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: rslookupc [-v] -o <image> <table.json>\n"
+            "compile a JSON lookup table into a binary image for rsyslogd\n");
+}
+
+
+static struct option long_options[] = {{"output", required_argument, NULL, 'o'},
+                                       {"verbose", no_argument, NULL, 'v'},
+                                       {"version", no_argument, NULL, 'V'},
+                                       {"help", no_argument, NULL, 'h'},
+                                       {NULL, 0, NULL, 0}};
+static const char *short_options = "o:vVh";
+
+int main(int argc, char *argv[]) {
+    const char *outfile = NULL;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, short_options, long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'o':
+                outfile = optarg;
+                break;
+            case 'v':
+                verbose = 1;
+                break;
+            case 'V':
+                fprintf(stderr, "rslookupc " VERSION "\n");
+                exit(0);
+                break;
+            case 'h':
+                usage();
+                exit(0);
+                break;
+            default:
+                usage();
+                exit(1);
+        }
+    }
+    if (outfile == NULL || optind != argc - 1) {
+        usage();
+        exit(1);
+    }
+    return compile(argv[optind], outfile);
+}
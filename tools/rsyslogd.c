@@ -2177,6 +2177,7 @@ static void deinitAll(void) {
      */
     DBGPRINTF("Terminating outputs...\n");
     rsyslogd_destructAllActions();
+    dnscacheStopResolvers(); /* resolver threads use runConf */
 
     DBGPRINTF("all primary multi-thread sources have been terminated - now doing aux cleanup...\n");
 